@@ -188,6 +188,7 @@ CONSTANT(int, Xapian, DB_BACKEND_HONEY);
 CONSTANT(int, Xapian, DB_BACKEND_INMEMORY);
 CONSTANT(int, Xapian, DB_BACKEND_STUB);
 CONSTANT(int, Xapian, DB_RETRY_LOCK);
+CONSTANT(int, Xapian, DB_SPELLING_DELETES);
 CONSTANT(int, Xapian, DBCHECK_SHORT_TREE);
 CONSTANT(int, Xapian, DBCHECK_FULL_TREE);
 CONSTANT(int, Xapian, DBCHECK_SHOW_FREELIST);
@@ -324,6 +325,15 @@ SUBCLASSABLE(Xapian, MatchDecider)
 %include <xapian/matchdecider.h>
 
 STANDARD_IGNORES(Xapian, Enquire)
+/* FIXME: Wrap Xapian::Reranker - the weights are returned via a non-const
+ * std::vector<double>& parameter, which needs typemaps for directors.
+ */
+%ignore Xapian::Enquire::set_reranker;
+/* FIXME: Wrap get_mset_async() - it takes std::function parameters and calls
+ * them from other threads, which needs care with each language's threading
+ * model.
+ */
+%ignore Xapian::Enquire::get_mset_async;
 
 #ifdef XAPIAN_TERMITERATOR_PAIR_OUTPUT_TYPEMAP
 /* Instantiating the template we're going to use avoids SWIG wrapping uses
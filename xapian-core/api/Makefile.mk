@@ -9,6 +9,7 @@ noinst_HEADERS +=\
 	api/queryinternal.h\
 	api/queryvector.h\
 	api/replication.h\
+	api/rerankerinternal.h\
 	api/roundestimate.h\
 	api/rsetinternal.h\
 	api/smallvector.h\
@@ -31,6 +32,7 @@ lib_src +=\
 	api/enquire.cc\
 	api/error.cc\
 	api/expanddecider.cc\
+	api/indexingpipeline.cc\
 	api/keymaker.cc\
 	api/matchspy.cc\
 	api/mset.cc\
@@ -42,6 +44,7 @@ lib_src +=\
 	api/query.cc\
 	api/queryinternal.cc\
 	api/registry.cc\
+	api/reranker.cc\
 	api/rset.cc\
 	api/smallvector.cc\
 	api/sortable-serialise.cc\
@@ -163,6 +163,7 @@ Database::compact_(const string * output_ptr, int fd, unsigned flags,
 
     if (n_shards > 1) {
 	auto multi_db = static_cast<MultiDatabase*>(internal.get());
+	multi_db->sync_writers();
 	for (auto&& db : multi_db->shards) {
 	    internals.push_back(db);
 	}
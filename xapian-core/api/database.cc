@@ -181,6 +181,7 @@ Database::add_database_(const Database& o, bool read_only)
     } else {
 	// Must be a MultiDatabase.
 	auto o_multi = static_cast<MultiDatabase*>(o.internal.get());
+	o_multi->sync_writers();
 	// Add the shards from o to ourself.
 	for (auto&& shard : o_multi->shards) {
 	    multi_db->push_back(shard);
@@ -364,6 +365,42 @@ Database::get_wdfdocmax(Xapian::docid did) const
     return internal->get_wdfdocmax(did);
 }
 
+/// Check @a dids is suitable to pass to a batch lookup method.
+static void
+check_docid_batch(const vector<Xapian::docid>& dids)
+{
+    Xapian::docid prev = 0;
+    for (Xapian::docid did : dids) {
+	if (did == 0)
+	    docid_zero_invalid();
+	if (rare(did < prev))
+	    throw InvalidArgumentError("Document ids must be in ascending order");
+	prev = did;
+    }
+}
+
+vector<Xapian::termcount>
+Database::get_doclength(const vector<Xapian::docid>& dids) const
+{
+    check_docid_batch(dids);
+    return internal->get_doclengths(dids);
+}
+
+vector<Xapian::termcount>
+Database::get_unique_terms(const vector<Xapian::docid>& dids) const
+{
+    check_docid_batch(dids);
+    return internal->get_unique_terms_counts(dids);
+}
+
+vector<string>
+Database::get_values(const vector<Xapian::docid>& dids,
+		     Xapian::valueno slot) const
+{
+    check_docid_batch(dids);
+    return internal->get_values(dids, slot);
+}
+
 Document
 Database::get_document(Xapian::docid did, unsigned flags) const
 {
@@ -407,9 +444,16 @@ Database::get_spelling_suggestion(const string& word,
     if (word.size() <= 1)
 	return string();
 
-    unique_ptr<TermList> merger(internal->open_spelling_termlist(word));
-    if (!merger.get())
-	return string();
+    // If the database has a symmetric delete index, it gives us exactly the
+    // words within range, so we don't need to filter by trigram score.
+    unique_ptr<TermList> merger(
+	internal->open_spelling_deletes_termlist(word, max_edit_distance));
+    bool use_trigrams = !merger.get();
+    if (use_trigrams) {
+	merger.reset(internal->open_spelling_termlist(word));
+	if (!merger.get())
+	    return string();
+    }
 
     EditDistanceCalculator edcalc(word);
     Xapian::termcount best = 1;
@@ -428,7 +472,7 @@ Database::get_spelling_suggestion(const string& word,
 
 	LOGVALUE(SPELLING, term);
 	LOGVALUE(SPELLING, score);
-	if (score + TRIGRAM_SCORE_THRESHOLD >= best) {
+	if (!use_trigrams || score + TRIGRAM_SCORE_THRESHOLD >= best) {
 	    if (score > best) best = score;
 
 	    int edist = edcalc(term, edist_best);
@@ -517,6 +561,12 @@ Database::unlock() {
     return Xapian::Database(internal->update_lock(Xapian::DB_READONLY_));
 }
 
+Xapian::Database
+Database::clone() const
+{
+    return Xapian::Database(internal->clone());
+}
+
 Xapian::rev
 Database::get_revision() const
 {
@@ -590,6 +640,46 @@ WritableDatabase::replace_document(const string& term, const Document& doc)
     return internal->replace_document(term, doc);
 }
 
+vector<Xapian::docid>
+WritableDatabase::replace_documents(const vector<string>& terms,
+				    const vector<Document>& docs)
+{
+    if (rare(terms.size() != docs.size())) {
+	throw InvalidArgumentError("replace_documents() needs one document "
+				   "for each unique term");
+    }
+    for (const string& term : terms) {
+	if (term.empty())
+	    empty_term_invalid();
+    }
+
+    // Apply the changes in ascending order of term, keeping the given order
+    // for repeated terms.
+    vector<size_t> order(terms.size());
+    for (size_t i = 0; i != order.size(); ++i) {
+	order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(),
+		[&terms](size_t a, size_t b) { return terms[a] < terms[b]; });
+
+    vector<Xapian::docid> dids(terms.size());
+    for (size_t i : order) {
+	dids[i] = internal->replace_document(terms[i], docs[i]);
+    }
+    return dids;
+}
+
+void
+WritableDatabase::set_document_value(Xapian::docid did,
+				     Xapian::valueno slot,
+				     const string& value)
+{
+    if (rare(did == 0))
+	docid_zero_invalid();
+
+    internal->set_document_value(did, slot, value);
+}
+
 void
 WritableDatabase::add_spelling(const string& word,
 			       Xapian::termcount freqinc) const
@@ -228,3 +228,136 @@ EditDistanceCalculator::calc(const unsigned* ptr, int len,
     return seqcmp_editdist<unsigned>(ptr, len, &target[0], target.size(),
 				     array, max_distance);
 }
+
+EditDistanceAutomaton::EditDistanceAutomaton(const string& target_,
+					     unsigned max_distance_)
+    : max_distance(max_distance_)
+{
+    target.assign(Xapian::Utf8Iterator(target_), Xapian::Utf8Iterator());
+    target_chars = target;
+    sort(target_chars.begin(), target_chars.end());
+    target_chars.erase(unique(target_chars.begin(), target_chars.end()),
+		       target_chars.end());
+}
+
+unsigned
+EditDistanceAutomaton::step(size_t len, unsigned ch, unsigned* out) const
+{
+    const size_t width = target.size() + 1;
+    const unsigned cap = max_distance + 1;
+    const unsigned* prev = &rows[len * width];
+    const unsigned* prev2 = len ? prev - width : nullptr;
+    unsigned min_entry = out[0] = min(unsigned(len + 1), cap);
+    for (size_t j = 1; j != width; ++j) {
+	unsigned d = prev[j - 1] + (target[j - 1] != ch);
+	d = min(d, prev[j] + 1);
+	d = min(d, out[j - 1] + 1);
+	if (prev2 && j >= 2 &&
+	    ch == target[j - 2] && utf32[len - 1] == target[j - 1]) {
+	    // Transposition.
+	    d = min(d, prev2[j - 2] + 1);
+	}
+	out[j] = min(d, cap);
+	min_entry = min(min_entry, out[j]);
+    }
+    return min_entry;
+}
+
+EditDistanceAutomaton::result
+EditDistanceAutomaton::test(const string& candidate, string& next)
+{
+    const size_t width = target.size() + 1;
+    utf32.clear();
+    offsets.clear();
+    bool valid_utf8 = true;
+    for (Xapian::Utf8Iterator it(candidate); it != Xapian::Utf8Iterator(); ) {
+	const char* start = it.raw();
+	unsigned ch = *it;
+	offsets.push_back(start - candidate.data());
+	utf32.push_back(ch);
+	++it;
+	// Invalid UTF-8 is decoded one byte at a time as ISO-8859-1, so a
+	// character whose encoding is a different length must have come from
+	// invalid UTF-8.
+	char buf[4];
+	if (size_t(it.raw() - start) != Xapian::Unicode::to_utf8(ch, buf))
+	    valid_utf8 = false;
+    }
+    offsets.push_back(candidate.size());
+
+    rows.resize(width * (utf32.size() + 1));
+    for (size_t j = 0; j != width; ++j) {
+	rows[j] = min(unsigned(j), max_distance + 1);
+    }
+
+    size_t len;
+    for (len = 0; len != utf32.size(); ++len) {
+	if (step(len, utf32[len], &rows[(len + 1) * width]) > max_distance)
+	    break;
+    }
+
+    if (len == utf32.size()) {
+	if (rows[len * width + target.size()] <= max_distance)
+	    return MATCH;
+	// Any extension of the candidate might still match, and those sort
+	// immediately after it.
+	return NO_MATCH;
+    }
+
+    // With invalid UTF-8, strings sharing a prefix of bytes with the
+    // candidate may decode differently, so we can't safely skip anything.
+    if (!valid_utf8)
+	return NO_MATCH;
+
+    // The prefix of length len is live, but no extension of it with
+    // utf32[len] is.  Look for the smallest character greater than the
+    // candidate's which keeps the prefix live, backing off to shorter
+    // prefixes if there isn't one.
+    //
+    // Any character not in the target gives the same row, and it's never
+    // better than the row for a character in the target, so we only need to
+    // check that row and the rows for characters in the target.
+    const unsigned not_in_target = unsigned(-1);
+    vector<unsigned> row(width);
+    do {
+	unsigned ch = utf32[len];
+	if (ch >= 0x80) {
+	    // Strings which differ from the candidate in a non-ASCII character
+	    // might contain invalid UTF-8 which doesn't sort in code point
+	    // order, so just skip past the strings starting with this prefix,
+	    // which we know can't match.
+	    next.assign(candidate, 0, offsets[len + 1]);
+	    while (!next.empty() && next.back() == '\xff')
+		next.resize(next.size() - 1);
+	    if (next.empty())
+		return END;
+	    next.back() = char(static_cast<unsigned char>(next.back()) + 1);
+	    return SKIP_TO;
+	}
+
+	unsigned new_ch = 0;
+	if (step(len, not_in_target, &row[0]) <= max_distance) {
+	    new_ch = ch + 1;
+	} else {
+	    auto i = upper_bound(target_chars.begin(), target_chars.end(), ch);
+	    for ( ; i != target_chars.end(); ++i) {
+		if (step(len, *i, &row[0]) <= max_distance) {
+		    new_ch = *i;
+		    break;
+		}
+	    }
+	}
+
+	if (new_ch) {
+	    next.assign(candidate, 0, offsets[len]);
+	    // Strings between the candidate and the one we return start with
+	    // an ASCII character less than new_ch after the prefix.  If
+	    // new_ch isn't ASCII, we skip to the first non-ASCII byte rather
+	    // than to the encoded character to avoid skipping invalid UTF-8.
+	    next += char(min(new_ch, 0x80u));
+	    return SKIP_TO;
+	}
+    } while (len-- != 0);
+
+    return END;
+}
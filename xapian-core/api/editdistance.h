@@ -24,6 +24,7 @@
 
 #include <cstdlib>
 #include <climits>
+#include <string>
 #include <vector>
 
 #include "omassert.h"
@@ -135,7 +136,7 @@ class EditDistanceCalculator {
 	    // Candidate too short.
 	    return INT_MAX;
 	}
-	if (target.size() + max_distance < candidate.size() * 3 / 4) {
+	if (target.size() + max_distance < (candidate.size() + 3) / 4) {
 	    // Candidate too long.
 	    return INT_MAX;
 	}
@@ -154,4 +155,84 @@ class EditDistanceCalculator {
     }
 };
 
+/** Levenshtein automaton for intersecting with a sorted list of strings.
+ *
+ *  This simulates an automaton which accepts strings within a given edit
+ *  distance of a target, using the same edit operations as
+ *  EditDistanceCalculator.  The state after each character of a candidate is
+ *  a row of the dynamic programming matrix, with entries capped at one more
+ *  than the maximum distance.
+ *
+ *  Once no extension of a prefix of the candidate can be accepted, the
+ *  automaton works out the smallest string greater than the candidate which
+ *  could be, so a caller walking a sorted list of terms can skip_to() that
+ *  string instead of testing every term in between.
+ */
+class EditDistanceAutomaton {
+    /// Don't allow assignment.
+    EditDistanceAutomaton& operator=(const EditDistanceAutomaton&) = delete;
+
+    /// Don't allow copying.
+    EditDistanceAutomaton(const EditDistanceAutomaton&) = delete;
+
+    /// Target in UTF-32.
+    std::vector<unsigned> target;
+
+    /// The distinct characters in target, in ascending order.
+    std::vector<unsigned> target_chars;
+
+    /// Maximum edit distance to accept.
+    unsigned max_distance;
+
+    /// Current candidate in UTF-32.
+    std::vector<unsigned> utf32;
+
+    /// Byte offset of the start of each character of the current candidate.
+    std::vector<size_t> offsets;
+
+    /// The row for each prefix of the current candidate, concatenated.
+    std::vector<unsigned> rows;
+
+    /** Calculate the row after appending a character to a prefix.
+     *
+     *  @param len	Length of the prefix of the current candidate.
+     *  @param ch	Character to append.
+     *  @param out	Where to write the new row.
+     *
+     *  @return The smallest entry in the new row.
+     */
+    unsigned step(size_t len, unsigned ch, unsigned* out) const;
+
+  public:
+    /// Result of testing a candidate.
+    enum result {
+	/// The candidate is within the maximum edit distance.
+	MATCH,
+	/// The candidate doesn't match, but the next string might.
+	NO_MATCH,
+	/// Nothing between the candidate and the string returned matches.
+	SKIP_TO,
+	/// No string greater than the candidate matches.
+	END
+    };
+
+    /** Constructor.
+     *
+     *  @param target_		Target string.
+     *  @param max_distance_	Maximum edit distance to accept.
+     */
+    EditDistanceAutomaton(const std::string& target_,
+			  unsigned max_distance_);
+
+    /** Test a candidate.
+     *
+     *  @param candidate	String to test.
+     *  @param next		Set to the string to skip to if SKIP_TO is
+     *				returned.
+     *
+     *  @return A value from @a result.
+     */
+    result test(const std::string& candidate, std::string& next);
+};
+
 #endif // XAPIAN_INCLUDED_EDITDISTANCE_H
@@ -39,8 +39,16 @@
 #include "xapian/rset.h"
 #include "xapian/weight.h"
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 using namespace std;
@@ -51,6 +59,71 @@ throw_invalid_arg(const char* msg) {
     throw Xapian::InvalidArgumentError(msg);
 }
 
+/** Threads which run the matches for the std::future get_mset_async().
+ *
+ *  There's at most one thread per CPU, each started when a task is queued
+ *  and no thread is free.  Tasks queued while all the threads are busy wait
+ *  for one to finish.
+ */
+class AsyncMatchPool {
+    mutex m;
+
+    /// Signalled when a task is queued.
+    condition_variable queued;
+
+    deque<function<void()>> tasks;
+
+    /// Number of threads started.
+    unsigned n_threads = 0;
+
+    /// Number of threads waiting for a task.
+    unsigned n_idle = 0;
+
+    unsigned max_threads;
+
+    void run_thread() {
+	while (true) {
+	    function<void()> task;
+	    {
+		unique_lock<mutex> locker(m);
+		++n_idle;
+		queued.wait(locker, [this]() { return !tasks.empty(); });
+		--n_idle;
+		task = std::move(tasks.front());
+		tasks.pop_front();
+	    }
+	    task();
+	}
+    }
+
+  public:
+    AsyncMatchPool() {
+	max_threads = thread::hardware_concurrency();
+	if (max_threads == 0) max_threads = 1;
+    }
+
+    /** Return the pool.
+     *
+     *  The pool is never destroyed, since its threads are never stopped.
+     */
+    static AsyncMatchPool& get() {
+	static AsyncMatchPool* pool = new AsyncMatchPool();
+	return *pool;
+    }
+
+    void run(const function<void()>& task) {
+	{
+	    lock_guard<mutex> locker(m);
+	    tasks.push_back(task);
+	    if (n_idle < tasks.size() && n_threads < max_threads) {
+		thread([this]() { run_thread(); }).detach();
+		++n_threads;
+	    }
+	}
+	queued.notify_one();
+    }
+};
+
 namespace Xapian {
 
 Enquire::Enquire(const Enquire&) = default;
@@ -195,6 +268,19 @@ Enquire::set_time_limit(double time_limit)
     internal->time_limit = time_limit;
 }
 
+void
+Enquire::set_shard_time_limit(double time_limit)
+{
+    internal->shard_time_limit = time_limit;
+}
+
+void
+Enquire::set_reranker(Reranker* reranker, doccount rerank_depth)
+{
+    internal->reranker = reranker;
+    internal->rerank_depth = rerank_depth;
+}
+
 MSet
 Enquire::get_mset(doccount first,
 		  doccount maxitems,
@@ -205,6 +291,64 @@ Enquire::get_mset(doccount first,
     return internal->get_mset(first, maxitems, checkatleast, rset, mdecider);
 }
 
+void
+Enquire::get_mset_async(const executor_type& executor,
+			const callback_type& callback,
+			doccount first,
+			doccount maxitems,
+			doccount checkatleast,
+			const RSet* rset,
+			const MatchDecider* mdecider) const
+{
+    // Take copies now, since the task may run after the caller's objects
+    // have gone.  These share reference counted objects with the caller's,
+    // so they're released before the callback is called.  The MSet passed
+    // to the callback also refers to them, so the caller can't use those
+    // objects again until the callback has returned.
+    struct Task {
+	unique_ptr<Enquire> enquire;
+	unique_ptr<RSet> rset;
+    };
+    auto task = make_shared<Task>();
+    task->enquire.reset(new Enquire(*this));
+    if (rset) task->rset.reset(new RSet(*rset));
+    executor([=]() {
+	MSet mset;
+	exception_ptr error;
+	try {
+	    mset = task->enquire->get_mset(first, maxitems, checkatleast,
+					   task->rset.get(), mdecider);
+	} catch (...) {
+	    error = current_exception();
+	}
+	task->enquire.reset();
+	task->rset.reset();
+	callback(std::move(mset), error);
+    });
+}
+
+future<MSet>
+Enquire::get_mset_async(doccount first,
+			doccount maxitems,
+			doccount checkatleast,
+			const RSet* rset,
+			const MatchDecider* mdecider) const
+{
+    auto result = make_shared<promise<MSet>>();
+    get_mset_async([](const function<void()>& task) {
+			AsyncMatchPool::get().run(task);
+		   },
+		   [result](MSet mset, exception_ptr error) {
+			if (error) {
+			    result->set_exception(error);
+			} else {
+			    result->set_value(std::move(mset));
+			}
+		   },
+		   first, maxitems, checkatleast, rset, mdecider);
+    return result->get_future();
+}
+
 TermIterator
 Enquire::get_matching_terms_begin(docid did) const
 {
@@ -270,6 +414,13 @@ Enquire::Internal::get_mset(doccount first,
 					 "currently supported");
     }
 
+    bool reranking = reranker.get() && rerank_depth != 0;
+    if (reranking && sort_by != REL && sort_by != REL_VAL) {
+	throw Xapian::UnimplementedError("Use of a reranker while sorting "
+					 "primarily by value isn't currently "
+					 "supported");
+    }
+
     // Lazily initialise weight to its default if necessary.
     if (!weight.get())
 	weight.reset(new BM25Weight);
@@ -280,10 +431,21 @@ Enquire::Internal::get_mset(doccount first,
     }
 
     Xapian::doccount first_orig = first;
+    Xapian::doccount rerank_first = 0;
+    Xapian::doccount rerank_maxitems = 0;
     {
 	Xapian::doccount docs = db.get_doccount();
 	first = min(first, docs);
 	maxitems = min(maxitems, docs - first);
+	if (reranking) {
+	    // The reranker needs to see the top rerank_depth candidates
+	    // whichever range of results has been asked for, so we run the
+	    // match from the start and select the range after reranking.
+	    rerank_first = first;
+	    rerank_maxitems = maxitems;
+	    maxitems = max(first + maxitems, min(rerank_depth, docs));
+	    first = 0;
+	}
 	checkatleast = min(checkatleast, docs);
 	checkatleast = max(checkatleast, first + maxitems);
     }
@@ -306,6 +468,7 @@ Enquire::Internal::get_mset(doccount first,
 		    sort_by,
 		    sort_val_reverse,
 		    time_limit,
+		    shard_time_limit,
 		    matchspies);
 
     MSet mset = match.get_mset(first,
@@ -326,6 +489,15 @@ Enquire::Internal::get_mset(doccount first,
 			       time_limit,
 			       matchspies);
 
+    if (reranking) {
+	// If there were remote shards then the MSet has the merged stats.
+	const Xapian::Weight::Internal* mset_stats = mset.internal->get_stats();
+	match.rerank(mset, *reranker, rerank_depth,
+		     mset_stats ? *mset_stats : *stats,
+		     rerank_first, rerank_maxitems,
+		     order, sort_by, sort_val_reverse);
+    }
+
     if (first_orig != first && mset.internal.get()) {
 	mset.internal->set_first(first_orig);
     }
@@ -30,6 +30,7 @@
 #include "xapian/matchspy.h"
 #include "xapian/mset.h" // Only needed to forward declare MSet::Internal.
 #include "xapian/query.h"
+#include "xapian/reranker.h"
 
 #include <memory>
 #include <string>
@@ -79,6 +80,12 @@ class Enquire::Internal : public Xapian::Internal::intrusive_base {
 
     double time_limit = 0.0;
 
+    double shard_time_limit = 0.0;
+
+    Xapian::Internal::opt_intrusive_ptr<Reranker> reranker;
+
+    doccount rerank_depth = 0;
+
     enum { EXPAND_TRAD, EXPAND_BO1 } eweight = EXPAND_TRAD;
 
     double expand_k = 1.0;
@@ -110,8 +117,13 @@ class Enquire::Internal : public Xapian::Internal::intrusive_base {
 	return db.get_document(did, Xapian::DOC_ASSUME_VALID);
     }
 
-    void request_document(docid did) const {
-	db.internal->request_document(did);
+    void request_documents(const std::vector<docid>& dids) const {
+	db.internal->request_documents(dids);
+    }
+
+    /// Is the database read-only (so its documents can't change under us)?
+    bool is_read_only() const {
+	return db.internal->is_read_only();
     }
 };
 
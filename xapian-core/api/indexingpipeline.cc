@@ -0,0 +1,450 @@
+/** @file indexingpipeline.cc
+ * @brief Index documents using several threads
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "xapian/indexingpipeline.h"
+
+#include "xapian/database.h"
+#include "xapian/document.h"
+#include "xapian/termgenerator.h"
+
+#include "realtime.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace Xapian {
+
+class IndexingPipeline::Internal : public Xapian::Internal::intrusive_base {
+    /// A document to build and write.
+    struct job {
+	enum { ADD, REPLACE_BY_DOCID, REPLACE_BY_TERM } type;
+
+	/// Position in the order the jobs were submitted.
+	uint64_t seq;
+
+	/// The docid to replace, for REPLACE_BY_DOCID.
+	Xapian::docid did;
+
+	/// The unique term, for REPLACE_BY_TERM.
+	string unique_term;
+
+	/// Function to build the document (cleared once it's been called).
+	builder_type builder;
+
+	/// The built document.
+	Xapian::Document doc;
+
+	/// True if building the document failed.
+	bool failed;
+    };
+
+    Xapian::WritableDatabase db;
+
+    setup_type setup;
+
+    Xapian::doccount max_pending;
+
+    /// Protects all the members below.
+    mutex m;
+
+    /// Signalled when a job is submitted, or the threads should stop.
+    condition_variable job_submitted;
+
+    /// Signalled when the next job to write has been built.
+    condition_variable job_built;
+
+    /// Signalled when jobs have been written.
+    condition_variable jobs_written;
+
+    /// Jobs waiting for a worker.
+    deque<job> to_build;
+
+    /// Built jobs waiting to be written, keyed by seq.
+    map<uint64_t, job> to_write;
+
+    /// The seq to give the next job submitted.
+    uint64_t next_seq = 0;
+
+    /// The seq of the next job to write.
+    uint64_t next_write = 0;
+
+    /// Should the threads stop?
+    bool stopping = false;
+
+    /// The first error since the last one was reported.
+    exception_ptr error;
+
+    vector<thread> workers;
+
+    thread writer;
+
+    atomic<Xapian::doccount> built_count;
+
+    atomic<Xapian::doccount> written_count;
+
+    /// Total time spent building documents, in microseconds.
+    atomic<uint64_t> build_usecs;
+
+    /// Total time spent writing documents, in microseconds.
+    atomic<uint64_t> write_usecs;
+
+    /// Record @a e if it's the first error since the last was reported.
+    void set_error(exception_ptr e) {
+	lock_guard<mutex> lock(m);
+	if (!error) error = e;
+    }
+
+    /// Rethrow any error which hasn't been reported.  Call with m locked.
+    void check_error() {
+	if (error) {
+	    exception_ptr e = error;
+	    error = nullptr;
+	    rethrow_exception(e);
+	}
+    }
+
+    void run_worker();
+
+    void run_writer();
+
+    /// Apply the update for @a j to the database.
+    void write(job& j);
+
+  public:
+    Internal(const Xapian::WritableDatabase& db_,
+	     const setup_type& setup_,
+	     unsigned n_workers,
+	     Xapian::doccount max_pending_);
+
+    ~Internal();
+
+    void submit(job&& j);
+
+    void add_document(const builder_type& builder) {
+	submit(job{job::ADD, 0, 0, string(), builder, Xapian::Document(),
+		   false});
+    }
+
+    void replace_document(Xapian::docid did, const builder_type& builder) {
+	submit(job{job::REPLACE_BY_DOCID, 0, did, string(), builder,
+		   Xapian::Document(), false});
+    }
+
+    void replace_document(const string& unique_term,
+			  const builder_type& builder) {
+	submit(job{job::REPLACE_BY_TERM, 0, 0, unique_term, builder,
+		   Xapian::Document(), false});
+    }
+
+    void finish();
+
+    Xapian::doccount get_submitted_count() {
+	lock_guard<mutex> lock(m);
+	return Xapian::doccount(next_seq);
+    }
+
+    Xapian::doccount get_built_count() const { return built_count; }
+
+    Xapian::doccount get_written_count() const { return written_count; }
+
+    double get_build_time() const { return build_usecs * 1e-6; }
+
+    double get_write_time() const { return write_usecs * 1e-6; }
+};
+
+IndexingPipeline::Internal::Internal(const Xapian::WritableDatabase& db_,
+				     const setup_type& setup_,
+				     unsigned n_workers,
+				     Xapian::doccount max_pending_)
+    : db(db_), setup(setup_), max_pending(max_pending_)
+{
+    // std::atomic's default constructor doesn't initialise the value.
+    built_count = 0;
+    written_count = 0;
+    build_usecs = 0;
+    write_usecs = 0;
+
+    if (n_workers == 0) {
+	n_workers = thread::hardware_concurrency();
+	if (n_workers == 0) n_workers = 1;
+    }
+    if (max_pending == 0) max_pending = n_workers * 16;
+
+    try {
+	writer = thread([this]() { run_writer(); });
+	for (unsigned i = 0; i != n_workers; ++i) {
+	    workers.emplace_back([this]() { run_worker(); });
+	}
+    } catch (...) {
+	{
+	    lock_guard<mutex> lock(m);
+	    stopping = true;
+	}
+	job_submitted.notify_all();
+	job_built.notify_all();
+	for (auto&& worker : workers) worker.join();
+	if (writer.joinable()) writer.join();
+	throw;
+    }
+}
+
+IndexingPipeline::Internal::~Internal()
+{
+    {
+	unique_lock<mutex> lock(m);
+	jobs_written.wait(lock, [this]() { return next_write == next_seq; });
+	stopping = true;
+    }
+    job_submitted.notify_all();
+    job_built.notify_all();
+    for (auto&& worker : workers) worker.join();
+    writer.join();
+}
+
+void
+IndexingPipeline::Internal::submit(job&& j)
+{
+    {
+	unique_lock<mutex> lock(m);
+	jobs_written.wait(lock, [this]() {
+	    return error || next_seq - next_write < max_pending;
+	});
+	if (error) {
+	    // Let the jobs already queued be discarded before reporting the
+	    // error, so the discarding doesn't extend to jobs submitted later.
+	    jobs_written.wait(lock, [this]() { return next_write == next_seq; });
+	    check_error();
+	}
+	j.seq = next_seq++;
+	to_build.push_back(std::move(j));
+    }
+    job_submitted.notify_one();
+}
+
+void
+IndexingPipeline::Internal::finish()
+{
+    unique_lock<mutex> lock(m);
+    jobs_written.wait(lock, [this]() { return next_write == next_seq; });
+    check_error();
+}
+
+void
+IndexingPipeline::Internal::run_worker()
+{
+    Xapian::TermGenerator termgen;
+    exception_ptr setup_error;
+    try {
+	if (setup) setup(termgen);
+    } catch (...) {
+	setup_error = current_exception();
+    }
+
+    while (true) {
+	job j;
+	{
+	    unique_lock<mutex> lock(m);
+	    job_submitted.wait(lock, [this]() {
+		return stopping || !to_build.empty();
+	    });
+	    if (to_build.empty()) return;
+	    j = std::move(to_build.front());
+	    to_build.pop_front();
+	    // Don't build documents which will be discarded.
+	    if (error) j.failed = true;
+	}
+
+	if (setup_error) {
+	    set_error(setup_error);
+	    j.failed = true;
+	} else if (!j.failed) {
+	    double start = RealTime::now();
+	    try {
+		termgen.set_document(j.doc);
+		j.builder(termgen, j.doc);
+	    } catch (...) {
+		set_error(current_exception());
+		j.failed = true;
+	    }
+	    // The TermGenerator mustn't keep a reference to the document as
+	    // it's about to be handed to the writer thread.
+	    termgen.set_document(Xapian::Document());
+	    build_usecs += uint64_t((RealTime::now() - start) * 1e6);
+	    if (!j.failed) ++built_count;
+	}
+	// Destroy the builder here rather than in the writer thread.
+	j.builder = nullptr;
+
+	bool next = false;
+	{
+	    lock_guard<mutex> lock(m);
+	    next = (j.seq == next_write);
+	    uint64_t seq = j.seq;
+	    to_write.emplace(seq, std::move(j));
+	}
+	if (next) job_built.notify_one();
+    }
+}
+
+void
+IndexingPipeline::Internal::write(job& j)
+{
+    switch (j.type) {
+	case job::ADD:
+	    (void)db.add_document(j.doc);
+	    break;
+	case job::REPLACE_BY_DOCID:
+	    db.replace_document(j.did, j.doc);
+	    break;
+	case job::REPLACE_BY_TERM:
+	    (void)db.replace_document(j.unique_term, j.doc);
+	    break;
+    }
+}
+
+void
+IndexingPipeline::Internal::run_writer()
+{
+    vector<job> batch;
+    // Set once a job has failed, so the jobs after it are discarded until the
+    // error has been reported (which only happens once they've all been
+    // through here).
+    bool discard = false;
+    while (true) {
+	{
+	    unique_lock<mutex> lock(m);
+	    job_built.wait(lock, [this]() {
+		return (!to_write.empty() && to_write.begin()->first == next_write)
+		       || (stopping && next_write == next_seq);
+	    });
+	    if (to_write.empty()) return;
+	    // Take all the jobs which are ready to write in order.
+	    auto i = to_write.begin();
+	    uint64_t seq = next_write;
+	    while (i != to_write.end() && i->first == seq) {
+		batch.push_back(std::move(i->second));
+		i = to_write.erase(i);
+		++seq;
+	    }
+	    if (!error) discard = false;
+	}
+
+	double start = RealTime::now();
+	for (auto&& j : batch) {
+	    if (j.failed) discard = true;
+	    if (discard) continue;
+	    try {
+		write(j);
+		++written_count;
+	    } catch (...) {
+		set_error(current_exception());
+		discard = true;
+	    }
+	}
+	write_usecs += uint64_t((RealTime::now() - start) * 1e6);
+
+	{
+	    lock_guard<mutex> lock(m);
+	    next_write += batch.size();
+	}
+	// Release the documents before waiting for more.
+	batch.clear();
+	jobs_written.notify_all();
+    }
+}
+
+IndexingPipeline::IndexingPipeline(const Xapian::WritableDatabase& db,
+				   const setup_type& setup,
+				   unsigned n_workers,
+				   Xapian::doccount max_pending)
+    : internal(new Internal(db, setup, n_workers, max_pending)) {}
+
+IndexingPipeline::~IndexingPipeline() {}
+
+void
+IndexingPipeline::add_document(const builder_type& builder)
+{
+    internal->add_document(builder);
+}
+
+void
+IndexingPipeline::replace_document(Xapian::docid did,
+				   const builder_type& builder)
+{
+    internal->replace_document(did, builder);
+}
+
+void
+IndexingPipeline::replace_document(const string& unique_term,
+				   const builder_type& builder)
+{
+    internal->replace_document(unique_term, builder);
+}
+
+void
+IndexingPipeline::finish()
+{
+    internal->finish();
+}
+
+Xapian::doccount
+IndexingPipeline::get_submitted_count() const
+{
+    return internal->get_submitted_count();
+}
+
+Xapian::doccount
+IndexingPipeline::get_built_count() const
+{
+    return internal->get_built_count();
+}
+
+Xapian::doccount
+IndexingPipeline::get_written_count() const
+{
+    return internal->get_written_count();
+}
+
+double
+IndexingPipeline::get_build_time() const
+{
+    return internal->get_build_time();
+}
+
+double
+IndexingPipeline::get_write_time() const
+{
+    return internal->get_write_time();
+}
+
+}
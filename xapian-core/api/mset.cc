@@ -23,6 +23,7 @@
 #include "msetinternal.h"
 #include "xapian/mset.h"
 
+#include "backends/documentinternal.h"
 #include "net/serialise.h"
 #include "matcher/msetcmp.h"
 #include "pack.h"
@@ -34,6 +35,8 @@
 #include <algorithm>
 #include <cfloat>
 #include <string>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
@@ -72,6 +75,8 @@ MSet::sort_by_relevance()
 {
     std::sort(internal->items.begin(), internal->items.end(),
 	      get_msetcmp_function(Enquire::Internal::REL, true, false));
+    // Fetched documents are keyed by index, which sorting invalidates.
+    internal->fetched.clear();
 }
 
 int
@@ -161,6 +166,13 @@ MSet::get_uncollapsed_matches_upper_bound() const
     return internal->uncollapsed_upper_bound;
 }
 
+bool
+MSet::shard_timed_out(Xapian::doccount shard) const
+{
+    const auto& shards = internal->timed_out_shards;
+    return find(shards.begin(), shards.end(), shard) != shards.end();
+}
+
 double
 MSet::get_max_attained() const
 {
@@ -211,6 +223,10 @@ MSet::Internal::get_document(Xapian::doccount index) const
 	throw Xapian::RangeError(msg);
     }
     Assert(enquire.get());
+    auto i = fetched.find(index);
+    if (i != fetched.end()) {
+	return i->second;
+    }
     return enquire->get_document(items[index].get_docid());
 }
 
@@ -223,12 +239,45 @@ MSet::Internal::fetch(Xapian::doccount first_, Xapian::doccount last) const
     if (last > items.size() - 1) {
 	last = items.size() - 1;
     }
-    if (first_ <= last) {
-	Xapian::doccount n = last - first_;
-	for (Xapian::doccount i = 0; i <= n; ++i) {
-	    enquire->request_document(items[i].get_docid());
+    if (first_ > last) {
+	return;
+    }
+
+    // Read the documents in docid order, which means a local shard reads
+    // keys from each table in ascending order, reusing the blocks its
+    // cursors already hold where possible.
+    vector<pair<Xapian::docid, Xapian::doccount>> to_fetch;
+    to_fetch.reserve(last - first_ + 1);
+    for (Xapian::doccount i = first_; i <= last; ++i) {
+	if (fetched.find(i) == fetched.end()) {
+	    to_fetch.emplace_back(items[i].get_docid(), i);
 	}
     }
+    if (to_fetch.empty()) {
+	return;
+    }
+    sort(to_fetch.begin(), to_fetch.end());
+
+    vector<Xapian::docid> dids;
+    dids.reserve(to_fetch.size());
+    for (auto&& item : to_fetch) {
+	dids.push_back(item.first);
+    }
+    // For a remote shard this fetches the data and values of all the
+    // documents in one exchange; for a local shard it's a readahead hint.
+    enquire->request_documents(dids);
+
+    // Documents in a writable database could be modified before they're
+    // used, so we can't keep them.
+    if (!enquire->is_read_only()) {
+	return;
+    }
+
+    for (auto&& item : to_fetch) {
+	Xapian::Document doc = enquire->get_document(item.first);
+	doc.internal->fetch_data_and_values();
+	fetched.emplace(item.second, std::move(doc));
+    }
 }
 
 void
@@ -26,6 +26,7 @@
 #include "result.h"
 #include "weight/weightinternal.h"
 
+#include "xapian/document.h"
 #include "xapian/intrusive_ptr.h"
 #include "xapian/mset.h"
 #include "xapian/types.h"
@@ -83,6 +84,15 @@ class MSet::Internal : public Xapian::Internal::intrusive_base {
     /// Scale factor to convert weights to percentages.
     double percent_scale_factor = 0;
 
+    /// Remote shards which didn't reply in time.
+    std::vector<Xapian::doccount> timed_out_shards;
+
+    /** Documents read by fetch().
+     *
+     *  Keyed by index into @a items.
+     */
+    mutable std::unordered_map<Xapian::doccount, Xapian::Document> fetched;
+
   public:
     Internal() {}
 
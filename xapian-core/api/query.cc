@@ -135,9 +135,8 @@ Query::Query(op op_,
 	throw Xapian::InvalidArgumentError("op must be OP_EDIT_DISTANCE or "
 					   "OP_WILDCARD");
 
-    auto just_flags = flags & ~Query::WILDCARD_LIMIT_MASK_;
     if (pattern.empty()) {
-	if (just_flags == 0) {
+	if ((flags & Query::WILDCARD_PATTERN_GLOB) == 0) {
 	    // Empty pattern with implicit trailing '*' -> MatchAll.
 	    internal = new Xapian::Internal::QueryTerm();
 	} else {
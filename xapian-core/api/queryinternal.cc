@@ -30,6 +30,7 @@
 
 #include "api/editdistance.h"
 #include "backends/postlist.h"
+#include "backends/termngramindex.h"
 #include "heap.h"
 #include "matcher/andmaybepostlist.h"
 #include "matcher/andnotpostlist.h"
@@ -50,6 +51,7 @@
 #include "serialise-double.h"
 #include "stringutils.h"
 #include "termlist.h"
+#include "vectortermlist.h"
 
 #include "debuglog.h"
 #include "omassert.h"
@@ -233,8 +235,30 @@ inline void
 Context<T>::expand_wildcard(const QueryWildcard* query,
 			    double factor)
 {
-    unique_ptr<TermList> t(qopt->db.open_allterms(query->get_fixed_prefix()));
+    unique_ptr<TermList> t;
     bool skip_ucase = query->get_fixed_prefix().empty();
+    // Set if the terms in t are already known to match the pattern.
+    bool candidates_checked = false;
+    if (query->get_use_ngram_index()) {
+	auto index = qopt->db.get_term_ngram_index();
+	vector<string> candidates;
+	if (index && index->get_candidates(query->get_fragments(), candidates)) {
+	    auto no_match = [&](const string& term) {
+		// As below, a leading wildcard doesn't match prefixed terms.
+		if (skip_ucase && term[0] >= 'A' && term[0] <= 'Z')
+		    return true;
+		return !query->test(term);
+	    };
+	    candidates.erase(remove_if(candidates.begin(), candidates.end(),
+				       no_match),
+			     candidates.end());
+	    t.reset(new VectorTermList(candidates.begin(), candidates.end()));
+	    skip_ucase = false;
+	    candidates_checked = true;
+	}
+    }
+    if (!t)
+	t.reset(qopt->db.open_allterms(query->get_fixed_prefix()));
     auto max_type = query->get_max_type();
     Xapian::termcount expansions_left = query->get_max_expansion();
     // If there's no expansion limit, set expansions_left to the maximum
@@ -264,7 +288,7 @@ done_skip_to:
 	    }
 	}
 
-	if (!query->test_prefix_known(term)) continue;
+	if (!candidates_checked && !query->test_prefix_known(term)) continue;
 
 	if (max_type < Xapian::Query::WILDCARD_LIMIT_MOST_FREQUENT) {
 	    if (expansions_left-- == 0) {
@@ -272,7 +296,7 @@ done_skip_to:
 		    break;
 		string msg("Wildcard ");
 		msg += query->get_pattern();
-		if (query->get_just_flags() == 0)
+		if ((query->get_just_flags() & Query::WILDCARD_PATTERN_GLOB) == 0)
 		    msg += '*';
 		msg += " expands to more than ";
 		msg += str(query->get_max_expansion());
@@ -309,6 +333,12 @@ Context<T>::expand_edit_distance(const QueryEditDistance* query,
     string pfx(query->get_pattern(), 0, query->get_fixed_prefix_len());
     unique_ptr<TermList> t(qopt->db.open_allterms(pfx));
     bool skip_ucase = pfx.empty();
+    // Rather than calculating the edit distance for every term, we run an
+    // automaton over the terms which lets us skip past runs of terms which
+    // can't match.
+    EditDistanceAutomaton automaton(query->get_pattern(),
+				    query->get_threshold());
+    string next;
     auto max_type = query->get_max_type();
     Xapian::termcount expansions_left = query->get_max_expansion();
     // If there's no expansion limit, set expansions_left to the maximum
@@ -339,7 +369,15 @@ done_skip_to:
 	    }
 	}
 
-	if (!query->test(term)) continue;
+	auto result = automaton.test(term, next);
+	if (result != EditDistanceAutomaton::MATCH) {
+	    if (result == EditDistanceAutomaton::NO_MATCH)
+		continue;
+	    if (result == EditDistanceAutomaton::END)
+		break;
+	    t->skip_to(next);
+	    goto done_skip_to;
+	}
 
 	if (max_type < Xapian::Query::WILDCARD_LIMIT_MOST_FREQUENT) {
 	    if (expansions_left-- == 0) {
@@ -1362,7 +1400,7 @@ QueryWildcard::QueryWildcard(const std::string &pattern_,
       flags(flags_),
       combiner(combiner_)
 {
-    if ((flags & ~Query::WILDCARD_LIMIT_MASK_) == 0) {
+    if ((flags & Query::WILDCARD_PATTERN_GLOB) == 0) {
 	head = min_len = pattern.size();
 	max_len = numeric_limits<decltype(max_len)>::max();
 	prefix = pattern;
@@ -1495,6 +1533,36 @@ QueryWildcard::test_wildcard_(const string& candidate, size_t o, size_t p,
     return (o == p);
 }
 
+vector<string>
+QueryWildcard::get_fragments() const
+{
+    vector<string> fragments;
+    string fragment(1, '\0');
+    fragment += prefix;
+    for (size_t i = head; i < tail; ++i) {
+	char ch = pattern[i];
+	if ((ch == '*' && (flags & Query::WILDCARD_PATTERN_MULTI)) ||
+	    (ch == '?' && (flags & Query::WILDCARD_PATTERN_SINGLE))) {
+	    if (!fragment.empty()) {
+		fragments.push_back(std::move(fragment));
+		fragment.clear();
+	    }
+	    continue;
+	}
+	fragment += ch;
+    }
+    if (tail > head) {
+	// There was at least one wildcard, so the suffix is a fragment on its
+	// own.
+	if (!fragment.empty())
+	    fragments.push_back(std::move(fragment));
+	fragment = suffix;
+	fragment += '\0';
+    }
+    fragments.push_back(std::move(fragment));
+    return fragments;
+}
+
 bool
 QueryWildcard::test_prefix_known(const string& candidate) const
 {
@@ -483,6 +483,18 @@ class QueryWildcard : public Query::Internal {
 	return startswith(candidate, prefix) && test_prefix_known(candidate);
     }
 
+    /** Get the literal fragments of the pattern.
+     *
+     *  The fixed prefix has a zero byte prepended and the fixed suffix has
+     *  a zero byte appended, as expected by TermNgramIndex::get_candidates().
+     */
+    std::vector<std::string> get_fragments() const;
+
+    /// Should a TermNgramIndex be used to find candidate terms?
+    bool get_use_ngram_index() const {
+	return flags & Xapian::Query::WILDCARD_USE_NGRAM_INDEX;
+    }
+
     Xapian::Query::op get_type() const noexcept XAPIAN_PURE_FUNCTION;
 
     std::string get_pattern() const { return pattern; }
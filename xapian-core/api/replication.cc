@@ -68,9 +68,10 @@ throw_connection_closed_unexpectedly()
 void
 DatabaseMaster::write_changesets_to_fd(int fd,
 				       const string & start_revision,
-				       ReplicationInfo * info) const
+				       ReplicationInfo * info,
+				       bool compress) const
 {
-    LOGCALL_VOID(REPLICA, "DatabaseMaster::write_changesets_to_fd", fd | start_revision | info);
+    LOGCALL_VOID(REPLICA, "DatabaseMaster::write_changesets_to_fd", fd | start_revision | info | compress);
     if (info != NULL)
 	info->clear();
     Database db;
@@ -106,7 +107,8 @@ DatabaseMaster::write_changesets_to_fd(int fd,
 	revision.assign(ptr, end - ptr);
     }
 
-    db.internal->write_changesets_to_fd(fd, revision, need_whole_db, info);
+    db.internal->write_changesets_to_fd(fd, revision, need_whole_db, info,
+					compress);
 }
 
 string
@@ -97,10 +97,14 @@ class XAPIAN_VISIBILITY_DEFAULT DatabaseMaster {
      *  @param info     If non-NULL, the supplied structure will be updated
      *                  to reflect the changes written to the file
      *                  descriptor.
+     *
+     *  @param compress Compress larger messages.  Only set this if the
+     *                  reader knows to expect compressed messages.
      */
     void write_changesets_to_fd(int fd,
 				const std::string & start_revision,
-				ReplicationInfo * info) const;
+				ReplicationInfo * info,
+				bool compress = false) const;
 
     /// Return a string describing this object.
     std::string get_description() const;
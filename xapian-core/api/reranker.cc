@@ -0,0 +1,183 @@
+/** @file reranker.cc
+ * @brief Second-phase reranking of the top matching documents.
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "xapian/reranker.h"
+
+#include "xapian/postingiterator.h"
+#include "xapian/termiterator.h"
+
+#include "api/rerankerinternal.h"
+#include "debuglog.h"
+#include "omassert.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+namespace Xapian {
+
+Reranker::~Reranker() { }
+
+RerankCandidates::Internal::Internal(const Xapian::Database& db_,
+				     const Xapian::Query& query_,
+				     const Xapian::Weight::Internal& stats_,
+				     const vector<Result>& items,
+				     Xapian::doccount n)
+    : db(db_), query(query_), stats(stats_)
+{
+    LOGCALL_CTOR(MATCH, "RerankCandidates::Internal", db_ | query_ | n);
+    AssertRel(n, <=, items.size());
+    docids.reserve(n);
+    weights.reserve(n);
+    for (Xapian::doccount i = 0; i != n; ++i) {
+	docids.push_back(items[i].get_docid());
+	weights.push_back(items[i].get_weight());
+    }
+
+    for (auto t = query.get_unique_terms_begin();
+	 t != query.get_terms_end();
+	 ++t) {
+	terms.push_back(*t);
+    }
+
+    // The match has released its postlists by now, and may have run on
+    // remote shards, so we can't take the wdfs and doclengths from it.
+    // Instead visit the candidates in ascending docid order so that each of
+    // the lookups below moves forwards through the data.
+    vector<Xapian::doccount> order(n);
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(),
+	 [&](Xapian::doccount a, Xapian::doccount b) {
+	     return docids[a] < docids[b];
+	 });
+
+    doclengths.resize(n);
+    for (auto i : order) {
+	doclengths[i] = db.get_doclength(docids[i]);
+    }
+
+    wdfs.resize(size_t(n) * terms.size());
+    for (size_t t = 0; t != terms.size(); ++t) {
+	Xapian::PostingIterator p = db.postlist_begin(terms[t]);
+	for (auto i : order) {
+	    if (p == Xapian::PostingIterator())
+		break;
+	    p.skip_to(docids[i]);
+	    if (p != Xapian::PostingIterator() && *p == docids[i])
+		wdfs[i * terms.size() + t] = p.get_wdf();
+	}
+    }
+}
+
+Xapian::doccount
+RerankCandidates::size() const
+{
+    return internal.docids.size();
+}
+
+Xapian::docid
+RerankCandidates::get_docid(Xapian::doccount i) const
+{
+    AssertRel(i, <, internal.docids.size());
+    return internal.docids[i];
+}
+
+double
+RerankCandidates::get_weight(Xapian::doccount i) const
+{
+    AssertRel(i, <, internal.weights.size());
+    return internal.weights[i];
+}
+
+Xapian::termcount
+RerankCandidates::get_doclength(Xapian::doccount i) const
+{
+    AssertRel(i, <, internal.doclengths.size());
+    return internal.doclengths[i];
+}
+
+const vector<string>&
+RerankCandidates::get_terms() const
+{
+    return internal.terms;
+}
+
+Xapian::termcount
+RerankCandidates::get_wdf(Xapian::doccount i,
+			  Xapian::termcount term_index) const
+{
+    AssertRel(i, <, internal.docids.size());
+    AssertRel(term_index, <, internal.terms.size());
+    return internal.wdfs[i * internal.terms.size() + term_index];
+}
+
+Xapian::doccount
+RerankCandidates::get_termfreq(Xapian::termcount term_index) const
+{
+    AssertRel(term_index, <, internal.terms.size());
+    const string& term = internal.terms[term_index];
+    Xapian::doccount termfreq;
+    if (internal.stats.get_stats(term, termfreq))
+	return termfreq;
+    // The term wasn't weighted (e.g. it's under OP_SCALE_WEIGHT with a
+    // factor of 0) so we don't have cached statistics for it.
+    return internal.db.get_termfreq(term);
+}
+
+Xapian::termcount
+RerankCandidates::get_collection_freq(Xapian::termcount term_index) const
+{
+    AssertRel(term_index, <, internal.terms.size());
+    const string& term = internal.terms[term_index];
+    Xapian::doccount termfreq, reltermfreq;
+    Xapian::termcount collfreq;
+    if (internal.stats.get_stats(term, termfreq, reltermfreq, collfreq))
+	return collfreq;
+    return internal.db.get_collection_freq(term);
+}
+
+Xapian::doccount
+RerankCandidates::get_doccount() const
+{
+    return internal.stats.collection_size;
+}
+
+Xapian::totallength
+RerankCandidates::get_total_length() const
+{
+    return internal.stats.total_length;
+}
+
+const Xapian::Database&
+RerankCandidates::get_database() const
+{
+    return internal.db;
+}
+
+const Xapian::Query&
+RerankCandidates::get_query() const
+{
+    return internal.query;
+}
+
+}
@@ -0,0 +1,71 @@
+/** @file rerankerinternal.h
+ * @brief Internals of RerankCandidates.
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_RERANKERINTERNAL_H
+#define XAPIAN_INCLUDED_RERANKERINTERNAL_H
+
+#include "xapian/reranker.h"
+
+#include "api/result.h"
+#include "weight/weightinternal.h"
+
+#include <string>
+#include <vector>
+
+class Xapian::RerankCandidates::Internal {
+    friend class Xapian::RerankCandidates;
+
+    Xapian::Database db;
+
+    Xapian::Query query;
+
+    /// Statistics gathered for the match.
+    const Xapian::Weight::Internal& stats;
+
+    std::vector<Xapian::docid> docids;
+
+    std::vector<double> weights;
+
+    std::vector<Xapian::termcount> doclengths;
+
+    /// The unique query terms, in ascending byte order.
+    std::vector<std::string> terms;
+
+    /// The wdf of terms[t] in candidate i is wdfs[i * terms.size() + t].
+    std::vector<Xapian::termcount> wdfs;
+
+  public:
+    /** Gather the statistics for the first @a n entries of @a items.
+     *
+     *  @param db_	The database being searched.
+     *  @param query_	The query being run.
+     *  @param stats_	Statistics gathered for the match.  These must remain
+     *			valid while this object exists.
+     *  @param items	The matching documents, best first.
+     *  @param n	The number of candidates.
+     */
+    Internal(const Xapian::Database& db_,
+	     const Xapian::Query& query_,
+	     const Xapian::Weight::Internal& stats_,
+	     const std::vector<Result>& items,
+	     Xapian::doccount n);
+};
+
+#endif // XAPIAN_INCLUDED_RERANKERINTERNAL_H
@@ -75,6 +75,21 @@ class TermInfo {
 	positions.push_back(termpos);
     }
 
+    /** Return a copy which doesn't share its positions with this one.
+     *
+     *  Copying a VecCOW shares the data using an unlocked reference count,
+     *  so this is needed when the copy will be used by another thread.
+     */
+    TermInfo unshared_copy() const {
+	TermInfo result(wdf);
+	result.split = split;
+	result.positions.reserve(positions.size());
+	for (auto pos : positions) {
+	    result.positions.push_back(pos);
+	}
+	return result;
+    }
+
     /// Get a pointer to the positions.
     const Xapian::VecCOW<Xapian::termpos>* get_positions() const {
 	if (split) merge();
@@ -15,6 +15,7 @@ noinst_HEADERS +=\
 	backends/postlist.h\
 	backends/prefix_compressed_strings.h\
 	backends/slowvaluelist.h\
+	backends/termngramindex.h\
 	backends/uuids.h\
 	backends/valuelist.h\
 	backends/valuestats.h
@@ -34,6 +35,7 @@ lib_src +=\
 	backends/leafpostlist.cc\
 	backends/postlist.cc\
 	backends/slowvaluelist.cc\
+	backends/termngramindex.cc\
 	backends/uuids.cc\
 	backends/valuelist.cc
 
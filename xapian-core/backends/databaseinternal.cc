@@ -29,11 +29,14 @@
 #include "postlist.h"
 #include "slowvaluelist.h"
 #include "stringutils.h"
+#include "termngramindex.h"
 #include "xapian/error.h"
 
 #include <algorithm>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 using namespace std;
 using Xapian::Internal::intrusive_ptr;
@@ -46,6 +49,15 @@ static void invalid_operation(const char* msg)
     throw InvalidOperationError(msg);
 }
 
+Database::Internal::Internal(transaction_state transaction_support)
+    : state(transaction_support)
+{
+}
+
+Database::Internal::~Internal()
+{
+}
+
 Database::Internal::size_type
 Database::Internal::size() const
 {
@@ -63,6 +75,52 @@ Database::Internal::readahead_for_query(const Xapian::Query &) const
 {
 }
 
+vector<Xapian::termcount>
+Database::Internal::get_doclengths(const vector<Xapian::docid>& dids) const
+{
+    vector<Xapian::termcount> result;
+    result.reserve(dids.size());
+    for (Xapian::docid did : dids) {
+	result.push_back(get_doclength(did));
+    }
+    return result;
+}
+
+vector<Xapian::termcount>
+Database::Internal::get_unique_terms_counts(const vector<Xapian::docid>& dids) const
+{
+    vector<Xapian::termcount> result;
+    result.reserve(dids.size());
+    for (Xapian::docid did : dids) {
+	result.push_back(get_unique_terms(did));
+    }
+    return result;
+}
+
+vector<string>
+Database::Internal::get_values(const vector<Xapian::docid>& dids,
+			       Xapian::valueno slot) const
+{
+    vector<string> result;
+    result.reserve(dids.size());
+    unique_ptr<ValueList> vl;
+    bool at_end = false;
+    for (Xapian::docid did : dids) {
+	if (!at_end) {
+	    if (!vl.get()) vl.reset(open_value_list(slot));
+	    // skip_to() only moves forwards, so this is a single pass.
+	    vl->skip_to(did);
+	    at_end = vl->at_end();
+	}
+	if (!at_end && vl->get_docid() == did) {
+	    result.push_back(vl->get_value());
+	} else {
+	    result.emplace_back();
+	}
+    }
+    return result;
+}
+
 Xapian::termcount
 Database::Internal::get_unique_terms_lower_bound() const
 {
@@ -264,12 +322,83 @@ Database::Internal::replace_document(const string & unique_term,
     return did;
 }
 
+void
+Database::Internal::set_document_value(Xapian::docid did,
+				       Xapian::valueno slot,
+				       const string& value)
+{
+    if (is_read_only()) {
+	// This can happen if a read-only shard gets added to a
+	// WritableDatabase.
+	invalid_operation("WritableDatabase::set_document_value() called "
+			  "with a read-only shard");
+    }
+
+    Xapian::Document doc(open_document(did, false));
+    doc.add_value(slot, value);
+    replace_document(did, doc);
+}
+
 ValueList *
 Database::Internal::open_value_list(Xapian::valueno slot) const
 {
     return new SlowValueList(this, slot);
 }
 
+shared_ptr<const TermNgramIndex>
+Database::Internal::get_term_ngram_index() const
+{
+    if (!is_read_only())
+	return NULL;
+
+    Xapian::rev revision;
+    try {
+	revision = get_revision();
+    } catch (const Xapian::UnimplementedError&) {
+	return NULL;
+    }
+
+    // Building the index costs more than a scan of the terms, so only build
+    // it once this many calls have asked for the same revision.
+    const unsigned MIN_REQUESTS = 4;
+    {
+	lock_guard<mutex> locker(term_ngram_index_mutex);
+	if (term_ngram_index) {
+	    if (term_ngram_index->get_revision() == revision)
+		return term_ngram_index;
+	    // Free the out of date index now.
+	    term_ngram_index.reset();
+	}
+	if (term_ngram_index_rev != revision) {
+	    term_ngram_index_rev = revision;
+	    term_ngram_index_requests = 0;
+	}
+	if (++term_ngram_index_requests < MIN_REQUESTS ||
+	    term_ngram_index_building) {
+	    return NULL;
+	}
+	term_ngram_index_building = true;
+    }
+
+    shared_ptr<const TermNgramIndex> index;
+    try {
+	index = make_shared<const TermNgramIndex>(*this, revision);
+    } catch (...) {
+	lock_guard<mutex> locker(term_ngram_index_mutex);
+	term_ngram_index_building = false;
+	throw;
+    }
+
+    lock_guard<mutex> locker(term_ngram_index_mutex);
+    term_ngram_index_building = false;
+    // Don't replace an index of a newer revision.
+    if (!term_ngram_index ||
+	term_ngram_index->get_revision() < index->get_revision()) {
+	term_ngram_index = index;
+    }
+    return index;
+}
+
 TermList *
 Database::Internal::open_spelling_termlist(const string &) const
 {
@@ -279,6 +408,15 @@ Database::Internal::open_spelling_termlist(const string &) const
     return NULL;
 }
 
+TermList *
+Database::Internal::open_spelling_deletes_termlist(const string &,
+						   unsigned) const
+{
+    // Only implemented for some database backends - others fall back to the
+    // trigram-based termlist.
+    return NULL;
+}
+
 TermList *
 Database::Internal::open_spelling_wordlist() const
 {
@@ -380,7 +518,16 @@ Database::Internal::request_document(Xapian::docid) const
 }
 
 void
-Database::Internal::write_changesets_to_fd(int, const string&, bool, ReplicationInfo*)
+Database::Internal::request_documents(const vector<Xapian::docid>& dids) const
+{
+    for (Xapian::docid did : dids) {
+	request_document(did);
+    }
+}
+
+void
+Database::Internal::write_changesets_to_fd(int, const string&, bool,
+					   ReplicationInfo*, bool)
 {
     throw Xapian::UnimplementedError("This backend doesn't provide changesets");
 }
@@ -423,6 +570,12 @@ Database::Internal::update_lock(int flags)
     throw Xapian::DatabaseLockError("Not possible to lock for writing");
 }
 
+Database::Internal*
+Database::Internal::clone() const
+{
+    throw Xapian::UnimplementedError("This backend doesn't support clone()");
+}
+
 namespace {
     class Pos {
 	Xapian::termpos pos;
@@ -33,13 +33,17 @@
 #include <xapian/types.h>
 #include <xapian/valueiterator.h>
 
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 typedef Xapian::TermIterator::Internal TermList;
 typedef Xapian::PositionIterator::Internal PositionList;
 typedef Xapian::ValueIterator::Internal ValueList;
 
 class LeafPostList;
+class TermNgramIndex;
 
 namespace Xapian {
 namespace Internal {
@@ -66,6 +70,22 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
     /// The "action required" helper for the dtor_called() helper.
     void dtor_called_();
 
+    /// Trigram index of the terms, built on demand for wildcard expansion.
+    mutable std::shared_ptr<const TermNgramIndex> term_ngram_index;
+
+    /// Revision which term_ngram_index_requests counts requests for.
+    mutable Xapian::rev term_ngram_index_rev = 0;
+
+    /// Number of requests for an index of revision term_ngram_index_rev.
+    mutable unsigned term_ngram_index_requests = 0;
+
+    /// Is a thread currently building a term_ngram_index?
+    mutable bool term_ngram_index_building = false;
+
+    /// Mutex guarding the term_ngram_index members, which const methods
+    /// update.
+    mutable std::mutex term_ngram_index_mutex;
+
   protected:
     /// Transaction state enum.
     enum transaction_state {
@@ -83,16 +103,16 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
      *	* TRANSACTION_UNIMPLEMENTED - writable but no transaction support
      *	* TRANSACTION_NONE - writable with transaction support
      */
-    Internal(transaction_state transaction_support)
-	: state(transaction_support) {}
+    explicit Internal(transaction_state transaction_support);
 
     /// Current transaction state.
     transaction_state state;
 
-    /// Test if this shard is read-only.
-    bool is_read_only() const {
-	return state == TRANSACTION_READONLY;
-    }
+    /** Are updates pipelined (Xapian::DB_PIPELINE_UPDATES)?
+     *
+     *  Backends which support the flag set this when they're opened.
+     */
+    bool pipeline_updates = false;
 
     /// Test if a transaction is currently active.
     bool transaction_active() const { return state > 0; }
@@ -120,7 +140,18 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
     /** We have virtual methods and want to be able to delete derived classes
      *  using a pointer to the base class, so we need a virtual destructor.
      */
-    virtual ~Internal() {}
+    virtual ~Internal();
+
+    /// Test if this shard is read-only.
+    bool is_read_only() const {
+	return state == TRANSACTION_READONLY;
+    }
+
+    /** Test if updates to this shard may be applied asynchronously.
+     *
+     *  If so, errors from them may be reported by a later call.
+     */
+    bool pipelines_updates() const { return pipeline_updates; }
 
     typedef Xapian::doccount size_type;
 
@@ -152,6 +183,35 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
      */
     virtual termcount get_wdfdocmax(docid did) const = 0;
 
+    /** Get the lengths of several documents.
+     *
+     *  @param dids  The document ids, in ascending order.
+     *
+     *  The default implementation calls get_doclength() for each document.
+     */
+    virtual std::vector<termcount>
+    get_doclengths(const std::vector<docid>& dids) const;
+
+    /** Get the number of unique terms in several documents.
+     *
+     *  @param dids  The document ids, in ascending order.
+     *
+     *  The default implementation calls get_unique_terms() for each
+     *  document.
+     */
+    virtual std::vector<termcount>
+    get_unique_terms_counts(const std::vector<docid>& dids) const;
+
+    /** Get the values in slot @a slot for several documents.
+     *
+     *  @param dids  The document ids, in ascending order.
+     *
+     *  The default implementation makes a single pass over the value stream
+     *  for @a slot using open_value_list().
+     */
+    virtual std::vector<std::string>
+    get_values(const std::vector<docid>& dids, valueno slot) const;
+
     /** Returns frequencies for a term.
      *
      *  @param term		The term to get frequencies for
@@ -246,6 +306,26 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
 
     virtual TermList* open_allterms(const std::string& prefix) const = 0;
 
+    /** Get a trigram index of the terms in this shard.
+     *
+     *  The index is built from open_allterms() once a few calls have
+     *  asked for an index of the shard's current revision, and built again
+     *  in the same way after the revision changes.  Until then NULL is
+     *  returned, so the caller scans the terms as it would without the
+     *  index - a shard which is reopened often doesn't pay for building an
+     *  index for each revision which is only used once or twice.
+     *
+     *  It's safe to call this from several threads at once.  The index is
+     *  built without holding the lock, and other threads get NULL rather
+     *  than waiting while that happens.  A rebuild doesn't affect an index
+     *  which an earlier caller is still using.
+     *
+     *  @return The index, or NULL if there isn't one for the current
+     *		revision yet, or this shard is writable (or doesn't support
+     *		revisions) so the index can't be kept current.
+     */
+    std::shared_ptr<const TermNgramIndex> get_term_ngram_index() const;
+
     virtual PositionList* open_position_list(docid did,
 					     const std::string& term) const = 0;
 
@@ -273,6 +353,20 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
      */
     virtual TermList* open_spelling_termlist(const std::string& word) const;
 
+    /** Create a list of spelling candidates using symmetric deletes.
+     *
+     *  The list must contain every spelling word within @a max_edit_distance
+     *  edits of @a word, but may contain others.
+     *
+     *  You can assume word.size() > 1.
+     *
+     *  If there's no symmetric delete index covering @a max_edit_distance,
+     *  returns NULL and the caller should use open_spelling_termlist()
+     *  instead.
+     */
+    virtual TermList* open_spelling_deletes_termlist(const std::string& word,
+						     unsigned max_edit_distance) const;
+
     /** Return a termlist which returns the words which are spelling
      *  correction targets.
      *
@@ -401,14 +495,22 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
     virtual docid replace_document(const std::string& unique_term,
 				   const Document& document);
 
+    /** Set the value in slot @a slot of document @a did.
+     *
+     *  An empty @a value removes any value in the slot.
+     *
+     *  The default implementation reads the document, sets the value and
+     *  replaces the document with it.
+     */
+    virtual void set_document_value(docid did, valueno slot,
+				    const std::string& value);
+
     /** Request a document.
      *
      *  This tells the database that we're going to want a particular
      *  document soon.  It's just a hint which the backend may ignore,
      *  but for glass it issues a preread hint on the file with the
-     *  document data in, and for the remote backend it might cause
-     *  the document to be fetched asynchronously (this isn't currently
-     *  implemented though).
+     *  document data in.
      *
      *  It can be called for multiple documents in turn, and a common usage
      *  pattern would be to iterate over an MSet and request the documents,
@@ -418,15 +520,28 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
      */
     virtual void request_document(docid did) const;
 
+    /** Request several documents.
+     *
+     *  Like request_document(), but for a batch of documents, which allows
+     *  the remote backend to fetch them all in a single round trip.
+     *
+     *  The default implementation calls request_document() for each
+     *  document.
+     */
+    virtual void request_documents(const std::vector<docid>& dids) const;
+
     /** Write a set of changesets to a file descriptor.
      *
      *  This call may reopen the database, leaving it pointing to a more
      *  recent version of the database.
+     *
+     *  If compress is true, larger messages are sent compressed.
      */
     virtual void write_changesets_to_fd(int fd,
 					const std::string& start_revision,
 					bool need_whole_db,
-					ReplicationInfo* info);
+					ReplicationInfo* info,
+					bool compress);
 
     /// Get revision number of database (if meaningful).
     virtual Xapian::rev get_revision() const;
@@ -498,6 +613,16 @@ class Database::Internal : public Xapian::Internal::intrusive_base {
      */
     virtual Internal* update_lock(int flags);
 
+    /** Open another handle on this database for use by a different thread.
+     *
+     *  This is the internal method behind Database::clone().
+     *
+     *  The new object shares open files and the revision being read with
+     *  this one, but has its own cursors.  The default implementation
+     *  throws Xapian::UnimplementedError.
+     */
+    virtual Internal* clone() const;
+
     virtual std::string reconstruct_text(Xapian::docid did,
 					 size_t length,
 					 const std::string& prefix,
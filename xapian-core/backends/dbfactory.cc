@@ -41,6 +41,7 @@
 
 #ifdef XAPIAN_HAS_GLASS_BACKEND
 # include "glass/glass_database.h"
+# include "glass/glass_segmented.h"
 #endif
 #include "glass/glass_defs.h"
 #ifdef XAPIAN_HAS_HONEY_BACKEND
@@ -386,6 +387,10 @@ WritableDatabase::WritableDatabase(const std::string &path, int flags, int block
 	    // by preference.
 #ifdef XAPIAN_HAS_GLASS_BACKEND
 	case DB_BACKEND_GLASS:
+	    if (flags & DB_SEGMENTED_COMMITS) {
+		internal = new GlassSegmentedDatabase(path, flags, block_size);
+		return;
+	    }
 	    internal = new GlassWritableDatabase(path, flags, block_size);
 	    return;
 #endif
@@ -22,11 +22,15 @@
 
 #include <xapian/dbfactory.h>
 
+#include "backends/backends.h"
+#include "backends/remote/remote-database.h"
 #include "debuglog.h"
 #include "net/progclient.h"
 #include "net/remotetcpclient.h"
+#include "xapian/error.h"
 
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -37,8 +41,8 @@ Remote::open(const string &host, unsigned int port, unsigned timeout_,
 	     unsigned connect_timeout)
 {
     LOGCALL_STATIC(API, Database, "Remote::open", host | port | timeout_ | connect_timeout);
-    RETURN(Database(new RemoteTcpClient(host, port, timeout_ * 1e-3,
-					connect_timeout * 1e-3, false, 0)));
+    RETURN(Database(RemoteTcpClient::open(host, port, timeout_ * 1e-3,
+					  connect_timeout * 1e-3)));
 }
 
 WritableDatabase
@@ -69,4 +73,42 @@ Remote::open_writable(const string &program, const string &args,
 					   timeout_ * 1e-3, true, flags)));
 }
 
+Database
+Remote::replicated(const vector<Database>& dbs, double hedge_percentile)
+{
+    LOGCALL_STATIC(API, Database, "Remote::replicated", dbs.size() | hedge_percentile);
+    if (dbs.empty()) {
+	throw InvalidArgumentError("Remote::replicated(): no databases");
+    }
+    if (!(hedge_percentile >= 0.0 && hedge_percentile <= 100.0)) {
+	throw InvalidArgumentError("Remote::replicated(): hedge_percentile "
+				   "must be between 0 and 100");
+    }
+    for (const Database& db : dbs) {
+	if (db.internal->size() != 1 ||
+	    db.internal->get_backend_info(NULL) != BACKEND_REMOTE) {
+	    throw InvalidArgumentError("Remote::replicated(): each database "
+				       "must be a single remote database");
+	}
+    }
+    using Xapian::Internal::intrusive_ptr;
+    vector<intrusive_ptr<Database::Internal>> replicas;
+    replicas.reserve(dbs.size() - 1);
+    for (size_t i = 1; i != dbs.size(); ++i) {
+	Database::Internal* internal = dbs[i].internal.get();
+	if (internal == dbs[0].internal.get()) {
+	    throw InvalidArgumentError("Remote::replicated(): the first "
+				       "database can't also be a replica");
+	}
+	if (static_cast<RemoteDatabase*>(internal)->get_replica_count()) {
+	    throw InvalidArgumentError("Remote::replicated(): a replica can't "
+				       "have replicas of its own");
+	}
+	replicas.emplace_back(internal);
+    }
+    auto primary = static_cast<RemoteDatabase*>(dbs[0].internal.get());
+    primary->set_replicas(std::move(replicas), hedge_percentile);
+    RETURN(dbs[0]);
+}
+
 }
@@ -72,6 +72,26 @@ Document::Internal::ensure_values_fetched() const
     }
 }
 
+Document::Internal*
+Document::Internal::unshared_copy() const
+{
+    unique_ptr<Internal> copy(new Internal());
+    copy->data.reset(new string(get_data()));
+
+    ensure_terms_fetched();
+    copy->terms.reset(new map<string, TermInfo>());
+    for (auto&& i : *terms) {
+	copy->terms->emplace_hint(copy->terms->end(),
+				  i.first, i.second.unshared_copy());
+    }
+    copy->termlist_size = termlist_size;
+    copy->positions_modified_ = true;
+
+    ensure_values_fetched();
+    copy->values.reset(new map<Xapian::valueno, string>(*values));
+    return copy.release();
+}
+
 string
 Document::Internal::fetch_data() const
 {
@@ -237,6 +237,35 @@ class Document::Internal : public Xapian::Internal::intrusive_base {
 	return fetch_data();
     }
 
+    /** Read the data and values from the database now.
+     *
+     *  Used by MSet::fetch() so that later calls to get_data() and
+     *  get_value() don't need to access the database.
+     */
+    void fetch_data_and_values() {
+	if (!data)
+	    data.reset(new std::string(fetch_data()));
+	ensure_values_fetched();
+    }
+
+    /** Read the data, values and terms from the database now.
+     *
+     *  Used by MultiDatabase for shards which are updated by a writer thread,
+     *  so the document doesn't read from the shard while it's being updated.
+     */
+    void fetch_all() {
+	fetch_data_and_values();
+	ensure_terms_fetched();
+    }
+
+    /** Return a copy of this document which shares nothing with it.
+     *
+     *  The data, terms and values are read from the database first if
+     *  necessary, and the copy doesn't refer to the database.  Used by
+     *  MultiDatabase to hand a document over to a shard's writer thread.
+     */
+    Internal* unshared_copy() const;
+
     /// Set the document data.
     void set_data(const std::string& data_) {
 	data.reset(new std::string(data_));
@@ -252,7 +252,8 @@ void
 EmptyDatabase::write_changesets_to_fd(int,
 				      const std::string&,
 				      bool,
-				      Xapian::ReplicationInfo*)
+				      Xapian::ReplicationInfo*,
+				      bool)
 {
     throw Xapian::InvalidOperationError("write_changesets_to_fd() with "
 					"no subdatabases");
@@ -371,6 +372,12 @@ EmptyDatabase::set_metadata(const string&, const string&)
     no_subdatabases();
 }
 
+Xapian::Database::Internal*
+EmptyDatabase::clone() const
+{
+    return new EmptyDatabase();
+}
+
 string
 EmptyDatabase::get_description() const
 {
@@ -99,7 +99,8 @@ class EmptyDatabase : public Xapian::Database::Internal {
     void write_changesets_to_fd(int fd,
 				const std::string& start_revision,
 				bool need_whole_db,
-				Xapian::ReplicationInfo* info);
+				Xapian::ReplicationInfo* info,
+				bool compress);
 
     void invalidate_doc_object(Xapian::Document::Internal* obj) const;
 
@@ -140,6 +141,8 @@ class EmptyDatabase : public Xapian::Database::Internal {
 
     void set_metadata(const std::string& key, const std::string& value);
 
+    Internal* clone() const;
+
     std::string get_description() const;
 };
 
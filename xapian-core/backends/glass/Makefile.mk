@@ -20,7 +20,9 @@ noinst_HEADERS +=\
 	backends/glass/glass_metadata.h\
 	backends/glass/glass_positionlist.h\
 	backends/glass/glass_postlist.h\
+	backends/glass/glass_reader.h\
 	backends/glass/glass_replicate_internal.h\
+	backends/glass/glass_segmented.h\
 	backends/glass/glass_spelling.h\
 	backends/glass/glass_spellingwordslist.h\
 	backends/glass/glass_synonym.h\
@@ -46,6 +48,7 @@ lib_src +=\
 	backends/glass/glass_metadata.cc\
 	backends/glass/glass_positionlist.cc\
 	backends/glass/glass_postlist.cc\
+	backends/glass/glass_segmented.cc\
 	backends/glass/glass_spelling.cc\
 	backends/glass/glass_spellingwordslist.cc\
 	backends/glass/glass_synonym.cc\
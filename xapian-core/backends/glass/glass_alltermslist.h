@@ -25,6 +25,7 @@
 #include "backends/alltermslist.h"
 #include "glass_database.h"
 #include "glass_postlist.h"
+#include "glass_reader.h"
 
 class GlassCursor;
 
@@ -38,6 +39,9 @@ class GlassAllTermsList : public AllTermsList {
     /// Keep a reference to our database to stop it being deleted.
     Xapian::Internal::intrusive_ptr<const GlassDatabase> database;
 
+    /// Stop the tables being changed in the background while we exist.
+    GlassReader reader_guard;
+
     /** A cursor which runs through the postlist table reading termnames from
      *  the keys.
      */
@@ -62,7 +66,7 @@ class GlassAllTermsList : public AllTermsList {
   public:
     GlassAllTermsList(Xapian::Internal::intrusive_ptr<const GlassDatabase> database_,
 		      const std::string & prefix_)
-	: database(database_), cursor(NULL), prefix(prefix_), termfreq(0) { }
+	: database(database_), reader_guard(database.get()), cursor(NULL), prefix(prefix_), termfreq(0) { }
 
     /// Destructor.
     ~GlassAllTermsList();
@@ -409,9 +409,20 @@ merge_spellings(GlassTable * out,
 		vector<const GlassTable*>::const_iterator e)
 {
     priority_queue<MergeCursor *, vector<MergeCursor *>, CursorGt> pq;
+    // We can only keep the symmetric delete lists if every input with any
+    // spelling data has them, covering the same edit distance.
+    bool keep_deletes = true;
+    string deletes_marker;
     for ( ; b != e; ++b) {
 	const GlassTable *in = *b;
 	if (!in->empty()) {
+	    string marker;
+	    if (!in->get_exact_entry("D", marker) ||
+		(!deletes_marker.empty() && marker != deletes_marker)) {
+		keep_deletes = false;
+	    } else {
+		deletes_marker = marker;
+	    }
 	    pq.push(new MergeCursor(in));
 	}
     }
@@ -421,6 +432,25 @@ merge_spellings(GlassTable * out,
 	pq.pop();
 
 	string key = cur->current_key;
+	if (key[0] == 'D' && (key.size() == 1 || !keep_deletes)) {
+	    // Either the marker, which we only want to write once, or a delete
+	    // list we're dropping.  Skip this key in every input.
+	    if (keep_deletes) {
+		out->add(key, deletes_marker);
+	    }
+	    while (true) {
+		if (cur->next()) {
+		    pq.push(cur);
+		} else {
+		    delete cur;
+		}
+		if (pq.empty() || pq.top()->current_key != key) break;
+		cur = pq.top();
+		pq.pop();
+	    }
+	    continue;
+	}
+
 	if (pq.empty() || pq.top()->current_key > key) {
 	    // No need to merge the tags, just copy the (possibly compressed)
 	    // tag value.
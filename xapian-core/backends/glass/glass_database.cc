@@ -44,6 +44,7 @@
 #include "glass_metadata.h"
 #include "glass_positionlist.h"
 #include "glass_postlist.h"
+#include "glass_reader.h"
 #include "glass_replicate_internal.h"
 #include "glass_spellingwordslist.h"
 #include "glass_termlist.h"
@@ -76,22 +77,6 @@ using namespace std;
 using namespace Xapian;
 using Xapian::Internal::intrusive_ptr;
 
-// The maximum safe term length is determined by the postlist.  There we
-// store the term using pack_string_preserving_sort() which takes the
-// length of the string plus an extra byte (assuming the string doesn't
-// contain any zero bytes), followed by the docid with encoded with
-// pack_uint_preserving_sort() which takes up to 5 bytes (for a 32-bit
-// docid).
-//
-// The Btree manager's key length limit is 255 bytes so the maximum safe term
-// length is 255 - 1 - 5 = 249 bytes.  We actually set the limit at 245 for
-// consistency with flint and chert, and also because this allows for 64-bit
-// docids.
-//
-// If the term contains zero bytes, the limit is lower (by one for each zero
-// byte in the term).
-#define MAX_SAFE_TERM_LENGTH 245
-
 /* This opens the tables, determining the current and next revision numbers,
  * and stores handles to the tables.
  */
@@ -184,6 +169,44 @@ GlassDatabase::GlassDatabase(int fd)
     open_tables(Xapian::DB_READONLY_);
 }
 
+GlassDatabase::GlassDatabase(const GlassDatabase& o)
+	: Xapian::Database::Internal(TRANSACTION_READONLY),
+	  db_dir(o.db_dir),
+	  readonly(true),
+	  version_file(o.version_file),
+	  postlist_table(db_dir, readonly),
+	  position_table(db_dir, readonly),
+	  termlist_table(db_dir, readonly, true),
+	  value_manager(&postlist_table, &termlist_table),
+	  synonym_table(db_dir, readonly),
+	  spelling_table(db_dir, readonly),
+	  docdata_table(db_dir, readonly),
+	  lock(db_dir),
+	  changes(db_dir)
+{
+    LOGCALL_CTOR(DB, "GlassDatabase", Literal("clone"));
+    Assert(o.readonly);
+    Assert(!o.db_dir.empty());
+
+    int flags = o.postlist_table.get_flags();
+    glass_revision_number_t rev = version_file.get_revision();
+    docdata_table.open(flags, version_file.get_root(Glass::DOCDATA), rev,
+		       o.docdata_table);
+    spelling_table.open(flags, version_file.get_root(Glass::SPELLING), rev,
+			o.spelling_table);
+    synonym_table.open(flags, version_file.get_root(Glass::SYNONYM), rev,
+		       o.synonym_table);
+    termlist_table.open(flags, version_file.get_root(Glass::TERMLIST), rev,
+			o.termlist_table);
+    position_table.open(flags, version_file.get_root(Glass::POSITION), rev,
+			o.position_table);
+    postlist_table.open(flags, version_file.get_root(Glass::POSTLIST), rev,
+			o.postlist_table);
+
+    Xapian::termcount swfub = version_file.get_spelling_wordfreq_upper_bound();
+    spelling_table.set_wordfreq_upper_bound(swfub);
+}
+
 GlassDatabase::~GlassDatabase()
 {
     LOGCALL_DTOR(DB, "GlassDatabase");
@@ -382,12 +405,13 @@ GlassDatabase::request_document(Xapian::docid did) const
 void
 GlassDatabase::readahead_for_query(const Xapian::Query &query) const
 {
+    vector<string> keys;
     Xapian::TermIterator t;
     for (t = query.get_unique_terms_begin(); t != Xapian::TermIterator(); ++t) {
-	const string & term = *t;
-	if (!postlist_table.readahead_key(GlassPostListTable::make_key(term)))
-	    break;
+	keys.push_back(GlassPostListTable::make_key(*t));
     }
+    if (!keys.empty())
+	postlist_table.readahead_keys(keys);
 }
 
 bool
@@ -472,13 +496,128 @@ GlassDatabase::send_whole_database(RemoteConnection & conn, double end_time)
 #endif
 }
 
+bool
+GlassDatabase::send_changed_blocks(RemoteConnection& conn,
+				   glass_revision_number_t start_rev,
+				   glass_revision_number_t& end_rev,
+				   double end_time)
+{
+    LOGCALL(DB, bool, "GlassDatabase::send_changed_blocks", conn | start_rev | end_rev | end_time);
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+    if (single_file())
+	RETURN(false);
+
+    // Read the version file first - blocks which it says are live can't be
+    // overwritten until two revisions after it.
+    GlassVersion snapshot(db_dir);
+    string version_data;
+    snapshot.read(&version_data);
+    glass_revision_number_t rev = snapshot.get_revision();
+    if (rev <= start_rev || snapshot.get_uuid_string() != get_uuid())
+	RETURN(false);
+
+    FILE* tmp = tmpfile();
+    if (!tmp)
+	throw Xapian::DatabaseError("Couldn't create temporary file", errno);
+    try {
+	int tmp_fd = fileno(tmp);
+	string buf = CHANGES_MAGIC_STRING;
+	buf += char(CHANGES_VERSION);
+	pack_uint(buf, start_rev);
+	pack_uint(buf, rev);
+	buf += '\x00'; // Changes can be applied to a live database.
+	io_write(tmp_fd, buf.data(), buf.size());
+
+	// In the same order as Glass::table_type.
+	static const char* const tablenames[Glass::MAX_] = {
+	    "postlist", "docdata", "termlist", "position", "spelling", "synonym"
+	};
+	unique_ptr<char[]> block;
+	unsigned block_buf_size = 0;
+	for (unsigned table = 0; table != Glass::MAX_; ++table) {
+	    string path = db_dir;
+	    path += '/';
+	    path += tablenames[table];
+	    path += "." GLASS_TABLE_EXTENSION;
+	    FD fd(posixy_open(path.c_str(), O_RDONLY | O_CLOEXEC));
+	    if (fd < 0) {
+		// Lazily created tables may not exist yet.
+		if (errno == ENOENT) continue;
+		throw Xapian::DatabaseOpeningError("Couldn't open " + path,
+						   errno);
+	    }
+
+	    unsigned block_size =
+		snapshot.get_root(Glass::table_type(table)).get_blocksize();
+	    unsigned v = 0;
+	    while ((unsigned(GLASS_MIN_BLOCKSIZE) << v) < block_size) ++v;
+	    if (block_size > block_buf_size) {
+		block.reset(new char[block_size]);
+		block_buf_size = block_size;
+	    }
+	    off_t size = file_size(fd);
+	    glass_block_t n_blocks = glass_block_t(size / block_size);
+	    for (glass_block_t n = 0; n != n_blocks; ++n) {
+		io_read_block(fd, block.get(), block_size, n);
+		glass_revision_number_t block_rev =
+		    Glass::REVISION(reinterpret_cast<const uint8_t*>(block.get()));
+		if (block_rev <= start_rev)
+		    continue;
+		if (block_rev > rev + 1) {
+		    // This block could have been live in revision rev.
+		    fclose(tmp);
+		    RETURN(false);
+		}
+		buf.assign(1, char(table | (v << 3)));
+		pack_uint(buf, n);
+		io_write(tmp_fd, buf.data(), buf.size());
+		io_write(tmp_fd, block.get(), block_size);
+	    }
+	}
+
+	buf.assign(1, '\xfe');
+	pack_uint(buf, rev);
+	pack_uint(buf, version_data.size());
+	buf += version_data;
+	buf += '\xff';
+	io_write(tmp_fd, buf.data(), buf.size());
+
+	// If a second revision was committed while we were reading, blocks
+	// which were live in revision rev might have been overwritten.
+	GlassVersion check(db_dir);
+	check.read();
+	if (check.get_revision() > rev + 1) {
+	    fclose(tmp);
+	    RETURN(false);
+	}
+
+	if (lseek(tmp_fd, 0, SEEK_SET) < 0)
+	    throw Xapian::DatabaseError("Couldn't seek temporary file", errno);
+	conn.send_file(REPL_REPLY_CHANGESET, tmp_fd, end_time);
+    } catch (...) {
+	fclose(tmp);
+	throw;
+    }
+    fclose(tmp);
+    end_rev = rev;
+    RETURN(true);
+#else
+    (void)conn;
+    (void)start_rev;
+    (void)end_rev;
+    (void)end_time;
+    RETURN(false);
+#endif
+}
+
 void
 GlassDatabase::write_changesets_to_fd(int fd,
 				      const string & revision,
 				      bool need_whole_db,
-				      ReplicationInfo * info)
+				      ReplicationInfo * info,
+				      bool compress)
 {
-    LOGCALL_VOID(DB, "GlassDatabase::write_changesets_to_fd", fd | revision | need_whole_db | info);
+    LOGCALL_VOID(DB, "GlassDatabase::write_changesets_to_fd", fd | revision | need_whole_db | info | compress);
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
     int whole_db_copies_left = MAX_DB_COPIES_PER_CONVERSATION;
     glass_revision_number_t start_rev_num = 0;
@@ -492,7 +631,14 @@ GlassDatabase::write_changesets_to_fd(int fd,
 	need_whole_db = true;
     }
 
+    // If the replica has a revision of this database, we can try to bring it
+    // up to date with just the changed blocks if the changesets it needs
+    // aren't available.
+    bool try_changed_blocks = !need_whole_db;
+
     RemoteConnection conn(-1, fd, string());
+    if (compress)
+	conn.enable_compression();
 
     // While the starting revision number is less than the latest revision
     // number, look for a changeset, and write it.
@@ -501,6 +647,22 @@ GlassDatabase::write_changesets_to_fd(int fd,
     // likely to need, first, and then start sending them, so that there's no
     // risk of them disappearing while we're sending earlier ones.
     while (true) {
+	if (need_whole_db && try_changed_blocks) {
+	    // The replica has a revision of this database, so try sending it
+	    // just the blocks which have changed since.
+	    try_changed_blocks = false;
+	    glass_revision_number_t end_rev_num;
+	    if (send_changed_blocks(conn, start_rev_num, end_rev_num, 0.0)) {
+		start_rev_num = end_rev_num;
+		if (info != NULL) {
+		    ++(info->changeset_count);
+		    if (start_rev_num >= needed_rev_num)
+			info->changed = true;
+		}
+		need_whole_db = false;
+		continue;
+	    }
+	}
 	if (need_whole_db) {
 	    // Decrease the counter of copies left to be sent, and fail
 	    // if we've already copied the database enough.  This ensures that
@@ -555,6 +717,7 @@ GlassDatabase::write_changesets_to_fd(int fd,
 		reopen();
 		if (start_uuid != get_uuid()) {
 		    need_whole_db = true;
+		    try_changed_blocks = false;
 		    continue;
 		}
 		if (start_rev_num >= get_revision()) {
@@ -600,6 +763,7 @@ GlassDatabase::write_changesets_to_fd(int fd,
     (void)revision;
     (void)need_whole_db;
     (void)info;
+    (void)compress;
 #endif
 }
 
@@ -765,6 +929,53 @@ GlassDatabase::get_wdfdocmax(Xapian::docid did) const
     RETURN(max_wdf);
 }
 
+vector<Xapian::termcount>
+GlassDatabase::get_doclengths(const vector<Xapian::docid>& dids) const
+{
+    vector<Xapian::termcount> result;
+    if (dids.empty()) return result;
+    result.reserve(dids.size());
+    // Use our own cursor over the doclen list rather than the one cached by
+    // the postlist table, so we don't move that away from where the matcher
+    // left it.
+    intrusive_ptr<const GlassDatabase> ptrtothis(this);
+    GlassPostList doclen_pl(ptrtothis, string(), false);
+    for (Xapian::docid did : dids) {
+	Assert(did != 0);
+	if (!doclen_pl.jump_to(did))
+	    throw Xapian::DocNotFoundError("Document " + str(did) + " not found");
+	result.push_back(doclen_pl.get_wdf());
+    }
+    return result;
+}
+
+vector<Xapian::termcount>
+GlassDatabase::get_unique_terms_counts(const vector<Xapian::docid>& dids) const
+{
+    vector<Xapian::termcount> result;
+    if (dids.empty()) return result;
+    result.reserve(dids.size());
+    // Read the header of each termlist entry with one cursor which moves
+    // forwards through the table, rather than building a GlassTermList for
+    // each document.
+    unique_ptr<GlassCursor> cursor(termlist_table.cursor_get());
+    for (Xapian::docid did : dids) {
+	Assert(did != 0);
+	if (!cursor.get() ||
+	    !cursor->find_exact(GlassTermListTable::make_key(did))) {
+	    throw Xapian::DocNotFoundError("No termlist for document " +
+					   str(did));
+	}
+	const char* p = cursor->current_tag.data();
+	const char* end = p + cursor->current_tag.size();
+	Xapian::termcount doclen, termlist_size;
+	GlassTermList::read_header(&p, end, doclen, termlist_size);
+	// As for get_unique_terms(), ensure unique_terms <= doclen.
+	result.push_back(min(termlist_size, doclen));
+    }
+    return result;
+}
+
 void
 GlassDatabase::get_freqs(const string & term,
 			 Xapian::doccount * termfreq_ptr,
@@ -900,8 +1111,17 @@ GlassDatabase::open_document(Xapian::docid did, bool lazy) const
 	(void)get_doclength(did);
     }
 
-    intrusive_ptr<const Database::Internal> ptrtothis(this);
-    RETURN(new GlassDocument(ptrtothis, did, &value_manager, &docdata_table));
+    RETURN(new GlassDocument(this, did, &value_manager, &docdata_table));
+}
+
+GlassReader::GlassReader(const GlassDatabase* db_)
+    : db(db_ && db_->reader_opened() ? db_ : NULL)
+{
+}
+
+GlassReader::~GlassReader()
+{
+    if (db) db->reader_closed();
 }
 
 void
@@ -940,6 +1160,13 @@ GlassDatabase::open_spelling_termlist(const string & word) const
     return spelling_table.open_termlist(word);
 }
 
+TermList *
+GlassDatabase::open_spelling_deletes_termlist(const string & word,
+					      unsigned max_edit_distance) const
+{
+    return spelling_table.open_deletes_termlist(word, max_edit_distance);
+}
+
 TermList *
 GlassDatabase::open_spelling_wordlist() const
 {
@@ -1054,6 +1281,24 @@ GlassDatabase::update_lock(int flags)
     return new GlassWritableDatabase(db_dir, Xapian::DB_OPEN, flags);
 }
 
+Xapian::Database::Internal*
+GlassDatabase::clone() const
+{
+    if (!postlist_table.is_open())
+	GlassTable::throw_database_closed();
+
+    if (!readonly) {
+	throw Xapian::InvalidOperationError("Can't clone a WritableDatabase");
+    }
+    if (single_file()) {
+	// The tables in a single-file database share an fd with the version
+	// file and read it at varying offsets, so can't easily be shared.
+	throw Xapian::UnimplementedError("clone() of a single-file database "
+					 "isn't supported");
+    }
+    return new GlassDatabase(*this);
+}
+
 string
 GlassDatabase::get_description() const
 {
@@ -1087,6 +1332,13 @@ GlassWritableDatabase::GlassWritableDatabase(const string &dir, int flags,
     }
     if (flush_threshold == 0)
 	flush_threshold = 10000;
+
+    if (flags & Xapian::DB_SPELLING_DELETES)
+	spelling_table.enable_deletes();
+
+    pipeline_updates = (flags & Xapian::DB_PIPELINE_UPDATES);
+
+    replay_segments(flags);
 }
 
 GlassWritableDatabase::~GlassWritableDatabase()
@@ -1440,6 +1692,69 @@ GlassWritableDatabase::replace_document(Xapian::docid did,
     check_flush_threshold();
 }
 
+Xapian::docid
+GlassWritableDatabase::replace_document(const string & unique_term,
+					const Xapian::Document & document)
+{
+    LOGCALL(DB, Xapian::docid, "GlassWritableDatabase::replace_document", unique_term | document);
+
+    Xapian::docid did;
+    if (!inverter.get_unique_term(unique_term, did)) {
+	unique_ptr<PostList> pl(open_post_list(unique_term));
+	pl->next();
+	if (pl->at_end()) {
+	    did = 0;
+	} else {
+	    did = pl->get_docid();
+	    pl->next();
+	    if (!pl->at_end()) {
+		// The term indexes several documents, so leave it to the
+		// default implementation to delete all but the first.
+		pl.reset();
+		RETURN(Xapian::Database::Internal::replace_document(unique_term,
+								   document));
+	    }
+	}
+	inverter.set_unique_term(unique_term, did);
+    }
+
+    if (did == 0) {
+	RETURN(add_document(document));
+    }
+    replace_document(did, document);
+    RETURN(did);
+}
+
+void
+GlassWritableDatabase::set_document_value(Xapian::docid did,
+					  Xapian::valueno slot,
+					  const string & value)
+{
+    LOGCALL_VOID(DB, "GlassWritableDatabase::set_document_value", did | slot | value);
+    Assert(did != 0);
+
+    // Throw DocNotFoundError if the document doesn't exist.
+    (void)get_doclength(did);
+
+    if (rare(modify_shortcut_docid == did)) {
+	// The document's values no longer match those in the database, so
+	// it can't be used as a modification shortcut.
+	modify_shortcut_document = NULL;
+	modify_shortcut_docid = 0;
+    }
+
+    try {
+	value_manager.set_value(did, slot, value, value_stats);
+    } catch (...) {
+	// As for the other modifications, don't leave partial changes in
+	// memory to be written to disk later.
+	cancel();
+	throw;
+    }
+
+    check_flush_threshold();
+}
+
 Xapian::Document::Internal *
 GlassWritableDatabase::open_document(Xapian::docid did, bool lazy) const
 {
@@ -1480,6 +1795,31 @@ GlassWritableDatabase::get_unique_terms(Xapian::docid did) const
     RETURN(GlassDatabase::get_unique_terms(did));
 }
 
+vector<Xapian::termcount>
+GlassWritableDatabase::get_doclengths(const vector<Xapian::docid>& dids) const
+{
+    // Sweep the doclen list for the documents whose lengths aren't buffered,
+    // then merge in the buffered ones.
+    vector<Xapian::docid> stored_dids;
+    Xapian::termcount doclen;
+    for (Xapian::docid did : dids) {
+	if (!inverter.get_doclength(did, doclen))
+	    stored_dids.push_back(did);
+    }
+    auto stored = GlassDatabase::get_doclengths(stored_dids);
+    if (stored.size() == dids.size()) return stored;
+
+    vector<Xapian::termcount> result;
+    result.reserve(dids.size());
+    auto s = stored.begin();
+    for (Xapian::docid did : dids) {
+	if (!inverter.get_doclength(did, doclen))
+	    doclen = *s++;
+	result.push_back(doclen);
+    }
+    return result;
+}
+
 void
 GlassWritableDatabase::get_freqs(const string & term,
 				 Xapian::doccount * termfreq_ptr,
@@ -201,6 +201,33 @@ class GlassDatabase : public Xapian::Database::Internal {
      */
     void send_whole_database(RemoteConnection & conn, double end_time);
 
+    /** Send the blocks which have changed since a revision as a changeset.
+     *
+     *  Every block records the revision it was written in, and the blocks
+     *  which are live in the current revision but written no later than
+     *  @a start_rev are unchanged since then, so a replica at @a start_rev
+     *  can be brought up to date by sending it the blocks with a later
+     *  revision and the current version file.  This allows a replica to
+     *  catch up without a full copy when the changesets it needs are no
+     *  longer available.
+     *
+     *  The changeset is built in a temporary file first.  If the database
+     *  changes too much while doing so for the result to be consistent,
+     *  nothing is sent and false is returned.
+     *
+     *  @param conn		The connection to send the changeset over.
+     *  @param start_rev	The replica's revision.
+     *  @param[out] end_rev	The revision the changeset brings the replica
+     *				up to (set if true is returned).
+     *  @param end_time		Timeout for sending.
+     *
+     *  @return true if the changeset was sent.
+     */
+    bool send_changed_blocks(RemoteConnection& conn,
+			     glass_revision_number_t start_rev,
+			     glass_revision_number_t& end_rev,
+			     double end_time);
+
     /** Get the revision stored in a changeset.
      */
     void get_changeset_revisions(const string & path,
@@ -233,6 +260,13 @@ class GlassDatabase : public Xapian::Database::Internal {
 
     explicit GlassDatabase(int fd);
 
+    /** Open another handle on the revision @a o is reading.
+     *
+     *  The tables share file descriptors with those of @a o, but have their
+     *  own cursors.  Used to implement clone().
+     */
+    GlassDatabase(const GlassDatabase& o);
+
     ~GlassDatabase();
 
     /// Get a postlist table cursor (used by GlassValueList).
@@ -248,6 +282,10 @@ class GlassDatabase : public Xapian::Database::Internal {
     Xapian::termcount get_doclength(Xapian::docid did) const;
     Xapian::termcount get_unique_terms(Xapian::docid did) const;
     Xapian::termcount get_wdfdocmax(Xapian::docid did) const;
+    std::vector<Xapian::termcount>
+    get_doclengths(const std::vector<Xapian::docid>& dids) const;
+    std::vector<Xapian::termcount>
+    get_unique_terms_counts(const std::vector<Xapian::docid>& dids) const;
     void get_freqs(const string & term,
 		   Xapian::doccount * termfreq_ptr,
 		   Xapian::termcount * collfreq_ptr) const;
@@ -280,6 +318,8 @@ class GlassDatabase : public Xapian::Database::Internal {
     TermList * open_allterms(const string & prefix) const;
 
     TermList * open_spelling_termlist(const string & word) const;
+    TermList * open_spelling_deletes_termlist(const string & word,
+					      unsigned max_edit_distance) const;
     TermList * open_spelling_wordlist() const;
     Xapian::doccount get_spelling_frequency(const string & word) const;
 
@@ -291,7 +331,8 @@ class GlassDatabase : public Xapian::Database::Internal {
     void write_changesets_to_fd(int fd,
 				const string & start_revision,
 				bool need_whole_db,
-				Xapian::ReplicationInfo * info);
+				Xapian::ReplicationInfo * info,
+				bool compress);
     /** Get the revision number which the tables are opened at.
      *
      *  @return the current revision number.
@@ -319,10 +360,21 @@ class GlassDatabase : public Xapian::Database::Internal {
     /** Return true if there are uncommitted changes. */
     virtual bool has_uncommitted_changes() const;
 
+    /** Note that an object which reads from the tables has been created.
+     *
+     *  @return true if reader_closed() must be called when it's destroyed.
+     */
+    virtual bool reader_opened() const { return false; }
+
+    /// Note that an object which reader_opened() returned true for is gone.
+    virtual void reader_closed() const { }
+
     bool locked() const;
 
     Xapian::Database::Internal* update_lock(int flags);
 
+    Xapian::Database::Internal* clone() const;
+
     static void compact(Xapian::Compactor * compactor,
 			const char * destdir,
 			int fd,
@@ -363,6 +415,23 @@ class GlassWritableDatabase : public GlassDatabase {
      */
     mutable Xapian::docid modify_shortcut_docid;
 
+  protected:
+    /** Apply any segments left by a database opened with
+     *  Xapian::DB_SEGMENTED_COMMITS, then commit and remove them.
+     *
+     *  Defined in glass_segmented.cc.
+     */
+    void replay_segments(int flags);
+
+    /** Apply serialised changes from a segment to the tables.
+     *
+     *  @param data	The serialised changes.
+     *  @param start	The offset in @a data to start at.
+     *
+     *  Defined in glass_segmented.cc.
+     */
+    void apply_segment_changes(const std::string& data, size_t start);
+
     /** Check if we should autoflush.
      *
      *  Called at the end of each document changing operation.
@@ -390,16 +459,34 @@ class GlassWritableDatabase : public GlassDatabase {
     Xapian::docid add_document(const Xapian::Document& document);
     Xapian::docid add_document_(Xapian::docid did,
 				const Xapian::Document& document);
-    // Stop the default implementation of delete_document(term) and
-    // replace_document(term) from being hidden.  This isn't really
-    // a problem as we only try to call them through the base class
-    // (where they aren't hidden) but some compilers generate a warning
-    // about the hiding.
+    // Stop the default implementation of delete_document(term) from being
+    // hidden.  This isn't really a problem as we only try to call it
+    // through the base class (where it isn't hidden) but some compilers
+    // generate a warning about the hiding.
     using Xapian::Database::Internal::delete_document;
-    using Xapian::Database::Internal::replace_document;
     void delete_document(Xapian::docid did);
     void replace_document(Xapian::docid did, const Xapian::Document & document);
 
+    /** Replace any documents indexed by @a unique_term.
+     *
+     *  The first call for a term looks it up in the postlist table, and the
+     *  result is remembered in the inverter's unique term index, so later
+     *  calls with the same term don't need to look it up again.  The index
+     *  is only held in memory, so this only helps repeated updates of the
+     *  same term while this database is open.
+     */
+    Xapian::docid replace_document(const std::string & unique_term,
+				   const Xapian::Document & document);
+
+    /** Set a value in a document.
+     *
+     *  Only the value table and value statistics are updated, rather than
+     *  comparing the document's old and new termlists as replacing it
+     *  would.
+     */
+    void set_document_value(Xapian::docid did, Xapian::valueno slot,
+			    const std::string & value);
+
     Xapian::Document::Internal * open_document(Xapian::docid did,
 					       bool lazy) const;
 
@@ -425,6 +512,8 @@ class GlassWritableDatabase : public GlassDatabase {
     //@{
     Xapian::termcount get_doclength(Xapian::docid did) const;
     Xapian::termcount get_unique_terms(Xapian::docid did) const;
+    std::vector<Xapian::termcount>
+    get_doclengths(const std::vector<Xapian::docid>& dids) const;
     void get_freqs(const string & term,
 		   Xapian::doccount * termfreq_ptr,
 		   Xapian::termcount * collfreq_ptr) const;
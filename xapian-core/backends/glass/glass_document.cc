@@ -22,9 +22,20 @@
 
 #include "glass_document.h"
 
+#include "glass_database.h"
 #include "glass_docdata.h"
 #include "glass_values.h"
 
+GlassDocument::GlassDocument(const GlassDatabase* db,
+			     Xapian::docid did_,
+			     const GlassValueManager *value_manager_,
+			     const GlassDocDataTable *docdata_table_)
+    : Xapian::Document::Internal(db, did_),
+      value_manager(value_manager_), docdata_table(docdata_table_),
+      reader_guard(db)
+{
+}
+
 string
 GlassDocument::fetch_value(Xapian::valueno slot) const
 {
@@ -22,10 +22,13 @@
 #define XAPIAN_INCLUDED_GLASS_DOCUMENT_H
 
 #include "glass_docdata.h"
+#include "glass_reader.h"
 #include "glass_values.h"
 #include "backends/databaseinternal.h"
 #include "backends/documentinternal.h"
 
+class GlassDatabase;
+
 /// A document read from a GlassDatabase.
 class GlassDocument : public Xapian::Document::Internal {
     /// Don't allow assignment.
@@ -40,16 +43,17 @@ class GlassDocument : public Xapian::Document::Internal {
     /// Used for lazy access to document data.
     const GlassDocDataTable *docdata_table;
 
+    /// Stop the tables being changed in the background while we exist.
+    GlassReader reader_guard;
+
     /// GlassDatabase::open_document() needs to call our private constructor.
     friend class GlassDatabase;
 
     /// Private constructor - only called by GlassDatabase::open_document().
-    GlassDocument(Xapian::Internal::intrusive_ptr<const Xapian::Database::Internal> db,
+    GlassDocument(const GlassDatabase* db,
 		  Xapian::docid did_,
 		  const GlassValueManager *value_manager_,
-		  const GlassDocDataTable *docdata_table_)
-	: Xapian::Document::Internal(db, did_),
-	  value_manager(value_manager_), docdata_table(docdata_table_) { }
+		  const GlassDocDataTable *docdata_table_);
 
   protected:
     /** Implementation of virtual methods @{ */
@@ -145,7 +145,23 @@ Inverter::has_positions(const GlassPositionListTable & position_table) const
     }
 
     // We have positions unless all the existing entries are removed.
-    return changes != position_table.get_entry_count();
+    glass_tablesize_t entries = position_table.get_entry_count();
+    if (changes < entries)
+	return true;
+    if (entries == 0)
+	return false;
+
+    // Replacing a document records removals for terms without positions
+    // too, so count only the removals of entries which actually exist.
+    changes = 0;
+    for (const auto& i : pos_changes) {
+	for (const auto& j : i.second) {
+	    if (position_table.key_exists(position_table.make_key(j.first,
+								  i.first)))
+		++changes;
+	}
+    }
+    return changes != entries;
 }
 
 void
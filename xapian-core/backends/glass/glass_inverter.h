@@ -27,6 +27,7 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "omassert.h"
@@ -119,6 +120,41 @@ class Inverter {
     /// Buffered changes to positional data.
     std::map<std::string, std::map<Xapian::docid, std::string>> pos_changes;
 
+    /// Maximum number of entries in unique_terms.
+    static constexpr size_t MAX_UNIQUE_TERMS = 262144;
+
+    /** Index from "unique" terms to the document indexed by them.
+     *
+     *  An entry maps a term to the only document indexed by it, or to 0 if
+     *  no document is.  Entries are added by set_unique_term(), and kept up
+     *  to date as postings are added and removed, so the entries remain
+     *  valid until clear() is called.  Terms which index several documents
+     *  don't have an entry.
+     */
+    std::unordered_map<std::string, Xapian::docid> unique_terms;
+
+    /// Update unique_terms for a posting of @a term being added to @a did.
+    void unique_term_added(Xapian::docid did, const std::string& term) {
+	auto i = unique_terms.find(term);
+	if (i == unique_terms.end()) return;
+	if (i->second == 0) {
+	    i->second = did;
+	} else if (i->second != did) {
+	    unique_terms.erase(i);
+	}
+    }
+
+    /// Update unique_terms for a posting of @a term being removed from @a did.
+    void unique_term_removed(Xapian::docid did, const std::string& term) {
+	auto i = unique_terms.find(term);
+	if (i == unique_terms.end()) return;
+	if (i->second == did) {
+	    i->second = 0;
+	} else {
+	    unique_terms.erase(i);
+	}
+    }
+
     void store_positions(const GlassPositionListTable & position_table,
 			 Xapian::docid did,
 			 const std::string & tname,
@@ -136,6 +172,8 @@ class Inverter {
   public:
     void add_posting(Xapian::docid did, const std::string & term,
 		     Xapian::doccount wdf) {
+	if (!unique_terms.empty())
+	    unique_term_added(did, term);
 	std::map<std::string, PostingChanges>::iterator i;
 	i = postlist_changes.find(term);
 	if (i == postlist_changes.end()) {
@@ -148,6 +186,8 @@ class Inverter {
 
     void remove_posting(Xapian::docid did, const std::string & term,
 			Xapian::doccount wdf) {
+	if (!unique_terms.empty())
+	    unique_term_removed(did, term);
 	std::map<std::string, PostingChanges>::iterator i;
 	i = postlist_changes.find(term);
 	if (i == postlist_changes.end()) {
@@ -190,6 +230,34 @@ class Inverter {
 	doclen_changes.clear();
 	postlist_changes.clear();
 	pos_changes.clear();
+	unique_terms.clear();
+    }
+
+    /** Look up the document indexed by @a term in the unique term index.
+     *
+     *  @param[out] did	The only document indexed by @a term, or 0 if no
+     *			document is.
+     *
+     *  @return true if @a term is in the index.
+     */
+    bool get_unique_term(const std::string& term, Xapian::docid& did) const {
+	auto i = unique_terms.find(term);
+	if (i == unique_terms.end()) return false;
+	did = i->second;
+	return true;
+    }
+
+    /** Add @a term to the unique term index.
+     *
+     *  @param did	The only document indexed by @a term, or 0 if no
+     *			document is.
+     */
+    void set_unique_term(const std::string& term, Xapian::docid did) {
+	if (unique_terms.size() >= MAX_UNIQUE_TERMS) {
+	    // Start again rather than letting the index grow without limit.
+	    unique_terms.clear();
+	}
+	unique_terms[term] = did;
     }
 
     void set_doclength(Xapian::docid did, Xapian::termcount doclen, bool add) {
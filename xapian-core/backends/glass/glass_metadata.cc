@@ -24,6 +24,7 @@
 #include "glass_metadata.h"
 
 #include "glass_cursor.h"
+#include "glass_database.h"
 
 #include "backends/databaseinternal.h"
 #include "debuglog.h"
@@ -39,7 +40,9 @@ GlassMetadataTermList::GlassMetadataTermList(
 	intrusive_ptr<const Xapian::Database::Internal> database_,
 	GlassCursor * cursor_,
 	const string &prefix_)
-	: database(database_), cursor(cursor_), prefix(string("\x00\xc0", 2) + prefix_)
+	: database(database_),
+	  reader_guard(static_cast<const GlassDatabase*>(database.get())),
+	  cursor(cursor_), prefix(string("\x00\xc0", 2) + prefix_)
 {
     LOGCALL_CTOR(DB, "GlassMetadataTermList", database_ | cursor_ | prefix_);
     Assert(cursor);
@@ -28,6 +28,7 @@
 
 #include "backends/alltermslist.h"
 #include "glass_table.h"
+#include "glass_reader.h"
 #include "api/termlist.h"
 
 #include <string>
@@ -44,6 +45,9 @@ class GlassMetadataTermList : public AllTermsList {
     /// Keep a reference to our database to stop it being deleted.
     Xapian::Internal::intrusive_ptr<const Xapian::Database::Internal> database;
 
+    /// Stop the tables being changed in the background while we exist.
+    GlassReader reader_guard;
+
     /** A cursor which runs through the postlist table reading metadata keys.
      */
     GlassCursor * cursor;
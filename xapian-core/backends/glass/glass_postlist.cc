@@ -699,6 +699,7 @@ GlassPostList::GlassPostList(intrusive_ptr<const GlassDatabase> this_db_,
 			     bool keep_reference)
 	: LeafPostList(term_),
 	  this_db(keep_reference ? this_db_ : NULL),
+	  reader_guard(this_db.get()),
 	  have_started(false),
 	  is_at_end(false),
 	  cursor(this_db_->postlist_table.cursor_get())
@@ -712,6 +713,7 @@ GlassPostList::GlassPostList(intrusive_ptr<const GlassDatabase> this_db_,
 			     GlassCursor * cursor_)
 	: LeafPostList(term_),
 	  this_db(this_db_),
+	  reader_guard(this_db.get()),
 	  have_started(false),
 	  is_at_end(false),
 	  cursor(cursor_)
@@ -31,6 +31,7 @@
 #include "glass_defs.h"
 #include "glass_inverter.h"
 #include "glass_positionlist.h"
+#include "glass_reader.h"
 #include "omassert.h"
 
 #include <memory>
@@ -85,6 +86,8 @@ class GlassPostListTable : public GlassTable {
 	GlassTable::open(flags_, root_info, rev);
     }
 
+    using GlassTable::open;
+
     /// Merge changes for a term.
     void merge_changes(const string& term,
 		       const Inverter::PostingChanges& changes);
@@ -149,6 +152,9 @@ class GlassPostList : public LeafPostList {
      */
     Xapian::Internal::intrusive_ptr<const GlassDatabase> this_db;
 
+    /// Stop the tables being changed in the background while we exist.
+    GlassReader reader_guard;
+
     /// The position list object for this posting list.
     GlassRePositionList* positionlist = NULL;
 
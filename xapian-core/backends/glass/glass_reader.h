@@ -0,0 +1,53 @@
+/** @file glass_reader.h
+ * @brief Register an object which reads from a glass database
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_GLASS_READER_H
+#define XAPIAN_INCLUDED_GLASS_READER_H
+
+class GlassDatabase;
+
+/** Tell a database that an object which reads its tables exists.
+ *
+ *  Iterators and documents which keep a reference to their database hold one
+ *  of these, so a GlassSegmentedDatabase knows not to change the tables from
+ *  its background thread while they might be read.
+ */
+class GlassReader {
+    /// Don't allow assignment.
+    GlassReader& operator=(const GlassReader&) = delete;
+
+    /// Don't allow copying.
+    GlassReader(const GlassReader&) = delete;
+
+    /// The database to tell when we're destroyed, or NULL.
+    const GlassDatabase* db;
+
+  public:
+    /** Constructor.
+     *
+     *  @param db_	The database read from, or NULL if the object doesn't
+     *			keep a reference to it.
+     */
+    explicit GlassReader(const GlassDatabase* db_);
+
+    ~GlassReader();
+};
+
+#endif // XAPIAN_INCLUDED_GLASS_READER_H
@@ -0,0 +1,1094 @@
+/** @file glass_segmented.cc
+ * @brief Glass database which commits by writing segments of changes
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "glass_segmented.h"
+
+#include "xapian/constants.h"
+#include "xapian/error.h"
+
+#include "backends/postlist.h"
+#include "fd.h"
+#include "glass_defs.h"
+#include "glass_table.h"
+#include "io_utils.h"
+#include "net/serialise.h"
+#include "pack.h"
+#include "parseint.h"
+#include "posixy_wrapper.h"
+#include "safedirent.h"
+#include "safefcntl.h"
+#include "safeunistd.h"
+#include "str.h"
+#include "stringutils.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/// Magic string at the start of a segment file.
+#define SEGMENT_MAGIC "xapian-glass-segment\n"
+
+/// Prefix of the names of segment files.
+#define SEGMENT_PREFIX "segment"
+
+/// Suffix of a segment file which is being written.
+#define SEGMENT_TMP_SUFFIX ".tmp"
+
+/// The database the current thread is applying changes to the tables of.
+static thread_local const GlassSegmentedDatabase* applying = nullptr;
+
+namespace {
+
+/// Set the database being applied to for the lifetime of this object.
+class ApplyingGuard {
+    const GlassSegmentedDatabase* old;
+
+  public:
+    explicit ApplyingGuard(const GlassSegmentedDatabase* db) : old(applying) {
+	applying = db;
+    }
+
+    ~ApplyingGuard() { applying = old; }
+};
+
+}
+
+[[noreturn]]
+static void
+throw_bad_segment()
+{
+    throw Xapian::DatabaseCorruptError("Bad glass segment file");
+}
+
+static string
+segment_path(const string& dir, unsigned number)
+{
+    string path = dir;
+    path += "/" SEGMENT_PREFIX;
+    path += str(number);
+    return path;
+}
+
+/** Find the segment files in @a dir.
+ *
+ *  Any segment files left partly written are removed.
+ *
+ *  @return The numbers of the segments, in ascending order.
+ */
+static vector<unsigned>
+find_segments(const string& dir)
+{
+    vector<string> names;
+    DIR* d = opendir(dir.c_str());
+    if (d == NULL) {
+	throw Xapian::DatabaseOpeningError("Cannot open directory '" + dir +
+					   "'", errno);
+    }
+    while (true) {
+	errno = 0;
+	struct dirent* entry = readdir(d);
+	if (entry == NULL) {
+	    if (errno == 0) break;
+	    int saved_errno = errno;
+	    closedir(d);
+	    throw Xapian::DatabaseOpeningError("Cannot read entry from "
+					       "directory '" + dir + "'",
+					       saved_errno);
+	}
+	if (startswith(entry->d_name, SEGMENT_PREFIX))
+	    names.emplace_back(entry->d_name);
+    }
+    closedir(d);
+
+    vector<unsigned> numbers;
+    for (const string& name : names) {
+	if (endswith(name, SEGMENT_TMP_SUFFIX)) {
+	    io_unlink(dir + "/" + name);
+	    continue;
+	}
+	unsigned number;
+	if (parse_unsigned(name.c_str() + CONST_STRLEN(SEGMENT_PREFIX), number))
+	    numbers.push_back(number);
+    }
+    sort(numbers.begin(), numbers.end());
+    return numbers;
+}
+
+/// Read the changes from segment file @a filename.
+static string
+read_segment(const string& filename)
+{
+    int fd = posixy_open(filename.c_str(), O_RDONLY|O_BINARY|O_CLOEXEC);
+    if (fd < 0) {
+	throw Xapian::DatabaseOpeningError("Couldn't open segment file: " +
+					   filename, errno);
+    }
+    FD close_fd(fd);
+    string data;
+    char buf[65536];
+    size_t n;
+    do {
+	n = io_read(fd, buf, sizeof(buf));
+	data.append(buf, n);
+    } while (n == sizeof(buf));
+    if (!startswith(data, SEGMENT_MAGIC)) {
+	throw Xapian::DatabaseCorruptError("Segment file magic incorrect: " +
+					   filename);
+    }
+    data.erase(0, CONST_STRLEN(SEGMENT_MAGIC));
+    return data;
+}
+
+void
+GlassWritableDatabase::apply_segment_changes(const string& data,
+					     size_t start)
+{
+    // Call our own methods explicitly so that GlassSegmentedDatabase's
+    // overrides (which log changes rather than applying them) aren't used.
+    const char* p = data.data() + start;
+    const char* end = data.data() + data.size();
+    while (p != end) {
+	char op = *p++;
+	switch (op) {
+	    case 'R': {
+		Xapian::docid did;
+		string serialised;
+		if (!unpack_uint(&p, end, &did) ||
+		    !unpack_string(&p, end, serialised)) {
+		    throw_bad_segment();
+		}
+		GlassWritableDatabase::replace_document(
+		    did, unserialise_document(serialised));
+		break;
+	    }
+	    case 'D': {
+		Xapian::docid did;
+		if (!unpack_uint(&p, end, &did)) throw_bad_segment();
+		try {
+		    GlassWritableDatabase::delete_document(did);
+		} catch (const Xapian::DocNotFoundError&) {
+		    // The segment is being applied again after a crash.
+		}
+		break;
+	    }
+	    case 'T': {
+		string term;
+		if (!unpack_string(&p, end, term)) throw_bad_segment();
+		vector<Xapian::docid> dids;
+		{
+		    unique_ptr<PostList> pl(
+			GlassWritableDatabase::open_post_list(term));
+		    while (pl->next(), !pl->at_end()) {
+			dids.push_back(pl->get_docid());
+		    }
+		}
+		for (Xapian::docid did : dids) {
+		    GlassWritableDatabase::delete_document(did);
+		}
+		break;
+	    }
+	    case 'M': {
+		string key, value;
+		if (!unpack_string(&p, end, key) ||
+		    !unpack_string(&p, end, value)) {
+		    throw_bad_segment();
+		}
+		GlassWritableDatabase::set_metadata(key, value);
+		break;
+	    }
+	    case 'V': {
+		Xapian::docid did;
+		Xapian::valueno slot;
+		string value;
+		if (!unpack_uint(&p, end, &did) ||
+		    !unpack_uint(&p, end, &slot) ||
+		    !unpack_string(&p, end, value)) {
+		    throw_bad_segment();
+		}
+		try {
+		    GlassWritableDatabase::set_document_value(did, slot, value);
+		} catch (const Xapian::DocNotFoundError&) {
+		    // The segment is being applied again after a crash, and a
+		    // later segment deleted the document.
+		}
+		break;
+	    }
+	    default:
+		throw_bad_segment();
+	}
+    }
+}
+
+void
+GlassWritableDatabase::replay_segments(int flags)
+{
+    vector<unsigned> numbers = find_segments(db_dir);
+    if (numbers.empty()) return;
+
+    if ((flags & Xapian::DB_ACTION_MASK_) != Xapian::DB_CREATE_OR_OVERWRITE) {
+	// We're called from the constructor, so nothing holds a reference to
+	// us yet, but deleting a document briefly puts us in an intrusive_ptr
+	// which would delete us when it released the only reference.
+	++_refs;
+	try {
+	    for (unsigned number : numbers) {
+		string path = segment_path(db_dir, number);
+		apply_segment_changes(read_segment(path), 0);
+	    }
+	    GlassWritableDatabase::commit();
+	} catch (...) {
+	    --_refs;
+	    throw;
+	}
+	--_refs;
+    }
+
+    // Remove the segments in order, so if we're interrupted the ones left
+    // are still a suffix of the sequence.
+    for (unsigned number : numbers) {
+	io_unlink(segment_path(db_dir, number));
+    }
+}
+
+GlassSegmentedDatabase::GlassSegmentedDatabase(const string& dir_,
+					       int flags_,
+					       int block_size)
+    : GlassWritableDatabase(dir_, flags_, block_size),
+      flags(flags_),
+      dir(dir_)
+{
+    // Any segments have been applied by GlassWritableDatabase's constructor.
+    lastdocid = GlassWritableDatabase::get_lastdocid();
+    committed_lastdocid = lastdocid;
+}
+
+GlassSegmentedDatabase::~GlassSegmentedDatabase()
+{
+    dtor_called();
+    stop_applier();
+}
+
+bool
+GlassSegmentedDatabase::has_work() const
+{
+    if (error) return false;
+    for (auto&& seg : segments) {
+	if (seg.applied != seg.changes.size()) return true;
+    }
+    return (merge_needed || !segments.empty()) && !uncommitted_applied;
+}
+
+void
+GlassSegmentedDatabase::catch_up() const
+{
+    if (applying == this) return;
+    {
+	unique_lock<mutex> locker(m);
+	wait_until_idle(locker);
+	check_error();
+	if (tail_applied == tail.size()) return;
+	uncommitted_applied = true;
+    }
+
+    // The background thread is idle and stays so until the next commit(), so
+    // we can update the tables here.  They're mutable as far as callers which
+    // only read from the database are concerned.
+    auto self = const_cast<GlassSegmentedDatabase*>(this);
+    try {
+	ApplyingGuard guard(this);
+	self->apply_segment_changes(tail, tail_applied);
+    } catch (...) {
+	lock_guard<mutex> locker(m);
+	if (!error) self->error = current_exception();
+	throw;
+    }
+    tail_applied = tail.size();
+}
+
+void
+GlassSegmentedDatabase::begin_direct_change() const
+{
+    catch_up();
+    lock_guard<mutex> locker(m);
+    uncommitted_applied = true;
+    unlogged_changes = true;
+}
+
+void
+GlassSegmentedDatabase::log_replace(Xapian::docid did,
+				    const Xapian::Document& document)
+{
+    if (closed) GlassTable::throw_database_closed();
+    check_error_unlocked();
+    // A document read from a database may read from the tables as we
+    // serialise it.
+    if (document.get_docid() != 0) wait_for_applier();
+
+    // Check for terms the tables can't store now, since an error applying
+    // the changes later couldn't be reported usefully.
+    for (auto t = document.termlist_begin(); t != document.termlist_end(); ++t) {
+	const string& term = *t;
+	if (term.size() > MAX_SAFE_TERM_LENGTH)
+	    throw Xapian::InvalidArgumentError("Term too long (> " STRINGIZE(MAX_SAFE_TERM_LENGTH) "): " + term);
+    }
+
+    tail += 'R';
+    pack_uint(tail, did);
+    pack_string(tail, serialise_document(document));
+}
+
+unsigned
+GlassSegmentedDatabase::write_segment()
+{
+    unsigned number = next_segment++;
+    string filename = segment_path(dir, number);
+    string tmpfile = filename;
+    tmpfile += SEGMENT_TMP_SUFFIX;
+    int fd = posixy_open(tmpfile.c_str(),
+			 O_CREAT|O_TRUNC|O_WRONLY|O_BINARY|O_CLOEXEC,
+			 0666);
+    if (fd < 0) {
+	throw Xapian::DatabaseError("Couldn't write segment file: " + tmpfile,
+				    errno);
+    }
+    FD close_fd(fd);
+    try {
+	io_write(fd, SEGMENT_MAGIC, CONST_STRLEN(SEGMENT_MAGIC));
+	io_write(fd, tail.data(), tail.size());
+	if ((flags & Xapian::DB_NO_SYNC) == 0 &&
+	    ((flags & Xapian::DB_FULL_SYNC) ? !io_full_sync(fd) : !io_sync(fd))) {
+	    throw Xapian::DatabaseError("Couldn't sync segment file: " +
+					tmpfile, errno);
+	}
+	if (close_fd.close() < 0) {
+	    throw Xapian::DatabaseError("Couldn't close segment file: " +
+					tmpfile, errno);
+	}
+    } catch (...) {
+	(void)unlink(tmpfile.c_str());
+	throw;
+    }
+    if (!io_tmp_rename(tmpfile, filename)) {
+	throw Xapian::DatabaseError("Couldn't update segment file: " +
+				    filename, errno);
+    }
+    return number;
+}
+
+void
+GlassSegmentedDatabase::stop_applier()
+{
+    if (!applier.joinable()) return;
+    {
+	unique_lock<mutex> locker(m);
+	wait_until_idle(locker);
+	stopping = true;
+    }
+    work_queued.notify_one();
+    applier.join();
+    stopping = false;
+}
+
+void
+GlassSegmentedDatabase::wait_until_idle(unique_lock<mutex>& locker) const
+{
+    work_done.wait(locker, [this]() {
+	return !busy && (readers || !has_work());
+    });
+    // The tables are only read by this thread while there are readers.
+    auto self = const_cast<GlassSegmentedDatabase*>(this);
+    while (has_work()) self->apply_next(locker);
+}
+
+void
+GlassSegmentedDatabase::apply_next(unique_lock<mutex>& locker)
+{
+    // Apply the first segment which hasn't been applied, or if they all have
+    // been, commit the tables and remove the segment files.
+    segment* seg = nullptr;
+    for (auto&& s : segments) {
+	if (s.applied != s.changes.size()) {
+	    seg = &s;
+	    break;
+	}
+    }
+    vector<unsigned> merged;
+    if (!seg) {
+	for (auto&& s : segments) merged.push_back(s.number);
+    }
+    busy = true;
+    locker.unlock();
+
+    exception_ptr e;
+    try {
+	ApplyingGuard guard(this);
+	if (seg) {
+	    // commit() and cancel() don't modify a segment while we're busy,
+	    // so it's safe to read it without the locker.
+	    apply_segment_changes(seg->changes, seg->applied);
+	} else {
+	    GlassWritableDatabase::commit();
+	    for (unsigned number : merged) {
+		io_unlink(segment_path(dir, number));
+	    }
+	}
+    } catch (...) {
+	e = current_exception();
+    }
+
+    locker.lock();
+    if (e) {
+	if (!error) error = e;
+    } else if (seg) {
+	seg->applied = seg->changes.size();
+    } else {
+	segments.erase(segments.begin(), segments.begin() + merged.size());
+	merge_needed = false;
+    }
+    busy = false;
+    work_done.notify_all();
+}
+
+void
+GlassSegmentedDatabase::run()
+{
+    unique_lock<mutex> locker(m);
+    while (true) {
+	// Iterators and documents may be reading the tables while there are
+	// readers, so leave the tables alone until they've all gone.
+	work_queued.wait(locker, [this]() {
+	    return stopping || (has_work() && !readers);
+	});
+	if (stopping) return;
+	apply_next(locker);
+    }
+}
+
+Xapian::doccount
+GlassSegmentedDatabase::get_doccount() const
+{
+    catch_up();
+    return GlassWritableDatabase::get_doccount();
+}
+
+Xapian::docid
+GlassSegmentedDatabase::get_lastdocid() const
+{
+    if (applying == this) return GlassWritableDatabase::get_lastdocid();
+    check_error_unlocked();
+    return lastdocid;
+}
+
+Xapian::totallength
+GlassSegmentedDatabase::get_total_length() const
+{
+    catch_up();
+    return GlassWritableDatabase::get_total_length();
+}
+
+Xapian::termcount
+GlassSegmentedDatabase::get_doclength(Xapian::docid did) const
+{
+    catch_up();
+    return GlassWritableDatabase::get_doclength(did);
+}
+
+Xapian::termcount
+GlassSegmentedDatabase::get_unique_terms(Xapian::docid did) const
+{
+    catch_up();
+    return GlassWritableDatabase::get_unique_terms(did);
+}
+
+vector<Xapian::termcount>
+GlassSegmentedDatabase::get_doclengths(const vector<Xapian::docid>& dids) const
+{
+    catch_up();
+    return GlassWritableDatabase::get_doclengths(dids);
+}
+
+vector<Xapian::termcount>
+GlassSegmentedDatabase::get_unique_terms_counts(const vector<Xapian::docid>& dids) const
+{
+    catch_up();
+    return GlassWritableDatabase::get_unique_terms_counts(dids);
+}
+
+Xapian::termcount
+GlassSegmentedDatabase::get_wdfdocmax(Xapian::docid did) const
+{
+    catch_up();
+    return GlassWritableDatabase::get_wdfdocmax(did);
+}
+
+void
+GlassSegmentedDatabase::get_freqs(const string& term,
+				  Xapian::doccount* termfreq_ptr,
+				  Xapian::termcount* collfreq_ptr) const
+{
+    catch_up();
+    GlassWritableDatabase::get_freqs(term, termfreq_ptr, collfreq_ptr);
+}
+
+Xapian::doccount
+GlassSegmentedDatabase::get_value_freq(Xapian::valueno slot) const
+{
+    catch_up();
+    return GlassWritableDatabase::get_value_freq(slot);
+}
+
+string
+GlassSegmentedDatabase::get_value_lower_bound(Xapian::valueno slot) const
+{
+    catch_up();
+    return GlassWritableDatabase::get_value_lower_bound(slot);
+}
+
+string
+GlassSegmentedDatabase::get_value_upper_bound(Xapian::valueno slot) const
+{
+    catch_up();
+    return GlassWritableDatabase::get_value_upper_bound(slot);
+}
+
+Xapian::termcount
+GlassSegmentedDatabase::get_doclength_lower_bound() const
+{
+    catch_up();
+    return GlassWritableDatabase::get_doclength_lower_bound();
+}
+
+Xapian::termcount
+GlassSegmentedDatabase::get_doclength_upper_bound() const
+{
+    catch_up();
+    return GlassWritableDatabase::get_doclength_upper_bound();
+}
+
+Xapian::termcount
+GlassSegmentedDatabase::get_wdf_upper_bound(const string& term) const
+{
+    catch_up();
+    return GlassWritableDatabase::get_wdf_upper_bound(term);
+}
+
+Xapian::termcount
+GlassSegmentedDatabase::get_unique_terms_lower_bound() const
+{
+    catch_up();
+    return GlassWritableDatabase::get_unique_terms_lower_bound();
+}
+
+bool
+GlassSegmentedDatabase::term_exists(const string& term) const
+{
+    catch_up();
+    return GlassWritableDatabase::term_exists(term);
+}
+
+bool
+GlassSegmentedDatabase::has_positions() const
+{
+    catch_up();
+    return GlassWritableDatabase::has_positions();
+}
+
+PostList*
+GlassSegmentedDatabase::open_post_list(const string& term) const
+{
+    catch_up();
+    return GlassWritableDatabase::open_post_list(term);
+}
+
+LeafPostList*
+GlassSegmentedDatabase::open_leaf_post_list(const string& term,
+					    bool need_read_pos) const
+{
+    catch_up();
+    return GlassWritableDatabase::open_leaf_post_list(term, need_read_pos);
+}
+
+ValueList*
+GlassSegmentedDatabase::open_value_list(Xapian::valueno slot) const
+{
+    catch_up();
+    return GlassWritableDatabase::open_value_list(slot);
+}
+
+TermList*
+GlassSegmentedDatabase::open_term_list(Xapian::docid did) const
+{
+    catch_up();
+    return GlassWritableDatabase::open_term_list(did);
+}
+
+TermList*
+GlassSegmentedDatabase::open_term_list_direct(Xapian::docid did) const
+{
+    catch_up();
+    return GlassWritableDatabase::open_term_list_direct(did);
+}
+
+TermList*
+GlassSegmentedDatabase::open_allterms(const string& prefix) const
+{
+    catch_up();
+    return GlassWritableDatabase::open_allterms(prefix);
+}
+
+void
+GlassSegmentedDatabase::read_position_list(GlassRePositionList* pos_list,
+					   Xapian::docid did,
+					   const string& term) const
+{
+    catch_up();
+    GlassWritableDatabase::read_position_list(pos_list, did, term);
+}
+
+Xapian::termcount
+GlassSegmentedDatabase::positionlist_count(Xapian::docid did,
+					   const string& term) const
+{
+    catch_up();
+    return GlassWritableDatabase::positionlist_count(did, term);
+}
+
+PositionList*
+GlassSegmentedDatabase::open_position_list(Xapian::docid did,
+					   const string& term) const
+{
+    catch_up();
+    return GlassWritableDatabase::open_position_list(did, term);
+}
+
+Xapian::Document::Internal*
+GlassSegmentedDatabase::open_document(Xapian::docid did, bool lazy) const
+{
+    catch_up();
+    return GlassWritableDatabase::open_document(did, lazy);
+}
+
+TermList*
+GlassSegmentedDatabase::open_spelling_termlist(const string& word) const
+{
+    catch_up();
+    return GlassWritableDatabase::open_spelling_termlist(word);
+}
+
+TermList*
+GlassSegmentedDatabase::open_spelling_deletes_termlist(const string& word,
+						       unsigned max_distance) const
+{
+    catch_up();
+    return GlassWritableDatabase::open_spelling_deletes_termlist(word,
+								 max_distance);
+}
+
+TermList*
+GlassSegmentedDatabase::open_spelling_wordlist() const
+{
+    catch_up();
+    return GlassWritableDatabase::open_spelling_wordlist();
+}
+
+Xapian::doccount
+GlassSegmentedDatabase::get_spelling_frequency(const string& word) const
+{
+    catch_up();
+    return GlassWritableDatabase::get_spelling_frequency(word);
+}
+
+void
+GlassSegmentedDatabase::add_spelling(const string& word,
+				     Xapian::termcount freqinc) const
+{
+    begin_direct_change();
+    ApplyingGuard guard(this);
+    GlassWritableDatabase::add_spelling(word, freqinc);
+}
+
+Xapian::termcount
+GlassSegmentedDatabase::remove_spelling(const string& word,
+					Xapian::termcount freqdec) const
+{
+    begin_direct_change();
+    ApplyingGuard guard(this);
+    return GlassWritableDatabase::remove_spelling(word, freqdec);
+}
+
+TermList*
+GlassSegmentedDatabase::open_synonym_termlist(const string& term) const
+{
+    catch_up();
+    return GlassWritableDatabase::open_synonym_termlist(term);
+}
+
+TermList*
+GlassSegmentedDatabase::open_synonym_keylist(const string& prefix) const
+{
+    catch_up();
+    return GlassWritableDatabase::open_synonym_keylist(prefix);
+}
+
+void
+GlassSegmentedDatabase::add_synonym(const string& term,
+				    const string& synonym) const
+{
+    begin_direct_change();
+    ApplyingGuard guard(this);
+    GlassWritableDatabase::add_synonym(term, synonym);
+}
+
+void
+GlassSegmentedDatabase::remove_synonym(const string& term,
+				       const string& synonym) const
+{
+    begin_direct_change();
+    ApplyingGuard guard(this);
+    GlassWritableDatabase::remove_synonym(term, synonym);
+}
+
+void
+GlassSegmentedDatabase::clear_synonyms(const string& term) const
+{
+    begin_direct_change();
+    ApplyingGuard guard(this);
+    GlassWritableDatabase::clear_synonyms(term);
+}
+
+string
+GlassSegmentedDatabase::get_metadata(const string& key) const
+{
+    catch_up();
+    return GlassWritableDatabase::get_metadata(key);
+}
+
+TermList*
+GlassSegmentedDatabase::open_metadata_keylist(const string& prefix) const
+{
+    catch_up();
+    return GlassWritableDatabase::open_metadata_keylist(prefix);
+}
+
+void
+GlassSegmentedDatabase::set_metadata(const string& key, const string& value)
+{
+    if (closed) GlassTable::throw_database_closed();
+    check_error_unlocked();
+    tail += 'M';
+    pack_string(tail, key);
+    pack_string(tail, value);
+}
+
+void
+GlassSegmentedDatabase::close()
+{
+    if (closed) return;
+    if (!transaction_active()) {
+	commit();
+	wait_for_applier();
+    }
+    // In a transaction, any segments which haven't been merged are applied
+    // when the database is next opened.
+    stop_applier();
+    GlassWritableDatabase::close();
+    closed = true;
+}
+
+void
+GlassSegmentedDatabase::commit()
+{
+    if (closed) GlassTable::throw_database_closed();
+    check_error_unlocked();
+    if (transaction_active())
+	throw Xapian::InvalidOperationError("Can't commit during a transaction");
+
+    unsigned number = 0;
+    if (!tail.empty()) number = write_segment();
+
+    {
+	unique_lock<mutex> locker(m);
+	if (number) {
+	    segments.push_back(segment{number, std::move(tail), tail_applied});
+	}
+	if (uncommitted_applied) {
+	    // The changes applied directly are committed now, so the tables
+	    // can be committed.
+	    uncommitted_applied = false;
+	    merge_needed = true;
+	}
+	if (has_work() && !applier.joinable()) {
+	    applier = thread([this]() { run(); });
+	}
+	work_queued.notify_one();
+	if (unlogged_changes) {
+	    // Changes which aren't in a segment must reach the tables before
+	    // we return, as they'd be lost if we crashed.
+	    wait_until_idle(locker);
+	    unlogged_changes = false;
+	} else {
+	    work_done.wait(locker, [this]() {
+		return error || segments.size() <= MAX_SEGMENTS || readers;
+	    });
+	    // The background thread is waiting for any readers to go.
+	    if (segments.size() > MAX_SEGMENTS) wait_until_idle(locker);
+	}
+	check_error();
+    }
+    tail.clear();
+    tail_applied = 0;
+    committed_lastdocid = lastdocid;
+}
+
+void
+GlassSegmentedDatabase::cancel()
+{
+    if (closed) GlassTable::throw_database_closed();
+    {
+	unique_lock<mutex> locker(m);
+	wait_until_idle(locker);
+	check_error();
+	bool applied = uncommitted_applied;
+	for (auto&& seg : segments) {
+	    if (seg.applied) applied = true;
+	}
+	if (applied) {
+	    // The committed segments are applied again after the tables are
+	    // reverted.
+	    ApplyingGuard guard(this);
+	    GlassWritableDatabase::cancel();
+	    for (auto&& seg : segments) seg.applied = 0;
+	    uncommitted_applied = false;
+	    unlogged_changes = false;
+	    work_queued.notify_one();
+	}
+    }
+    tail.clear();
+    tail_applied = 0;
+    lastdocid = committed_lastdocid;
+}
+
+void
+GlassSegmentedDatabase::begin_transaction(bool flushed)
+{
+    if (flushed && !transaction_active()) commit();
+    // The tables mustn't be committed in the background during a
+    // transaction.  Nothing is queued during one, as commit() isn't allowed.
+    wait_for_applier();
+    GlassWritableDatabase::begin_transaction(flushed);
+}
+
+Xapian::docid
+GlassSegmentedDatabase::add_document(const Xapian::Document& document)
+{
+    // Make sure the docid counter doesn't overflow.
+    if (lastdocid == GLASS_MAX_DOCID)
+	throw Xapian::DatabaseError("Run out of docids - you'll have to use copydatabase to eliminate any gaps before you can add more documents");
+    Xapian::docid did = lastdocid + 1;
+    log_replace(did, document);
+    lastdocid = did;
+    return did;
+}
+
+void
+GlassSegmentedDatabase::delete_document(Xapian::docid did)
+{
+    if (closed) GlassTable::throw_database_closed();
+    // Apply this directly so DocNotFoundError can be thrown.
+    catch_up();
+    {
+	ApplyingGuard guard(this);
+	GlassWritableDatabase::delete_document(did);
+    }
+    {
+	lock_guard<mutex> locker(m);
+	uncommitted_applied = true;
+    }
+    tail += 'D';
+    pack_uint(tail, did);
+    tail_applied = tail.size();
+}
+
+void
+GlassSegmentedDatabase::set_document_value(Xapian::docid did,
+					   Xapian::valueno slot,
+					   const string& value)
+{
+    if (closed) GlassTable::throw_database_closed();
+    // Apply this directly so DocNotFoundError can be thrown.
+    catch_up();
+    {
+	ApplyingGuard guard(this);
+	GlassWritableDatabase::set_document_value(did, slot, value);
+    }
+    {
+	lock_guard<mutex> locker(m);
+	uncommitted_applied = true;
+    }
+    tail += 'V';
+    pack_uint(tail, did);
+    pack_uint(tail, slot);
+    pack_string(tail, value);
+    tail_applied = tail.size();
+}
+
+void
+GlassSegmentedDatabase::delete_document(const string& unique_term)
+{
+    if (closed) GlassTable::throw_database_closed();
+    check_error_unlocked();
+    tail += 'T';
+    pack_string(tail, unique_term);
+}
+
+void
+GlassSegmentedDatabase::replace_document(Xapian::docid did,
+					 const Xapian::Document& document)
+{
+    log_replace(did, document);
+    if (did > lastdocid) lastdocid = did;
+}
+
+Xapian::docid
+GlassSegmentedDatabase::replace_document(const string& unique_term,
+					 const Xapian::Document& document)
+{
+    if (closed) GlassTable::throw_database_closed();
+    catch_up();
+    // Log the changes in terms of docids, so that applying them again gives
+    // the same result.
+    unique_ptr<PostList> pl(GlassWritableDatabase::open_post_list(unique_term));
+    pl->next();
+    if (pl->at_end()) {
+	return add_document(document);
+    }
+    Xapian::docid did = pl->get_docid();
+    vector<Xapian::docid> to_delete;
+    while (pl->next(), !pl->at_end()) {
+	to_delete.push_back(pl->get_docid());
+    }
+    pl.reset();
+    log_replace(did, document);
+    for (Xapian::docid i : to_delete) {
+	tail += 'D';
+	pack_uint(tail, i);
+    }
+    return did;
+}
+
+void
+GlassSegmentedDatabase::request_document(Xapian::docid did) const
+{
+    catch_up();
+    GlassWritableDatabase::request_document(did);
+}
+
+void
+GlassSegmentedDatabase::readahead_for_query(const Xapian::Query& query) const
+{
+    catch_up();
+    GlassWritableDatabase::readahead_for_query(query);
+}
+
+void
+GlassSegmentedDatabase::write_changesets_to_fd(int fd,
+					       const string& start_revision,
+					       bool need_whole_db,
+					       Xapian::ReplicationInfo* info,
+					       bool compress)
+{
+    catch_up();
+    GlassWritableDatabase::write_changesets_to_fd(fd, start_revision,
+						  need_whole_db, info,
+						  compress);
+}
+
+Xapian::rev
+GlassSegmentedDatabase::get_revision() const
+{
+    catch_up();
+    return GlassWritableDatabase::get_revision();
+}
+
+void
+GlassSegmentedDatabase::invalidate_doc_object(Xapian::Document::Internal* obj) const
+{
+    if (applying != this) {
+	// Called when a document from open_document() is destroyed.  Errors
+	// are reported elsewhere.
+	unique_lock<mutex> locker(m);
+	wait_until_idle(locker);
+    }
+    GlassWritableDatabase::invalidate_doc_object(obj);
+}
+
+bool
+GlassSegmentedDatabase::reader_opened() const
+{
+    if (applying == this) return false;
+    unique_lock<mutex> locker(m);
+    work_done.wait(locker, [this]() { return !busy; });
+    ++readers;
+    return true;
+}
+
+void
+GlassSegmentedDatabase::reader_closed() const
+{
+    lock_guard<mutex> locker(m);
+    if (--readers == 0) work_queued.notify_one();
+}
+
+void
+GlassSegmentedDatabase::get_used_docid_range(Xapian::docid& first,
+					     Xapian::docid& last) const
+{
+    catch_up();
+    GlassWritableDatabase::get_used_docid_range(first, last);
+}
+
+Xapian::Database::Internal*
+GlassSegmentedDatabase::update_lock(int flags_)
+{
+    if (flags_ == Xapian::DB_READONLY_ && !closed && !transaction_active()) {
+	// Get all the changes into the tables before the read-only database
+	// is opened.
+	commit();
+    }
+    wait_for_applier();
+    if (flags_ != Xapian::DB_READONLY_) flags = flags_;
+    return GlassWritableDatabase::update_lock(flags_);
+}
+
+bool
+GlassSegmentedDatabase::has_uncommitted_changes() const
+{
+    if (!tail.empty()) return true;
+    wait_for_applier();
+    lock_guard<mutex> locker(m);
+    return !segments.empty() || uncommitted_applied ||
+	   GlassWritableDatabase::has_uncommitted_changes();
+}
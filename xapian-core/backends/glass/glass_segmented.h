@@ -0,0 +1,305 @@
+/** @file glass_segmented.h
+ * @brief Glass database which commits by writing segments of changes
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_GLASS_SEGMENTED_H
+#define XAPIAN_INCLUDED_GLASS_SEGMENTED_H
+
+#include "glass_database.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/** A writable glass database opened with Xapian::DB_SEGMENTED_COMMITS.
+ *
+ *  Changes are serialised as they're made, and commit() writes those since
+ *  the last commit to a "segment" file and syncs it.  A background thread
+ *  applies the segments to the tables, and commits the tables once all the
+ *  segments have been applied, so several segments are merged into each
+ *  revision when commits come faster than it can keep up with.
+ *
+ *  Methods which read from the tables first wait for the background thread
+ *  to be idle, then apply any uncommitted changes to the tables themselves.
+ *  While such changes are applied, the tables aren't committed in the
+ *  background (since that would commit changes which haven't been
+ *  committed).
+ *
+ *  Iterators and documents which read the tables register themselves (see
+ *  GlassReader), and the background thread doesn't touch the tables while
+ *  any exist.  A method which needs the outstanding work done meanwhile does
+ *  it in the calling thread, which is safe as glass cursors cope with the
+ *  tables being modified between calls.
+ *
+ *  Segments which haven't been applied when the database is closed are
+ *  applied by GlassWritableDatabase::replay_segments() when it is next
+ *  opened.  Changes are serialised as operations which give the same result
+ *  if they're applied again, so a segment which was applied but not removed
+ *  before a crash is harmless.
+ */
+class GlassSegmentedDatabase : public GlassWritableDatabase {
+    /// Maximum number of segments waiting to be applied before commit() blocks.
+    static constexpr size_t MAX_SEGMENTS = 16;
+
+    /// A segment which has been committed but not yet merged.
+    struct segment {
+	/// The number in the segment's filename.
+	unsigned number;
+
+	/// The serialised changes.
+	std::string changes;
+
+	/// How much of @a changes has been applied to the tables.
+	size_t applied;
+    };
+
+    /// The flags the database was opened with.
+    int flags;
+
+    /// The database directory.
+    std::string dir;
+
+    /// The serialised changes since the last commit.
+    std::string tail;
+
+    /// How much of @a tail has been applied to the tables.
+    mutable size_t tail_applied = 0;
+
+    /// The number to give the next segment.
+    unsigned next_segment = 1;
+
+    /// Has close() been called?
+    bool closed = false;
+
+    /// The highest docid used, including uncommitted changes.
+    Xapian::docid lastdocid;
+
+    /// The highest docid used as of the last commit.
+    Xapian::docid committed_lastdocid;
+
+    /// Protects all the members below.
+    mutable std::mutex m;
+
+    /// Signalled when there's work for the background thread, or it should stop.
+    mutable std::condition_variable work_queued;
+
+    /// Signalled when the background thread has finished some work.
+    mutable std::condition_variable work_done;
+
+    /// Segments which haven't been merged, in the order they were committed.
+    std::deque<segment> segments;
+
+    /// Have changes which aren't committed been applied to the tables?
+    mutable bool uncommitted_applied = false;
+
+    /** Have changes which aren't logged in a segment been made to the tables?
+     *
+     *  Spelling and synonym changes are made directly, so commit() waits for
+     *  the tables to be committed when there are any.
+     */
+    mutable bool unlogged_changes = false;
+
+    /** Do the tables need committing?
+     *
+     *  Set when commit() is called after changes have been applied to the
+     *  tables directly.
+     */
+    bool merge_needed = false;
+
+    /// Is the background thread working?
+    bool busy = false;
+
+    /// The number of registered objects which read from the tables.
+    mutable size_t readers = 0;
+
+    bool stopping = false;
+
+    /** The error from applying changes, if there was one.
+     *
+     *  This is rethrown by every later call, as the tables no longer match
+     *  the changes which have been committed.
+     */
+    std::exception_ptr error;
+
+    std::thread applier;
+
+    /// Is there work for the background thread?  Call with m locked.
+    bool has_work() const;
+
+    /** Wait for the background thread to be idle.  Call with m locked.
+     *
+     *  If there are readers, the background thread won't do the outstanding
+     *  work, so it's done in this thread.
+     */
+    void wait_until_idle(std::unique_lock<std::mutex>& locker) const;
+
+    /** Do the next piece of work for the background thread.
+     *
+     *  Call with m locked.  It's unlocked while the tables are updated.
+     */
+    void apply_next(std::unique_lock<std::mutex>& locker);
+
+    /// Rethrow any error from applying changes.  Call with m locked.
+    void check_error() const {
+	if (error) std::rethrow_exception(error);
+    }
+
+    /// Rethrow any error from applying changes.
+    void check_error_unlocked() const {
+	std::lock_guard<std::mutex> locker(m);
+	check_error();
+    }
+
+    /// Wait for the background thread to be idle so the tables can be read.
+    void wait_for_applier() const {
+	std::unique_lock<std::mutex> locker(m);
+	wait_until_idle(locker);
+	check_error();
+    }
+
+    /// Bring the tables up to date with all the changes made.
+    void catch_up() const;
+
+    /** Prepare to change the tables directly.
+     *
+     *  For changes which aren't logged, or which have to be made now to
+     *  find out if they succeed.
+     */
+    void begin_direct_change() const;
+
+    /// Log replacing document @a did with @a document.
+    void log_replace(Xapian::docid did, const Xapian::Document& document);
+
+    /// Write the changes in @a tail to a segment file, returning its number.
+    unsigned write_segment();
+
+    /// Stop the background thread after it has finished all its work.
+    void stop_applier();
+
+    void run();
+
+  public:
+    GlassSegmentedDatabase(const std::string& dir_, int flags_, int block_size);
+
+    ~GlassSegmentedDatabase();
+
+    /** Virtual methods of Database::Internal. */
+    //@{
+    Xapian::doccount get_doccount() const;
+    Xapian::docid get_lastdocid() const;
+    Xapian::totallength get_total_length() const;
+    Xapian::termcount get_doclength(Xapian::docid did) const;
+    Xapian::termcount get_unique_terms(Xapian::docid did) const;
+    std::vector<Xapian::termcount>
+    get_doclengths(const std::vector<Xapian::docid>& dids) const;
+    std::vector<Xapian::termcount>
+    get_unique_terms_counts(const std::vector<Xapian::docid>& dids) const;
+    Xapian::termcount get_wdfdocmax(Xapian::docid did) const;
+    void get_freqs(const std::string& term,
+		   Xapian::doccount* termfreq_ptr,
+		   Xapian::termcount* collfreq_ptr) const;
+    Xapian::doccount get_value_freq(Xapian::valueno slot) const;
+    std::string get_value_lower_bound(Xapian::valueno slot) const;
+    std::string get_value_upper_bound(Xapian::valueno slot) const;
+    Xapian::termcount get_doclength_lower_bound() const;
+    Xapian::termcount get_doclength_upper_bound() const;
+    Xapian::termcount get_wdf_upper_bound(const std::string& term) const;
+    Xapian::termcount get_unique_terms_lower_bound() const;
+    bool term_exists(const std::string& term) const;
+    bool has_positions() const;
+
+    PostList* open_post_list(const std::string& term) const;
+    LeafPostList* open_leaf_post_list(const std::string& term,
+				      bool need_read_pos) const;
+    ValueList* open_value_list(Xapian::valueno slot) const;
+    TermList* open_term_list(Xapian::docid did) const;
+    TermList* open_term_list_direct(Xapian::docid did) const;
+    TermList* open_allterms(const std::string& prefix) const;
+    void read_position_list(GlassRePositionList* pos_list,
+			    Xapian::docid did,
+			    const std::string& term) const;
+    Xapian::termcount positionlist_count(Xapian::docid did,
+					 const std::string& term) const;
+    PositionList* open_position_list(Xapian::docid did,
+				     const std::string& term) const;
+    Xapian::Document::Internal* open_document(Xapian::docid did,
+					      bool lazy) const;
+
+    TermList* open_spelling_termlist(const std::string& word) const;
+    TermList* open_spelling_deletes_termlist(const std::string& word,
+					     unsigned max_distance) const;
+    TermList* open_spelling_wordlist() const;
+    Xapian::doccount get_spelling_frequency(const std::string& word) const;
+    void add_spelling(const std::string& word,
+		      Xapian::termcount freqinc) const;
+    Xapian::termcount remove_spelling(const std::string& word,
+				      Xapian::termcount freqdec) const;
+
+    TermList* open_synonym_termlist(const std::string& term) const;
+    TermList* open_synonym_keylist(const std::string& prefix) const;
+    void add_synonym(const std::string& term,
+		     const std::string& synonym) const;
+    void remove_synonym(const std::string& term,
+			const std::string& synonym) const;
+    void clear_synonyms(const std::string& term) const;
+
+    std::string get_metadata(const std::string& key) const;
+    TermList* open_metadata_keylist(const std::string& prefix) const;
+    void set_metadata(const std::string& key, const std::string& value);
+
+    void close();
+    void commit();
+    void cancel();
+    void begin_transaction(bool flushed);
+
+    Xapian::docid add_document(const Xapian::Document& document);
+    void delete_document(Xapian::docid did);
+    void delete_document(const std::string& unique_term);
+    void replace_document(Xapian::docid did,
+			  const Xapian::Document& document);
+    Xapian::docid replace_document(const std::string& unique_term,
+				   const Xapian::Document& document);
+    void set_document_value(Xapian::docid did, Xapian::valueno slot,
+			    const std::string& value);
+
+    void request_document(Xapian::docid did) const;
+    void readahead_for_query(const Xapian::Query& query) const;
+
+    void write_changesets_to_fd(int fd,
+				const std::string& start_revision,
+				bool need_whole_db,
+				Xapian::ReplicationInfo* info,
+				bool compress);
+    Xapian::rev get_revision() const;
+    void invalidate_doc_object(Xapian::Document::Internal* obj) const;
+    void get_used_docid_range(Xapian::docid& first,
+			      Xapian::docid& last) const;
+    Xapian::Database::Internal* update_lock(int flags_);
+    //@}
+
+    bool has_uncommitted_changes() const;
+
+    bool reader_opened() const;
+    void reader_closed() const;
+};
+
+#endif // XAPIAN_INCLUDED_GLASS_SEGMENTED_H
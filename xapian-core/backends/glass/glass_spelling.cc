@@ -22,17 +22,21 @@
 
 #include <xapian/error.h>
 #include <xapian/types.h>
+#include <xapian/unicode.h>
 
 #include "expand/expandweight.h"
 #include "expand/termlistmerger.h"
 #include "glass_spelling.h"
 #include "omassert.h"
 #include "pack.h"
+#include "stringutils.h"
+#include "api/vectortermlist.h"
 
 #include "../prefix_compressed_strings.h"
 
 #include <algorithm>
 #include <map>
+#include <memory>
 #include <queue>
 #include <vector>
 #include <set>
@@ -41,57 +45,101 @@
 using namespace Glass;
 using namespace std;
 
-void
-GlassSpellingTable::merge_changes()
+/// Maximum edit distance covered by newly built symmetric delete lists.
+static const unsigned SPELLING_DELETES_DISTANCE = 2;
+
+/** Generate the variants of @a word with up to @a max_distance characters
+ *  deleted.
+ *
+ *  Characters are UTF-8 sequences rather than bytes, so that a deletion
+ *  corresponds to a single edit as EditDistanceCalculator counts them.  The
+ *  empty string is never included in @a result.
+ */
+static void
+generate_deletes(const string & word, unsigned max_distance,
+		 set<string> & result)
 {
-    for (auto i : termlist_deltas) {
-	const string& key = i.first;
-	const set<string>& changes = i.second;
-
-	auto d = changes.begin();
-	if (d == changes.end()) continue;
-
-	string updated;
-	string current;
-	PrefixCompressedStringWriter out(updated);
-	if (get_exact_entry(key, current)) {
-	    PrefixCompressedStringItor in(current);
-	    updated.reserve(current.size()); // FIXME plus some?
-	    while (!in.at_end() && d != changes.end()) {
-		const string & word = *in;
-		Assert(d != changes.end());
-		int cmp = word.compare(*d);
-		if (cmp < 0) {
-		    out.append(word);
-		    ++in;
-		} else if (cmp > 0) {
-		    out.append(*d);
-		    ++d;
-		} else {
-		    // If an existing entry is in the changes list, that means
-		    // we should remove it.
-		    ++in;
-		    ++d;
-		}
-	    }
-	    if (!in.at_end()) {
-		// FIXME : easy to optimise this to a fix-up and substring copy.
-		while (!in.at_end()) {
-		    out.append(*in++);
-		}
+    set<string> current{word};
+    for (unsigned distance = 0; distance != max_distance; ++distance) {
+	set<string> next;
+	for (auto&& s : current) {
+	    Xapian::Utf8Iterator i(s);
+	    while (i != Xapian::Utf8Iterator()) {
+		size_t start = s.size() - i.left();
+		++i;
+		size_t len = s.size() - i.left() - start;
+		if (len == s.size()) continue;
+		string variant(s, 0, start);
+		variant.append(s, start + len, string::npos);
+		if (result.insert(variant).second)
+		    next.insert(std::move(variant));
 	    }
 	}
-	while (d != changes.end()) {
-	    out.append(*d++);
+	if (next.empty()) break;
+	swap(current, next);
+    }
+}
+
+void
+GlassSpellingTable::merge_word_list(const string & key,
+				    const set<string> & changes)
+{
+    auto d = changes.begin();
+    if (d == changes.end()) return;
+
+    string updated;
+    string current;
+    PrefixCompressedStringWriter out(updated);
+    if (get_exact_entry(key, current)) {
+	PrefixCompressedStringItor in(current);
+	updated.reserve(current.size()); // FIXME plus some?
+	while (!in.at_end() && d != changes.end()) {
+	    const string & word = *in;
+	    Assert(d != changes.end());
+	    int cmp = word.compare(*d);
+	    if (cmp < 0) {
+		out.append(word);
+		++in;
+	    } else if (cmp > 0) {
+		out.append(*d);
+		++d;
+	    } else {
+		// If an existing entry is in the changes list, that means
+		// we should remove it.
+		++in;
+		++d;
+	    }
 	}
-	if (!updated.empty()) {
-	    add(key, updated);
-	} else {
-	    del(key);
+	if (!in.at_end()) {
+	    // FIXME : easy to optimise this to a fix-up and substring copy.
+	    while (!in.at_end()) {
+		out.append(*in++);
+	    }
 	}
     }
+    while (d != changes.end()) {
+	out.append(*d++);
+    }
+    if (!updated.empty()) {
+	add(key, updated);
+    } else {
+	del(key);
+    }
+}
+
+void
+GlassSpellingTable::merge_changes()
+{
+    for (auto i : termlist_deltas) {
+	merge_word_list(i.first, i.second);
+    }
     termlist_deltas.clear();
 
+    for (auto&& i : deletes_deltas) {
+	merge_word_list(i.first, i.second);
+    }
+    deletes_deltas.clear();
+
     map<string, Xapian::termcount>::const_iterator j;
     for (j = wordfreq_changes.begin(); j != wordfreq_changes.end(); ++j) {
 	string key = "W" + j->first;
@@ -251,6 +299,70 @@ GlassSpellingTable::toggle_word(const string & word)
 		toggle_fragment(buf, word);
 	}
     }
+
+    if (get_deletes_distance())
+	toggle_deletes(word);
+}
+
+void
+GlassSpellingTable::toggle_deletes(const string & word)
+{
+    set<string> variants;
+    generate_deletes(word, get_deletes_distance(), variants);
+    for (auto&& variant : variants) {
+	auto& changes = deletes_deltas["D" + variant];
+	auto res = changes.insert(word);
+	if (!res.second) {
+	    // word is already in the set, so remove it.
+	    changes.erase(res.first);
+	}
+    }
+}
+
+unsigned
+GlassSpellingTable::get_deletes_distance() const
+{
+    if (deletes_distance < 0) {
+	string tag;
+	unsigned distance = 0;
+	if (get_exact_entry("D", tag)) {
+	    const char * p = tag.data();
+	    if (!unpack_uint_last(&p, p + tag.size(), &distance) ||
+		distance == 0) {
+		throw Xapian::DatabaseCorruptError("Bad spelling deletes marker");
+	    }
+	}
+	deletes_distance = distance;
+    }
+    return deletes_distance;
+}
+
+void
+GlassSpellingTable::enable_deletes()
+{
+    if (get_deletes_distance()) return;
+
+    // Make sure every word is on disk so the cursor below sees it.
+    merge_changes();
+
+    vector<string> words;
+    unique_ptr<GlassCursor> cursor(cursor_get());
+    if (cursor.get()) {
+	cursor->find_entry_ge("W");
+	while (!cursor->after_end() && startswith(cursor->current_key, 'W')) {
+	    words.emplace_back(cursor->current_key, 1);
+	    cursor->next();
+	}
+    }
+
+    deletes_distance = SPELLING_DELETES_DISTANCE;
+    string tag;
+    pack_uint_last(tag, SPELLING_DELETES_DISTANCE);
+    add("D", tag);
+    for (auto&& word : words) {
+	toggle_deletes(word);
+    }
+    merge_changes();
 }
 
 struct TermListGreaterApproxSize {
@@ -352,6 +464,44 @@ GlassSpellingTable::open_termlist(const string & word)
     }
 }
 
+TermList *
+GlassSpellingTable::open_deletes_termlist(const string & word,
+					  unsigned max_edit_distance)
+{
+    unsigned distance = get_deletes_distance();
+    if (distance == 0 || max_edit_distance > distance)
+	return NULL;
+
+    // Merge any pending changes to disk, but don't call commit() so they
+    // won't be switched live.
+    if (!wordfreq_changes.empty()) merge_changes();
+
+    // A word within max_edit_distance edits of the misspelling shares a
+    // deletion variant with it (counting each of them as a variant of
+    // itself), so looking up each variant of the misspelling among both the
+    // words and their stored variants finds every candidate.
+    set<string> variants;
+    generate_deletes(word, max_edit_distance, variants);
+    variants.insert(word);
+
+    vector<string> candidates;
+    string data;
+    for (auto&& variant : variants) {
+	if (key_exists("W" + variant))
+	    candidates.push_back(variant);
+	if (get_exact_entry("D" + variant, data)) {
+	    PrefixCompressedStringItor in(data);
+	    while (!in.at_end()) {
+		candidates.push_back(*in++);
+	    }
+	}
+    }
+    sort(candidates.begin(), candidates.end());
+    candidates.erase(unique(candidates.begin(), candidates.end()),
+		     candidates.end());
+    return new VectorTermList(candidates.begin(), candidates.end());
+}
+
 Xapian::doccount
 GlassSpellingTable::get_word_frequency(const string & word) const
 {
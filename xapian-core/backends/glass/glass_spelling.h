@@ -63,6 +63,17 @@ using Glass::RootInfo;
 class GlassSpellingTable : public GlassLazyTable {
     void toggle_word(const std::string & word);
     void toggle_fragment(Glass::fragment frag, const std::string & word);
+    void toggle_deletes(const std::string & word);
+
+    /** Apply xor-style @a changes to the word list stored under @a key. */
+    void merge_word_list(const std::string & key,
+			 const std::set<std::string> & changes);
+
+    /** Maximum edit distance covered by the symmetric delete lists.
+     *
+     *  Zero if there are no such lists, or -1 if we haven't checked yet.
+     */
+    mutable int deletes_distance = -1;
 
     std::map<std::string, Xapian::termcount> wordfreq_changes;
 
@@ -76,6 +87,13 @@ class GlassSpellingTable : public GlassLazyTable {
      */
     std::map<Glass::fragment, std::set<std::string>> termlist_deltas;
 
+    /** Changes to make to the symmetric delete lists.
+     *
+     *  These are keyed by the full key ("D" followed by the deletion
+     *  variant) and work in the same way as termlist_deltas.
+     */
+    std::map<std::string, std::set<std::string>> deletes_deltas;
+
     /** Used to track an upper bound on wordfreq. */
     Xapian::termcount wordfreq_upper_bound = 0;
 
@@ -106,6 +124,30 @@ class GlassSpellingTable : public GlassLazyTable {
 
     TermList * open_termlist(const std::string & word);
 
+    /** Return the maximum edit distance covered by the delete lists.
+     *
+     *  Returns 0 if this table doesn't have symmetric delete lists.
+     */
+    unsigned get_deletes_distance() const;
+
+    /** Build symmetric delete lists for the existing words.
+     *
+     *  Does nothing if this table already has them.  Once built they are
+     *  maintained by add_word() and remove_word().
+     */
+    void enable_deletes();
+
+    /** Open a list of candidate corrections for @a word.
+     *
+     *  The list contains every word within @a max_edit_distance edits of
+     *  @a word (and possibly some others).
+     *
+     *  Returns NULL if there are no symmetric delete lists or they don't
+     *  cover @a max_edit_distance.
+     */
+    TermList * open_deletes_termlist(const std::string & word,
+				     unsigned max_edit_distance);
+
     Xapian::doccount get_word_frequency(const std::string & word) const;
 
     void set_wordfreq_upper_bound(Xapian::termcount ub) {
@@ -119,6 +161,15 @@ class GlassSpellingTable : public GlassLazyTable {
      *  @{
      */
 
+    void open(int flags_, const RootInfo & root_info,
+	      glass_revision_number_t rev) {
+	// The revision being opened may have gained or lost delete lists.
+	deletes_distance = -1;
+	GlassTable::open(flags_, root_info, rev);
+    }
+
+    using GlassTable::open;
+
     bool is_modified() const {
 	return !wordfreq_changes.empty() || GlassTable::is_modified();
     }
@@ -134,6 +185,8 @@ class GlassSpellingTable : public GlassLazyTable {
 	// Discard batched-up changes.
 	wordfreq_changes.clear();
 	termlist_deltas.clear();
+	deletes_deltas.clear();
+	deletes_distance = -1;
 
 	GlassTable::cancel(root_info, rev);
     }
@@ -25,6 +25,7 @@
 #include "backends/alltermslist.h"
 #include "glass_spelling.h"
 #include "glass_cursor.h"
+#include "glass_reader.h"
 
 class GlassDatabase;
 
@@ -38,6 +39,9 @@ class GlassSpellingWordsList : public AllTermsList {
     /// Keep a reference to our database to stop it being deleted.
     Xapian::Internal::intrusive_ptr<const GlassDatabase> database;
 
+    /// Stop the tables being changed in the background while we exist.
+    GlassReader reader_guard;
+
     /** A cursor which runs through the spelling table reading termnames from
      *  the keys.
      */
@@ -57,7 +61,7 @@ class GlassSpellingWordsList : public AllTermsList {
   public:
     GlassSpellingWordsList(Xapian::Internal::intrusive_ptr<const GlassDatabase> database_,
 			   GlassCursor * cursor_)
-	    : database(database_), cursor(cursor_), termfreq(0) {
+	    : database(database_), reader_guard(database.get()), cursor(cursor_), termfreq(0) {
 	// Seek to the entry before the first key with a "W" prefix, so the
 	// first next() will advance us to the first such entry.
 	cursor->find_entry(std::string("W", 1));
@@ -25,6 +25,7 @@
 
 #include "backends/alltermslist.h"
 #include "glass_lazytable.h"
+#include "glass_reader.h"
 #include "api/termlist.h"
 
 #include <set>
@@ -128,6 +129,9 @@ class GlassSynonymTermList : public AllTermsList {
     /// Keep a reference to our database to stop it being deleted.
     Xapian::Internal::intrusive_ptr<const GlassDatabase> database;
 
+    /// Stop the tables being changed in the background while we exist.
+    GlassReader reader_guard;
+
     /** A cursor which runs through the synonym table reading termnames from
      *  the keys.
      */
@@ -140,7 +144,7 @@ class GlassSynonymTermList : public AllTermsList {
     GlassSynonymTermList(Xapian::Internal::intrusive_ptr<const GlassDatabase> database_,
 			 GlassCursor * cursor_,
 			 const string & prefix_)
-	    : database(database_), cursor(cursor_), prefix(prefix_)
+	    : database(database_), reader_guard(database.get()), cursor(cursor_), prefix(prefix_)
     {
 	// Position the cursor on the highest key before the first key we want,
 	// so that the first call to next() will put us on the first key we
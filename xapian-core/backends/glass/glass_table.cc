@@ -47,6 +47,7 @@
 
 #include "debuglog.h"
 #include "filetests.h"
+#include "io_batch.h"
 #include "io_utils.h"
 #include "pack.h"
 #include "wordaccess.h"
@@ -220,6 +221,13 @@ GlassTable::write_block(uint4 n, const uint8_t * p, bool appending) const
     const char * p_char = reinterpret_cast<const char *>(p);
     io_write_block(handle, p_char, block_size, n, offset);
 
+    log_block_change(n, p);
+}
+
+/// Record block n with contents p in the changes file, if we're writing one.
+void
+GlassTable::log_block_change(uint4 n, const uint8_t * p) const
+{
     if (!changes_obj) return;
 
     unsigned char v;
@@ -1467,6 +1475,99 @@ GlassTable::readahead_key(const string &key) const
     RETURN(true);
 }
 
+bool
+GlassTable::readahead_keys(const vector<string>& keys) const
+{
+    LOGCALL(DB, bool, "GlassTable::readahead_keys", keys.size());
+
+    // See readahead_key() for what a negative handle means.
+    if (handle < 0)
+	RETURN(false);
+
+    // If the table only has one level, the root is the only block.
+    if (level == 0)
+	RETURN(false);
+
+    // For each key we're looking for, the block it's in at the level we've
+    // descended to, and the index of the key in keys.
+    vector<pair<uint4, size_t>> todo;
+    todo.reserve(keys.size());
+    const uint8_t* p = C[level].get_p();
+    for (size_t i = 0; i != keys.size(); ++i) {
+	const string& key = keys[i];
+	Assert(!key.empty());
+	// An overlong key cannot be found.
+	if (key.size() > GLASS_BTREE_MAX_KEY_LEN)
+	    continue;
+	form_key(key);
+	int c = find_in_branch(p, kt, -1);
+	todo.emplace_back(BItem(p, c).block_given_by(), i);
+    }
+
+    try {
+	// Descend through the branch levels, reading all the blocks needed at
+	// each level in one batch.
+	vector<uint4> blocks;
+	vector<uint8_t> buf;
+	for (int j = level - 1; j > 0; --j) {
+	    blocks.clear();
+	    for (auto&& item : todo) blocks.push_back(item.first);
+	    sort(blocks.begin(), blocks.end());
+	    blocks.erase(unique(blocks.begin(), blocks.end()), blocks.end());
+
+	    buf.resize(blocks.size() * block_size);
+	    IOBatch batch;
+	    for (size_t i = 0; i != blocks.size(); ++i) {
+		// The cursor's copy of the block may have been modified.
+		if (blocks[i] == C[j].get_n()) continue;
+		char* q = reinterpret_cast<char*>(&buf[i * block_size]);
+		batch.add_read_block(handle, q, block_size, blocks[i], offset);
+	    }
+	    batch.run();
+
+	    for (size_t i = 0; i != blocks.size(); ++i) {
+		if (blocks[i] == C[j].get_n()) continue;
+		p = &buf[i * block_size];
+		// Leave reporting problems to the real lookups.
+		if (REVISION(p) > revision_number + writable ||
+		    GET_LEVEL(p) != j ||
+		    DIR_END(p) < DIR_START || unsigned(DIR_END(p)) > block_size)
+		    RETURN(false);
+	    }
+
+	    for (auto&& item : todo) {
+		if (item.first == C[j].get_n()) {
+		    p = C[j].get_p();
+		} else {
+		    auto it = lower_bound(blocks.begin(), blocks.end(),
+					  item.first);
+		    p = &buf[(it - blocks.begin()) * block_size];
+		}
+		form_key(keys[item.second]);
+		int c = find_in_branch(p, kt, -1);
+		item.first = BItem(p, c).block_given_by();
+	    }
+	}
+    } catch (const Xapian::DatabaseError&) {
+	// The readahead is just a hint.
+	RETURN(false);
+    }
+
+    // Now we know which leaf blocks the keys are in, ask for them all.
+    IOBatch batch;
+    for (auto&& item : todo) {
+	uint4 n = item.first;
+	// Don't preread if it's the block we last preread or already in the
+	// cursor.
+	if (n != last_readahead && n != C[0].get_n()) {
+	    last_readahead = n;
+	    batch.add_readahead_block(handle, block_size, n, offset);
+	}
+    }
+    batch.run();
+    RETURN(true);
+}
+
 bool
 GlassTable::get_exact_entry(const string &key, string & tag) const
 {
@@ -1814,9 +1915,14 @@ void GlassTable::close(bool permanent) {
 	if (single_file()) {
 	    handle = -3 - handle;
 	} else {
-	    // If an error occurs here, we just ignore it, since we're just
-	    // trying to free everything.
-	    (void)::close(handle);
+	    if (handle_owner) {
+		// The fd is closed once no other table is using it.
+		handle_owner.reset();
+	    } else {
+		// If an error occurs here, we just ignore it, since we're
+		// just trying to free everything.
+		(void)::close(handle);
+	    }
 	    handle = -1;
 	}
     }
@@ -1997,6 +2103,7 @@ GlassTable::do_open_to_read(const RootInfo * root_info,
 	    message += GLASS_TABLE_EXTENSION" to read";
 	    throw Xapian::DatabaseOpeningError(message, errno);
 	}
+	handle_owner = std::make_shared<FD>(handle);
     }
 
     basic_open(root_info, rev);
@@ -2023,6 +2130,37 @@ GlassTable::open(int flags_, const RootInfo & root_info,
     do_open_to_write(&root_info, rev);
 }
 
+void
+GlassTable::open(int flags_, const RootInfo & root_info,
+		 glass_revision_number_t rev, const GlassTable & other)
+{
+    LOGCALL_VOID(DB, "GlassTable::open", flags_|root_info|rev|Literal("other"));
+    Assert(!writable);
+    Assert(!single_file());
+    close();
+
+    if (other.handle == -2) {
+	GlassTable::throw_database_closed();
+    }
+
+    flags = flags_;
+    block_size = root_info.get_blocksize();
+    root = root_info.get_root();
+
+    if (!other.handle_owner) {
+	// A lazy table which doesn't exist yet.
+	AssertEq(other.handle, -1);
+	revision_number = rev;
+	return;
+    }
+    handle = other.handle;
+    handle_owner = other.handle_owner;
+
+    basic_open(&root_info, rev);
+
+    read_root();
+}
+
 bool
 GlassTable::prev_for_sequential(Glass::Cursor * C_, int /*dummy*/) const
 {
@@ -38,9 +38,12 @@
 #include "wordaccess.h"
 
 #include "common/compression_stream.h"
+#include "fd.h"
 
 #include <algorithm>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace Glass {
 
@@ -485,6 +488,15 @@ class GlassTable {
 
     bool readahead_key(const string &key) const;
 
+    /** Readahead the leaf blocks containing several keys.
+     *
+     *  The branch blocks on the way down are read in a batch for each level,
+     *  then readahead is requested for all the leaf blocks at once.
+     *
+     *  Returns false if readahead isn't possible for this table.
+     */
+    bool readahead_keys(const std::vector<std::string>& keys) const;
+
     /** Determine whether the btree exists on disk.
      */
     bool exists() const;
@@ -503,6 +515,21 @@ class GlassTable {
     void open(int flags_, const RootInfo & root_info,
 	      glass_revision_number_t rev);
 
+    /** Open the btree for reading, sharing the file of another table.
+     *
+     *  This is used to open another handle on the same revision of a
+     *  database for use by a different thread.  The two tables share the
+     *  file descriptor, but each has its own cursor.
+     *
+     *  @param flags_	flags for opening
+     *  @param root_info	root block info
+     *  @param rev	revision number
+     *  @param other	the table to share the file of (which must be open
+     *			to read the same revision)
+     */
+    void open(int flags_, const RootInfo & root_info,
+	      glass_revision_number_t rev, const GlassTable & other);
+
     /** Return true if this table is open.
      *
      *  NB If the table is lazy and doesn't yet exist, returns false.
@@ -742,6 +769,7 @@ class GlassTable {
     void read_block(uint4 n, uint8_t *p) const;
     void write_block(uint4 n, const uint8_t *p,
 		     bool appending = false) const;
+    void log_block_change(uint4 n, const uint8_t *p) const;
     [[noreturn]]
     void set_overwritten() const;
     void block_to_cursor(Glass::Cursor *C_, int j, uint4 n) const;
@@ -797,6 +825,14 @@ class GlassTable {
      */
     int handle;
 
+    /** Owner of handle for a table open read-only.
+     *
+     *  Tables on the same database for other threads can share the file
+     *  descriptor, so it's only closed once none of them are using it.
+     *  NULL if we don't have an fd of our own open for reading.
+     */
+    std::shared_ptr<FD> handle_owner;
+
     /// number of levels, counting from 0
     int level;
 
@@ -39,7 +39,7 @@ using Xapian::Internal::intrusive_ptr;
 GlassTermList::GlassTermList(intrusive_ptr<const GlassDatabase> db_,
 			     Xapian::docid did_,
 			     bool throw_if_not_present)
-	: db(db_), did(did_), current_wdf(0), current_termfreq(0)
+	: db(db_), reader_guard(db.get()), did(did_), current_wdf(0), current_termfreq(0)
 {
     LOGCALL_CTOR(DB, "GlassTermList", db_ | did_ | throw_if_not_present);
 
@@ -54,17 +54,24 @@ GlassTermList::GlassTermList(intrusive_ptr<const GlassDatabase> db_,
 
     pos = data.data();
     end = pos + data.size();
+    read_header(&pos, end, doclen, termlist_size);
+}
 
-    if (pos == end) {
-	doclen = 0;
-	termlist_size = 0;
+void
+GlassTermList::read_header(const char** p, const char* end,
+			   Xapian::termcount& doclen_,
+			   Xapian::termcount& size_)
+{
+    if (*p == end) {
+	doclen_ = 0;
+	size_ = 0;
 	return;
     }
 
     // Read doclen
-    if (!unpack_uint(&pos, end, &doclen)) {
+    if (!unpack_uint(p, end, &doclen_)) {
 	const char *msg;
-	if (pos == 0) {
+	if (*p == 0) {
 	    msg = "Too little data for doclen in termlist";
 	} else {
 	    msg = "Overflowed value for doclen in termlist";
@@ -73,9 +80,9 @@ GlassTermList::GlassTermList(intrusive_ptr<const GlassDatabase> db_,
     }
 
     // Read termlist_size
-    if (!unpack_uint(&pos, end, &termlist_size)) {
+    if (!unpack_uint(p, end, &size_)) {
 	const char *msg;
-	if (pos == 0) {
+	if (*p == 0) {
 	    msg = "Too little data for list size in termlist";
 	} else {
 	    msg = "Overflowed value for list size in termlist";
@@ -36,6 +36,7 @@ namespace Xapian {
 #include "glass_database.h"
 #include "api/termlist.h"
 #include "glass_table.h"
+#include "glass_reader.h"
 
 /// A TermList in a glass database.
 class GlassTermList : public TermList {
@@ -48,6 +49,9 @@ class GlassTermList : public TermList {
     /// The database we're reading data from.
     Xapian::Internal::intrusive_ptr<const GlassDatabase> db;
 
+    /// Stop the tables being changed in the background while we exist.
+    GlassReader reader_guard;
+
     /// The document id that this TermList is for.
     Xapian::docid did;
 
@@ -96,6 +100,18 @@ class GlassTermList : public TermList {
     GlassTermList(Xapian::Internal::intrusive_ptr<const GlassDatabase> db_,
 		  Xapian::docid did_, bool throw_if_not_present = true);
 
+    /** Decode the document length and termlist size from a termlist entry.
+     *
+     *  @param p		Pointer to the start of the entry, which is
+     *			updated to point after the decoded header.
+     *  @param end		Pointer to the end of the entry.
+     *  @param doclen_	Used to return the document length.
+     *  @param size_	Used to return the number of entries.
+     */
+    static void read_header(const char** p, const char* end,
+			    Xapian::termcount& doclen_,
+			    Xapian::termcount& size_);
+
     /** Return the length of this document.
      *
      *  This is a non-virtual method, used by GlassDatabase.
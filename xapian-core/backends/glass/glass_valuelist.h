@@ -22,6 +22,7 @@
 #define XAPIAN_INCLUDED_GLASS_VALUELIST_H
 
 #include "backends/valuelist.h"
+#include "glass_reader.h"
 #include "glass_values.h"
 
 class GlassCursor;
@@ -43,13 +44,16 @@ class GlassValueList : public Xapian::ValueIterator::Internal {
 
     Xapian::Internal::intrusive_ptr<const GlassDatabase> db;
 
+    /// Stop the tables being changed in the background while we exist.
+    GlassReader reader_guard;
+
     /// Update @a reader to use the chunk currently pointed to by @a cursor.
     bool update_reader();
 
   public:
     GlassValueList(Xapian::valueno slot_,
 		   Xapian::Internal::intrusive_ptr<const GlassDatabase> db_)
-	: cursor(NULL), slot(slot_), db(db_) { }
+	: cursor(NULL), slot(slot_), db(db_), reader_guard(db.get()) { }
 
     ~GlassValueList();
 
@@ -35,6 +35,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <vector>
 
 using namespace Glass;
 using namespace std;
@@ -468,6 +469,87 @@ GlassValueManager::replace_document(Xapian::docid did,
     add_document(did, doc, value_stats);
 }
 
+void
+GlassValueManager::set_value(Xapian::docid did, Xapian::valueno slot,
+			     const string & value,
+			     map<Xapian::valueno, ValueStats> & value_stats)
+{
+    string old_value = get_value(did, slot);
+    if (old_value == value) return;
+
+    std::pair<map<Xapian::valueno, ValueStats>::iterator, bool> i;
+    i = value_stats.insert(make_pair(slot, ValueStats()));
+    ValueStats & stats = i.first->second;
+    if (i.second) {
+	// There were no statistics stored already, so read them.
+	get_value_stats(slot, stats);
+    }
+
+    if (!old_value.empty()) {
+	// As for delete_document(), the bounds are only reset when the last
+	// value is removed.
+	AssertRelParanoid(stats.freq, >, 0);
+	if (--(stats.freq) == 0) {
+	    stats.lower_bound.resize(0);
+	    stats.upper_bound.resize(0);
+	}
+    }
+    if (value.empty()) {
+	remove_value(did, slot);
+    } else {
+	if ((stats.freq)++ == 0) {
+	    stats.lower_bound = value;
+	    stats.upper_bound = value;
+	} else if (value < stats.lower_bound) {
+	    stats.lower_bound = value;
+	} else if (value > stats.upper_bound) {
+	    stats.upper_bound = value;
+	}
+	add_value(did, slot, value);
+    }
+
+    if (!termlist_table->is_open() ||
+	old_value.empty() == value.empty()) {
+	// The slots used haven't changed (or aren't stored).
+	return;
+    }
+
+    // Decode the slots used, add or remove this one, and encode them again.
+    map<Xapian::docid, string>::iterator it = slots.find(did);
+    string s;
+    if (it != slots.end()) {
+	s = it->second;
+    } else {
+	(void)termlist_table->get_exact_entry(make_slot_key(did), s);
+    }
+    vector<Xapian::valueno> used;
+    const char * p = s.data();
+    const char * end = p + s.size();
+    Xapian::valueno prev_slot = static_cast<Xapian::valueno>(-1);
+    while (p != end) {
+	Xapian::valueno used_slot;
+	if (!unpack_uint(&p, end, &used_slot)) {
+	    throw Xapian::DatabaseCorruptError("Value slot encoding corrupt");
+	}
+	used_slot += prev_slot + 1;
+	prev_slot = used_slot;
+	used.push_back(used_slot);
+    }
+    auto pos = lower_bound(used.begin(), used.end(), slot);
+    if (value.empty()) {
+	if (pos != used.end() && *pos == slot) used.erase(pos);
+    } else {
+	if (pos == used.end() || *pos != slot) used.insert(pos, slot);
+    }
+    string slots_used;
+    prev_slot = static_cast<Xapian::valueno>(-1);
+    for (Xapian::valueno used_slot : used) {
+	pack_uint(slots_used, used_slot - prev_slot - 1);
+	prev_slot = used_slot;
+    }
+    slots[did] = std::move(slots_used);
+}
+
 string
 GlassValueManager::get_value(Xapian::docid did, Xapian::valueno slot) const
 {
@@ -129,6 +129,16 @@ class GlassValueManager {
     void replace_document(Xapian::docid did, const Xapian::Document &doc,
 			  std::map<Xapian::valueno, ValueStats> & value_stats);
 
+    /** Set the value in slot @a slot of document @a did.
+     *
+     *  Only the value, the list of slots used by the document and the
+     *  statistics for @a slot are updated.  An empty @a value removes any
+     *  value in the slot.
+     */
+    void set_value(Xapian::docid did, Xapian::valueno slot,
+		   const std::string & value,
+		   std::map<Xapian::valueno, ValueStats> & value_stats);
+
     std::string get_value(Xapian::docid did, Xapian::valueno slot) const;
 
     void get_all_values(std::map<Xapian::valueno, std::string> & values,
@@ -94,9 +94,9 @@ GlassVersion::~GlassVersion()
 }
 
 void
-GlassVersion::read()
+GlassVersion::read(string* data)
 {
-    LOGCALL_VOID(DB, "GlassVersion::read", NO_ARGS);
+    LOGCALL_VOID(DB, "GlassVersion::read", data);
     FD close_fd(-1);
     int fd_in;
     if (single_file()) {
@@ -125,6 +125,10 @@ GlassVersion::read()
 
     const char * p = buf;
     const char * end = p + io_read(fd_in, buf, sizeof(buf), 33);
+    if (data) {
+	Assert(!single_file());
+	data->assign(buf, end - buf);
+    }
 
     if (memcmp(buf, GLASS_VERSION_MAGIC, GLASS_VERSION_MAGIC_LEN) != 0)
 	throw Xapian::DatabaseCorruptError("Rev file magic incorrect");
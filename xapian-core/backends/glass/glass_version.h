@@ -166,6 +166,29 @@ class GlassVersion {
 
     explicit GlassVersion(int fd_);
 
+    /** Copy the revision and stats read by another GlassVersion.
+     *
+     *  Only supported for a multi-file database which isn't being modified.
+     */
+    GlassVersion(const GlassVersion & o)
+	: rev(o.rev), uuid(o.uuid), fd(-1), offset(o.offset),
+	  db_dir(o.db_dir), changes(NULL),
+	  doccount(o.doccount), total_doclen(o.total_doclen),
+	  last_docid(o.last_docid),
+	  doclen_lbound(o.doclen_lbound), doclen_ubound(o.doclen_ubound),
+	  wdf_ubound(o.wdf_ubound),
+	  spelling_wordfreq_ubound(o.spelling_wordfreq_ubound),
+	  oldest_changeset(o.oldest_changeset),
+	  serialised_stats(o.serialised_stats) {
+	for (unsigned i = 0; i != Glass::MAX_; ++i) {
+	    root[i] = o.root[i];
+	    old_root[i] = o.old_root[i];
+	}
+    }
+
+    /// Don't allow assignment.
+    GlassVersion & operator=(const GlassVersion &) = delete;
+
     ~GlassVersion();
 
     /** Create the version file. */
@@ -176,8 +199,11 @@ class GlassVersion {
     /** Read the version file and check it's a version we understand.
      *
      *  On failure, an exception is thrown.
+     *
+     *  @param data	If non-NULL, the raw contents of the version file are
+     *			stored here (only supported if !single_file()).
      */
-    void read();
+    void read(std::string* data = NULL);
 
     void cancel();
 
@@ -1197,6 +1197,16 @@ merge_spellings(HoneyTable* out,
 	// Note that the key ordering is the same for glass and honey, which
 	// makes translating during compaction simpler.
 	string key = cur->current_key;
+	if (key[0] == 'D') {
+	    // Honey doesn't support glass's symmetric delete lists, so drop
+	    // them (and the marker which says they're present).
+	    if (cur->next()) {
+		pq.push(cur);
+	    } else {
+		delete cur;
+	    }
+	    continue;
+	}
 	switch (key[0]) {
 	    case 'B':
 		key[0] = Honey::KEY_PREFIX_BOOKEND;
@@ -164,6 +164,76 @@ HoneyDatabase::get_unique_terms(Xapian::docid did) const
     return HoneyTermList(this, did).get_unique_terms();
 }
 
+vector<Xapian::termcount>
+HoneyDatabase::get_doclengths(const vector<Xapian::docid>& dids) const
+{
+    vector<Xapian::termcount> result;
+    if (dids.empty()) return result;
+    result.reserve(dids.size());
+    // Like get_doclength(), but with our own cursor and chunk reader so we
+    // don't disturb the cached ones.
+    unique_ptr<HoneyCursor> cursor(get_postlist_cursor());
+    Honey::DocLenChunkReader reader;
+    bool have_chunk = false;
+    for (Xapian::docid did : dids) {
+	Assert(did != 0);
+	if (rare(did > version_file.get_last_docid())) {
+	    string message = "Document ID not in use: ";
+	    message += str(did);
+	    throw Xapian::DocNotFoundError(message);
+	}
+	if (have_chunk && reader.find_doclength(did)) {
+	    result.push_back(reader.get_doclength());
+	    continue;
+	}
+
+	// If exact is true, the desired docid is the last in this chunk.
+	bool exact = cursor->find_entry_ge(Honey::make_doclenchunk_key(did));
+	have_chunk = reader.update(cursor.get());
+	if (have_chunk) {
+	    if (exact) {
+		result.push_back(reader.back());
+		continue;
+	    }
+	    if (reader.find_doclength(did)) {
+		result.push_back(reader.get_doclength());
+		continue;
+	    }
+	}
+
+	string message = "Document ID not in use: ";
+	message += str(did);
+	throw Xapian::DocNotFoundError(message);
+    }
+    return result;
+}
+
+vector<Xapian::termcount>
+HoneyDatabase::get_unique_terms_counts(const vector<Xapian::docid>& dids) const
+{
+    vector<Xapian::termcount> result;
+    if (dids.empty()) return result;
+    result.reserve(dids.size());
+    // Read the header of each termlist entry with one cursor which moves
+    // forwards through the table, rather than building a HoneyTermList for
+    // each document.
+    unique_ptr<HoneyCursor> cursor(termlist_table.cursor_get());
+    for (Xapian::docid did : dids) {
+	Assert(did != 0);
+	Xapian::termcount doclen = 0, termlist_size = 0;
+	if (cursor.get() &&
+	    cursor->find_exact(HoneyTermListTable::make_key(did))) {
+	    cursor->read_tag();
+	    const char* p = cursor->current_tag.data();
+	    const char* end = p + cursor->current_tag.size();
+	    HoneyTermList::read_header(&p, end, doclen, termlist_size);
+	}
+	// As for get_unique_terms(), ensure unique_terms <= doclen.
+	result.push_back(min(termlist_size, doclen));
+    }
+    return result;
+}
+
 Xapian::termcount
 HoneyDatabase::get_wdfdocmax(Xapian::docid did) const
 {
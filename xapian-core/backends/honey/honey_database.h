@@ -114,6 +114,12 @@ class HoneyDatabase : public Xapian::Database::Internal {
     // Return the max_wdf in the document
     Xapian::termcount get_wdfdocmax(Xapian::docid did) const;
 
+    std::vector<Xapian::termcount>
+    get_doclengths(const std::vector<Xapian::docid>& dids) const;
+
+    std::vector<Xapian::termcount>
+    get_unique_terms_counts(const std::vector<Xapian::docid>& dids) const;
+
     /** Returns frequencies for a term.
      *
      *  @param term		The term to get frequencies for
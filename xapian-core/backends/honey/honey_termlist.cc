@@ -54,39 +54,46 @@ HoneyTermList::HoneyTermList(const HoneyDatabase* db_, Xapian::docid did_)
 
     pos = data.data();
     end = pos + data.size();
+    read_header(&pos, end, doclen, termlist_size);
+}
 
-    if (pos == end)
-	throw_database_corrupt("No termlist data", pos);
+void
+HoneyTermList::read_header(const char** p, const char* end,
+			   Xapian::termcount& doclen_,
+			   Xapian::termcount& size_)
+{
+    if (*p == end)
+	throw_database_corrupt("No termlist data", *p);
 
-    size_t slot_enc_size = *pos++;
+    size_t slot_enc_size = *(*p)++;
 
     // If the top bit is clear we have a 7-bit bitmap of slots used.
     if (slot_enc_size & 0x80) {
 	slot_enc_size &= 0x7f;
 	if (slot_enc_size == 0) {
-	    if (!unpack_uint(&pos, end, &slot_enc_size)) {
+	    if (!unpack_uint(p, end, &slot_enc_size)) {
 		throw Xapian::DatabaseCorruptError("Termlist encoding corrupt");
 	    }
 	}
 
 	// Skip encoded slot data.
-	pos += slot_enc_size;
+	*p += slot_enc_size;
     }
 
-    if (pos == end) {
+    if (*p == end) {
 	// Document with values but no terms.
-	termlist_size = 0;
-	doclen = 0;
+	size_ = 0;
+	doclen_ = 0;
 	return;
     }
 
-    if (!unpack_uint(&pos, end, &termlist_size)) {
-	throw_database_corrupt("termlist length", pos);
+    if (!unpack_uint(p, end, &size_)) {
+	throw_database_corrupt("termlist length", *p);
     }
-    ++termlist_size;
+    ++size_;
 
-    if (!unpack_uint(&pos, end, &doclen)) {
-	throw_database_corrupt("doclen", pos);
+    if (!unpack_uint(p, end, &doclen_)) {
+	throw_database_corrupt("doclen", *p);
     }
 }
 
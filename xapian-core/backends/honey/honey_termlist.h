@@ -87,6 +87,18 @@ class HoneyTermList : public TermList {
     /// Create a new HoneyTermList object for document @a did_ in DB @a db_
     HoneyTermList(const HoneyDatabase* db_, Xapian::docid did_);
 
+    /** Decode the document length and termlist size from a termlist entry.
+     *
+     *  @param p		Pointer to the start of the entry, which is
+     *			updated to point after the decoded header.
+     *  @param end		Pointer to the end of the entry.
+     *  @param doclen_	Used to return the document length.
+     *  @param size_	Used to return the number of entries.
+     */
+    static void read_header(const char** p, const char* end,
+			    Xapian::termcount& doclen_,
+			    Xapian::termcount& size_);
+
     /** Return the length of this document.
      *
      *  This is a non-virtual method, used by HoneyDatabase.
@@ -21,6 +21,7 @@
 #include "multi_database.h"
 
 #include "backends/backends.h"
+#include "backends/documentinternal.h"
 #include "backends/multi.h"
 #include "expand/ortermlist.h"
 #include "expand/termlistmerger.h"
@@ -30,9 +31,66 @@
 #include "multi_valuelist.h"
 
 #include <memory>
+#include <vector>
 
 using namespace std;
 
+/** Make a copy of @a doc which doesn't share anything with it.
+ *
+ *  Document objects are reference counted without locking, so we can't hand
+ *  the caller's document over to a writer thread.  Instead the writer thread
+ *  gets sole ownership of a copy of the internals, made in one pass here.
+ */
+static Xapian::Document
+copy_document(const Xapian::Document& doc)
+{
+    return Xapian::Document(doc.internal->unshared_copy());
+}
+
+ShardWriter*
+MultiDatabase::get_writer(size_type i) const
+{
+    if (writers.empty()) {
+	writers.resize(shards.size());
+	for (size_type j = 0; j != shards.size(); ++j) {
+	    if (shards[j]->pipelines_updates())
+		writers[j].reset(new ShardWriter(shards[j]));
+	}
+    }
+    return writers[i].get();
+}
+
+void
+MultiDatabase::sync_writers_(bool report_errors) const
+{
+    // Wait for every shard, even if one has failed.
+    exception_ptr error;
+    for (auto&& writer : writers) {
+	if (!writer) continue;
+	try {
+	    writer->sync();
+	} catch (...) {
+	    if (!error) error = current_exception();
+	}
+    }
+    if (error) {
+	// An update we counted may not have happened.
+	lastdocid_known = false;
+	if (report_errors) rethrow_exception(error);
+    }
+}
+
+void
+MultiDatabase::push_back(Xapian::Database::Internal* shard)
+{
+    // Adding a shard changes which shard each docid is in, so the writers
+    // need to be set up again.
+    sync_writers();
+    writers.clear();
+    lastdocid_known = false;
+    shards.push_back(shard);
+}
+
 MultiDatabase::size_type
 MultiDatabase::size() const
 {
@@ -42,6 +100,8 @@ MultiDatabase::size() const
 bool
 MultiDatabase::reopen()
 {
+    sync_writers();
+    lastdocid_known = false;
     bool result = false;
     for (auto&& shard : shards) {
 	if (shard->reopen()) {
@@ -54,6 +114,9 @@ MultiDatabase::reopen()
 void
 MultiDatabase::close()
 {
+    // Any errors from queued updates are moot now.
+    writers.clear();
+    lastdocid_known = false;
     for (auto&& shard : shards) {
 	shard->close();
     }
@@ -62,6 +125,7 @@ MultiDatabase::close()
 PostList*
 MultiDatabase::open_post_list(const string& term) const
 {
+    sync_writers();
     PostList** postlists = new PostList*[shards.size()];
     size_t count = 0;
     try {
@@ -95,6 +159,7 @@ MultiDatabase::open_term_list(Xapian::docid did) const
 TermList*
 MultiDatabase::open_term_list_direct(Xapian::docid did) const
 {
+    sync_writers();
     Xapian::doccount n_shards = shards.size();
     auto shard_index = shard_number(did, n_shards);
     auto shard = shards[shard_index];
@@ -107,6 +172,7 @@ MultiDatabase::open_term_list_direct(Xapian::docid did) const
 TermList*
 MultiDatabase::open_allterms(const string& prefix) const
 {
+    sync_writers();
     size_t count = 0;
     TermList** termlists = new TermList*[shards.size()];
     try {
@@ -126,6 +192,7 @@ MultiDatabase::open_allterms(const string& prefix) const
 bool
 MultiDatabase::has_positions() const
 {
+    sync_writers();
     for (auto&& shard : shards) {
 	if (shard->has_positions()) {
 	    return true;
@@ -137,6 +204,7 @@ MultiDatabase::has_positions() const
 PositionList*
 MultiDatabase::open_position_list(Xapian::docid did, const string& term) const
 {
+    sync_writers();
     auto n_shards = shards.size();
     auto shard = shards[shard_number(did, n_shards)];
     auto shard_did = shard_docid(did, n_shards);
@@ -146,6 +214,7 @@ MultiDatabase::open_position_list(Xapian::docid did, const string& term) const
 Xapian::doccount
 MultiDatabase::get_doccount() const
 {
+    sync_writers();
     Xapian::doccount result = 0;
     for (auto&& shard : shards) {
 	auto old_result = result;
@@ -159,6 +228,9 @@ MultiDatabase::get_doccount() const
 Xapian::docid
 MultiDatabase::get_lastdocid() const
 {
+    if (lastdocid_known) return lastdocid;
+
+    sync_writers();
     Xapian::docid result = 0;
     Xapian::doccount n_shards = shards.size();
     for (Xapian::doccount shard = 0; shard != n_shards; ++shard) {
@@ -176,6 +248,7 @@ MultiDatabase::get_lastdocid() const
 Xapian::totallength
 MultiDatabase::get_total_length() const
 {
+    sync_writers();
     Xapian::totallength result = 0;
     for (auto&& shard : shards) {
 	auto old_result = result;
@@ -193,6 +266,7 @@ MultiDatabase::get_freqs(const string& term,
 {
     Assert(!term.empty());
 
+    sync_writers();
     Xapian::doccount shard_tf;
     Xapian::doccount* shard_tf_ptr = tf_ptr ? &shard_tf : NULL;
     Xapian::doccount total_tf = 0;
@@ -227,6 +301,7 @@ MultiDatabase::get_freqs(const string& term,
 Xapian::doccount
 MultiDatabase::get_value_freq(Xapian::valueno slot) const
 {
+    sync_writers();
     Xapian::termcount result = 0;
     for (auto&& shard : shards) {
 	auto old_result = result;
@@ -240,6 +315,7 @@ MultiDatabase::get_value_freq(Xapian::valueno slot) const
 string
 MultiDatabase::get_value_lower_bound(Xapian::valueno slot) const
 {
+    sync_writers();
     string result;
     for (auto&& shard : shards) {
 	string shard_result = shard->get_value_lower_bound(slot);
@@ -254,6 +330,7 @@ MultiDatabase::get_value_lower_bound(Xapian::valueno slot) const
 string
 MultiDatabase::get_value_upper_bound(Xapian::valueno slot) const
 {
+    sync_writers();
     string result;
     for (auto&& shard : shards) {
 	string shard_result = shard->get_value_upper_bound(slot);
@@ -266,6 +343,7 @@ MultiDatabase::get_value_upper_bound(Xapian::valueno slot) const
 Xapian::termcount
 MultiDatabase::get_doclength_lower_bound() const
 {
+    sync_writers();
     // We want the smallest answer from amongst the shards, except that 0 means
     // that all documents have length 0 (including the special case of there
     // being no documents), so any non-zero answer should "beat" 0.  To achieve
@@ -285,6 +363,7 @@ MultiDatabase::get_doclength_lower_bound() const
 Xapian::termcount
 MultiDatabase::get_doclength_upper_bound() const
 {
+    sync_writers();
     Xapian::termcount result = 0;
     for (auto&& shard : shards) {
 	result = max(result, shard->get_doclength_upper_bound());
@@ -297,6 +376,7 @@ MultiDatabase::get_wdf_upper_bound(const string& term) const
 {
     Assert(!term.empty());
 
+    sync_writers();
     Xapian::termcount result = 0;
     for (auto&& shard : shards) {
 	result = max(result, shard->get_wdf_upper_bound(term));
@@ -307,6 +387,7 @@ MultiDatabase::get_wdf_upper_bound(const string& term) const
 ValueList*
 MultiDatabase::open_value_list(Xapian::valueno slot) const
 {
+    sync_writers();
     SubValueList** valuelists = new SubValueList*[shards.size()];
     unsigned count = 0;
     try {
@@ -329,6 +410,7 @@ MultiDatabase::get_doclength(Xapian::docid did) const
 {
     Assert(did != 0);
 
+    sync_writers();
     auto n_shards = shards.size();
     auto shard = shards[shard_number(did, n_shards)];
     auto shard_did = shard_docid(did, n_shards);
@@ -340,6 +422,7 @@ MultiDatabase::get_unique_terms(Xapian::docid did) const
 {
     Assert(did != 0);
 
+    sync_writers();
     auto n_shards = shards.size();
     auto shard = shards[shard_number(did, n_shards)];
     auto shard_did = shard_docid(did, n_shards);
@@ -351,26 +434,112 @@ MultiDatabase::get_wdfdocmax(Xapian::docid did) const
 {
     Assert(did != 0);
 
+    sync_writers();
     auto n_shards = shards.size();
     auto shard = shards[shard_number(did, n_shards)];
     auto shard_did = shard_docid(did, n_shards);
     return shard->get_wdfdocmax(shard_did);
 }
 
+/** Perform a batch lookup by splitting the docids between the shards.
+ *
+ *  @param shards	The shards.
+ *  @param dids		The docids to look up, in ascending order.
+ *  @param lookup	Called with each shard and its docids (which will also
+ *			be in ascending order), and returns the results.
+ *
+ *  @return The results, in the same order as @a dids.
+ */
+template<typename T, typename S, typename F>
+static vector<T>
+batch_by_shard(const S& shards, const vector<Xapian::docid>& dids, F lookup)
+{
+    auto n_shards = shards.size();
+    vector<vector<Xapian::docid>> shard_dids(n_shards);
+    for (Xapian::docid did : dids) {
+	Assert(did != 0);
+	auto shard = shard_number(did, n_shards);
+	shard_dids[shard].push_back(shard_docid(did, n_shards));
+    }
+
+    vector<vector<T>> shard_results(n_shards);
+    for (size_t i = 0; i != n_shards; ++i) {
+	if (!shard_dids[i].empty())
+	    shard_results[i] = lookup(shards[i], shard_dids[i]);
+    }
+
+    vector<T> result;
+    result.reserve(dids.size());
+    vector<size_t> pos(n_shards);
+    for (Xapian::docid did : dids) {
+	auto shard = shard_number(did, n_shards);
+	result.push_back(std::move(shard_results[shard][pos[shard]++]));
+    }
+    return result;
+}
+
+vector<Xapian::termcount>
+MultiDatabase::get_doclengths(const vector<Xapian::docid>& dids) const
+{
+    sync_writers();
+    return batch_by_shard<Xapian::termcount>(
+	shards, dids,
+	[](const Xapian::Database::Internal* shard,
+	   const vector<Xapian::docid>& shard_dids) {
+	    return shard->get_doclengths(shard_dids);
+	});
+}
+
+vector<Xapian::termcount>
+MultiDatabase::get_unique_terms_counts(const vector<Xapian::docid>& dids) const
+{
+    sync_writers();
+    return batch_by_shard<Xapian::termcount>(
+	shards, dids,
+	[](const Xapian::Database::Internal* shard,
+	   const vector<Xapian::docid>& shard_dids) {
+	    return shard->get_unique_terms_counts(shard_dids);
+	});
+}
+
+vector<string>
+MultiDatabase::get_values(const vector<Xapian::docid>& dids,
+			  Xapian::valueno slot) const
+{
+    sync_writers();
+    return batch_by_shard<string>(
+	shards, dids,
+	[slot](const Xapian::Database::Internal* shard,
+	       const vector<Xapian::docid>& shard_dids) {
+	    return shard->get_values(shard_dids, slot);
+	});
+}
+
 Xapian::Document::Internal*
 MultiDatabase::open_document(Xapian::docid did, bool lazy) const
 {
     Assert(did != 0);
 
+    sync_writers();
     auto n_shards = shards.size();
     auto shard = shards[shard_number(did, n_shards)];
     auto shard_did = shard_docid(did, n_shards);
-    return shard->open_document(shard_did, lazy);
+    Xapian::Document::Internal* doc = shard->open_document(shard_did, lazy);
+    if (shard->pipelines_updates()) {
+	// Updates queued after we return are applied to the shard by a writer
+	// thread, so read the whole document now rather than from the shard
+	// while the thread may be updating it.
+	unique_ptr<Xapian::Document::Internal> doc_ptr(doc);
+	doc->fetch_all();
+	doc = doc_ptr.release();
+    }
+    return doc;
 }
 
 bool
 MultiDatabase::term_exists(const string& term) const
 {
+    sync_writers();
     for (auto&& shard : shards) {
 	if (shard->term_exists(term))
 	    return true;
@@ -381,6 +550,7 @@ MultiDatabase::term_exists(const string& term) const
 void
 MultiDatabase::keep_alive()
 {
+    sync_writers();
     for (auto&& shard : shards) {
 	shard->keep_alive();
     }
@@ -389,6 +559,7 @@ MultiDatabase::keep_alive()
 TermList*
 MultiDatabase::open_spelling_termlist(const string& word) const
 {
+    sync_writers();
     vector<TermList*> termlists;
     termlists.reserve(shards.size());
 
@@ -408,9 +579,40 @@ MultiDatabase::open_spelling_termlist(const string& word) const
     }
 }
 
+TermList*
+MultiDatabase::open_spelling_deletes_termlist(const string& word,
+					      unsigned max_edit_distance) const
+{
+    sync_writers();
+    vector<TermList*> termlists;
+    termlists.reserve(shards.size());
+
+    try {
+	for (auto&& shard : shards) {
+	    TermList* termlist =
+		shard->open_spelling_deletes_termlist(word, max_edit_distance);
+	    if (!termlist) {
+		// The candidates would be incomplete unless every shard can
+		// supply them this way, so fall back to trigrams for all.
+		for (auto&& t : termlists)
+		    delete t;
+		return NULL;
+	    }
+	    termlists.push_back(termlist);
+	}
+
+	return make_termlist_merger(termlists);
+    } catch (...) {
+	for (auto&& termlist : termlists)
+	    delete termlist;
+	throw;
+    }
+}
+
 TermList*
 MultiDatabase::open_spelling_wordlist() const
 {
+    sync_writers();
     vector<TermList*> termlists;
     termlists.reserve(shards.size());
 
@@ -433,6 +635,7 @@ MultiDatabase::open_spelling_wordlist() const
 Xapian::doccount
 MultiDatabase::get_spelling_frequency(const string& word) const
 {
+    sync_writers();
     Xapian::doccount result = 0;
     for (auto&& shard : shards) {
 	auto old_result = result;
@@ -446,6 +649,7 @@ MultiDatabase::get_spelling_frequency(const string& word) const
 TermList*
 MultiDatabase::open_synonym_termlist(const string& term) const
 {
+    sync_writers();
     vector<TermList*> termlists;
     termlists.reserve(shards.size());
 
@@ -468,6 +672,7 @@ MultiDatabase::open_synonym_termlist(const string& term) const
 TermList*
 MultiDatabase::open_synonym_keylist(const string& prefix) const
 {
+    sync_writers();
     vector<TermList*> termlists;
     termlists.reserve(shards.size());
 
@@ -490,18 +695,21 @@ MultiDatabase::open_synonym_keylist(const string& prefix) const
 string
 MultiDatabase::get_metadata(const string& key) const
 {
+    sync_writers();
     return shards[0]->get_metadata(key);
 }
 
 TermList*
 MultiDatabase::open_metadata_keylist(const string& prefix) const
 {
+    sync_writers();
     return shards[0]->open_metadata_keylist(prefix);
 }
 
 string
 MultiDatabase::get_uuid() const
 {
+    sync_writers();
     string uuid;
     for (auto&& shard : shards) {
 	const string& sub_uuid = shard->get_uuid();
@@ -531,7 +739,8 @@ void
 MultiDatabase::write_changesets_to_fd(int,
 				      const std::string&,
 				      bool,
-				      Xapian::ReplicationInfo*)
+				      Xapian::ReplicationInfo*,
+				      bool)
 {
     throw Xapian::InvalidOperationError("write_changesets_to_fd() with "
 					"more than one subdatabase");
@@ -562,14 +771,41 @@ MultiDatabase::get_backend_info(string*) const
 void
 MultiDatabase::commit()
 {
-    for (auto&& shard : shards) {
-	shard->commit();
+    // Shards with a writer thread are committed by it once the updates
+    // queued for it have been applied, in parallel with each other and with
+    // committing the other shards here.
+    exception_ptr error;
+    for (size_type i = 0; i != shards.size(); ++i) {
+	ShardWriter* writer = get_writer(i);
+	if (!writer) continue;
+	try {
+	    writer->queue_commit();
+	} catch (...) {
+	    if (!error) error = current_exception();
+	}
+    }
+    for (size_type i = 0; i != shards.size(); ++i) {
+	if (writers[i]) continue;
+	try {
+	    shards[i]->commit();
+	} catch (...) {
+	    if (!error) error = current_exception();
+	}
+    }
+    try {
+	sync_writers();
+    } catch (...) {
+	if (!error) error = current_exception();
     }
+    if (error) rethrow_exception(error);
 }
 
 void
 MultiDatabase::cancel()
 {
+    // The queued updates are being cancelled anyway.
+    sync_writers_(false);
+    lastdocid_known = false;
     for (auto&& shard : shards) {
 	shard->cancel();
     }
@@ -578,6 +814,7 @@ MultiDatabase::cancel()
 void
 MultiDatabase::begin_transaction(bool flushed)
 {
+    sync_writers();
     for (auto&& shard : shards) {
 	shard->begin_transaction(flushed);
     }
@@ -586,6 +823,12 @@ MultiDatabase::begin_transaction(bool flushed)
 void
 MultiDatabase::end_transaction_(bool do_commit)
 {
+    if (do_commit) {
+	sync_writers();
+    } else {
+	sync_writers_(false);
+	lastdocid_known = false;
+    }
     for (auto&& shard : shards) {
 	shard->end_transaction(do_commit);
     }
@@ -603,15 +846,26 @@ MultiDatabase::add_document(const Xapian::Document& doc)
 				    "before you can add more documents");
     }
 
+    // A document read from a database may need to read from our shards.
+    if (doc.get_docid()) sync_writers();
     auto n_shards = shards.size();
-    auto shard = shards[shard_number(did, n_shards)];
-    shard->replace_document(shard_docid(did, n_shards), doc);
+    auto i = shard_number(did, n_shards);
+    ShardWriter* writer = get_writer(i);
+    if (writer) {
+	writer->queue_replace(shard_docid(did, n_shards), copy_document(doc));
+	// The shard may not have been updated yet, so remember the docid.
+	lastdocid_known = true;
+    } else {
+	shards[i]->replace_document(shard_docid(did, n_shards), doc);
+    }
+    lastdocid = did;
     return did;
 }
 
 void
 MultiDatabase::delete_document(Xapian::docid did)
 {
+    sync_writers();
     auto n_shards = shards.size();
     auto shard = shards[shard_number(did, n_shards)];
     shard->delete_document(shard_docid(did, n_shards));
@@ -620,6 +874,7 @@ MultiDatabase::delete_document(Xapian::docid did)
 void
 MultiDatabase::delete_document(const string& term)
 {
+    sync_writers();
     for (auto&& shard : shards) {
 	shard->delete_document(term);
     }
@@ -628,29 +883,29 @@ MultiDatabase::delete_document(const string& term)
 void
 MultiDatabase::replace_document(Xapian::docid did, const Xapian::Document& doc)
 {
+    // A document read from a database may need to read from our shards.
+    if (doc.get_docid()) sync_writers();
     auto n_shards = shards.size();
-    auto shard = shards[shard_number(did, n_shards)];
-    shard->replace_document(shard_docid(did, n_shards), doc);
+    auto i = shard_number(did, n_shards);
+    ShardWriter* writer = get_writer(i);
+    if (writer) {
+	writer->queue_replace(shard_docid(did, n_shards), copy_document(doc));
+    } else {
+	shards[i]->replace_document(shard_docid(did, n_shards), doc);
+    }
+    if (lastdocid_known && did > lastdocid) lastdocid = did;
 }
 
 Xapian::docid
 MultiDatabase::replace_document(const string& term, const Xapian::Document& doc)
 {
+    sync_writers();
     auto n_shards = shards.size();
     unique_ptr<PostList> pl(open_post_list(term));
     pl->next();
     // If no unique_term in the database, this is just an add_document().
     if (pl->at_end()) {
-	// Which database will the next never used docid be in?
-	Xapian::docid did = get_lastdocid() + 1;
-	if (rare(did == 0)) {
-	    throw Xapian::DatabaseError("Run out of docids - you'll have to "
-					"use copydatabase to eliminate any "
-					"gaps before you can add more "
-					"documents");
-	}
-	auto shard = shards[shard_number(did, n_shards)];
-	return shard->add_document(doc);
+	return add_document(doc);
     }
 
     Xapian::docid result = pl->get_docid();
@@ -667,21 +922,51 @@ MultiDatabase::replace_document(const string& term, const Xapian::Document& doc)
     return result;
 }
 
+void
+MultiDatabase::set_document_value(Xapian::docid did,
+				  Xapian::valueno slot,
+				  const string& value)
+{
+    sync_writers();
+    auto n_shards = shards.size();
+    auto shard = shards[shard_number(did, n_shards)];
+    shard->set_document_value(shard_docid(did, n_shards), slot, value);
+}
+
 void
 MultiDatabase::request_document(Xapian::docid did) const
 {
     Assert(did != 0);
 
+    sync_writers();
     auto n_shards = shards.size();
     auto shard = shards[shard_number(did, n_shards)];
     auto shard_did = shard_docid(did, n_shards);
     shard->request_document(shard_did);
 }
 
+void
+MultiDatabase::request_documents(const vector<Xapian::docid>& dids) const
+{
+    sync_writers();
+    auto n_shards = shards.size();
+    vector<vector<Xapian::docid>> shard_dids(n_shards);
+    for (Xapian::docid did : dids) {
+	Assert(did != 0);
+	auto shard = shard_number(did, n_shards);
+	shard_dids[shard].push_back(shard_docid(did, n_shards));
+    }
+    for (size_t i = 0; i != n_shards; ++i) {
+	if (!shard_dids[i].empty())
+	    shards[i]->request_documents(shard_dids[i]);
+    }
+}
+
 void
 MultiDatabase::add_spelling(const string& word,
 			    Xapian::termcount freqinc) const
 {
+    sync_writers();
     shards[0]->add_spelling(word, freqinc);
 }
 
@@ -689,6 +974,7 @@ Xapian::termcount
 MultiDatabase::remove_spelling(const string& word,
 			       Xapian::termcount freqdec) const
 {
+    sync_writers();
     for (auto&& shard : shards) {
 	freqdec = shard->remove_spelling(word, freqdec);
 	if (freqdec == 0)
@@ -701,6 +987,7 @@ void
 MultiDatabase::add_synonym(const string& term,
 			   const string& synonym) const
 {
+    sync_writers();
     shards[0]->add_synonym(term, synonym);
 }
 
@@ -708,6 +995,7 @@ void
 MultiDatabase::remove_synonym(const string& term,
 			      const string& synonym) const
 {
+    sync_writers();
     for (auto&& shard : shards) {
 	shard->remove_synonym(term, synonym);
     }
@@ -716,6 +1004,7 @@ MultiDatabase::remove_synonym(const string& term,
 void
 MultiDatabase::clear_synonyms(const string& term) const
 {
+    sync_writers();
     for (auto&& shard : shards) {
 	shard->clear_synonyms(term);
     }
@@ -724,6 +1013,7 @@ MultiDatabase::clear_synonyms(const string& term) const
 void
 MultiDatabase::set_metadata(const string& key, const string& value)
 {
+    sync_writers();
     shards[0]->set_metadata(key, value);
 }
 
@@ -736,6 +1026,7 @@ MultiDatabase::reconstruct_text(Xapian::docid did,
 {
     Assert(did != 0);
 
+    sync_writers();
     auto n_shards = shards.size();
     auto shard = shards[shard_number(did, n_shards)];
     auto shard_did = shard_docid(did, n_shards);
@@ -743,6 +1034,17 @@ MultiDatabase::reconstruct_text(Xapian::docid did,
 				   start_pos, end_pos);
 }
 
+Xapian::Database::Internal*
+MultiDatabase::clone() const
+{
+    sync_writers();
+    unique_ptr<MultiDatabase> result(new MultiDatabase(shards.size(), true));
+    for (auto&& shard : shards) {
+	result->push_back(shard->clone());
+    }
+    return result.release();
+}
+
 string
 MultiDatabase::get_description() const
 {
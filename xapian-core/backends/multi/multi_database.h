@@ -24,6 +24,10 @@
 #include "api/termlist.h"
 #include "backends/databaseinternal.h"
 #include "backends/valuelist.h"
+#include "backends/multi/multi_shardwriter.h"
+
+#include <memory>
+#include <vector>
 
 class LeafPostList;
 class Matcher;
@@ -47,6 +51,36 @@ class MultiDatabase : public Xapian::Database::Internal {
 
     Xapian::SmallVectorI<Xapian::Database::Internal> shards;
 
+    /** Threads which apply document updates to each shard.
+     *
+     *  Shards opened with Xapian::DB_PIPELINE_UPDATES get a writer thread,
+     *  so that the shards are updated in parallel.  Other shards have NULL
+     *  here and are updated by the calling thread.
+     *
+     *  Empty until the first document update, so a read-only MultiDatabase
+     *  (or one which isn't updated) doesn't start any threads.
+     */
+    mutable std::vector<std::unique_ptr<ShardWriter>> writers;
+
+    /** The value get_lastdocid() would return, if lastdocid_known.
+     *
+     *  Tracked by the methods which add and replace documents, so that they
+     *  don't need to wait for queued updates to work out the next docid.
+     */
+    mutable Xapian::docid lastdocid = 0;
+
+    mutable bool lastdocid_known = false;
+
+    /// The writer thread for shard @a i, or NULL if it doesn't have one.
+    ShardWriter* get_writer(size_type i) const;
+
+    /** Wait for all queued updates to be applied.
+     *
+     *  @param report_errors	If true, rethrow the first exception from a
+     *				failed update, otherwise ignore them.
+     */
+    void sync_writers_(bool report_errors) const;
+
   public:
     explicit MultiDatabase(size_type reserve_size, bool read_only)
 	: Xapian::Database::Internal(read_only ?
@@ -58,8 +92,15 @@ class MultiDatabase : public Xapian::Database::Internal {
 
     void reserve(size_type new_size) { shards.reserve(new_size); }
 
-    void push_back(Xapian::Database::Internal* shard) {
-	shards.push_back(shard);
+    void push_back(Xapian::Database::Internal* shard);
+
+    /** Wait for all queued document updates to be applied.
+     *
+     *  This must be called before accessing the shards directly.  If an
+     *  update failed, the first exception is rethrown.
+     */
+    void sync_writers() const {
+	if (!writers.empty()) sync_writers_(true);
     }
 
     bool reopen();
@@ -111,6 +152,16 @@ class MultiDatabase : public Xapian::Database::Internal {
 
     Xapian::termcount get_wdfdocmax(Xapian::docid did) const;
 
+    std::vector<Xapian::termcount>
+    get_doclengths(const std::vector<Xapian::docid>& dids) const;
+
+    std::vector<Xapian::termcount>
+    get_unique_terms_counts(const std::vector<Xapian::docid>& dids) const;
+
+    std::vector<std::string>
+    get_values(const std::vector<Xapian::docid>& dids,
+	       Xapian::valueno slot) const;
+
     Xapian::Document::Internal* open_document(Xapian::docid did,
 					      bool lazy) const;
 
@@ -120,6 +171,9 @@ class MultiDatabase : public Xapian::Database::Internal {
 
     TermList* open_spelling_termlist(const std::string& word) const;
 
+    TermList* open_spelling_deletes_termlist(const std::string& word,
+					     unsigned max_edit_distance) const;
+
     TermList* open_spelling_wordlist() const;
 
     Xapian::doccount get_spelling_frequency(const std::string& word) const;
@@ -139,7 +193,8 @@ class MultiDatabase : public Xapian::Database::Internal {
     void write_changesets_to_fd(int fd,
 				const std::string& start_revision,
 				bool need_whole_db,
-				Xapian::ReplicationInfo* info);
+				Xapian::ReplicationInfo* info,
+				bool compress);
 
     void invalidate_doc_object(Xapian::Document::Internal* obj) const;
 
@@ -166,8 +221,13 @@ class MultiDatabase : public Xapian::Database::Internal {
     Xapian::docid replace_document(const std::string& term,
 				   const Xapian::Document& doc);
 
+    void set_document_value(Xapian::docid did, Xapian::valueno slot,
+			    const std::string& value);
+
     void request_document(Xapian::docid did) const;
 
+    void request_documents(const std::vector<Xapian::docid>& dids) const;
+
     void add_spelling(const std::string& word, Xapian::termcount freqinc) const;
 
     Xapian::termcount remove_spelling(const std::string& word,
@@ -188,6 +248,8 @@ class MultiDatabase : public Xapian::Database::Internal {
 				 Xapian::termpos start_pos,
 				 Xapian::termpos end_pos) const;
 
+    Xapian::Database::Internal* clone() const;
+
     std::string get_description() const;
 };
 
@@ -0,0 +1,110 @@
+/** @file multi_shardwriter.cc
+ * @brief Thread which applies updates to one shard of a MultiDatabase.
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "multi_shardwriter.h"
+
+using namespace std;
+
+ShardWriter::~ShardWriter()
+{
+    if (!writer.joinable()) return;
+    {
+	unique_lock<mutex> lock(m);
+	wait_until_idle(lock);
+	stopping = true;
+    }
+    queued.notify_one();
+    writer.join();
+}
+
+void
+ShardWriter::wait_until_idle(unique_lock<mutex>& lock)
+{
+    done.wait(lock, [this]() { return updates.empty() && !busy; });
+}
+
+void
+ShardWriter::queue(update&& u)
+{
+    {
+	unique_lock<mutex> lock(m);
+	if (error) {
+	    wait_until_idle(lock);
+	    exception_ptr e = error;
+	    error = nullptr;
+	    rethrow_exception(e);
+	}
+	if (!writer.joinable()) {
+	    writer = thread([this]() { run(); });
+	}
+	done.wait(lock, [this]() { return updates.size() < MAX_QUEUED; });
+	updates.push_back(std::move(u));
+    }
+    queued.notify_one();
+}
+
+void
+ShardWriter::sync()
+{
+    unique_lock<mutex> lock(m);
+    wait_until_idle(lock);
+    if (error) {
+	exception_ptr e = error;
+	error = nullptr;
+	rethrow_exception(e);
+    }
+}
+
+void
+ShardWriter::run()
+{
+    unique_lock<mutex> lock(m);
+    while (true) {
+	queued.wait(lock, [this]() { return stopping || !updates.empty(); });
+	if (updates.empty()) return;
+	update u = std::move(updates.front());
+	updates.pop_front();
+	bool discard = bool(error);
+	busy = true;
+	lock.unlock();
+
+	exception_ptr e;
+	if (!discard) {
+	    try {
+		if (u.did) {
+		    shard->replace_document(u.did, u.doc);
+		} else {
+		    shard->commit();
+		}
+	    } catch (...) {
+		e = current_exception();
+	    }
+	}
+	// Release the document in this thread, as it was handed over to us.
+	u.doc = Xapian::Document();
+
+	lock.lock();
+	if (e && !error) error = e;
+	busy = false;
+	done.notify_all();
+    }
+}
@@ -0,0 +1,117 @@
+/** @file multi_shardwriter.h
+ * @brief Thread which applies updates to one shard of a MultiDatabase.
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_MULTI_SHARDWRITER_H
+#define XAPIAN_INCLUDED_MULTI_SHARDWRITER_H
+
+#include "backends/databaseinternal.h"
+#include "xapian/document.h"
+#include "xapian/types.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+/** Thread which applies updates to one shard of a MultiDatabase.
+ *
+ *  Updates are queued and applied in order by the thread, so the shards of a
+ *  MultiDatabase can be updated in parallel.  The thread is started when the
+ *  first update is queued.
+ *
+ *  The shard mustn't be accessed in any other way unless sync() has been
+ *  called since the last update was queued.
+ *
+ *  If an update fails, later updates are discarded until the exception has
+ *  been rethrown by sync() or queue_replace().
+ */
+class ShardWriter {
+    /// Maximum number of updates to queue before queue_replace() blocks.
+    static constexpr size_t MAX_QUEUED = 64;
+
+    struct update {
+	/// The docid in the shard, or 0 to commit.
+	Xapian::docid did;
+
+	Xapian::Document doc;
+    };
+
+    Xapian::Database::Internal* shard;
+
+    /// Protects all the members below.
+    std::mutex m;
+
+    /// Signalled when an update is queued, or the thread should stop.
+    std::condition_variable queued;
+
+    /// Signalled when the thread has finished an update.
+    std::condition_variable done;
+
+    std::deque<update> updates;
+
+    /// Is the thread applying an update?
+    bool busy = false;
+
+    bool stopping = false;
+
+    /// The first error which hasn't been reported.
+    std::exception_ptr error;
+
+    std::thread writer;
+
+    /// Queue @a u, blocking while the queue is full.
+    void queue(update&& u);
+
+    /// Wait for all queued updates to be applied.  Call with m locked.
+    void wait_until_idle(std::unique_lock<std::mutex>& lock);
+
+    void run();
+
+  public:
+    explicit ShardWriter(Xapian::Database::Internal* shard_) : shard(shard_) {}
+
+    /** Destructor.
+     *
+     *  Waits for the queued updates to be applied, and ignores any error.
+     */
+    ~ShardWriter();
+
+    /** Queue replacing document @a did in the shard.
+     *
+     *  @a doc mustn't be shared with any other Document object.
+     */
+    void queue_replace(Xapian::docid did, Xapian::Document&& doc) {
+	queue(update{did, std::move(doc)});
+    }
+
+    /// Queue committing the shard.
+    void queue_commit() {
+	queue(update{0, Xapian::Document()});
+    }
+
+    /** Wait for the queued updates to be applied.
+     *
+     *  If any of them failed, the first exception is rethrown.
+     */
+    void sync();
+};
+
+#endif // XAPIAN_INCLUDED_MULTI_SHARDWRITER_H
@@ -8,6 +8,7 @@ noinst_HEADERS +=\
 	backends/remote/remote-database.h\
 	backends/remote/remote-document.h\
 	backends/remote/remote_keylist.h\
+	backends/remote/remote_liststream.h\
 	backends/remote/remote_termlist.h
 
 lib_src +=\
@@ -16,6 +17,7 @@ lib_src +=\
 	backends/remote/remote-database.cc\
 	backends/remote/remote-document.cc\
 	backends/remote/remote_keylist.cc\
+	backends/remote/remote_liststream.cc\
 	backends/remote/remote_termlist.cc
 
 endif
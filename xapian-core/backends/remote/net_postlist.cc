@@ -55,23 +55,21 @@ NetworkPostList::open_position_list() const
 PostList *
 NetworkPostList::next(double)
 {
-    if (!started) {
-	started = true;
-	pos = postings.data();
-	pos_end = pos + postings.size();
-	lastdocid = 0;
+    started = true;
+    if (!postings.ensure_data(pos)) {
+	finished = true;
+	return NULL;
     }
 
-    if (pos == pos_end) {
-	pos = NULL;
-    } else {
-	Xapian::docid inc;
-	if (!unpack_uint(&pos, pos_end, &inc) ||
-	    !unpack_uint(&pos, pos_end, &lastwdf)) {
-	    unpack_throw_serialisation_error(pos);
-	}
-	lastdocid += inc + 1;
+    const char* p = postings.data.data() + pos;
+    const char* p_end = postings.data.data() + postings.data.size();
+    Xapian::docid inc;
+    if (!unpack_uint(&p, p_end, &inc) ||
+	!unpack_uint(&p, p_end, &lastwdf)) {
+	unpack_throw_serialisation_error(p);
     }
+    lastdocid += inc + 1;
+    pos = p - postings.data.data();
 
     return NULL;
 }
@@ -81,7 +79,7 @@ NetworkPostList::skip_to(Xapian::docid did, double min_weight)
 {
     if (!started)
 	next(min_weight);
-    while (pos && lastdocid < did)
+    while (!finished && lastdocid < did)
 	next(min_weight);
     return NULL;
 }
@@ -89,7 +87,7 @@ NetworkPostList::skip_to(Xapian::docid did, double min_weight)
 bool
 NetworkPostList::at_end() const
 {
-    return (pos == NULL && started);
+    return finished;
 }
 
 string
@@ -28,6 +28,7 @@
 #include "backends/leafpostlist.h"
 #include "omassert.h"
 #include "remote-database.h"
+#include "remote_liststream.h"
 
 using namespace std;
 
@@ -38,10 +39,16 @@ class NetworkPostList : public LeafPostList {
 
     Xapian::Internal::intrusive_ptr<const RemoteDatabase> db;
 
-    string postings;
+    /// The postings, which are read as they are needed.
+    RemoteListStream postings;
+
     bool started = false;
-    const char* pos = NULL;
-    const char* pos_end = NULL;
+
+    /// Have we moved off the end of the list?
+    bool finished = false;
+
+    /// Offset of the next unparsed posting in postings.data.
+    size_t pos = 0;
 
     Xapian::docid lastdocid = 0;
     Xapian::termcount lastwdf = 0;
@@ -52,10 +59,9 @@ class NetworkPostList : public LeafPostList {
     /// Constructor.
     NetworkPostList(Xapian::Internal::intrusive_ptr<const RemoteDatabase> db_,
 		    const string& term_,
-		    Xapian::doccount termfreq_,
-		    string&& postings_)
+		    Xapian::doccount termfreq_)
 	: LeafPostList(term_),
-	  db(db_), postings(std::move(postings_)), termfreq(termfreq_) { }
+	  db(db_), postings(*db_, REPLY_POSTLIST), termfreq(termfreq_) { }
 
     /// Get number of documents indexed by this term.
     Xapian::doccount get_termfreq() const;
@@ -37,12 +37,14 @@
 #include "pack.h"
 #include "remote_alltermslist.h"
 #include "remote_keylist.h"
+#include "remote_liststream.h"
 #include "remote_termlist.h"
 #include "serialise-double.h"
 #include "str.h"
 #include "stringutils.h" // For STRINGIZE().
 #include "weight/weightinternal.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <memory>
 #include <string>
@@ -62,7 +64,9 @@ is_intermediate_reply(int reply_code)
     return reply_code == REPLY_DOCDATA ||
 	   reply_code == REPLY_VALUE ||
 	   reply_code == REPLY_TERMLISTHEADER ||
-	   reply_code == REPLY_POSTLISTHEADER;
+	   reply_code == REPLY_TERMLIST ||
+	   reply_code == REPLY_POSTLISTHEADER ||
+	   reply_code == REPLY_POSTLIST;
 }
 
 [[noreturn]]
@@ -89,7 +93,7 @@ throw_connection_closed_unexpectedly()
 
 RemoteDatabase::RemoteDatabase(int fd, double timeout_,
 			       const string& context_, bool writable,
-			       int flags)
+			       int flags, bool reused)
     : Xapian::Database::Internal(writable ?
 				 TRANSACTION_NONE :
 				 TRANSACTION_READONLY),
@@ -108,9 +112,33 @@ RemoteDatabase::RemoteDatabase(int fd, double timeout_,
     }
 #endif
 
+    if (reused) {
+	// Check the connection still works, and get the server to reopen its
+	// database so we see the latest revision as we would with a new
+	// connection.  The reply to MSG_REOPEN is either REPLY_DONE or
+	// REPLY_UPDATE, so we also send MSG_UPDATE and read its reply in place
+	// of the greeting.  Send all three before waiting for any replies.
+	double end_time = RealTime::end_time(timeout);
+	link.send_message(static_cast<unsigned char>(MSG_KEEPALIVE), string(),
+			  end_time);
+	link.send_message(static_cast<unsigned char>(MSG_REOPEN), string(),
+			  end_time);
+	link.send_message(static_cast<unsigned char>(MSG_UPDATE), string(),
+			  end_time);
+	string message;
+	get_message(message, REPLY_DONE);
+	get_message(message, REPLY_UPDATE, REPLY_DONE);
+    }
+
     update_stats(MSG_MAX);
 
+    // Tell the server we can handle compressed messages.  There's no reply
+    // to this message, so we don't need to wait for one.
+    link.send_message(static_cast<unsigned char>(MSG_COMPRESSION), string(),
+		      RealTime::end_time(timeout));
+
     if (writable) {
+	pipeline_updates = (flags & Xapian::DB_PIPELINE_UPDATES);
 	if (flags & Xapian::DB_RETRY_LOCK) {
 	    string message;
 	    pack_uint_last(message, unsigned(flags & Xapian::DB_RETRY_LOCK));
@@ -181,9 +209,7 @@ RemoteDatabase::open_term_list(Xapian::docid did) const
 	!unpack_uint_last(&p, p_end, &num_entries)) {
 	throw Xapian::NetworkError("Bad REPLY_TERMLISTHEADER", context);
     }
-    get_message(message, REPLY_TERMLIST);
-    return new RemoteTermList(num_entries, doclen, doccount, this, did,
-			      std::move(message));
+    return new RemoteTermList(num_entries, doclen, doccount, this, did);
 }
 
 TermList *
@@ -222,12 +248,9 @@ RemoteDatabase::open_leaf_post_list(const string& term, bool) const
 	unpack_throw_serialisation_error(p);
     }
 
-    get_message(message, REPLY_POSTLIST);
-
     return new NetworkPostList(intrusive_ptr<const RemoteDatabase>(this),
 			       term,
-			       termfreq,
-			       std::move(message));
+			       termfreq);
 }
 
 PositionList *
@@ -267,6 +290,7 @@ bool
 RemoteDatabase::reopen()
 {
     mru_slot = Xapian::BAD_VALUENO;
+    prefetched_docs.clear();
     return update_stats(MSG_REOPEN);
 }
 
@@ -303,6 +327,14 @@ RemoteDatabase::open_document(Xapian::docid did, bool /*lazy*/) const
 {
     Assert(did);
 
+    auto i = prefetched_docs.find(did);
+    if (i != prefetched_docs.end()) {
+	auto doc = new RemoteDocument(this, did, std::move(i->second.first),
+				      std::move(i->second.second));
+	prefetched_docs.erase(i);
+	return doc;
+    }
+
     string message;
     pack_uint_last(message, did);
     send_message(MSG_DOCUMENT, message);
@@ -325,6 +357,42 @@ RemoteDatabase::open_document(Xapian::docid did, bool /*lazy*/) const
 			      std::move(values));
 }
 
+void
+RemoteDatabase::request_documents(const vector<Xapian::docid>& dids) const
+{
+    prefetched_docs.clear();
+    if (dids.empty())
+	return;
+
+    string message;
+    for (Xapian::docid did : dids) {
+	Assert(did);
+	pack_uint(message, did);
+    }
+    send_message(MSG_DOCUMENTS, message);
+
+    while (get_message_or_done(message, REPLY_DOCUMENT)) {
+	const char * p = message.data();
+	const char * p_end = p + message.size();
+	Xapian::docid did;
+	prefetched_document doc;
+	if (!unpack_uint(&p, p_end, &did) ||
+	    !unpack_string(&p, p_end, doc.first)) {
+	    unpack_throw_serialisation_error(p);
+	}
+	while (p != p_end) {
+	    Xapian::valueno slot;
+	    string value;
+	    if (!unpack_uint(&p, p_end, &slot) ||
+		!unpack_string(&p, p_end, value)) {
+		unpack_throw_serialisation_error(p);
+	    }
+	    doc.second.insert(make_pair(slot, std::move(value)));
+	}
+	prefetched_docs[did] = std::move(doc);
+    }
+}
+
 bool
 RemoteDatabase::update_stats(message_type msg_code, const string & body) const
 {
@@ -560,6 +628,84 @@ RemoteDatabase::get_unique_terms(Xapian::docid did) const
     return doclen;
 }
 
+vector<Xapian::termcount>
+RemoteDatabase::get_termcounts(message_type msg_code,
+			       reply_type reply_code,
+			       const vector<Xapian::docid>& dids) const
+{
+    vector<Xapian::termcount> result;
+    if (dids.empty())
+	return result;
+
+    string message;
+    for (Xapian::docid did : dids) {
+	Assert(did != 0);
+	pack_uint(message, did);
+    }
+    send_message(msg_code, message);
+
+    get_message(message, reply_code);
+    const char* p = message.data();
+    const char* p_end = p + message.size();
+    result.reserve(dids.size());
+    while (p != p_end) {
+	Xapian::termcount count;
+	if (!unpack_uint(&p, p_end, &count)) {
+	    unpack_throw_serialisation_error(p);
+	}
+	result.push_back(count);
+    }
+    if (result.size() != dids.size()) {
+	throw Xapian::NetworkError("Wrong number of results in reply", context);
+    }
+    return result;
+}
+
+vector<Xapian::termcount>
+RemoteDatabase::get_doclengths(const vector<Xapian::docid>& dids) const
+{
+    return get_termcounts(MSG_DOCLENGTHS, REPLY_DOCLENGTHS, dids);
+}
+
+vector<Xapian::termcount>
+RemoteDatabase::get_unique_terms_counts(const vector<Xapian::docid>& dids) const
+{
+    return get_termcounts(MSG_UNIQUETERMCOUNTS, REPLY_UNIQUETERMCOUNTS, dids);
+}
+
+vector<string>
+RemoteDatabase::get_values(const vector<Xapian::docid>& dids,
+			   Xapian::valueno slot) const
+{
+    vector<string> result;
+    if (dids.empty())
+	return result;
+
+    string message;
+    pack_uint(message, slot);
+    for (Xapian::docid did : dids) {
+	Assert(did != 0);
+	pack_uint(message, did);
+    }
+    send_message(MSG_VALUES, message);
+
+    get_message(message, REPLY_VALUES);
+    const char* p = message.data();
+    const char* p_end = p + message.size();
+    result.reserve(dids.size());
+    while (p != p_end) {
+	string value;
+	if (!unpack_string(&p, p_end, value)) {
+	    unpack_throw_serialisation_error(p);
+	}
+	result.push_back(std::move(value));
+    }
+    if (result.size() != dids.size()) {
+	throw Xapian::NetworkError("Wrong number of results in reply", context);
+    }
+    return result;
+}
+
 Xapian::termcount
 RemoteDatabase::get_wdfdocmax(Xapian::docid did) const
 {
@@ -618,7 +764,39 @@ RemoteDatabase::get_message(string &result,
 void
 RemoteDatabase::send_message(message_type type, const string &message) const
 {
+    if (pipelined_count && type != MSG_PIPELINED && type != MSG_SYNCPIPELINE) {
+	// Report any error from a pipelined update before anything else.
+	sync_pipeline();
+    }
+    if (active_stream) {
+	// Keep the rest of the list being streamed for whatever is iterating
+	// it.
+	active_stream->read_all();
+    }
     double end_time = RealTime::end_time(timeout);
+    if (abandoned_query) {
+	// The server is waiting for MSG_GETMSET for a search we abandoned.
+	// Send back the statistics it gave us so it can finish that search
+	// cheaply, and then discard the results below.
+	string stats;
+	int reply_code = link.get_message(stats, end_time);
+	if (reply_code < 0)
+	    throw_connection_closed_unexpectedly();
+	abandoned_query = false;
+	pending_reply = false;
+	if (reply_code == REPLY_STATS) {
+	    // Ask for no results: first, maxitems, check_at_least, no sorter.
+	    string getmset;
+	    pack_uint(getmset, 0u);
+	    pack_uint(getmset, 0u);
+	    pack_uint(getmset, 0u);
+	    pack_string_empty(getmset);
+	    getmset += stats;
+	    link.send_message(static_cast<unsigned char>(MSG_GETMSET), getmset,
+			      end_time);
+	    pending_reply = true;
+	}
+    }
     while (pending_reply) {
 	string dummy;
 	int reply_code = link.get_message(dummy, end_time);
@@ -629,7 +807,63 @@ RemoteDatabase::send_message(message_type type, const string &message) const
 	}
     }
     link.send_message(static_cast<unsigned char>(type), message, end_time);
-    pending_reply = true;
+    // There's no reply to a pipelined update.
+    pending_reply = (type != MSG_PIPELINED);
+}
+
+void
+RemoteDatabase::send_update(message_type type, const string& message) const
+{
+    if (!pipeline_updates) {
+	send_message(type, message);
+	string dummy;
+	get_message(dummy, REPLY_DONE);
+	return;
+    }
+
+    string pipelined(1, char(type));
+    pipelined += message;
+    send_message(MSG_PIPELINED, pipelined);
+    ++pipelined_count;
+}
+
+void
+RemoteDatabase::sync_pipeline(bool report) const
+{
+    unsigned long count = pipelined_count;
+    pipelined_count = 0;
+    send_message(MSG_SYNCPIPELINE, string());
+    string message;
+    if (get_message(message, REPLY_DONE, REPLY_PIPELINEERROR) == REPLY_DONE)
+	return;
+
+    // Updates after the one which failed were ignored, so we don't know
+    // what docid the next added document should get.
+    pipeline_next_did = 0;
+    if (!report) return;
+
+    const char* p = message.data();
+    const char* p_end = p + message.size();
+    unsigned long failed;
+    if (!unpack_uint(&p, p_end, &failed)) {
+	unpack_throw_serialisation_error(p);
+    }
+    string prefix = "REMOTE:Pipelined update ";
+    prefix += str(failed);
+    prefix += " of ";
+    prefix += str(count);
+    prefix += " failed: ";
+    unserialise_error(string(p, p_end), prefix, context);
+}
+
+void
+RemoteDatabase::end_list_stream() const
+{
+    active_stream = NULL;
+    // Don't wait for the rest of the list, just leave pending_reply set so
+    // that whatever arrives before the server's REPLY_DONE is discarded.
+    link.send_message(static_cast<unsigned char>(MSG_ENDLIST), string(),
+		      RealTime::end_time(timeout));
 }
 
 void
@@ -660,21 +894,31 @@ RemoteDatabase::do_close()
     link.do_close();
 }
 
-void
-RemoteDatabase::set_query(const Xapian::Query& query,
-			  Xapian::termcount qlen,
-			  Xapian::valueno collapse_key,
-			  Xapian::doccount collapse_max,
-			  Xapian::Enquire::docid_order order,
-			  Xapian::valueno sort_key,
-			  Xapian::Enquire::Internal::sort_setting sort_by,
-			  bool sort_value_forward,
-			  double time_limit,
-			  int percent_threshold, double weight_threshold,
-			  const Xapian::Weight& wtscheme,
-			  const Xapian::RSet &omrset,
-			  const vector<opt_ptr_spy>& matchspies,
-			  bool full_db_has_positions) const
+int
+RemoteDatabase::release_idle_connection()
+{
+    if (!is_read_only() || pending_reply || abandoned_query || active_stream)
+	return -1;
+    if (link.get_read_fd() < 0 || link.input_waiting())
+	return -1;
+    return link.release_fd();
+}
+
+string
+RemoteDatabase::serialise_query(const Xapian::Query& query,
+				Xapian::termcount qlen,
+				Xapian::valueno collapse_key,
+				Xapian::doccount collapse_max,
+				Xapian::Enquire::docid_order order,
+				Xapian::valueno sort_key,
+				Xapian::Enquire::Internal::sort_setting sort_by,
+				bool sort_value_forward,
+				double time_limit,
+				int percent_threshold, double weight_threshold,
+				const Xapian::Weight& wtscheme,
+				const Xapian::RSet &omrset,
+				const vector<opt_ptr_spy>& matchspies,
+				bool full_db_has_positions)
 {
     string message;
     pack_string(message, query.serialise());
@@ -709,7 +953,7 @@ RemoteDatabase::set_query(const Xapian::Query& query,
 	pack_string(message, i->serialise());
     }
 
-    send_message(MSG_QUERY, message);
+    return message;
 }
 
 void
@@ -721,12 +965,12 @@ RemoteDatabase::get_remote_stats(Xapian::Weight::Internal& out) const
     unserialise_stats(p, p + message.size(), out);
 }
 
-void
-RemoteDatabase::send_global_stats(Xapian::doccount first,
-				  Xapian::doccount maxitems,
-				  Xapian::doccount check_at_least,
-				  const Xapian::KeyMaker* sorter,
-				  const Xapian::Weight::Internal &stats) const
+string
+RemoteDatabase::serialise_global_stats(Xapian::doccount first,
+				       Xapian::doccount maxitems,
+				       Xapian::doccount check_at_least,
+				       const Xapian::KeyMaker* sorter,
+				       const Xapian::Weight::Internal &stats)
 {
     string message;
     pack_uint(message, first);
@@ -743,7 +987,41 @@ RemoteDatabase::send_global_stats(Xapian::doccount first,
 	pack_string(message, sorter->serialise());
     }
     message += serialise_stats(stats);
-    send_message(MSG_GETMSET, message);
+    return message;
+}
+
+void
+RemoteDatabase::set_replicas(vector<intrusive_ptr<Xapian::Database::Internal>>&& replicas_,
+			     double hedge_percentile_)
+{
+    replicas = std::move(replicas_);
+    hedge_percentile = hedge_percentile_;
+}
+
+void
+RemoteDatabase::record_reply_time(unsigned phase, double secs) const
+{
+    auto& times = reply_times[phase];
+    if (times.size() < REPLY_TIMES_KEPT) {
+	times.push_back(secs);
+	return;
+    }
+    times[reply_times_next[phase]] = secs;
+    reply_times_next[phase] = (reply_times_next[phase] + 1) % REPLY_TIMES_KEPT;
+}
+
+double
+RemoteDatabase::get_hedge_delay(unsigned phase) const
+{
+    // Don't hedge until we've got a few reply times to base the delay on.
+    const size_t MIN_REPLY_TIMES = 8;
+    if (replicas.empty() || reply_times[phase].size() < MIN_REPLY_TIMES)
+	return 0.0;
+    vector<double> times = reply_times[phase];
+    size_t n = size_t(hedge_percentile * 0.01 * (times.size() - 1));
+    nth_element(times.begin(), times.begin() + n, times.end());
+    // Avoid a delay of zero, which means "don't hedge".
+    return max(times[n], 1e-6);
 }
 
 Xapian::MSet
@@ -785,8 +1063,14 @@ RemoteDatabase::cancel()
 {
     if (!uncommitted_changes) return;
 
+    // An error from a pipelined update doesn't matter since we're discarding
+    // all the changes anyway.
+    if (pipelined_count) sync_pipeline(false);
+
     cached_stats_valid = false;
     mru_slot = Xapian::BAD_VALUENO;
+    prefetched_docs.clear();
+    pipeline_next_did = 0;
 
     send_message(MSG_CANCEL, string());
     string dummy;
@@ -798,8 +1082,24 @@ RemoteDatabase::cancel()
 Xapian::docid
 RemoteDatabase::add_document(const Xapian::Document & doc)
 {
+    if (pipeline_updates) {
+	if (pipeline_next_did == 0) {
+	    // Nothing else can add documents while we have the database open
+	    // for writing, so once we know the last docid we can keep track of
+	    // it ourselves.
+	    pipeline_next_did = get_lastdocid() + 1;
+	}
+	// If we've run out of docids, let the server report that.
+	if (pipeline_next_did != 0) {
+	    Xapian::docid did = pipeline_next_did;
+	    replace_document(did, doc);
+	    return did;
+	}
+    }
+
     cached_stats_valid = false;
     mru_slot = Xapian::BAD_VALUENO;
+    prefetched_docs.clear();
     uncommitted_changes = true;
 
     send_message(MSG_ADDDOCUMENT, serialise_document(doc));
@@ -821,13 +1121,12 @@ RemoteDatabase::delete_document(Xapian::docid did)
 {
     cached_stats_valid = false;
     mru_slot = Xapian::BAD_VALUENO;
+    prefetched_docs.clear();
     uncommitted_changes = true;
 
     string message;
     pack_uint_last(message, did);
-    send_message(MSG_DELETEDOCUMENT, message);
-
-    get_message(message, REPLY_DONE);
+    send_update(MSG_DELETEDOCUMENT, message);
 }
 
 void
@@ -835,11 +1134,10 @@ RemoteDatabase::delete_document(const std::string & unique_term)
 {
     cached_stats_valid = false;
     mru_slot = Xapian::BAD_VALUENO;
+    prefetched_docs.clear();
     uncommitted_changes = true;
 
-    send_message(MSG_DELETEDOCUMENTTERM, unique_term);
-    string dummy;
-    get_message(dummy, REPLY_DONE);
+    send_update(MSG_DELETEDOCUMENTTERM, unique_term);
 }
 
 void
@@ -848,15 +1146,19 @@ RemoteDatabase::replace_document(Xapian::docid did,
 {
     cached_stats_valid = false;
     mru_slot = Xapian::BAD_VALUENO;
+    prefetched_docs.clear();
     uncommitted_changes = true;
 
+    // Replacing a document which doesn't exist adds it, so a pipelined
+    // add_document() needs to use a higher docid.
+    if (pipeline_next_did && did >= pipeline_next_did)
+	pipeline_next_did = did + 1;
+
     string message;
     pack_uint(message, did);
     message += serialise_document(doc);
 
-    send_message(MSG_REPLACEDOCUMENT, message);
-
-    get_message(message, REPLY_DONE);
+    send_update(MSG_REPLACEDOCUMENT, message);
 }
 
 Xapian::docid
@@ -865,7 +1167,10 @@ RemoteDatabase::replace_document(const std::string & unique_term,
 {
     cached_stats_valid = false;
     mru_slot = Xapian::BAD_VALUENO;
+    prefetched_docs.clear();
     uncommitted_changes = true;
+    // This may add a document.
+    pipeline_next_did = 0;
 
     string message;
     pack_string(message, unique_term);
@@ -884,6 +1189,24 @@ RemoteDatabase::replace_document(const std::string & unique_term,
     return did;
 }
 
+void
+RemoteDatabase::set_document_value(Xapian::docid did,
+				   Xapian::valueno slot,
+				   const string& value)
+{
+    cached_stats_valid = false;
+    mru_slot = Xapian::BAD_VALUENO;
+    prefetched_docs.clear();
+    uncommitted_changes = true;
+
+    string message;
+    pack_uint(message, did);
+    pack_uint(message, slot);
+    message += value;
+
+    send_update(MSG_SETDOCUMENTVALUE, message);
+}
+
 string
 RemoteDatabase::get_uuid() const
 {
@@ -907,9 +1230,7 @@ RemoteDatabase::set_metadata(const string & key, const string & value)
     string message;
     pack_string(message, key);
     message += value;
-    send_message(MSG_SETMETADATA, message);
-
-    get_message(message, REPLY_DONE);
+    send_update(MSG_SETMETADATA, message);
 }
 
 void
@@ -921,9 +1242,7 @@ RemoteDatabase::add_spelling(const string & word,
     string message;
     pack_uint(message, freqinc);
     message += word;
-    send_message(MSG_ADDSPELLING, message);
-
-    get_message(message, REPLY_DONE);
+    send_update(MSG_ADDSPELLING, message);
 }
 
 Xapian::termcount
@@ -973,8 +1292,7 @@ RemoteDatabase::add_synonym(const string& word, const string& synonym) const
     string message;
     pack_string(message, word);
     message += synonym;
-    send_message(MSG_ADDSYNONYM, message);
-    get_message(message, REPLY_DONE);
+    send_update(MSG_ADDSYNONYM, message);
 }
 
 void
@@ -985,8 +1303,7 @@ RemoteDatabase::remove_synonym(const string& word, const string& synonym) const
     string message;
     pack_string(message, word);
     message += synonym;
-    send_message(MSG_REMOVESYNONYM, message);
-    get_message(message, REPLY_DONE);
+    send_update(MSG_REMOVESYNONYM, message);
 }
 
 void
@@ -994,9 +1311,7 @@ RemoteDatabase::clear_synonyms(const string& word) const
 {
     uncommitted_changes = true;
 
-    string message;
-    send_message(MSG_CLEARSYNONYMS, word);
-    get_message(message, REPLY_DONE);
+    send_update(MSG_CLEARSYNONYMS, word);
 }
 
 bool
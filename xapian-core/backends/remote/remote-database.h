@@ -30,11 +30,17 @@
 #include "backends/valuestats.h"
 #include "xapian/weight.h"
 
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace Xapian {
     class RSet;
 }
 
 class NetworkPostList;
+class RemoteListStream;
 
 /** RemoteDatabase is the baseclass for remote database implementations.
  *
@@ -43,6 +49,8 @@ class NetworkPostList;
  *  with the RemoteSubMatch class during the match process.
  */
 class RemoteDatabase : public Xapian::Database::Internal {
+    friend class RemoteListStream;
+
     /// Don't allow assignment.
     void operator=(const RemoteDatabase &);
 
@@ -80,6 +88,53 @@ class RemoteDatabase : public Xapian::Database::Internal {
      */
     mutable bool pending_reply = false;
 
+    /** Was a search abandoned before its statistics were read?
+     *
+     *  In this case the server is waiting for MSG_GETMSET, so before sending
+     *  another message we need to read the statistics and let the server
+     *  finish the search.
+     */
+    mutable bool abandoned_query = false;
+
+    /** The list currently being streamed from the server, if any.
+     *
+     *  Before another message is sent, the rest of this list is read so
+     *  its reply doesn't get mixed up with the list.
+     */
+    mutable RemoteListStream* active_stream = NULL;
+
+    /** Ask the server to stop sending the list being streamed.
+     *
+     *  Anything it had already sent is discarded before the next message is
+     *  sent.
+     */
+    void end_list_stream() const;
+
+    /** Other remote databases with the same contents as this one.
+     *
+     *  If there are any, a search which is slow to get a reply from this
+     *  database is also sent to a replica, and whichever replies first is
+     *  used.
+     */
+    std::vector<Xapian::Internal::intrusive_ptr<Xapian::Database::Internal>>
+	replicas;
+
+    /// Percentile of recent reply times to wait before hedging a search.
+    double hedge_percentile = 0.0;
+
+    /// How many recent reply times to keep for each phase of a search.
+    static constexpr size_t REPLY_TIMES_KEPT = 64;
+
+    /** Recent reply times (in seconds) for each phase of a search.
+     *
+     *  Index 0 is for the statistics and index 1 for the results.  Each is
+     *  used as a ring buffer once it has REPLY_TIMES_KEPT entries.
+     */
+    mutable std::vector<double> reply_times[2];
+
+    /// Where to record the next reply time once a ring buffer is full.
+    mutable size_t reply_times_next[2] = { 0, 0 };
+
     /// The UUID of the remote database.
     mutable std::string uuid;
 
@@ -97,6 +152,17 @@ class RemoteDatabase : public Xapian::Database::Internal {
      */
     mutable Xapian::valueno mru_slot;
 
+    /// Document data and values fetched by request_documents().
+    typedef std::pair<std::string, std::map<Xapian::valueno, std::string>>
+	    prefetched_document;
+
+    /** Documents fetched by request_documents() which haven't been opened.
+     *
+     *  Only the most recently requested batch is kept, and documents are
+     *  removed when open_document() uses them.
+     */
+    mutable std::map<Xapian::docid, prefetched_document> prefetched_docs;
+
     /** True if there are (or may be) uncommitted changes.
      *
      *  Used to optimise away commit()/cancel() calls.  These can be explicit,
@@ -105,9 +171,40 @@ class RemoteDatabase : public Xapian::Database::Internal {
      */
     mutable bool uncommitted_changes = false;
 
+    /// Number of pipelined updates sent since we last checked for errors.
+    mutable unsigned long pipelined_count = 0;
+
+    /** The docid the next pipelined add_document() will use.
+     *
+     *  0 if we need to ask the server.
+     */
+    mutable Xapian::docid pipeline_next_did = 0;
+
+    /** Send an update which has no result.
+     *
+     *  If updates are pipelined, we don't wait for the server to process it.
+     */
+    void send_update(message_type type, const std::string& message) const;
+
+    /** Check whether any pipelined updates failed.
+     *
+     *  @param report	If true, throw the exception from an update which
+     *			failed; otherwise just discard it.
+     */
+    void sync_pipeline(bool report = true) const;
+
     bool update_stats(message_type msg_code = MSG_UPDATE,
 		      const std::string & body = std::string()) const;
 
+    /** Look up a count for each of several documents.
+     *
+     *  Used for MSG_DOCLENGTHS and MSG_UNIQUETERMCOUNTS.
+     */
+    std::vector<Xapian::termcount>
+    get_termcounts(message_type msg_code,
+		   reply_type reply_code,
+		   const std::vector<Xapian::docid>& dids) const;
+
   protected:
     /** Constructor.  The constructor is protected so that raw instances
      *  can't be created - a derived class must be instantiated which
@@ -122,9 +219,12 @@ class RemoteDatabase : public Xapian::Database::Internal {
      *  @param context_ The context to return with any error messages.
      *	@param writable	Is this a WritableDatabase?
      *	@param flags	Xapian::DB_RETRY_LOCK or 0.
+     *	@param reused	Is @a fd an idle connection from an earlier
+     *			RemoteDatabase (rather than a new connection, on which
+     *			the server sends a greeting)?
      */
     RemoteDatabase(int fd, double timeout_, const std::string& context_,
-		   bool writable, int flags);
+		   bool writable, int flags, bool reused = false);
 
     /// Receive a message from the server.
     reply_type get_message(std::string& message,
@@ -147,6 +247,16 @@ class RemoteDatabase : public Xapian::Database::Internal {
     /// Close the socket
     void do_close();
 
+    /** Detach the connection so it can be reused, if it's idle.
+     *
+     *  A connection is only idle if it's read-only and there's no reply
+     *  outstanding or list being streamed.
+     *
+     *  @return The fd of the connection, or -1 if it isn't idle (in which
+     *	        case it's left attached).
+     */
+    int release_idle_connection();
+
     bool get_posting(Xapian::docid& did, double& w, std::string& value);
 
     /// The timeout value used in network communications, in seconds.
@@ -165,7 +275,7 @@ class RemoteDatabase : public Xapian::Database::Internal {
 
     typedef Xapian::Internal::opt_intrusive_ptr<Xapian::MatchSpy> opt_ptr_spy;
 
-    /** Set the query
+    /** Serialise a query for sending with send_query().
      *
      * @param query			The query.
      * @param qlen			The query length.
@@ -186,20 +296,76 @@ class RemoteDatabase : public Xapian::Database::Internal {
      * @param matchspies                The matchspies to use.
      * @param full_db_has_positions	Does the full DB have positions?
      */
-    void set_query(const Xapian::Query& query,
-		   Xapian::termcount qlen,
-		   Xapian::valueno collapse_key,
-		   Xapian::doccount collapse_max,
-		   Xapian::Enquire::docid_order order,
-		   Xapian::valueno sort_key,
-		   Xapian::Enquire::Internal::sort_setting sort_by,
-		   bool sort_value_forward,
-		   double time_limit,
-		   int percent_threshold, double weight_threshold,
-		   const Xapian::Weight& wtscheme,
-		   const Xapian::RSet &omrset,
-		   const std::vector<opt_ptr_spy>& matchspies,
-		   bool full_db_has_positions) const;
+    static std::string
+    serialise_query(const Xapian::Query& query,
+		    Xapian::termcount qlen,
+		    Xapian::valueno collapse_key,
+		    Xapian::doccount collapse_max,
+		    Xapian::Enquire::docid_order order,
+		    Xapian::valueno sort_key,
+		    Xapian::Enquire::Internal::sort_setting sort_by,
+		    bool sort_value_forward,
+		    double time_limit,
+		    int percent_threshold, double weight_threshold,
+		    const Xapian::Weight& wtscheme,
+		    const Xapian::RSet &omrset,
+		    const std::vector<opt_ptr_spy>& matchspies,
+		    bool full_db_has_positions);
+
+    /// Send a query serialised by serialise_query() to the server.
+    void send_query(const std::string& message) const {
+	send_message(MSG_QUERY, message);
+    }
+
+    /** Abandon a search whose statistics haven't been read yet.
+     *
+     *  The search is finished off and its replies discarded when the next
+     *  message is sent.  (A search can be abandoned after its statistics have
+     *  been read without calling this method - the pending reply is just
+     *  discarded.)
+     */
+    void abandon_query() const { abandoned_query = true; }
+
+    /** Is this database still busy with an earlier request?
+     *
+     *  If so, the next message sent will have to wait for the server to
+     *  finish it.
+     */
+    bool is_busy() const { return pending_reply || abandoned_query; }
+
+    /** Set replicas of this database to hedge searches with.
+     *
+     *  @param replicas_	The replicas (each must be a RemoteDatabase).
+     *  @param hedge_percentile_	Percentile of recent reply times to wait
+     *				before hedging.
+     */
+    void set_replicas(
+	std::vector<Xapian::Internal::intrusive_ptr<Xapian::Database::Internal>>&& replicas_,
+	double hedge_percentile_);
+
+    /// Return the number of replicas of this database.
+    size_t get_replica_count() const { return replicas.size(); }
+
+    /// Return replica @a i of this database.
+    const RemoteDatabase* get_replica(size_t i) const {
+	return static_cast<const RemoteDatabase*>(replicas[i].get());
+    }
+
+    /** Record how long a phase of a search took to get a reply.
+     *
+     *  @param phase	0 for the statistics, 1 for the results.
+     *  @param secs	The time taken in seconds.
+     */
+    void record_reply_time(unsigned phase, double secs) const;
+
+    /** How long to wait for a reply before hedging a search.
+     *
+     *  @param phase	0 for the statistics, 1 for the results.
+     *
+     *  @return	The delay in seconds, or 0 to not hedge (because there are no
+     *		replicas, or too few reply times have been recorded).
+     */
+    double get_hedge_delay(unsigned phase) const;
 
     /** Get the underlying fd this remote connection reads from.
      *
@@ -213,12 +379,18 @@ class RemoteDatabase : public Xapian::Database::Internal {
     /// Get the stats from the remote server.
     void get_remote_stats(Xapian::Weight::Internal& out) const;
 
-    /// Send the global stats to the remote server.
-    void send_global_stats(Xapian::doccount first,
+    /// Serialise the global stats for sending with send_global_stats().
+    static std::string
+    serialise_global_stats(Xapian::doccount first,
 			   Xapian::doccount maxitems,
 			   Xapian::doccount check_at_least,
 			   const Xapian::KeyMaker* sorter,
-			   const Xapian::Weight::Internal &stats) const;
+			   const Xapian::Weight::Internal &stats);
+
+    /// Send the global stats to the remote server.
+    void send_global_stats(const std::string& message) const {
+	send_message(MSG_GETMSET, message);
+    }
 
     /// Get the MSet from the remote server.
     Xapian::MSet get_mset(const std::vector<opt_ptr_spy>& matchspies) const;
@@ -252,6 +424,13 @@ class RemoteDatabase : public Xapian::Database::Internal {
     /// Get a remote document.
     Xapian::Document::Internal * open_document(Xapian::docid did, bool lazy) const;
 
+    /** Fetch several documents in a single round trip.
+     *
+     *  The fetched documents are then used by subsequent calls to
+     *  open_document().
+     */
+    void request_documents(const std::vector<Xapian::docid>& dids) const;
+
     /// Get the document count.
     Xapian::doccount get_doccount() const;
 
@@ -264,6 +443,16 @@ class RemoteDatabase : public Xapian::Database::Internal {
     Xapian::termcount get_unique_terms(Xapian::docid did) const;
     Xapian::termcount get_wdfdocmax(Xapian::docid did) const;
 
+    std::vector<Xapian::termcount>
+    get_doclengths(const std::vector<Xapian::docid>& dids) const;
+
+    std::vector<Xapian::termcount>
+    get_unique_terms_counts(const std::vector<Xapian::docid>& dids) const;
+
+    std::vector<std::string>
+    get_values(const std::vector<Xapian::docid>& dids,
+	       Xapian::valueno slot) const;
+
     /// Check if term exists.
     bool term_exists(const std::string& tname) const;
 
@@ -294,6 +483,9 @@ class RemoteDatabase : public Xapian::Database::Internal {
     Xapian::docid replace_document(const std::string & unique_term,
 				   const Xapian::Document & document);
 
+    void set_document_value(Xapian::docid did, Xapian::valueno slot,
+			    const std::string& value);
+
     std::string get_uuid() const;
 
     std::string get_metadata(const std::string& key) const;
@@ -0,0 +1,76 @@
+/** @file remote_liststream.cc
+ * @brief Read a list which the server streams in chunks
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "remote_liststream.h"
+
+#include "omassert.h"
+#include "remote-database.h"
+
+using namespace std;
+
+RemoteListStream::RemoteListStream(const RemoteDatabase& db_,
+				   reply_type type_)
+    : db(db_), type(type_)
+{
+    Assert(db.active_stream == NULL);
+    db.active_stream = this;
+}
+
+RemoteListStream::~RemoteListStream()
+{
+    if (finished)
+	return;
+    try {
+	db.end_list_stream();
+    } catch (...) {
+	// If the connection has failed, the next operation on the database
+	// will report that.
+    }
+}
+
+void
+RemoteListStream::finish()
+{
+    finished = true;
+    if (db.active_stream == this)
+	db.active_stream = NULL;
+}
+
+bool
+RemoteListStream::read_chunk()
+{
+    if (finished)
+	return false;
+    string chunk;
+    try {
+	if (db.get_message(chunk, type, REPLY_DONE) == REPLY_DONE) {
+	    finish();
+	    return false;
+	}
+    } catch (...) {
+	// An exception from the server also ends the list.
+	finish();
+	throw;
+    }
+    data += chunk;
+    return true;
+}
@@ -0,0 +1,103 @@
+/** @file remote_liststream.h
+ * @brief Read a list which the server streams in chunks
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_REMOTE_LISTSTREAM_H
+#define XAPIAN_INCLUDED_REMOTE_LISTSTREAM_H
+
+#include "net/remoteprotocol.h"
+
+#include <string>
+
+class RemoteDatabase;
+
+/** Read a list which the server streams in chunks.
+ *
+ *  The server sends termlists and postlists as a series of messages each
+ *  holding complete entries, followed by REPLY_DONE.  Chunks are read as
+ *  the list is iterated, so the first entries can be used while the rest
+ *  are still arriving.
+ *
+ *  Only one list can be streaming on a connection at once.  If another
+ *  message needs to be sent to the server first, the rest of the list is
+ *  read into data (which only ever gets appended to in that case, so offsets
+ *  into it stay valid).  If the list is destroyed before the end has been
+ *  read, the server is asked to stop sending it.
+ */
+class RemoteListStream {
+    /// Don't allow assignment.
+    void operator=(const RemoteListStream&) = delete;
+
+    /// Don't allow copying.
+    RemoteListStream(const RemoteListStream&) = delete;
+
+    /// The database the list is from (the list holds a reference to it).
+    const RemoteDatabase& db;
+
+    /// The reply type used for the chunks of this list.
+    reply_type type;
+
+    /// Has REPLY_DONE been read?
+    bool finished = false;
+
+    /// Note that the end of the list has been reached.
+    void finish();
+
+    /** Read the next chunk and append it to data.
+     *
+     *  @return false if the end of the list was reached instead.
+     */
+    bool read_chunk();
+
+  public:
+    /// Data received which the list hasn't necessarily parsed yet.
+    std::string data;
+
+    /** Start streaming a list.
+     *
+     *  Must be called straight after the server's header reply for the list
+     *  has been read.
+     */
+    RemoteListStream(const RemoteDatabase& db_, reply_type type_);
+
+    /// Destructor.
+    ~RemoteListStream();
+
+    /** Ensure there's data to parse at offset @a pos in data.
+     *
+     *  If everything received has been parsed, data is cleared, @a pos is
+     *  reset to 0, and the next chunk is read.
+     *
+     *  @return false if the end of the list has been reached.
+     */
+    bool ensure_data(size_t& pos) {
+	if (pos < data.size())
+	    return true;
+	data.resize(0);
+	pos = 0;
+	return read_chunk();
+    }
+
+    /// Read all the rest of the list into data.
+    void read_all() {
+	while (read_chunk()) { }
+    }
+};
+
+#endif // XAPIAN_INCLUDED_REMOTE_LISTSTREAM_H
@@ -71,27 +71,27 @@ RemoteTermList::get_termfreq() const
 TermList*
 RemoteTermList::next()
 {
-    if (!p) {
-	p = data.data();
-    }
-    const char* p_end = data.data() + data.size();
-    if (p == p_end) {
-	data.resize(0);
+    if (!entries.ensure_data(pos)) {
+	finished = true;
 	return NULL;
     }
+    const char* p = entries.data.data() + pos;
+    const char* p_end = entries.data.data() + entries.data.size();
     current_term.resize(size_t(static_cast<unsigned char>(*p++)));
     if (!unpack_string_append(&p, p_end, current_term) ||
 	!unpack_uint(&p, p_end, &current_wdf) ||
 	!unpack_uint(&p, p_end, &current_termfreq)) {
 	unpack_throw_serialisation_error(p);
     }
+    pos = p - entries.data.data();
     return NULL;
 }
 
 TermList*
 RemoteTermList::skip_to(const std::string& term)
 {
-    if (!p) {
+    if (current_term.empty()) {
+	// Terms can't be empty, so we haven't started yet.
 	RemoteTermList::next();
     }
     while (!RemoteTermList::at_end() && current_term < term) {
@@ -103,7 +103,7 @@ RemoteTermList::skip_to(const std::string& term)
 bool
 RemoteTermList::at_end() const
 {
-    return data.empty();
+    return finished;
 }
 
 Xapian::termcount
@@ -22,6 +22,7 @@
 #define XAPIAN_INCLUDED_REMOTE_TERMLIST_H
 
 #include "api/termlist.h"
+#include "remote_liststream.h"
 
 class RemoteDatabase;
 
@@ -49,9 +50,14 @@ class RemoteTermList : public TermList {
 
     Xapian::docid did;
 
-    std::string data;
+    /// The entries, which are read as they are needed.
+    RemoteListStream entries;
 
-    const char* p = NULL;
+    /// Offset of the next unparsed entry in entries.data.
+    size_t pos = 0;
+
+    /// Have we moved off the end of the list?
+    bool finished = false;
 
   public:
     /// Construct.
@@ -59,14 +65,13 @@ class RemoteTermList : public TermList {
 		   Xapian::termcount doclen_,
 		   Xapian::doccount db_size_,
 		   const RemoteDatabase* db_,
-		   Xapian::docid did_,
-		   std::string&& data_)
+		   Xapian::docid did_)
 	: num_entries(num_entries_),
 	  doclen(doclen_),
 	  db_size(db_size_),
 	  db(db_),
 	  did(did_),
-	  data(data_) {}
+	  entries(*db_, REPLY_TERMLIST) {}
 
     /// Return approximate size of this termlist.
     Xapian::termcount get_approx_size() const;
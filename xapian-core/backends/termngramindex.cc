@@ -0,0 +1,128 @@
+/** @file termngramindex.cc
+ * @brief Character trigram index over the terms in a database shard.
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "termngramindex.h"
+
+#include "api/termlist.h"
+#include "debuglog.h"
+#include "omassert.h"
+
+#include <algorithm>
+#include <memory>
+
+using namespace std;
+
+/// Pack the three bytes starting at @a p into an integer key.
+static inline uint32_t
+trigram_key(const char* p)
+{
+    return (uint32_t(static_cast<unsigned char>(p[0])) << 16) |
+	   (uint32_t(static_cast<unsigned char>(p[1])) << 8) |
+	   uint32_t(static_cast<unsigned char>(p[2]));
+}
+
+TermNgramIndex::TermNgramIndex(const Xapian::Database::Internal& db,
+			       Xapian::rev rev)
+    : revision(rev)
+{
+    LOGCALL_CTOR(DB, "TermNgramIndex", &db | rev);
+    unique_ptr<TermList> t(db.open_allterms(string()));
+    while (true) {
+	t->next();
+	if (t->at_end())
+	    break;
+	add_term(t->get_termname());
+    }
+    offsets.push_back(terms.size());
+}
+
+void
+TermNgramIndex::add_term(const string& term)
+{
+    uint32_t term_index = offsets.size();
+    offsets.push_back(terms.size());
+    terms += term;
+
+    string padded;
+    padded.reserve(term.size() + 2);
+    padded += '\0';
+    padded += term;
+    padded += '\0';
+    for (size_t i = 0; i + 3 <= padded.size(); ++i) {
+	auto& list = postings[trigram_key(padded.data() + i)];
+	// A trigram which occurs more than once in a term only needs one entry.
+	if (list.empty() || list.back() != term_index)
+	    list.push_back(term_index);
+    }
+}
+
+bool
+TermNgramIndex::get_candidates(const vector<string>& fragments,
+			       vector<string>& result) const
+{
+    LOGCALL(DB, bool, "TermNgramIndex::get_candidates", fragments.size() | result.size());
+    vector<const vector<uint32_t>*> lists;
+    for (auto&& fragment : fragments) {
+	for (size_t i = 0; i + 3 <= fragment.size(); ++i) {
+	    auto it = postings.find(trigram_key(fragment.data() + i));
+	    if (it == postings.end()) {
+		// No term contains this trigram, so nothing can match.
+		RETURN(true);
+	    }
+	    lists.push_back(&it->second);
+	}
+    }
+
+    if (lists.empty())
+	RETURN(false);
+
+    // Intersect starting from the shortest list, which bounds the work done
+    // by the number of terms containing the rarest trigram.
+    sort(lists.begin(), lists.end(),
+	 [](const vector<uint32_t>* a, const vector<uint32_t>* b) {
+	     return a->size() < b->size();
+	 });
+    vector<uint32_t> matches(*lists.front());
+    for (size_t j = 1; j != lists.size() && !matches.empty(); ++j) {
+	if (lists[j] == lists[j - 1])
+	    continue;
+	auto out = matches.begin();
+	auto other = lists[j]->begin();
+	auto other_end = lists[j]->end();
+	for (auto term_index : matches) {
+	    other = lower_bound(other, other_end, term_index);
+	    if (other == other_end)
+		break;
+	    if (*other == term_index)
+		*out++ = term_index;
+	}
+	matches.erase(out, matches.end());
+    }
+
+    result.reserve(result.size() + matches.size());
+    for (auto term_index : matches) {
+	AssertRel(term_index + 1, <, offsets.size());
+	size_t start = offsets[term_index];
+	result.emplace_back(terms, start, offsets[term_index + 1] - start);
+    }
+    RETURN(true);
+}
@@ -0,0 +1,90 @@
+/** @file termngramindex.h
+ * @brief Character trigram index over the terms in a database shard.
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_TERMNGRAMINDEX_H
+#define XAPIAN_INCLUDED_TERMNGRAMINDEX_H
+
+#include "backends/databaseinternal.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** Character trigram index over the terms in a database shard.
+ *
+ *  Each term is padded with a zero byte at each end and every three byte
+ *  window of the padded term is indexed, so a fragment which must occur at
+ *  the start or end of a term can be anchored by padding it in the same way.
+ *
+ *  This allows wildcard patterns with a leading or infix wildcard to be
+ *  expanded by intersecting the lists for the trigrams of the pattern's
+ *  literal fragments rather than by scanning the whole term dictionary.  The
+ *  candidates returned are a superset of the matching terms, so the caller
+ *  still needs to test each one against the pattern.
+ */
+class TermNgramIndex {
+    /// Concatenation of all the terms, in ascending byte order.
+    std::string terms;
+
+    /** Offset of the start of each term in @a terms.
+     *
+     *  There's an extra entry at the end so the length of term i is always
+     *  offsets[i + 1] - offsets[i].
+     */
+    std::vector<size_t> offsets;
+
+    /// Map from a trigram to the ascending list of indices of terms with it.
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+
+    /// Revision of the shard which this index was built from.
+    Xapian::rev revision;
+
+    void add_term(const std::string& term);
+
+  public:
+    /** Build an index of all the terms in @a db.
+     *
+     *  @param db	The shard to index.
+     *  @param rev	The revision of @a db which is being indexed.
+     */
+    TermNgramIndex(const Xapian::Database::Internal& db, Xapian::rev rev);
+
+    /// The revision this index was built from.
+    Xapian::rev get_revision() const { return revision; }
+
+    /** Find candidate terms containing all of @a fragments.
+     *
+     *  A fragment which must occur at the start of a term should have a
+     *  zero byte prepended, and one which must occur at the end of a term
+     *  should have a zero byte appended.
+     *
+     *  @param fragments	The literal fragments to look for.
+     *  @param result		Candidates are appended to this in ascending
+     *				byte order.
+     *
+     *  @return false if the fragments contain no trigrams, in which case the
+     *		index can't help and the caller should scan all the terms.
+     */
+    bool get_candidates(const std::vector<std::string>& fragments,
+			std::vector<std::string>& result) const;
+};
+
+#endif // XAPIAN_INCLUDED_TERMNGRAMINDEX_H
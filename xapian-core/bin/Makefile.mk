@@ -72,6 +72,7 @@ bin_xapian_inspect_SOURCES = bin/xapian-inspect.cc\
 	backends/uuids.cc\
 	common/compression_stream.cc\
 	common/errno_to_string.cc\
+	common/io_batch.cc\
 	common/io_utils.cc\
 	common/posixy_wrapper.cc\
 	common/str.cc\
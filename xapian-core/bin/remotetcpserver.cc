@@ -28,8 +28,11 @@
 #include <xapian/error.h>
 
 #include "net/remoteserver.h"
+#include "net/remoteserverstats.h"
 
 #include <iostream>
+#include <mutex>
+#include <utility>
 
 using namespace std;
 
@@ -42,16 +45,105 @@ RemoteTcpServer::RemoteTcpServer(const vector<std::string> &dbpaths_,
       dbpaths(dbpaths_), writable(writable_),
       active_timeout(active_timeout_), idle_timeout(idle_timeout_)
 {
+    for (auto&& dbpath : dbpaths) {
+	if (!context.empty())
+	    context += ' ';
+	context += dbpath;
+    }
 }
 
 void
-RemoteTcpServer::handle_one_connection(int socket)
+RemoteTcpServer::run_server(RemoteServer& sserv)
 {
-    try {
-	RemoteServer sserv(dbpaths, socket, socket,
-			   active_timeout, idle_timeout, writable);
+    if (compress)
+	sserv.allow_compression();
+    sserv.set_stats(stats);
+    {
+	lock_guard<mutex> lock(reg_mutex);
 	sserv.set_registry(reg);
+    }
+    // Replace sserv's copy of reg before it is destroyed, so that we only
+    // touch the shared reference count with reg_mutex held.
+    Xapian::Registry empty_reg;
+    try {
 	sserv.run();
+    } catch (...) {
+	lock_guard<mutex> lock(reg_mutex);
+	sserv.set_registry(empty_reg);
+	throw;
+    }
+    lock_guard<mutex> lock(reg_mutex);
+    sserv.set_registry(empty_reg);
+}
+
+void
+RemoteTcpServer::enable_metrics(const std::string& host, int port)
+{
+    stats = RemoteServerStats::create();
+    RemoteServerStats* s = stats;
+    serve_metrics(host, port, [s]() { return s->report(); });
+}
+
+void
+RemoteTcpServer::handle_one_connection(int socket)
+{
+    try {
+	if (writable) {
+	    RemoteServer sserv(dbpaths, socket, socket,
+			       active_timeout, idle_timeout, true);
+	    run_server(sserv);
+	    return;
+	}
+
+	Xapian::Database db;
+	bool have_db = false;
+	{
+	    lock_guard<mutex> lock(idle_dbs_mutex);
+	    if (!idle_dbs.empty()) {
+		swap(db, idle_dbs.back());
+		idle_dbs.pop_back();
+		have_db = true;
+	    }
+	}
+	if (have_db) {
+	    try {
+		// Make sure the client sees the latest revision, as it would
+		// if we opened the database afresh.
+		(void)db.reopen();
+	    } catch (const Xapian::Error &) {
+		// Discard it and report any problem via a fresh open below.
+		have_db = false;
+	    }
+	}
+	if (!have_db) {
+	    // Open the database(s) - errors are reported to the client by
+	    // RemoteServer, so if this fails let it try again and do that.
+	    try {
+		db = Xapian::Database(dbpaths[0]);
+		for (size_t i = 1; i != dbpaths.size(); ++i) {
+		    db.add_database(Xapian::Database(dbpaths[i]));
+		}
+	    } catch (const Xapian::Error &) {
+		RemoteServer sserv(dbpaths, socket, socket,
+				   active_timeout, idle_timeout, false);
+		run_server(sserv);
+		return;
+	    }
+	}
+
+	try {
+	    RemoteServer sserv(db, context, socket, socket,
+			       active_timeout, idle_timeout);
+	    run_server(sserv);
+	} catch (...) {
+	    // The database is still usable if the connection failed (most
+	    // often this is just the client going idle for too long).
+	    lock_guard<mutex> lock(idle_dbs_mutex);
+	    idle_dbs.push_back(std::move(db));
+	    throw;
+	}
+	lock_guard<mutex> lock(idle_dbs_mutex);
+	idle_dbs.push_back(std::move(db));
     } catch (const Xapian::NetworkTimeoutError &e) {
 	if (verbose)
 	    cerr << "Connection timed out: " << e.get_description() << endl;
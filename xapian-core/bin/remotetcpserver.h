@@ -23,9 +23,13 @@
 
 #include "net/tcpserver.h"
 
+class RemoteServer;
+class RemoteServerStats;
+
 #include <xapian/database.h>
 #include <xapian/registry.h>
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -55,9 +59,40 @@ class RemoteTcpServer : public TcpServer {
     /** Timeout between operations (in seconds). */
     double idle_timeout;
 
+    /** Should replies be compressed for clients which support it? */
+    bool compress = false;
+
     /** Registry used for (un)serialisation. */
     Xapian::Registry reg;
 
+    /** Statistics about the messages handled, or NULL if not wanted. */
+    RemoteServerStats* stats = nullptr;
+
+    /** Protects copying and releasing reg.
+     *
+     *  Copies of a Registry share a reference count which isn't thread-safe,
+     *  and each connection uses a copy of reg.
+     */
+    std::mutex reg_mutex;
+
+    /** Description of the databases, used as the context for errors. */
+    std::string context;
+
+    /** Opened read-only databases which aren't currently in use.
+     *
+     *  When a read-only connection finishes, its database is kept here so a
+     *  later connection can reuse it rather than opening the database(s)
+     *  again.  This only helps when connections are handled by threads in
+     *  this process (see TcpServer::run_threaded()).
+     */
+    std::vector<Xapian::Database> idle_dbs;
+
+    /** Protects idle_dbs. */
+    std::mutex idle_dbs_mutex;
+
+    /** Run a RemoteServer, lending it a copy of reg while it runs. */
+    void run_server(RemoteServer& sserv);
+
     /** Accept a connection and return the filedescriptor for it. */
     int accept_connection();
 
@@ -84,6 +119,23 @@ class RemoteTcpServer : public TcpServer {
     /// Set the registry used for (un)serialisation.
     void set_registry(const Xapian::Registry & reg_) { reg = reg_; }
 
+    /// Set whether to compress replies for clients which support it.
+    void set_compression(bool compress_) { compress = compress_; }
+
+    /** Gather statistics and serve them on another port.
+     *
+     *  Counts and latency histograms for each message type, bytes sent and
+     *  received, and the number of active connections are reported in the
+     *  Prometheus text format.
+     *
+     *  This must be called before the server starts handling connections.
+     *
+     *  @param host	The hostname or address for the interface to listen on
+     *			(or "" to listen on all interfaces).
+     *  @param port	The TCP port number to serve the metrics on.
+     */
+    void enable_metrics(const std::string& host, int port);
+
     /** Handle a single connection on an already connected socket.
      *
      *  This method may be called by multiple threads.
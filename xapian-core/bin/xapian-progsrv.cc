@@ -36,11 +36,13 @@ using namespace std;
 
 #define OPT_HELP 1
 #define OPT_VERSION 2
+#define OPT_COMPRESS 3
 
 static const char * opts = "t:w";
 static const struct option long_opts[] = {
     {"timeout",		required_argument,	0, 't'},
     {"writable",	no_argument,		0, 'w'},
+    {"compress",	no_argument,		0, OPT_COMPRESS},
     {"help",		no_argument,		0, OPT_HELP},
     {"version",		no_argument,		0, OPT_VERSION},
     {NULL, 0, 0, 0}
@@ -51,6 +53,7 @@ static void show_usage() {
 "Options:\n"
 "  --timeout MSECS         set timeout\n"
 "  --writable              allow updates (only one database directory allowed)\n"
+"  --compress              compress larger replies to clients which support it\n"
 "  --help                  display this help and exit\n"
 "  --version               output version information and exit" << endl;
 }
@@ -59,6 +62,7 @@ int main(int argc, char **argv)
 {
     double timeout = 60.0;
     bool writable = false;
+    bool compress = false;
     bool syntax_error = false;
 
     int c;
@@ -83,6 +87,9 @@ int main(int argc, char **argv)
 	    case 'w':
 		writable = true;
 		break;
+	    case OPT_COMPRESS:
+		compress = true;
+		break;
 	    default:
 		syntax_error = true;
 	}
@@ -110,6 +117,8 @@ int main(int argc, char **argv)
 	// We communicate with the client via stdin (fd 0) and stdout (fd 1).
 	// Note that RemoteServer closes these fds.
 	RemoteServer server(dbnames, 0, 1, timeout, timeout, writable);
+	if (compress)
+	    server.allow_compression();
 
 	// If you have defined your own weighting scheme, register it here
 	// like so:
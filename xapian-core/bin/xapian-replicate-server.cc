@@ -38,6 +38,7 @@ using namespace std;
 
 #define OPT_HELP 1
 #define OPT_VERSION 2
+#define OPT_THREADS 3
 
 static void show_usage() {
     cout << "Usage: " PROG_NAME " [OPTIONS] DATABASE_PARENT_DIRECTORY\n\n"
@@ -45,6 +46,8 @@ static void show_usage() {
 "  -I, --interface=ADDR  listen on interface ADDR\n"
 "  -p, --port=PORT   port to listen on\n"
 "  -o, --one-shot    serve a single connection and exit\n"
+"  --threads=NUM     serve up to NUM replicas at once from this process using\n"
+"                    a pool of threads, instead of forking for each connection\n"
 "  --help            display this help and exit\n"
 "  --version         output version information and exit" << endl;
 }
@@ -57,6 +60,7 @@ main(int argc, char **argv)
 	{"interface",	required_argument,	0, 'I'},
 	{"port",	required_argument,	0, 'p'},
 	{"one-shot",	no_argument,		0, 'o'},
+	{"threads",	required_argument,	0, OPT_THREADS},
 	{"help",	no_argument, 0, OPT_HELP},
 	{"version",	no_argument, 0, OPT_VERSION},
 	{NULL,		0, 0, 0}
@@ -66,6 +70,7 @@ main(int argc, char **argv)
     int port = 0;
 
     bool one_shot = false;
+    unsigned num_threads = 0;
 
     int c;
     while ((c = gnu_getopt_long(argc, argv, opts, long_opts, 0)) != -1) {
@@ -84,6 +89,12 @@ main(int argc, char **argv)
 	    case 'o':
 		one_shot = true;
 		break;
+	    case OPT_THREADS:
+		if (!parse_unsigned(optarg, num_threads) || num_threads == 0) {
+		    cerr << "Number of threads must be > 0" << endl;
+		    exit(1);
+		}
+		break;
 	    case OPT_HELP:
 		cout << PROG_NAME " - " PROG_DESC "\n\n";
 		show_usage();
@@ -109,6 +120,8 @@ main(int argc, char **argv)
 	ReplicateTcpServer server(host, port, dbpath);
 	if (one_shot) {
 	    server.run_once();
+	} else if (num_threads) {
+	    server.run_threaded(num_threads);
 	} else {
 	    server.run();
 	}
@@ -39,6 +39,7 @@ using namespace std;
 
 #define OPT_HELP 1
 #define OPT_VERSION 2
+#define OPT_COMPRESS 3
 
 // Wait DEFAULT_INTERVAL seconds between updates unless --interval is passed.
 #define DEFAULT_INTERVAL 60
@@ -64,6 +65,8 @@ static void show_usage() {
 "  -f, --force-copy    force a full copy of the database to be sent (and then\n"
 "                      replicate as normal)\n"
 "  -o, --one-shot      replicate only once and then exit\n"
+"  --compress          ask the master to compress larger messages (needs a\n"
+"                      server which supports this)\n"
 "  -q, --quiet         only report errors\n"
 "  -v, --verbose       be more verbose\n"
 "  --help              display this help and exit\n"
@@ -85,6 +88,7 @@ main(int argc, char **argv)
 	{"force-copy",	no_argument,		0, 'f'},
 	{"quiet",	no_argument,		0, 'q'},
 	{"verbose",	no_argument,		0, 'v'},
+	{"compress",	no_argument,		0, OPT_COMPRESS},
 	{"help",	no_argument, 0, OPT_HELP},
 	{"version",	no_argument, 0, OPT_VERSION},
 	{NULL,		0, 0, 0}
@@ -97,6 +101,7 @@ main(int argc, char **argv)
     bool one_shot = false;
     enum { NORMAL, VERBOSE, QUIET } verbosity = NORMAL;
     bool force_copy = false;
+    bool compress = false;
     int reader_close_time = READER_CLOSE_TIME;
     int timeout = DEFAULT_TIMEOUT;
 
@@ -159,6 +164,9 @@ main(int argc, char **argv)
 	    case 'v':
 		verbosity = VERBOSE;
 		break;
+	    case OPT_COMPRESS:
+		compress = true;
+		break;
 	    case OPT_HELP:
 		cout << PROG_NAME " - " PROG_DESC "\n\n";
 		show_usage();
@@ -207,7 +215,7 @@ main(int argc, char **argv)
 	    }
 	    Xapian::ReplicationInfo info;
 	    client.update_from_master(dbpath, masterdb, info,
-				      reader_close_time, force_copy);
+				      reader_close_time, force_copy, compress);
 	    if (verbosity == VERBOSE) {
 		cout << "Update complete: "
 		     << info.fullcopy_count << " copies, "
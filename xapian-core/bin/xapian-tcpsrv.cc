@@ -55,6 +55,9 @@ const int MSECS_ACTIVE_TIMEOUT_DEFAULT = 15000;
 
 #define OPT_HELP 1
 #define OPT_VERSION 2
+#define OPT_THREADS 3
+#define OPT_COMPRESS 4
+#define OPT_METRICS_PORT 5
 
 static const char * opts = "I:p:a:i:t:oqw";
 static const struct option long_opts[] = {
@@ -66,6 +69,9 @@ static const struct option long_opts[] = {
     {"one-shot",	no_argument,		0, 'o'},
     {"quiet",		no_argument,		0, 'q'},
     {"writable",	no_argument,		0, 'w'},
+    {"threads",		required_argument,	0, OPT_THREADS},
+    {"compress",	no_argument,		0, OPT_COMPRESS},
+    {"metrics-port",	required_argument,	0, OPT_METRICS_PORT},
     {"help",		no_argument,		0, OPT_HELP},
     {"version",		no_argument,		0, OPT_VERSION},
     {NULL, 0, 0, 0}
@@ -83,6 +89,15 @@ static void show_usage() {
 "  --one-shot              serve a single connection and exit\n"
 "  --quiet                 disable information messages to stdout\n"
 "  --writable              allow updates (only one database directory allowed)\n"
+"  --threads NUM           handle connections with a pool of NUM threads which\n"
+"                          reuse open databases, instead of forking for each\n"
+"                          connection; each thread serves one connection at\n"
+"                          a time, so at most NUM clients are served at once\n"
+"                          (not allowed with --writable)\n"
+"  --compress              compress larger replies to clients which support it\n"
+"  --metrics-port PORTNUM  report per-message counts and latencies, bytes sent\n"
+"                          and received, and active connections to clients\n"
+"                          connecting to port PORTNUM (text, or HTTP for GET)\n"
 "  --help                  display this help and exit\n"
 "  --version               output version information and exit" << endl;
 }
@@ -90,12 +105,15 @@ static void show_usage() {
 int main(int argc, char **argv) {
     string host;
     int port = 0;
+    int metrics_port = 0;
     double active_timeout = MSECS_ACTIVE_TIMEOUT_DEFAULT * 1e-3;
     double idle_timeout   = MSECS_IDLE_TIMEOUT_DEFAULT * 1e-3;
 
     bool one_shot = false;
     bool verbose = true;
     bool writable = false;
+    unsigned num_threads = 0;
+    bool compress = false;
     bool syntax_error = false;
 
     int c;
@@ -155,6 +173,23 @@ int main(int argc, char **argv) {
 	    case 'w':
 		writable = true;
 		break;
+	    case OPT_THREADS:
+		if (!parse_unsigned(optarg, num_threads) || num_threads == 0) {
+		    cerr << "Number of threads must be > 0" << endl;
+		    exit(1);
+		}
+		break;
+	    case OPT_COMPRESS:
+		compress = true;
+		break;
+	    case OPT_METRICS_PORT:
+		if (!parse_signed(optarg, metrics_port) ||
+		    (metrics_port < 1 || metrics_port > 65535)) {
+		    cerr << "Error: must specify a valid metrics port number "
+			    "(between 1 and 65535). " << endl;
+		    exit(1);
+		}
+		break;
 	    default:
 		syntax_error = true;
 	}
@@ -175,6 +210,11 @@ int main(int argc, char **argv) {
 	exit(1);
     }
 
+    if (writable && num_threads) {
+	cerr << "Error: '--threads' can't be used with '--writable'." << endl;
+	exit(1);
+    }
+
     try {
 	vector<string> dbnames;
 	// Try to open the database(s) so we report problems now instead of
@@ -206,9 +246,17 @@ int main(int argc, char **argv) {
 	    cout << "Listening..." << endl;
 
 	register_user_weighting_schemes(server);
+	server.set_compression(compress);
+	if (metrics_port) {
+	    server.enable_metrics(host, metrics_port);
+	    if (verbose)
+		cout << "Serving metrics on port " << metrics_port << endl;
+	}
 
 	if (one_shot) {
 	    server.run_once();
+	} else if (num_threads) {
+	    server.run_threaded(num_threads);
 	} else {
 	    server.run();
 	}
@@ -13,6 +13,7 @@ noinst_HEADERS +=\
 	common/gnu_getopt.h\
 	common/heap.h\
 	common/internaltypes.h\
+	common/io_batch.h\
 	common/io_utils.h\
 	common/keyword.h\
 	common/log2.h\
@@ -58,6 +59,7 @@ lib_src +=\
 	common/debuglog.cc\
 	common/errno_to_string.cc\
 	common/fileutils.cc\
+	common/io_batch.cc\
 	common/io_utils.cc\
 	common/keyword.cc\
 	common/msvc_dirent.cc\
@@ -77,6 +79,11 @@ else
 if BUILD_BACKEND_HONEY
 lib_src +=\
 	common/compression_stream.cc
+else
+if BUILD_BACKEND_REMOTE
+lib_src +=\
+	common/compression_stream.cc
+endif
 endif
 endif
 
@@ -82,6 +82,39 @@ CompressionStream::compress(const char* buf, size_t* p_size) {
     return out;
 }
 
+void
+CompressionStream::compress_chunk(const char* p, size_t len, bool finish,
+				  string& buf)
+{
+    Bytef blk[8192];
+
+    deflate_zstream->next_in = reinterpret_cast<const Bytef*>(p);
+    deflate_zstream->avail_in = static_cast<uInt>(len);
+
+    while (true) {
+	deflate_zstream->next_out = blk;
+	deflate_zstream->avail_out = static_cast<uInt>(sizeof(blk));
+	int err = deflate(deflate_zstream, finish ? Z_FINISH : Z_NO_FLUSH);
+	// Z_BUF_ERROR just means no progress was possible.
+	if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR) {
+	    string msg = "deflate failed";
+	    if (deflate_zstream->msg) {
+		msg += " (";
+		msg += deflate_zstream->msg;
+		msg += ')';
+	    }
+	    throw Xapian::DatabaseError(msg);
+	}
+
+	buf.append(reinterpret_cast<const char*>(blk),
+		   deflate_zstream->next_out - blk);
+	if (err == Z_STREAM_END) return;
+	// Unless we're finishing, we're done once all the input has been
+	// consumed and deflate() didn't fill the output buffer.
+	if (!finish && deflate_zstream->avail_out != 0) return;
+    }
+}
+
 bool
 CompressionStream::decompress_chunk(const char* p, int len, string& buf)
 {
@@ -94,7 +127,8 @@ CompressionStream::decompress_chunk(const char* p, int len, string& buf)
 	inflate_zstream->next_out = blk;
 	inflate_zstream->avail_out = static_cast<uInt>(sizeof(blk));
 	int err = inflate(inflate_zstream, Z_SYNC_FLUSH);
-	if (err != Z_OK && err != Z_STREAM_END) {
+	// Z_BUF_ERROR just means no progress was possible.
+	if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR) {
 	    if (err == Z_MEM_ERROR) throw std::bad_alloc();
 	    string msg = "inflate failed";
 	    if (inflate_zstream->msg) {
@@ -108,7 +142,11 @@ CompressionStream::decompress_chunk(const char* p, int len, string& buf)
 	buf.append(reinterpret_cast<const char*>(blk),
 		   inflate_zstream->next_out - blk);
 	if (err == Z_STREAM_END) return true;
-	if (inflate_zstream->avail_in == 0) return false;
+	// If the output buffer was filled there may be more output pending
+	// even if all the input has been consumed.
+	if (err == Z_BUF_ERROR ||
+	    (inflate_zstream->avail_in == 0 && inflate_zstream->avail_out != 0))
+	    return false;
     }
 }
 
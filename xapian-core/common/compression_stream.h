@@ -63,6 +63,19 @@ class CompressionStream {
 
     const char* compress(const char* buf, size_t* p_size);
 
+    /** Start compressing a stream of data with compress_chunk(). */
+    void compress_start() { lazy_alloc_deflate_zstream(); }
+
+    /** Compress a chunk of a stream of data.
+     *
+     *  @param p	The data to compress.
+     *  @param len	The length of the data.
+     *  @param finish	True if this is the final chunk.
+     *  @param buf	The compressed data is appended to this.
+     */
+    void compress_chunk(const char* p, size_t len, bool finish,
+			std::string& buf);
+
     void decompress_start() { lazy_alloc_inflate_zstream(); }
 
     /** Returns true if this was the final chunk. */
@@ -0,0 +1,397 @@
+/** @file io_batch.cc
+ * @brief Perform a batch of block I/O requests together.
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "io_batch.h"
+
+#include "io_utils.h"
+#include "xapian/error.h"
+
+#include <exception>
+#include <memory>
+
+#ifdef HAVE_LINUX_IO_URING_H
+# include <linux/io_uring.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include "safefcntl.h"
+# include "safeunistd.h"
+# include <atomic>
+# include <cerrno>
+# include <cstdint>
+# include <cstring>
+# if defined __NR_io_uring_setup && defined __NR_io_uring_enter && \
+     defined IORING_FEAT_RW_CUR_POS
+#  define USE_IO_URING
+# endif
+#endif
+
+using namespace std;
+
+void
+IOBatch::run_sync(const request& r)
+{
+    switch (r.op) {
+	case READ:
+	    io_read_block(r.fd, r.p, r.n, r.b, r.o);
+	    break;
+	case WRITE:
+	    io_write_block(r.fd, r.p, r.n, r.b, r.o);
+	    break;
+	case READAHEAD:
+	    (void)io_readahead_block(r.fd, r.n, r.b, r.o);
+	    break;
+    }
+}
+
+#ifdef USE_IO_URING
+
+/** A minimal io_uring instance.
+ *
+ *  We talk to the kernel directly rather than depending on liburing as we
+ *  only need to submit a batch of requests and wait for them all to finish.
+ */
+class IOBatch::Ring {
+    /// Number of submission queue entries.
+    static constexpr unsigned ENTRIES = 64;
+
+    /** How many times in a row io_uring_enter() may fail while we're waiting
+     *  for requests in flight before we give up.
+     */
+    static constexpr unsigned MAX_WAIT_FAILURES = 1000;
+
+    int fd = -1;
+
+    unsigned sq_entries = 0;
+
+    void* sq_ring = MAP_FAILED;
+    size_t sq_ring_size = 0;
+
+    void* cq_ring = MAP_FAILED;
+    size_t cq_ring_size = 0;
+
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size = 0;
+
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    io_uring_cqe* cqes;
+
+    /// The process which set up the ring (a forked child can't use it).
+    pid_t pid;
+
+    /// Set if run() gave up waiting for requests, so the ring can't be reused.
+    bool failed = false;
+
+    /// Queue @a r, tagged with @a user_data.
+    void push(const request& r, unsigned user_data);
+
+  public:
+    Ring();
+
+    ~Ring();
+
+    bool ok() const { return fd >= 0; }
+
+    bool owned_by_this_process() const { return pid == getpid(); }
+
+    bool usable() const { return !failed && owned_by_this_process(); }
+
+    /// Maximum number of requests which can be in flight at once.
+    unsigned capacity() const { return sq_entries; }
+
+    /** Perform requests [begin, end), at most capacity() of them.
+     *
+     *  Requests which the kernel doesn't complete in full, or which can't be
+     *  submitted once some are in flight, are done with run_sync(), so that
+     *  errors are reported in the usual way.  The first
+     *  exception is stored in @a error and the other requests are still
+     *  waited for, since the buffers must remain valid until they finish.
+     *
+     *  Returns false if the requests couldn't be submitted (in which case the
+     *  ring shouldn't be used again).  Throws Xapian::DatabaseError if waiting
+     *  for the requests in flight keeps failing.
+     */
+    bool run(const request* begin, const request* end, exception_ptr& error);
+
+    /// The calling thread's ring, or NULL if io_uring isn't usable.
+    static Ring* get();
+};
+
+IOBatch::Ring::Ring() : pid(getpid())
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int ring_fd = int(syscall(__NR_io_uring_setup, ENTRIES, &params));
+    if (ring_fd < 0) return;
+    // IORING_FEAT_RW_CUR_POS arrived in Linux 5.6, the same release as the
+    // IORING_OP_READ, IORING_OP_WRITE and IORING_OP_FADVISE opcodes, and
+    // there's no other way to check they're supported without submitting
+    // something.
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+	close(ring_fd);
+	return;
+    }
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes +
+		   params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP);
+    if (single_mmap) {
+	if (cq_ring_size > sq_ring_size) sq_ring_size = cq_ring_size;
+	cq_ring_size = 0;
+    }
+    sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) {
+	close(ring_fd);
+	return;
+    }
+    void* cq_base = sq_ring;
+    if (!single_mmap) {
+	cq_ring = mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+	if (cq_ring == MAP_FAILED) {
+	    close(ring_fd);
+	    return;
+	}
+	cq_base = cq_ring;
+    }
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* p = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (p == MAP_FAILED) {
+	close(ring_fd);
+	return;
+    }
+    sqes = static_cast<io_uring_sqe*>(p);
+
+    char* sq = static_cast<char*>(sq_ring);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    char* cq = static_cast<char*>(cq_base);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    sq_entries = params.sq_entries;
+    fd = ring_fd;
+}
+
+IOBatch::Ring::~Ring()
+{
+    if (sqes != MAP_FAILED) munmap(sqes, sqes_size);
+    if (cq_ring != MAP_FAILED) munmap(cq_ring, cq_ring_size);
+    if (sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_size);
+    if (fd >= 0) close(fd);
+}
+
+void
+IOBatch::Ring::push(const request& r, unsigned user_data)
+{
+    // Only we write to the tail of the submission queue.
+    unsigned tail = *sq_tail;
+    unsigned i = tail & *sq_mask;
+    io_uring_sqe& sqe = sqes[i];
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.fd = r.fd;
+    sqe.off = r.offset();
+    sqe.len = unsigned(r.n);
+    sqe.user_data = user_data;
+    switch (r.op) {
+	case READ:
+	    sqe.opcode = IORING_OP_READ;
+	    sqe.addr = reinterpret_cast<uintptr_t>(r.p);
+	    break;
+	case WRITE:
+	    sqe.opcode = IORING_OP_WRITE;
+	    sqe.addr = reinterpret_cast<uintptr_t>(r.p);
+	    break;
+	case READAHEAD:
+	    sqe.opcode = IORING_OP_FADVISE;
+	    sqe.fadvise_advice = POSIX_FADV_WILLNEED;
+	    break;
+    }
+    sq_array[i] = i;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+bool
+IOBatch::Ring::run(const request* begin, const request* end,
+		   exception_ptr& error)
+{
+    unsigned count = unsigned(end - begin);
+    for (unsigned i = 0; i != count; ++i) {
+	push(begin[i], i);
+    }
+
+    unsigned to_submit = count;
+    // Requests [submit_end, count) are to be done the usual way, because
+    // io_uring_enter() failed before the kernel accepted them.
+    unsigned submit_end = count;
+    unsigned done = 0;
+    unsigned failures = 0;
+    while (to_submit || done != submit_end) {
+	long r = syscall(__NR_io_uring_enter, fd, to_submit, 1,
+			 IORING_ENTER_GETEVENTS, NULL, 0);
+	if (r < 0) {
+	    if (errno == EINTR) continue;
+	    if (to_submit == count) {
+		// Nothing was submitted, so the caller can do it all another
+		// way.  Wind back the submission queue.
+		__atomic_store_n(sq_tail, *sq_tail - count, __ATOMIC_RELEASE);
+		return false;
+	    }
+	    if (to_submit) {
+		// Stop submitting, and take the rest off the submission queue.
+		__atomic_store_n(sq_tail, *sq_tail - to_submit,
+				 __ATOMIC_RELEASE);
+		submit_end -= to_submit;
+		to_submit = 0;
+	    } else if (++failures == MAX_WAIT_FAILURES) {
+		// Requests are in flight, so we have to wait for them before
+		// the buffers can be released, but we can't spin forever.
+		failed = true;
+		throw Xapian::DatabaseError("Couldn't wait for I/O to complete",
+					    errno);
+	    }
+	    r = 0;
+	} else {
+	    failures = 0;
+	}
+	to_submit -= unsigned(r);
+
+	unsigned head = *cq_head;
+	unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+	while (head != tail) {
+	    const io_uring_cqe& cqe = cqes[head & *cq_mask];
+	    const request& req = begin[cqe.user_data];
+	    int res = cqe.res;
+	    ++head;
+	    ++done;
+	    if (req.op == READAHEAD || res == int(req.n))
+		continue;
+	    // A short read or write, or an error - redo the request the usual
+	    // way, which handles the partial cases and reports errors.
+	    try {
+		run_sync(req);
+	    } catch (...) {
+		if (!error) error = current_exception();
+	    }
+	}
+	__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    for (unsigned i = submit_end; i != count; ++i) {
+	try {
+	    run_sync(begin[i]);
+	} catch (...) {
+	    if (!error) error = current_exception();
+	}
+    }
+    return true;
+}
+
+IOBatch::Ring*
+IOBatch::Ring::get()
+{
+    // Set if io_uring isn't supported (which is generally process-wide, for
+    // example because of the kernel version or a seccomp filter), so we don't
+    // keep trying.
+    static atomic<bool> unsupported(false);
+    if (unsupported.load(memory_order_relaxed)) return NULL;
+
+    static thread_local unique_ptr<Ring> ring;
+    if (ring && !ring->usable()) {
+	// Either we've been forked (the ring's memory is shared with our
+	// parent) or requests may still be in flight on it.
+	ring.reset();
+    }
+    if (!ring) {
+	ring.reset(new Ring());
+	if (!ring->ok()) {
+	    ring.reset();
+	    unsupported = true;
+	    return NULL;
+	}
+    }
+    return ring.get();
+}
+
+bool
+IOBatch::run_io_uring(const vector<request>& reqs)
+{
+    Ring* ring = Ring::get();
+    if (!ring) return false;
+
+    exception_ptr error;
+    const request* p = reqs.data();
+    const request* end = p + reqs.size();
+    while (p != end) {
+	const request* chunk_end = p + min(size_t(end - p),
+					   size_t(ring->capacity()));
+	if (!ring->run(p, chunk_end, error)) {
+	    if (p == reqs.data()) return false;
+	    // Finish the rest synchronously.
+	    for ( ; p != end; ++p) {
+		try {
+		    run_sync(*p);
+		} catch (...) {
+		    if (!error) error = current_exception();
+		}
+	    }
+	    break;
+	}
+	p = chunk_end;
+    }
+    if (error) rethrow_exception(error);
+    return true;
+}
+
+#else
+
+bool
+IOBatch::run_io_uring(const vector<request>&)
+{
+    return false;
+}
+
+#endif
+
+void
+IOBatch::run()
+{
+    vector<request> reqs;
+    swap(reqs, requests);
+    // A single request gains nothing from being submitted asynchronously.
+    if (reqs.size() > 1 && run_io_uring(reqs))
+	return;
+    for (auto&& r : reqs) {
+	run_sync(r);
+    }
+}
@@ -0,0 +1,110 @@
+/** @file io_batch.h
+ * @brief Perform a batch of block I/O requests together.
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_IO_BATCH_H
+#define XAPIAN_INCLUDED_IO_BATCH_H
+
+#ifndef PACKAGE
+# error config.h must be included first in each C++ source file
+#endif
+
+#include <sys/types.h>
+#include <cstddef>
+#include <vector>
+
+/** A batch of block I/O requests.
+ *
+ *  Requests are queued by the add_*() methods and performed by run().  On
+ *  Linux they're submitted together using io_uring where the kernel allows
+ *  it, so a batch needs a single system call and the device can work on the
+ *  requests in parallel.  Otherwise each request is performed by a separate
+ *  call, just as io_read_block(), io_write_block() and io_readahead_block()
+ *  would.
+ *
+ *  The buffers passed in must remain valid until run() returns.
+ */
+class IOBatch {
+    enum op_type { READ, WRITE, READAHEAD };
+
+    struct request {
+	op_type op;
+	int fd;
+	char* p;
+	size_t n;
+	/// Block number.
+	off_t b;
+	/// Offset in the file of block 0.
+	off_t o;
+
+	/// Offset in the file of the block.
+	off_t offset() const { return o + b * off_t(n); }
+    };
+
+    /// The queued requests.
+    std::vector<request> requests;
+
+    class Ring;
+
+    /// Perform request @a r with ordinary system calls.
+    static void run_sync(const request& r);
+
+    /** Try to perform @a reqs with io_uring.
+     *
+     *  Returns false if io_uring isn't available, in which case nothing has
+     *  been done.
+     */
+    static bool run_io_uring(const std::vector<request>& reqs);
+
+  public:
+    /// Queue reading block @a b of size @a n into @a p from @a fd, offset @a o.
+    void add_read_block(int fd, char* p, size_t n, off_t b, off_t o = 0) {
+	requests.push_back(request{READ, fd, p, n, b, o});
+    }
+
+    /// Queue writing block @a b of size @a n from @a p to @a fd, offset @a o.
+    void add_write_block(int fd, const char* p, size_t n, off_t b,
+			 off_t o = 0) {
+	// The buffer isn't modified, but we share the request structure.
+	requests.push_back(request{WRITE, fd, const_cast<char*>(p), n, b, o});
+    }
+
+    /// Queue a readahead hint for block @a b of size @a n of @a fd.
+    void add_readahead_block(int fd, size_t n, off_t b, off_t o = 0) {
+	requests.push_back(request{READAHEAD, fd, NULL, n, b, o});
+    }
+
+    /// Number of requests queued.
+    size_t size() const { return requests.size(); }
+
+    /// Are there no requests queued?
+    bool empty() const { return requests.empty(); }
+
+    /** Perform the queued requests, and wait for them to finish.
+     *
+     *  The batch is empty afterwards, even if an exception is thrown.
+     *
+     *  If a read or write fails, Xapian::DatabaseError is thrown (once any
+     *  other requests in progress have finished).  Failed readahead requests
+     *  are ignored since they're only hints.
+     */
+    void run();
+};
+
+#endif // XAPIAN_INCLUDED_IO_BATCH_H
@@ -22,6 +22,7 @@ xapianinclude_HEADERS =\
 	include/xapian/enquire.h\
 	include/xapian/eset.h\
 	include/xapian/expanddecider.h\
+	include/xapian/indexingpipeline.h\
 	include/xapian/intrusive_ptr.h\
 	include/xapian/iterator.h\
 	include/xapian/keymaker.h\
@@ -34,6 +35,7 @@ xapianinclude_HEADERS =\
 	include/xapian/query.h\
 	include/xapian/queryparser.h\
 	include/xapian/registry.h\
+	include/xapian/reranker.h\
 	include/xapian/rset.h\
 	include/xapian/stem.h\
 	include/xapian/termgenerator.h\
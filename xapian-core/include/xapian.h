@@ -65,6 +65,7 @@
 #include <xapian/valueiterator.h>
 
 // Indexing
+#include <xapian/indexingpipeline.h>
 #include <xapian/termgenerator.h>
 
 // Searching
@@ -78,6 +79,7 @@
 #include <xapian/postingsource.h>
 #include <xapian/query.h>
 #include <xapian/queryparser.h>
+#include <xapian/reranker.h>
 #include <xapian/rset.h>
 #include <xapian/valuesetmatchdecider.h>
 #include <xapian/weight.h>
@@ -144,6 +144,25 @@ const int DB_NO_TERMLIST	 = 0x20;
  */
 const int DB_RETRY_LOCK		 = 0x40;
 
+/** Maintain a symmetric delete index for spelling suggestions.
+ *
+ *  When opening a WritableDatabase, this means build an index which maps
+ *  each variant of every spelling word with up to two characters deleted to
+ *  the words it was derived from (if the database doesn't already have one),
+ *  and keep it up to date as spelling words are added and removed.
+ *
+ *  Database::get_spelling_suggestion() then generates its candidates by
+ *  looking up the deletions of the misspelled word, which is much faster
+ *  than merging trigram lists, at the cost of a larger spelling table.
+ *
+ *  Once a database has this index it is maintained whether or not this flag
+ *  is specified.  Currently only the glass backend supports this flag - it
+ *  is ignored by other backends.
+ *
+ *  @since 1.5.0
+ */
+const int DB_SPELLING_DELETES	 = 0x80;
+
 /** Use the glass backend.
  *
  *  When opening a WritableDatabase, this means create a glass database if a
@@ -201,6 +220,78 @@ const int DB_BACKEND_INMEMORY	 = 0x400;
  */
 const int DB_BACKEND_HONEY	 = 0x500;
 
+/** Pipeline updates to a remote database or a shard.
+ *
+ *  When opening a remote WritableDatabase, this flag means that updates which
+ *  don't return anything (and add_document(), which can work out the docid
+ *  it will use) are sent to the server without waiting for each to be
+ *  processed, so indexing isn't limited by the time taken for a round trip to
+ *  the server.
+ *
+ *  The downside is that an error from such an update is only reported by the
+ *  next method call which needs a reply from the server (for example,
+ *  commit()), and any later pipelined updates are ignored.  The exception's
+ *  message says which update failed.
+ *
+ *  When a glass or remote WritableDatabase opened with this flag is a shard
+ *  of a WritableDatabase with several shards, add_document() and
+ *  replace_document() by docid on the combined database queue the update for
+ *  a thread which applies updates to that shard, and commit() commits such
+ *  shards in parallel.  The queued update gets its own copy of the
+ *  document, so the caller's Document can be modified or reused as soon as
+ *  the call returns.  An error from a queued update is reported by the
+ *  next call on the combined database which waits for the queue (which is
+ *  any call except another queued update, and is at the latest commit()),
+ *  and later queued updates to that shard are ignored.  While updates are
+ *  queued, the shard mustn't be accessed except through the combined
+ *  database.  A Document read from such a shard via the combined database
+ *  is read in full straight away, but iterators over it (e.g. from
+ *  postlist_begin() or termlist_begin()) shouldn't be used after a later
+ *  add_document() or replace_document(), since the thread may be updating
+ *  the shard they read from.  This flag is passed on to the shards when
+ *  opening a stub database file.
+ *
+ *  Other backends ignore this flag.
+ *
+ *  @since 1.5.0
+ */
+const int DB_PIPELINE_UPDATES	 = 0x800;
+
+/** Commit to a glass database by writing a segment of changes.
+ *
+ *  When opening a glass WritableDatabase, this flag means that commit()
+ *  writes the changes since the last commit to a small log file (a
+ *  "segment") in the database directory and syncs it, which takes time
+ *  proportional to the size of the changes rather than the size of the
+ *  database.  A background thread then applies segments to the B-tree
+ *  tables, merging several segments into each update to the tables when
+ *  commits come faster than it can keep up with.
+ *
+ *  Segments which haven't been applied when the database is next opened for
+ *  writing (for example after a crash) are applied then, whether or not this
+ *  flag is specified.
+ *
+ *  This means that when commit() returns the changes are durable, but they
+ *  are NOT necessarily visible to readers yet: a separate Database opened on
+ *  the same path (or reopened) only sees them once the background thread has
+ *  applied their segment and committed the tables, which may be some time
+ *  after commit() returns.  Reading via the WritableDatabase always sees
+ *  them.
+ *
+ *  An error applying a segment in the background is rethrown by every later
+ *  call on the WritableDatabase (the segment will be applied again when the
+ *  database is reopened).  The background thread doesn't update the tables
+ *  while any iterators or documents obtained from the WritableDatabase
+ *  exist - it waits until they have been destroyed, and any updates needed
+ *  meanwhile are made by the calling thread instead - so keeping such
+ *  objects around stops commits being applied in the background.
+ *
+ *  Other backends ignore this flag.
+ *
+ *  @since 1.5.0
+ */
+const int DB_SEGMENTED_COMMITS	 = 0x1000;
+
 #ifdef XAPIAN_LIB_BUILD
 /** @internal Bit mask for backend codes. */
 const int DB_BACKEND_MASK_	 = 0x700;
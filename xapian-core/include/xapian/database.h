@@ -427,6 +427,72 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
 
     Xapian::termcount get_wdfdocmax(Xapian::docid did) const;
 
+    /** Get the lengths of several documents.
+     *
+     *  This gives the same results as calling get_doclength() for each
+     *  document, but the lookups are made in a single pass over the
+     *  database, and a single round trip for a remote database.
+     *
+     *  @param dids	The document ids, in ascending order.
+     *
+     *  @return The document lengths, in the same order as @a dids.
+     *
+     *  @exception Xapian::InvalidArgumentError is thrown if @a dids contains
+     *		   0 or isn't in ascending order.
+     *  @exception Xapian::DocNotFoundError is thrown if any of the
+     *		   documents doesn't exist.
+     *
+     *  Experimental - see
+     *  https://xapian.org/docs/deprecation#experimental-features
+     */
+    std::vector<Xapian::termcount>
+    get_doclength(const std::vector<Xapian::docid>& dids) const;
+
+    /** Get the number of unique terms in several documents.
+     *
+     *  This gives the same results as calling get_unique_terms() for each
+     *  document, but the lookups are made in a single pass over the
+     *  database, and a single round trip for a remote database.
+     *
+     *  @param dids	The document ids, in ascending order.
+     *
+     *  @return The numbers of unique terms, in the same order as @a dids.
+     *
+     *  @exception Xapian::InvalidArgumentError is thrown if @a dids contains
+     *		   0 or isn't in ascending order.
+     *  @exception Xapian::DocNotFoundError is thrown if any of the
+     *		   documents doesn't exist.
+     *
+     *  Experimental - see
+     *  https://xapian.org/docs/deprecation#experimental-features
+     */
+    std::vector<Xapian::termcount>
+    get_unique_terms(const std::vector<Xapian::docid>& dids) const;
+
+    /** Get the values in a slot for several documents.
+     *
+     *  This gives the same results as calling get_value(@a slot) on each
+     *  document, but without opening the documents, and the values are read
+     *  in a single pass over the value stream for @a slot (and a single round
+     *  trip for a remote database).
+     *
+     *  @param dids	The document ids, in ascending order.
+     *  @param slot	The value slot to read.
+     *
+     *  @return The values, in the same order as @a dids.  The value is empty
+     *		for a document with no value in @a slot, including one which
+     *		doesn't exist.
+     *
+     *  @exception Xapian::InvalidArgumentError is thrown if @a dids contains
+     *		   0 or isn't in ascending order.
+     *
+     *  Experimental - see
+     *  https://xapian.org/docs/deprecation#experimental-features
+     */
+    std::vector<std::string>
+    get_values(const std::vector<Xapian::docid>& dids,
+	       Xapian::valueno slot) const;
+
     /** Send a keep-alive message.
      *
      *  For remote databases, this method sends a message to the server to
@@ -616,6 +682,34 @@ class XAPIAN_VISIBILITY_DEFAULT Database {
      */
     Xapian::Database unlock();
 
+    /** Open another handle on this database for use by a different thread.
+     *
+     *  A Database object mustn't be used by several threads at once, but
+     *  opening a separate Database for each thread means each reads the
+     *  version file and opens every table file for itself.  The returned
+     *  object instead shares the open files with this one, and reads the
+     *  same revision, but has its own cursors, so the two objects can be
+     *  used concurrently from different threads.
+     *
+     *  Each object can subsequently be reopen()-ed or close()-d without
+     *  affecting the other.
+     *
+     *  Several threads may call clone() on the same object at once, provided
+     *  it isn't being otherwise used while they do.
+     *
+     *  Currently supported for read-only glass databases (except
+     *  single-file databases), and databases made up of such shards.
+     *
+     *  @exception Xapian::InvalidOperationError is thrown if called on a
+     *		   WritableDatabase.
+     *  @exception Xapian::UnimplementedError is thrown if the backend
+     *		   doesn't support this.
+     *
+     *  Experimental - see
+     *  https://xapian.org/docs/deprecation#experimental-features
+     */
+    Xapian::Database clone() const;
+
     /** Get the revision of the database.
      *
      *  The revision is an unsigned integer which increases with each commit.
@@ -1243,6 +1337,13 @@ class XAPIAN_VISIBILITY_DEFAULT WritableDatabase : public Database {
      *  document.add_term(unique_term) first when using replace_document()
      *  in this way.
      *
+     *  The glass backend remembers which document a term indexes once it
+     *  has looked it up, so calling this again with the same term on the
+     *  same WritableDatabase object is quicker.  The first call for each
+     *  term still looks it up in the database, and the remembered terms are
+     *  forgotten by cancel() or when the WritableDatabase is closed (and all
+     *  at once if very many terms are remembered).
+     *
      *  Note that changes to the database won't be immediately committed to
      *  disk; see commit() for more details.
      *
@@ -1261,6 +1362,61 @@ class XAPIAN_VISIBILITY_DEFAULT WritableDatabase : public Database {
     Xapian::docid replace_document(const std::string& unique_term,
 				   const Xapian::Document& document);
 
+    /** Replace several documents, each identified by a "unique" term.
+     *
+     *  This gives the same result as calling
+     *  replace_document(@a unique_terms[i], @a documents[i]) for each i,
+     *  with the calls made in ascending order of unique term (calls with the
+     *  same unique term are made in the order given, so the last document
+     *  for a term is the one which ends up in the database).  Making the
+     *  lookups in order is faster for a large batch, since successive terms
+     *  are found near each other in the database.
+     *
+     *  Note that this means new documents are allocated document IDs in
+     *  ascending order of their unique terms, rather than in the order
+     *  given.
+     *
+     *  @param unique_terms	The "unique" terms.
+     *  @param documents	The new documents, one for each unique term.
+     *
+     *  @return The document IDs used by the new documents, in the same
+     *		order as @a documents.
+     *
+     *  @exception Xapian::InvalidArgumentError is thrown if
+     *		   @a unique_terms and @a documents are different sizes, or
+     *		   any of the unique terms is empty.
+     *
+     *  Experimental - see
+     *  https://xapian.org/docs/deprecation#experimental-features
+     */
+    std::vector<Xapian::docid>
+    replace_documents(const std::vector<std::string>& unique_terms,
+		      const std::vector<Xapian::Document>& documents);
+
+    /** Set a value in a document in the database.
+     *
+     *  This gives the same result as reading the document, setting the value
+     *  in it and replacing the document with it, but backends can update
+     *  just the value without touching the document's terms or data.
+     *
+     *  Note that changes to the database won't be immediately committed to
+     *  disk; see commit() for more details.
+     *
+     *  @param did	The document ID of the document to change.
+     *  @param slot	The value slot to set.
+     *  @param value	The value to set.  If empty, any value in @a slot is
+     *			removed.
+     *
+     *  @exception Xapian::DocNotFoundError is thrown if document @a did
+     *		   doesn't exist.
+     *
+     *  Experimental - see
+     *  https://xapian.org/docs/deprecation#experimental-features
+     */
+    void set_document_value(Xapian::docid did,
+			    Xapian::valueno slot,
+			    const std::string& value);
+
     /** Add a word to the spelling dictionary.
      *
      *  If the word is already present, its frequency is increased.
@@ -27,6 +27,7 @@
 #endif
 
 #include <string>
+#include <vector>
 
 #include <xapian/constants.h>
 #include <xapian/database.h>
@@ -47,6 +48,11 @@ namespace Remote {
  * Access to the remote database is via a TCP connection to the specified
  * host and port.
  *
+ * If the environment variable XAPIAN_REMOTE_POOL_SIZE is set to a non-zero
+ * value, the connection is kept open when the database is closed (up to that
+ * many for each server) and reused by a later call for the same host and
+ * port, which saves connecting again.
+ *
  * @param host		hostname to connect to.
  * @param port		port number to connect to.
  * @param timeout	timeout in milliseconds.  If this timeout is exceeded
@@ -119,6 +125,35 @@ Database open(const std::string &program, const std::string &args, unsigned time
 XAPIAN_VISIBILITY_DEFAULT
 WritableDatabase open_writable(const std::string &program, const std::string &args, unsigned timeout = 0, int flags = 0);
 
+/** Use several remote databases as replicas of one shard.
+ *
+ *  A search is sent to the first database in @a dbs which isn't busy
+ *  finishing an abandoned search.  If it takes longer than usual to reply,
+ *  the search is also sent to another replica (a "hedged" request), and
+ *  whichever replies first is used.  Other operations (such as reading
+ *  documents) always use the first database.
+ *
+ *  How long counts as "longer than usual" is set by @a hedge_percentile and
+ *  based on recent reply times.  Searches aren't hedged until a few reply
+ *  times have been recorded.
+ *
+ *  Hedging is currently only supported on platforms with poll().
+ *
+ *  @param dbs		The remote databases, which should have the same
+ *			contents (e.g. replicated with xapian-replicate).
+ *			Each must be a single remote database, and apart
+ *			from dbs[0] none can have replicas of its own.
+ *  @param hedge_percentile	Percentile of recent reply times to wait for
+ *				before hedging, between 0 and 100 (default
+ *				95).
+ *
+ *  @return A Database for the shard.  This shares its internals with
+ *	    dbs[0], which will also hedge searches from now on.
+ */
+XAPIAN_VISIBILITY_DEFAULT
+Database replicated(const std::vector<Database>& dbs,
+		    double hedge_percentile = 95.0);
+
 }
 #endif
 
@@ -27,6 +27,9 @@
 # error Never use <xapian/enquire.h> directly; include <xapian.h> instead.
 #endif
 
+#include <exception>
+#include <functional>
+#include <future>
 #include <string>
 
 #include <xapian/attributes.h>
@@ -46,6 +49,7 @@ class KeyMaker;
 class MatchDecider;
 class MatchSpy;
 class Query;
+class Reranker;
 class RSet;
 class Weight;
 
@@ -358,6 +362,50 @@ class XAPIAN_VISIBILITY_DEFAULT Enquire {
      */
     void set_time_limit(double time_limit);
 
+    /** Set a time limit for remote shards to reply.
+     *
+     *  If a remote shard hasn't replied within @a time_limit seconds of the
+     *  search starting, get_mset() stops waiting for it and returns results
+     *  from the other shards.  Use MSet::shard_timed_out() to check which
+     *  shards (if any) are missing from the results.
+     *
+     *  @param time_limit  time in seconds (default: 0.0 which means wait for
+     *			   all shards, subject to the timeout each remote
+     *			   database was opened with)
+     *
+     *  Limitations:
+     *
+     *  This feature is currently only supported on platforms with poll().
+     *  The next operation on a shard which timed out will wait for it to
+     *  finish the abandoned search.
+     */
+    void set_shard_time_limit(double time_limit);
+
+    /** Set a second-phase reranker.
+     *
+     *  The top @a rerank_depth documents from the match are passed to
+     *  @a reranker, which assigns them new weights, and they are then sorted
+     *  by these new weights before the requested range of results is taken.
+     *  Documents ranked below @a rerank_depth by the match keep their
+     *  original weights and follow the reranked documents.
+     *
+     *  The candidates are all fetched from the match however far down the
+     *  requested range starts, so paging through results gives a consistent
+     *  ordering.
+     *
+     *  A reranker can only be used when sorting primarily by relevance -
+     *  get_mset() will throw Xapian::UnimplementedError otherwise.
+     *
+     *  @param reranker	The Reranker subclass to use, or NULL to stop
+     *			reranking.  The caller must ensure that this remains
+     *			valid while the Enquire object remains active, or
+     *			until set_reranker() is called again, or else disown
+     *			the Reranker object by calling reranker->release()
+     *			before passing it in.
+     *  @param rerank_depth	The number of documents to rerank.
+     */
+    void set_reranker(Reranker* reranker, doccount rerank_depth);
+
     /** Run the query.
      *
      *  Run the query using the settings in this Enquire object and those
@@ -409,6 +457,84 @@ class XAPIAN_VISIBILITY_DEFAULT Enquire {
 	return get_mset(first, maxitems, 0, rset, mdecider);
     }
 
+    /** Function which arranges for a task to be run.
+     *
+     *  Used by get_mset_async().  It may run the task in another thread, or
+     *  queue it to run later (for example, from an event loop).
+     */
+    typedef std::function<void(const std::function<void()>&)> executor_type;
+
+    /** Function to call when an asynchronous match finishes.
+     *
+     *  Used by get_mset_async().  The first parameter is the MSet, and the
+     *  second is the exception thrown by the match (or a null exception_ptr
+     *  if the match succeeded - the MSet is empty if not).
+     */
+    typedef std::function<void(MSet, std::exception_ptr)> callback_type;
+
+    /** Run the query asynchronously.
+     *
+     *  The match is run as a task passed to @a executor, and when it has
+     *  finished @a callback is called from that task.  If @a executor
+     *  runs the task in another thread, this method returns without
+     *  waiting for the match.
+     *
+     *  Until @a callback has returned, this Enquire object, the
+     *  Database it was constructed with and the objects set on it (such as
+     *  the query and the weighting scheme) mustn't be used, copied or
+     *  destroyed by any other thread.  To keep several queries in flight at
+     *  once, use a separate Enquire for each (Database::clone() can cheaply
+     *  provide a Database for each).
+     *
+     *  Remote shards are queried in parallel, as for get_mset().
+     *
+     *  @param executor	Arranges for the match to be run.
+     *  @param callback	Called with the result when the match finishes.
+     *
+     *  The remaining parameters are as for get_mset().  The RSet is copied,
+     *  but @a mdecider must remain valid until @a callback is called.
+     *
+     *  The MSet passed to @a callback refers to this Enquire's internals,
+     *  so if @a callback passes it to another thread, that thread shouldn't
+     *  use it until @a callback has returned.
+     *
+     *  Experimental - see
+     *  https://xapian.org/docs/deprecation#experimental-features
+     */
+    void get_mset_async(const executor_type& executor,
+			const callback_type& callback,
+			doccount first,
+			doccount maxitems,
+			doccount checkatleast = 0,
+			const RSet* rset = NULL,
+			const MatchDecider* mdecider = NULL) const;
+
+    /** Run the query asynchronously using a pool of threads.
+     *
+     *  This is a convenience wrapper around the get_mset_async() overload
+     *  which takes an executor and callback.  The same restrictions on the
+     *  use of this Enquire object apply until the returned std::future is
+     *  ready.
+     *
+     *  The pool is shared by all Enquire objects, and has at most one thread
+     *  per CPU (as reported by std::thread::hardware_concurrency()), started
+     *  as needed.  If all the threads are busy, the match waits for one to
+     *  become free.
+     *
+     *  The parameters are as for get_mset().
+     *
+     *  @return	A std::future which will hold the MSet (or the exception
+     *		thrown by the match).
+     *
+     *  Experimental - see
+     *  https://xapian.org/docs/deprecation#experimental-features
+     */
+    std::future<MSet> get_mset_async(doccount first,
+				     doccount maxitems,
+				     doccount checkatleast = 0,
+				     const RSet* rset = NULL,
+				     const MatchDecider* mdecider = NULL) const;
+
     /** Iterate query terms matching a document.
      *
      *  Takes terms from the query set by @a set_query() and from the document
@@ -0,0 +1,186 @@
+/** @file indexingpipeline.h
+ * @brief Index documents using several threads
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_INDEXINGPIPELINE_H
+#define XAPIAN_INCLUDED_INDEXINGPIPELINE_H
+
+#if !defined XAPIAN_IN_XAPIAN_H && !defined XAPIAN_LIB_BUILD
+# error Never use <xapian/indexingpipeline.h> directly; include <xapian.h> instead.
+#endif
+
+#include <xapian/intrusive_ptr.h>
+#include <xapian/types.h>
+#include <xapian/visibility.h>
+
+#include <functional>
+#include <string>
+
+namespace Xapian {
+
+class Document;
+class TermGenerator;
+class WritableDatabase;
+
+/** Index documents using several threads.
+ *
+ *  Documents are built by a pool of worker threads, each with its own
+ *  TermGenerator, and a single writer thread adds them to the database.  The
+ *  writer applies the updates in the order they were submitted, so docids are
+ *  assigned just as if add_document() and replace_document() had been called
+ *  on the database directly in that order.
+ *
+ *  The number of documents which have been submitted but not yet written is
+ *  limited, so submitting a document blocks while the pipeline is full.
+ *
+ *  While a pipeline is active, the database it writes to mustn't be used
+ *  by other code (except via a separate Database object opened on the same
+ *  path).  The pipeline object itself should only be used from one thread.
+ *
+ *  Experimental - see
+ *  https://xapian.org/docs/deprecation#experimental-features
+ */
+class XAPIAN_VISIBILITY_DEFAULT IndexingPipeline {
+    /// Don't allow assignment.
+    void operator=(const IndexingPipeline&) = delete;
+
+    /// Don't allow copying.
+    IndexingPipeline(const IndexingPipeline&) = delete;
+
+  public:
+    /// @private @internal Class representing the IndexingPipeline internals.
+    class Internal;
+    /// @private @internal Reference counted internals.
+    Xapian::Internal::intrusive_ptr_nonnull<Internal> internal;
+
+    /** Function to configure the TermGenerator for a worker thread.
+     *
+     *  This is called once in each worker thread before it builds any
+     *  documents.  Since the workers run at the same time, any objects it
+     *  gives the TermGenerator (such as a Stem or a Stopper) should be
+     *  created by the call rather than shared between workers.  Don't call
+     *  TermGenerator::set_database() as the database is in use by the
+     *  writer thread.
+     */
+    typedef std::function<void(Xapian::TermGenerator&)> setup_type;
+
+    /** Function to build a document.
+     *
+     *  This is called in a worker thread with a TermGenerator which has been
+     *  set up with the setup function and has the document to build as its
+     *  current document (with the term position reset to 0).  It should
+     *  index the text and set any data and values.
+     */
+    typedef std::function<void(Xapian::TermGenerator&, Xapian::Document&)>
+	    builder_type;
+
+    /** Construct an IndexingPipeline.
+     *
+     *  @param db		The database to add documents to.
+     *  @param setup		Function to configure the TermGenerator for
+     *				each worker (default: leave it unconfigured).
+     *  @param n_workers	Number of worker threads to build documents
+     *				(default: 0, meaning the number of CPUs).
+     *  @param max_pending	The maximum number of documents submitted but
+     *				not yet written (default: 0, meaning 16 per
+     *				worker).
+     */
+    explicit
+    IndexingPipeline(const Xapian::WritableDatabase& db,
+		     const setup_type& setup = setup_type(),
+		     unsigned n_workers = 0,
+		     Xapian::doccount max_pending = 0);
+
+    /** Destructor.
+     *
+     *  Waits for all the submitted documents to be written, then stops the
+     *  threads.  Any error is ignored - call finish() first if you want to
+     *  know about it.  The database isn't committed by the pipeline.
+     */
+    ~IndexingPipeline();
+
+    /** Add a new document.
+     *
+     *  @param builder	Function to build the document.
+     *
+     *  If building or writing an earlier document has failed, its exception
+     *  is thrown here (see finish()) and this document isn't added.
+     */
+    void add_document(const builder_type& builder);
+
+    /** Replace a document by docid.
+     *
+     *  Like WritableDatabase::replace_document(did, doc), once the document
+     *  has been built.
+     *
+     *  @param did	The docid of the document to replace.
+     *  @param builder	Function to build the document.
+     */
+    void replace_document(Xapian::docid did, const builder_type& builder);
+
+    /** Replace any documents indexed by a unique term.
+     *
+     *  Like WritableDatabase::replace_document(unique_term, doc), once the
+     *  document has been built.  Note that the builder must add
+     *  @a unique_term to the document itself if it wants it there.
+     *
+     *  @param unique_term	The term identifying the documents to replace.
+     *  @param builder		Function to build the document.
+     */
+    void replace_document(const std::string& unique_term,
+			  const builder_type& builder);
+
+    /** Wait for all the submitted documents to be written.
+     *
+     *  The database isn't committed (call WritableDatabase::commit() after
+     *  this to do that).
+     *
+     *  If building or writing a document fails, the pipeline discards the
+     *  documents queued after it, and the first exception is rethrown by the
+     *  next call to finish(), add_document() or replace_document().  The
+     *  pipeline can continue to be used after that.
+     */
+    void finish();
+
+    /// Number of documents which have been submitted.
+    Xapian::doccount get_submitted_count() const;
+
+    /// Number of documents which have been built by the workers.
+    Xapian::doccount get_built_count() const;
+
+    /// Number of documents which have been written to the database.
+    Xapian::doccount get_written_count() const;
+
+    /** Total time the workers have spent building documents.
+     *
+     *  In seconds, summed over all the workers.
+     */
+    double get_build_time() const;
+
+    /** Total time the writer has spent updating the database.
+     *
+     *  In seconds.  If this is close to the elapsed time, the writer is the
+     *  bottleneck and more workers won't help.
+     */
+    double get_write_time() const;
+};
+
+}
+
+#endif // XAPIAN_INCLUDED_INDEXINGPIPELINE_H
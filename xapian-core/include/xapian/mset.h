@@ -234,6 +234,16 @@ class XAPIAN_VISIBILITY_DEFAULT MSet {
     /** The maximum possible weight any document could achieve. */
     double get_max_possible() const;
 
+    /** Did a shard fail to reply in time?
+     *
+     *  If Enquire::set_shard_time_limit() was used, this returns true for
+     *  each remote shard which didn't reply in time, and so isn't included
+     *  in the results (or the statistics such as get_matches_estimated()).
+     *
+     *  @param shard	The index of the shard in the Database searched.
+     */
+    bool shard_timed_out(Xapian::doccount shard) const;
+
     enum {
 	/** Model the relevancy of non-query terms in MSet::snippet().
 	 *
@@ -326,39 +336,49 @@ class XAPIAN_VISIBILITY_DEFAULT MSet {
 			const std::string & hi_end = "</b>",
 			const std::string & omit = "...") const;
 
-    /** Prefetch hint a range of items.
+    /** Prefetch a range of items.
+     *
+     *  The data and values of the requested documents are read in a single
+     *  batch (for a remote database, in a single exchange with each remote
+     *  server; for a disk-based database, in docid order) and kept in this
+     *  MSet.  A subsequent call to MSetIterator::get_document() for one of
+     *  them returns the fetched document without further access to the
+     *  database.  The MSet keeps the document, so every such call returns
+     *  the same Document object (modifying it affects later calls).
      *
-     *  For a remote database, this may start a pipelined fetch of the
-     *  requested documents from the remote server.
+     *  For a writable database, the documents could be modified before
+     *  they're used, so this is just a hint to start reading them.
      *
-     *  For a disk-based database, this may send prefetch hints to the
-     *  operating system such that the disk blocks the requested documents
-     *  are stored in are more likely to be in the cache when we come to
-     *  actually read them.
+     *  @param begin	The first item to fetch.
+     *  @param end	The item after the last to fetch.
      */
     void fetch(const MSetIterator &begin, const MSetIterator &end) const;
 
-    /** Prefetch hint a single MSet item.
+    /** Prefetch a single MSet item.
      *
-     *  For a remote database, this may start a pipelined fetch of the
-     *  requested documents from the remote server.
+     *  The data and values of the requested document are read and kept in
+     *  this MSet.  A subsequent call to MSetIterator::get_document() for it
+     *  returns the fetched document without further access to the database.
+     *  The MSet keeps the document, so every such call returns the same
+     *  Document object (modifying it affects later calls).
      *
-     *  For a disk-based database, this may send prefetch hints to the
-     *  operating system such that the disk blocks the requested documents
-     *  are stored in are more likely to be in the cache when we come to
-     *  actually read them.
+     *  For a writable database, the document could be modified before it's
+     *  used, so this is just a hint to start reading it.
      */
     void fetch(const MSetIterator &item) const;
 
-    /** Prefetch hint the whole MSet.
+    /** Prefetch the whole MSet.
      *
-     *  For a remote database, this may start a pipelined fetch of the
-     *  requested documents from the remote server.
+     *  The data and values of the requested documents are read in a single
+     *  batch (for a remote database, in a single exchange with each remote
+     *  server; for a disk-based database, in docid order) and kept in this
+     *  MSet.  A subsequent call to MSetIterator::get_document() for one of
+     *  them returns the fetched document without further access to the
+     *  database.  The MSet keeps the document, so every such call returns
+     *  the same Document object (modifying it affects later calls).
      *
-     *  For a disk-based database, this may send prefetch hints to the
-     *  operating system such that the disk blocks the requested documents
-     *  are stored in are more likely to be in the cache when we come to
-     *  actually read them.
+     *  For a writable database, the documents could be modified before
+     *  they're used, so this is just a hint to start reading them.
      */
     void fetch() const { fetch_(0, Xapian::doccount(-1)); }
 
@@ -662,13 +682,18 @@ operator+(MSetIterator::difference_type n, const MSetIterator& it)
 inline void
 MSet::fetch(const MSetIterator &begin_it, const MSetIterator &end_it) const
 {
-    fetch_(begin_it.off_from_end, end_it.off_from_end);
+    // Convert from offsets from the end to indices (fetch_() takes an
+    // inclusive range).
+    if (begin_it.off_from_end > end_it.off_from_end) {
+	fetch_(size() - begin_it.off_from_end, size() - end_it.off_from_end - 1);
+    }
 }
 
 inline void
 MSet::fetch(const MSetIterator &item) const
 {
-    fetch_(item.off_from_end, item.off_from_end);
+    Xapian::doccount index = size() - item.off_from_end;
+    fetch_(index, index);
 }
 
 inline MSetIterator
@@ -327,7 +327,32 @@ class XAPIAN_VISIBILITY_DEFAULT Query {
 	 *
 	 *  @since Added in Xapian 1.5.0.
 	 */
-	WILDCARD_PATTERN_GLOB = WILDCARD_PATTERN_MULTI|WILDCARD_PATTERN_SINGLE
+	WILDCARD_PATTERN_GLOB = WILDCARD_PATTERN_MULTI|WILDCARD_PATTERN_SINGLE,
+
+	/** Expand OP_WILDCARD using a trigram index of the terms.
+	 *
+	 *  Patterns with a leading or infix wildcard can't use the sorted
+	 *  order of the term dictionary, so normally have to test every
+	 *  term (or every term starting with the fixed prefix).  With this
+	 *  flag, an index mapping character trigrams to terms is used to
+	 *  find the candidate terms instead, so the time taken is roughly
+	 *  proportional to the number of terms containing the pattern's
+	 *  rarest trigram.
+	 *
+	 *  The index is built in memory for each database shard (which
+	 *  requires a scan of all the terms, and memory proportional to the
+	 *  total size of the terms) once a few wildcard expansions have asked
+	 *  for it, and built again in the same way after the shard's
+	 *  revision changes (e.g. by Database::reopen()).  Expansions before
+	 *  then scan the terms, so this is most suitable for long-lived
+	 *  read-only databases.  It is not used for writable
+	 *  databases, or for patterns without at least one literal fragment
+	 *  of three or more bytes (counting the start and end of the term
+	 *  as a byte each) - such cases fall back to scanning the terms.
+	 *
+	 *  @since Added in Xapian 1.5.0.
+	 */
+	WILDCARD_USE_NGRAM_INDEX = 0x40
     };
 
     /** Construct a query matching no documents.
@@ -475,6 +500,10 @@ class XAPIAN_VISIBILITY_DEFAULT Query {
      *			  start with the pattern interpreted as a literal
      *			  string.
      *
+     *			* For OP_WILDCARD: Optionally
+     *			  @a WILDCARD_USE_NGRAM_INDEX to expand the pattern
+     *			  using a trigram index of the terms.
+     *
      *	@param combiner The @a Query::op to combine the terms with - one of
      *			@a OP_SYNONYM (the default), @a OP_OR or @a OP_MAX.
      *
@@ -0,0 +1,179 @@
+/** @file reranker.h
+ * @brief Second-phase reranking of the top matching documents.
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_RERANKER_H
+#define XAPIAN_INCLUDED_RERANKER_H
+
+#if !defined XAPIAN_IN_XAPIAN_H && !defined XAPIAN_LIB_BUILD
+# error Never use <xapian/reranker.h> directly; include <xapian.h> instead.
+#endif
+
+#include <string>
+#include <vector>
+
+#include <xapian/database.h>
+#include <xapian/intrusive_ptr.h>
+#include <xapian/query.h>
+#include <xapian/types.h>
+#include <xapian/visibility.h>
+
+namespace Xapian {
+
+/** The candidate documents passed to a Reranker.
+ *
+ *  The candidates are in the order the first phase of the match ranked them.
+ *
+ *  The term and collection statistics are those already calculated for the
+ *  match.  The postlists used by the match have been released by the time
+ *  the candidates are known, so the doclengths and query term wdfs are read
+ *  afterwards - all the candidates are handled together, with one pass in
+ *  docid order over each query term's postings, so a Reranker can compute
+ *  features without fetching each document.
+ */
+class XAPIAN_VISIBILITY_DEFAULT RerankCandidates {
+  public:
+    /// Class representing the RerankCandidates internals.
+    class Internal;
+
+  private:
+    /// @private @internal The internals.
+    const Internal& internal;
+
+    /// Don't allow assignment.
+    void operator=(const RerankCandidates &) = delete;
+
+    /// Don't allow copying.
+    RerankCandidates(const RerankCandidates &) = delete;
+
+  public:
+    /// @private @internal Wrap an internal object.
+    explicit RerankCandidates(const Internal& internal_)
+	: internal(internal_) { }
+
+    /// Return the number of candidates.
+    Xapian::doccount size() const;
+
+    /// Return the docid of candidate @a i.
+    Xapian::docid get_docid(Xapian::doccount i) const;
+
+    /// Return the weight the first phase of the match gave candidate @a i.
+    double get_weight(Xapian::doccount i) const;
+
+    /// Return the length of candidate @a i.
+    Xapian::termcount get_doclength(Xapian::doccount i) const;
+
+    /** Return the unique terms in the query.
+     *
+     *  These are in ascending byte order, and their indices in this list are
+     *  used to identify them to get_wdf(), get_termfreq() and
+     *  get_collection_freq().
+     */
+    const std::vector<std::string>& get_terms() const;
+
+    /** Return the wdf of a query term in candidate @a i.
+     *
+     *  @param i	The candidate.
+     *  @param term_index	The index of the term in get_terms().
+     */
+    Xapian::termcount get_wdf(Xapian::doccount i,
+			      Xapian::termcount term_index) const;
+
+    /// Return the number of documents indexed by a query term.
+    Xapian::doccount get_termfreq(Xapian::termcount term_index) const;
+
+    /// Return the number of occurrences of a query term in the collection.
+    Xapian::termcount get_collection_freq(Xapian::termcount term_index) const;
+
+    /// Return the number of documents in the collection.
+    Xapian::doccount get_doccount() const;
+
+    /// Return the total length of all the documents in the collection.
+    Xapian::totallength get_total_length() const;
+
+    /// Return the database being searched.
+    const Xapian::Database& get_database() const;
+
+    /// Return the query being run.
+    const Xapian::Query& get_query() const;
+};
+
+/** Base class for second-phase rerankers.
+ *
+ *  A Reranker set with Enquire::set_reranker() is applied to the top
+ *  candidates from the match before the MSet is returned, reusing the
+ *  statistics from the match (see RerankCandidates for which).  This is more
+ *  efficient than reranking the MSet afterwards, and means the requested
+ *  page of results is taken from the reranked order.
+ */
+class XAPIAN_VISIBILITY_DEFAULT Reranker
+    : public Xapian::Internal::opt_intrusive_base {
+    /// Don't allow assignment.
+    void operator=(const Reranker &) = delete;
+
+    /// Don't allow copying.
+    Reranker(const Reranker &) = delete;
+
+  public:
+    /// Default constructor.
+    Reranker() { }
+
+    /** Virtual destructor, because we have virtual methods. */
+    virtual ~Reranker();
+
+    /** Compute new weights for the candidates.
+     *
+     *  @param candidates	The candidates to rerank.
+     *  @param weights		On entry, the weights from the first phase
+     *				of the match (weights[i] being the weight of
+     *				candidate i).  Set each entry to the new weight
+     *				for that candidate - the candidates will then
+     *				be sorted by these.
+     */
+    virtual void operator()(const RerankCandidates& candidates,
+			    std::vector<double>& weights) const = 0;
+
+    /** Start reference counting this object.
+     *
+     *  You can hand ownership of a dynamically allocated Reranker
+     *  object to Xapian by calling release() and then passing the object to a
+     *  Xapian method.  Xapian will arrange to delete the object once it is no
+     *  longer required.
+     */
+    Reranker * release() {
+	opt_intrusive_base::release();
+	return this;
+    }
+
+    /** Start reference counting this object.
+     *
+     *  You can hand ownership of a dynamically allocated Reranker
+     *  object to Xapian by calling release() and then passing the object to a
+     *  Xapian method.  Xapian will arrange to delete the object once it is no
+     *  longer required.
+     */
+    const Reranker * release() const {
+	opt_intrusive_base::release();
+	return this;
+    }
+};
+
+}
+
+#endif // XAPIAN_INCLUDED_RERANKER_H
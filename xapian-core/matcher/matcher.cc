@@ -24,6 +24,7 @@
 
 #include "api/enquireinternal.h"
 #include "api/msetinternal.h"
+#include "api/rerankerinternal.h"
 #include "api/rsetinternal.h"
 #include "backends/multi/multi_database.h"
 #include "deciderpostlist.h"
@@ -32,6 +33,7 @@
 #include "omassert.h"
 #include "postlisttree.h"
 #include "protomset.h"
+#include "realtime.h"
 #include "spymaster.h"
 #include "valuestreamdocument.h"
 #include "weight/weightinternal.h"
@@ -46,6 +48,7 @@
 #include <algorithm>
 #include <cerrno>
 #include <cfloat> // For DBL_EPSILON.
+#include <cmath>
 #include <vector>
 
 #ifdef HAVE_POLL_H
@@ -75,52 +78,89 @@ inline void
 Matcher::for_all_remotes(Action action)
 {
 #ifdef HAVE_POLL
-    size_t n_remotes = remotes.size();
-    if (n_remotes <= 1) {
-	// We only need to use poll() when there are at least 2 remote
-	// databases we need to wait for.
-	if (n_remotes == 1) {
+    // The remotes we're still waiting for.
+    vector<RemoteSubMatch*> waiting;
+    waiting.reserve(remotes.size());
+    for (auto&& submatch : remotes) {
+	if (!submatch->timed_out()) waiting.push_back(submatch.get());
+    }
+
+    vector<struct pollfd> fds;
+    // The remote and attempt each entry in fds is for.
+    vector<pair<RemoteSubMatch*, size_t>> fd_attempts;
+    while (!waiting.empty()) {
+	// Work out how long we can wait for, hedging any remotes which have
+	// been slow to reply.
+	double now = RealTime::now();
+	if (shard_deadline != 0.0 && now >= shard_deadline) {
+	    for (auto submatch : waiting) {
+		submatch->time_out();
+	    }
+	    return;
+	}
+	double wake_time = shard_deadline;
+	for (auto submatch : waiting) {
+	    double hedge_time = submatch->get_hedge_time();
+	    if (hedge_time == 0.0) continue;
+	    if (hedge_time <= now) {
+		submatch->hedge();
+		hedge_time = submatch->get_hedge_time();
+		if (hedge_time == 0.0) continue;
+	    }
+	    if (wake_time == 0.0 || hedge_time < wake_time)
+		wake_time = hedge_time;
+	}
+
+	if (waiting.size() == 1 && wake_time == 0.0 &&
+	    waiting[0]->get_attempt_count() == 1) {
 	    // Just execute action and block if it's not ready.
-	    action(remotes[0].get());
+	    if (waiting[0]->ready(0)) {
+		action(waiting[0]);
+		return;
+	    }
+	    continue;
 	}
-	return;
-    }
 
-    unique_ptr<struct pollfd[]> fds(new struct pollfd[n_remotes]);
-    for (size_t i = 0; i != n_remotes; ++i) {
-	fds[i].fd = remotes[i]->get_read_fd();
-	fds[i].events = POLLIN;
-	fds[i].revents = 0;
-    }
-    do {
-	int r = poll(fds.get(), n_remotes, -1);
+	fds.clear();
+	fd_attempts.clear();
+	for (auto submatch : waiting) {
+	    for (size_t i = 0; i != submatch->get_attempt_count(); ++i) {
+		struct pollfd fd;
+		fd.fd = submatch->get_read_fd(i);
+		fd.events = POLLIN;
+		fd.revents = 0;
+		fds.push_back(fd);
+		fd_attempts.emplace_back(submatch, i);
+	    }
+	}
+
+	int timeout_ms = -1;
+	if (wake_time != 0.0) {
+	    // Round up so we don't wake just before wake_time.
+	    timeout_ms = int(ceil((wake_time - now) * 1000.0));
+	}
+	int r = poll(fds.data(), fds.size(), timeout_ms);
 	if (r <= 0) {
-	    // We shouldn't get a timeout, but if we do retry.
+	    // On timeout loop round to hedge or give up as appropriate.
 	    if (r == 0 || errno == EINTR || errno == EAGAIN) {
 		continue;
 	    }
 	    throw Xapian::NetworkError("poll() failed waiting for remotes",
 				       errno);
 	}
-	size_t i = 0;
-	while (i != n_remotes) {
-	    if (fds[i].revents) {
-		action(remotes[i].get());
-		// Swap such that entries we still need to handle are first.
-		swap(remotes[i], remotes[--n_remotes]);
-		fds[i] = fds[n_remotes];
-		// r is number of ready fds.
-		if (--r == 0) break;
-	    } else {
-		++i;
+	RemoteSubMatch* handled = NULL;
+	for (size_t j = 0; j != fds.size(); ++j) {
+	    if (!fds[j].revents) continue;
+	    RemoteSubMatch* submatch = fd_attempts[j].first;
+	    // ready() can change which attempts a remote has, so only handle
+	    // one attempt per remote each time round.
+	    if (submatch == handled) continue;
+	    handled = submatch;
+	    if (submatch->ready(fd_attempts[j].second)) {
+		action(submatch);
+		waiting.erase(find(waiting.begin(), waiting.end(), submatch));
 	    }
 	}
-    } while (n_remotes > 1);
-
-    // If there's only one remote left just execute action and block if it's
-    // not ready.
-    if (n_remotes == 1) {
-	action(remotes[0].get());
     }
 #else
 #ifndef __WIN32__
@@ -192,6 +232,7 @@ Matcher::Matcher(const Xapian::Database& db_,
 		 Xapian::Enquire::Internal::sort_setting sort_by,
 		 bool sort_val_reverse,
 		 double time_limit,
+		 double shard_time_limit,
 		 const vector<opt_intrusive_ptr<Xapian::MatchSpy>>& matchspies)
     : db(db_), query(query_), full_db_has_positions(full_db_has_positions_)
 {
@@ -199,6 +240,10 @@ Matcher::Matcher(const Xapian::Database& db_,
     Assert(!query.empty());
 
     Xapian::doccount n_shards = db.internal->size();
+    if (n_shards > 1) {
+	// We access the shards directly below.
+	static_cast<const MultiDatabase*>(db.internal.get())->sync_writers();
+    }
     vector<Xapian::RSet> subrsets;
     if (rset && rset->internal.get()) {
 	rset->internal->shard(n_shards, subrsets);
@@ -220,16 +265,20 @@ Matcher::Matcher(const Xapian::Database& db_,
 		unimplemented("Xapian::MatchDecider not supported by the "
 			      "remote backend");
 	    }
-	    as_rem->set_query(query, query_length,
-			      collapse_key, collapse_max,
-			      order, sort_key, sort_by, sort_val_reverse,
-			      time_limit,
-			      n_shards == 1 ? percent_threshold : 0,
-			      weight_threshold,
-			      wtscheme,
-			      subrsets[i], matchspies,
-			      full_db_has_positions);
-	    remotes.emplace_back(new RemoteSubMatch(as_rem, i));
+	    string message =
+		RemoteDatabase::serialise_query(query, query_length,
+						collapse_key, collapse_max,
+						order, sort_key, sort_by,
+						sort_val_reverse,
+						time_limit,
+						n_shards == 1 ?
+						    percent_threshold : 0,
+						weight_threshold,
+						wtscheme,
+						subrsets[i], matchspies,
+						full_db_has_positions);
+	    remotes.emplace_back(new RemoteSubMatch(as_rem, i,
+						    std::move(message)));
 	    continue;
 	}
 #else
@@ -244,6 +293,7 @@ Matcher::Matcher(const Xapian::Database& db_,
 	(void)sort_by;
 	(void)sort_val_reverse;
 	(void)time_limit;
+	(void)shard_time_limit;
 	(void)matchspies;
 #endif /* XAPIAN_HAS_REMOTE_BACKEND */
 	if (locals.size() != i)
@@ -259,6 +309,7 @@ Matcher::Matcher(const Xapian::Database& db_,
 	locals.resize(n_shards);
 
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
+    shard_deadline = RealTime::end_time(shard_time_limit);
 # ifndef HAVE_POLL
 #  ifndef __WIN32__
     {
@@ -539,7 +590,8 @@ Matcher::get_mset(Xapian::doccount first,
     Assert(!query.empty());
 
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
-    if (locals.empty() && remotes.size() == 1) {
+    if (locals.empty() && remotes.size() == 1 && shard_deadline == 0.0 &&
+	!remotes[0]->has_replicas()) {
 	// Short cut for a single remote database.
 	Assert(remotes[0].get());
 	remotes[0]->start_match(first, maxitems, check_at_least, sorter,
@@ -640,6 +692,13 @@ Matcher::get_mset(Xapian::doccount first,
 	    msets.push_back({remote_mset, 0});
 	});
 
+    for (auto&& submatch : remotes) {
+	if (submatch->timed_out()) {
+	    merged_mset.internal->timed_out_shards.push_back(
+		submatch->get_shard());
+	}
+    }
+
     if (!locals.empty()) {
 	if (!local_mset.empty())
 	    msets.push_back({local_mset, 0});
@@ -797,3 +856,72 @@ Matcher::get_mset(Xapian::doccount first,
     return local_mset;
 #endif
 }
+
+void
+Matcher::rerank(Xapian::MSet& mset,
+		const Xapian::Reranker& reranker,
+		Xapian::doccount rerank_depth,
+		const Xapian::Weight::Internal& stats,
+		Xapian::doccount first,
+		Xapian::doccount maxitems,
+		Xapian::Enquire::docid_order order,
+		Xapian::Enquire::Internal::sort_setting sort_by,
+		bool sort_val_reverse) const
+{
+    auto mseti = mset.internal;
+    auto& items = mseti->items;
+    AssertEq(mseti->first, 0);
+
+    Xapian::doccount n = min(rerank_depth, Xapian::doccount(items.size()));
+    if (n != 0) {
+	vector<double> weights;
+	weights.reserve(n);
+	for (Xapian::doccount i = 0; i != n; ++i) {
+	    weights.push_back(items[i].get_weight());
+	}
+	{
+	    Xapian::RerankCandidates::Internal candidates(db, query, stats,
+							  items, n);
+	    reranker(Xapian::RerankCandidates(candidates), weights);
+	}
+	if (weights.size() != n) {
+	    throw Xapian::InvalidOperationError("Reranker changed the number "
+						"of weights");
+	}
+
+	double old_top = items[0].get_weight();
+	for (Xapian::doccount i = 0; i != n; ++i) {
+	    items[i].set_weight(weights[i]);
+	}
+	bool sort_forward = (order != Xapian::Enquire::DESCENDING);
+	stable_sort(items.begin(), items.begin() + n,
+		    get_msetcmp_function(sort_by, sort_forward,
+					 sort_val_reverse));
+
+	// Scale percentages so the top document keeps the percentage the
+	// first phase gave the document it ranked top.
+	double new_top = items[0].get_weight();
+	if (mseti->percent_scale_factor != 0.0 && old_top > 0.0 &&
+	    new_top > 0.0) {
+	    mseti->percent_scale_factor *= old_top / new_top;
+	}
+
+	double max_attained = 0.0;
+	for (auto&& item : items) {
+	    max_attained = max(max_attained, item.get_weight());
+	}
+	mseti->max_attained = max_attained;
+	// We can't know the highest weight the reranker could assign.
+	mseti->max_possible = max(mseti->max_possible, max_attained);
+    }
+
+    // Now select the range of results which was asked for.
+    if (first >= items.size()) {
+	items.clear();
+    } else {
+	items.erase(items.begin(), items.begin() + first);
+	if (items.size() > maxitems)
+	    items.erase(items.begin() + maxitems, items.end());
+    }
+    mseti->set_first(first);
+}
@@ -40,6 +40,7 @@ namespace Xapian {
     class KeyMaker;
     class MatchDecider;
     class MSet;
+    class Reranker;
     class Weight;
 }
 
@@ -78,6 +79,13 @@ class Matcher {
      */
     std::size_t first_oversize;
 # endif
+
+    /** When to give up waiting for remote shards (0.0 for never).
+     *
+     *  Remote shards which haven't replied by this time are left out of the
+     *  results.  This is only supported if poll() is available.
+     */
+    double shard_deadline = 0.0;
 #endif
 
     bool full_db_has_positions;
@@ -104,7 +112,11 @@ class Matcher {
 				double time_limit,
 				const std::vector<opt_ptr_spy>& matchspies);
 
-    /// Perform action on remotes as they become ready using poll() or select().
+    /** Perform action on remotes as they become ready using poll() or select().
+     *
+     *  When using poll(), this also hedges searches on remotes with replicas,
+     *  and gives up on remotes which haven't replied by @a shard_deadline.
+     */
     template<typename Action> void for_all_remotes(Action action);
 
   public:
@@ -130,6 +142,8 @@ class Matcher {
      *  @param sort_val_reverse	Reverse direction keys sort in?
      *  @param time_limit	time in seconds after which to disable
      *				check_at_least (0.0 means don't).
+     *  @param shard_time_limit	time in seconds after which to stop waiting
+     *				for remote shards (0.0 means don't).
      *  @param matchspies	MatchSpy objects to use
      */
     Matcher(const Xapian::Database& db_,
@@ -149,6 +163,7 @@ class Matcher {
 	    Xapian::Enquire::Internal::sort_setting sort_by,
 	    bool sort_val_reverse,
 	    double time_limit,
+	    double shard_time_limit,
 	    const std::vector<opt_ptr_spy>& matchspies);
 
     /** Run the match and produce an MSet object.
@@ -204,6 +219,32 @@ class Matcher {
 			  bool sort_val_reverse,
 			  double time_limit,
 			  const std::vector<opt_ptr_spy>& matchspies);
+
+    /** Apply a second-phase reranker and select the requested results.
+     *
+     *  @param mset		MSet from get_mset(), which must have been
+     *				called with first of 0 and maxitems large
+     *				enough to cover both @a rerank_depth and the
+     *				requested range.
+     *  @param reranker		Reranker to apply
+     *  @param rerank_depth	Number of top documents to rerank
+     *  @param stats		Collated stats for the match
+     *  @param first		Zero-based index of the first result to return
+     *				after reranking
+     *  @param maxitems		The maximum number of documents to return
+     *  @param order		Xapian::docid sort order
+     *  @param sort_by		What to sort results on (REL or REL_VAL)
+     *  @param sort_val_reverse	Reverse direction keys sort in?
+     */
+    void rerank(Xapian::MSet& mset,
+		const Xapian::Reranker& reranker,
+		Xapian::doccount rerank_depth,
+		const Xapian::Weight::Internal& stats,
+		Xapian::doccount first,
+		Xapian::doccount maxitems,
+		Xapian::Enquire::docid_order order,
+		Xapian::Enquire::Internal::sort_setting sort_by,
+		bool sort_val_reverse) const;
 };
 
 #endif // XAPIAN_INCLUDED_MATCHER_H
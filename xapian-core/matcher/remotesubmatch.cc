@@ -25,16 +25,122 @@
 
 #include "debuglog.h"
 #include "backends/remote/remote-database.h"
+#include "omassert.h"
+#include "realtime.h"
 #include "weight/weightinternal.h"
 
 using namespace std;
 
+RemoteSubMatch::RemoteSubMatch(const RemoteDatabase* db_,
+			       Xapian::doccount shard_,
+			       string&& query_message_)
+    : db(db_), shard(shard_), query_message(std::move(query_message_))
+{
+    // Send the query to the first database in the group which isn't still
+    // busy with an abandoned search (if they all are, the first).
+    size_t n_replicas = db->get_replica_count();
+    const RemoteDatabase* first = db;
+    if (first->is_busy()) {
+	for (size_t i = 0; i != n_replicas; ++i) {
+	    if (!db->get_replica(i)->is_busy()) {
+		first = db->get_replica(i);
+		break;
+	    }
+	}
+    }
+    if (first != db) untried.push_back(db);
+    for (size_t i = 0; i != n_replicas; ++i) {
+	auto replica = db->get_replica(i);
+	if (replica != first) untried.push_back(replica);
+    }
+
+    double now = RealTime::now();
+    first->send_query(query_message);
+    attempts.emplace_back(first, true, now);
+    set_hedge_time(now);
+}
+
+void
+RemoteSubMatch::set_hedge_time(double now)
+{
+    hedge_time = 0.0;
+    if (untried.empty()) return;
+    double delay = db->get_hedge_delay(phase);
+    if (delay > 0.0) hedge_time = now + delay;
+}
+
+void
+RemoteSubMatch::abandon(const Attempt& attempt)
+{
+    if (attempt.awaiting_stats) {
+	attempt.db->abandon_query();
+    }
+    // Otherwise the reply with the results will be discarded when the next
+    // message is sent.
+}
+
+void
+RemoteSubMatch::hedge()
+{
+    LOGCALL_VOID(MATCH, "RemoteSubMatch::hedge", NO_ARGS);
+    Assert(!untried.empty());
+    const RemoteDatabase* replica = untried.front();
+    untried.erase(untried.begin());
+    double now = RealTime::now();
+    // If we're waiting for the results, ready() sends the global stats once
+    // the replica has sent its statistics.
+    replica->send_query(query_message);
+    attempts.emplace_back(replica, true, now);
+    set_hedge_time(now);
+}
+
+bool
+RemoteSubMatch::ready(size_t i)
+{
+    LOGCALL(MATCH, bool, "RemoteSubMatch::ready", i);
+    Attempt& attempt = attempts[i];
+    if (phase == 1 && attempt.awaiting_stats) {
+	// A replica we hedged with while waiting for the results.  We already
+	// have the global statistics so just discard its statistics.
+	Xapian::Weight::Internal dummy;
+	attempt.db->get_remote_stats(dummy);
+	attempt.db->send_global_stats(stats_message);
+	attempt.awaiting_stats = false;
+	RETURN(false);
+    }
+    if (attempts.size() > 1) {
+	for (size_t j = 0; j != attempts.size(); ++j) {
+	    if (j != i) abandon(attempts[j]);
+	}
+	if (i != 0) attempts[0] = attempt;
+	attempts.erase(attempts.begin() + 1, attempts.end());
+    }
+    hedge_time = 0.0;
+    RETURN(true);
+}
+
+void
+RemoteSubMatch::time_out()
+{
+    LOGCALL_VOID(MATCH, "RemoteSubMatch::time_out", NO_ARGS);
+    for (auto&& attempt : attempts) {
+	abandon(attempt);
+    }
+    attempts.clear();
+    hedge_time = 0.0;
+    timed_out_ = true;
+}
+
 void
 RemoteSubMatch::prepare_match(Xapian::Weight::Internal& total_stats)
 {
     LOGCALL_VOID(MATCH, "RemoteSubMatch::prepare_match", total_stats);
+    Assert(attempts.size() == 1);
+    Attempt& attempt = attempts[0];
     Xapian::Weight::Internal remote_stats;
-    db->get_remote_stats(remote_stats);
+    attempt.db->get_remote_stats(remote_stats);
+    db->record_reply_time(0, RealTime::now() - attempt.start);
+    attempt.awaiting_stats = false;
     total_stats += remote_stats;
 }
 
@@ -46,5 +152,27 @@ RemoteSubMatch::start_match(Xapian::doccount first,
 			    Xapian::Weight::Internal & total_stats)
 {
     LOGCALL_VOID(MATCH, "RemoteSubMatch::start_match", first | maxitems | check_at_least | sorter | total_stats);
-    db->send_global_stats(first, maxitems, check_at_least, sorter, total_stats);
+    if (timed_out_) return;
+    stats_message = RemoteDatabase::serialise_global_stats(first, maxitems,
+							   check_at_least,
+							   sorter,
+							   total_stats);
+    Assert(attempts.size() == 1);
+    Attempt& attempt = attempts[0];
+    double now = RealTime::now();
+    attempt.db->send_global_stats(stats_message);
+    attempt.start = now;
+    phase = 1;
+    set_hedge_time(now);
+}
+
+Xapian::MSet
+RemoteSubMatch::get_mset(const vector<opt_ptr_spy>& matchspies)
+{
+    LOGCALL(MATCH, Xapian::MSet, "RemoteSubMatch::get_mset", matchspies);
+    Assert(attempts.size() == 1);
+    const Attempt& attempt = attempts[0];
+    Xapian::MSet mset = attempt.db->get_mset(matchspies);
+    db->record_reply_time(1, RealTime::now() - attempt.start);
+    RETURN(mset);
 }
@@ -25,6 +25,9 @@
 #include "backends/remote/remote-database.h"
 #include "xapian/weight.h"
 
+#include <string>
+#include <vector>
+
 namespace Xapian {
     class MatchSpy;
 }
@@ -37,21 +40,107 @@ class RemoteSubMatch {
     /// Don't allow copying.
     RemoteSubMatch(const RemoteSubMatch &) = delete;
 
-    /// The remote database.
+    /// The remote database (the first of the group if it has replicas).
     const RemoteDatabase *db;
 
     /// Index of this subdatabase.
     Xapian::doccount shard;
 
+    /// The serialised query, kept so it can be sent to replicas.
+    std::string query_message;
+
+    /// The serialised global stats, kept so they can be sent to replicas.
+    std::string stats_message;
+
+    /// A database we've sent the search to and are waiting for.
+    struct Attempt {
+	/// The database.
+	const RemoteDatabase* db;
+
+	/// Are we waiting for the statistics rather than the results?
+	bool awaiting_stats;
+
+	/// When we started waiting.
+	double start;
+
+	Attempt(const RemoteDatabase* db_, bool awaiting_stats_, double start_)
+	    : db(db_), awaiting_stats(awaiting_stats_), start(start_) {}
+    };
+
+    /** The databases we're waiting for in the current phase.
+     *
+     *  Once one replies, the others are abandoned so this only has one
+     *  entry, which is the one used for the rest of the search.
+     */
+    std::vector<Attempt> attempts;
+
+    /// Replicas we haven't sent the search to yet, in the order to try them.
+    std::vector<const RemoteDatabase*> untried;
+
+    /// 0 while getting the statistics, 1 while getting the results.
+    unsigned phase = 0;
+
+    /// When to send the search to another replica (0.0 for never).
+    double hedge_time = 0.0;
+
+    /// Did this shard fail to reply in time?
+    bool timed_out_ = false;
+
+    /// Set hedge_time for the current phase.
+    void set_hedge_time(double now);
+
+    /// Give up on @a attempt.
+    void abandon(const Attempt& attempt);
+
   public:
-    /// Constructor.
-    RemoteSubMatch(const RemoteDatabase* db_, Xapian::doccount shard_)
-	: db(db_), shard(shard_) {}
+    /** Constructor.
+     *
+     *  The query is sent to the database (or one of its replicas) here.
+     *
+     *  @param db_		The remote database.
+     *  @param shard_		Index of this subdatabase.
+     *  @param query_message_	The query, serialised by
+     *				RemoteDatabase::serialise_query().
+     */
+    RemoteSubMatch(const RemoteDatabase* db_, Xapian::doccount shard_,
+		   std::string&& query_message_);
 
+    /// Get the fd to wait on if there's only one attempt (as without hedging).
     int get_read_fd() const {
-	return db->get_read_fd();
+	return attempts[0].db->get_read_fd();
+    }
+
+    /// Number of databases we're waiting to hear from.
+    size_t get_attempt_count() const { return attempts.size(); }
+
+    /// Get the fd to wait on for attempt @a i.
+    int get_read_fd(size_t i) const {
+	return attempts[i].db->get_read_fd();
     }
 
+    /// Does this shard have replicas to hedge searches with?
+    bool has_replicas() const { return db->get_replica_count() != 0; }
+
+    /// When to call hedge() (0.0 for never).
+    double get_hedge_time() const { return hedge_time; }
+
+    /// Send the search to another replica.
+    void hedge();
+
+    /** Handle attempt @a i being ready to read.
+     *
+     *  @return true if the reply for the current phase is ready to read
+     *		(using attempt @a i, which becomes the only attempt); false
+     *		if more waiting is needed.
+     */
+    bool ready(size_t i);
+
+    /// Give up waiting for this shard.
+    void time_out();
+
+    /// Did this shard fail to reply in time?
+    bool timed_out() const { return timed_out_; }
+
     /** Fetch and collate statistics.
      *
      *  Before we can calculate term weights we need to fetch statistics from
@@ -82,9 +171,7 @@ class RemoteSubMatch {
      *
      *  @param matchspies   The matchspies to use.
      */
-    Xapian::MSet get_mset(const std::vector<opt_ptr_spy>& matchspies) {
-	return db->get_mset(matchspies);
-    }
+    Xapian::MSet get_mset(const std::vector<opt_ptr_spy>& matchspies);
 
     /// Return the index of the corresponding Database shard.
     Xapian::doccount get_shard() const { return shard; }
@@ -3,6 +3,7 @@ noinst_HEADERS +=\
 	net/remoteconnection.h\
 	net/remoteprotocol.h\
 	net/remoteserver.h\
+	net/remoteserverstats.h\
 	net/remotetcpclient.h\
 	net/replicatetcpclient.h\
 	net/replicatetcpserver.h\
@@ -25,6 +26,7 @@ lib_src +=\
 	net/progclient.cc\
 	net/remoteconnection.cc\
 	net/remoteserver.cc\
+	net/remoteserverstats.cc\
 	net/remotetcpclient.cc\
 	net/replicatetcpclient.cc\
 	net/replicatetcpserver.cc\
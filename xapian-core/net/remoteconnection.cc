@@ -32,16 +32,21 @@
 #else
 # include "safesysselect.h"
 #endif
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
 
 #include <algorithm>
 #include <cerrno>
 #include <climits>
 #include <cstdint>
+#include <cstdio>
 #include <string>
 #ifdef __WIN32__
 # include <type_traits>
 #endif
 
+#include "compression_stream.h"
 #include "debuglog.h"
 #include "fd.h"
 #include "filetests.h"
@@ -100,13 +105,22 @@ RemoteConnection::RemoteConnection(int fdin_, int fdout_,
 #endif
 }
 
-#ifdef __WIN32__
 RemoteConnection::~RemoteConnection()
 {
+    delete comp_stream;
+#ifdef __WIN32__
     if (overlapped.hEvent)
 	CloseHandle(overlapped.hEvent);
-}
 #endif
+}
+
+CompressionStream&
+RemoteConnection::get_comp_stream()
+{
+    if (!comp_stream)
+	comp_stream = new CompressionStream();
+    return *comp_stream;
+}
 
 bool
 RemoteConnection::read_at_least(size_t min_len, double end_time)
@@ -241,6 +255,18 @@ RemoteConnection::send_message(char type, const string &message,
     if (fdout == -1)
 	throw_database_closed();
 
+    if (compress_min && message.size() >= compress_min &&
+	!(static_cast<unsigned char>(type) & MESSAGE_COMPRESSED)) {
+	size_t size = message.size();
+	const char* p = get_comp_stream().compress(message.data(), &size);
+	if (p) {
+	    send_message(char(type | MESSAGE_COMPRESSED), string(p, size),
+			 end_time);
+	    return;
+	}
+	// It didn't get smaller, so send it uncompressed.
+    }
+
     string header;
     header += type;
     pack_uint(header, message.size());
@@ -371,8 +397,19 @@ RemoteConnection::send_file(char type, int fd, double end_time)
     off_t size = file_size(fd);
     if (errno)
 	throw Xapian::NetworkError("Couldn't stat file to send", errno);
-    // FIXME: Use sendfile() or similar if available?
 
+    if (compress_min && size >= off_t(compress_min)) {
+	send_file_compressed(type, fd, size, end_time);
+	return;
+    }
+
+    send_file_data(type, fd, size, end_time);
+}
+
+void
+RemoteConnection::send_file_data(char type, int fd, off_t size,
+				 double end_time)
+{
     char buf[CHUNKSIZE];
     buf[0] = type;
     size_t c = 1;
@@ -435,27 +472,59 @@ RemoteConnection::send_file(char type, int fd, double end_time)
     }
 
     size_t count = 0;
+#ifdef HAVE_SENDFILE
+    // Once the header is sent, try to have the kernel send the file data
+    // directly rather than copying it through buf.
+    bool use_sendfile = true;
+#endif
     while (true) {
-	// We've set write to non-blocking, so just try writing as there
-	// will usually be space.
-	ssize_t n = write(fdout, buf + count, c - count);
-
-	if (n >= 0) {
-	    count += n;
-	    if (count == c) {
-		if (size == 0) return;
+	ssize_t n;
+#ifdef HAVE_SENDFILE
+	if (use_sendfile && count == c) {
+	    if (size == 0) return;
 
-		ssize_t res;
-		do {
-		    res = read(fd, buf, sizeof(buf));
-		} while (res < 0 && errno == EINTR);
-		if (res < 0) throw Xapian::NetworkError("read failed", errno);
-		c = size_t(res);
+	    // Linux sends at most 0x7ffff000 bytes per call anyway.
+	    n = sendfile(fdout, fd, NULL, size_t(min(size, off_t(1) << 30)));
+	    if (n > 0) {
+		size -= n;
+		continue;
+	    }
+	    if (n == 0)
+		throw Xapian::NetworkError("File to send was truncated");
+	    if (errno == EINVAL || errno == ENOSYS) {
+		// Not supported for this pair of fds, so fall back to read()
+		// and write().
+		use_sendfile = false;
+		continue;
+	    }
+	} else
+#endif
+	{
+	    // We've set write to non-blocking, so just try writing as there
+	    // will usually be space.
+	    n = write(fdout, buf + count, c - count);
+
+	    if (n >= 0) {
+		count += n;
+		if (count == c) {
+		    if (size == 0) return;
+#ifdef HAVE_SENDFILE
+		    if (use_sendfile) continue;
+#endif
 
-		size -= c;
-		count = 0;
+		    ssize_t res;
+		    do {
+			res = read(fd, buf, sizeof(buf));
+		    } while (res < 0 && errno == EINTR);
+		    if (res < 0)
+			throw Xapian::NetworkError("read failed", errno);
+		    c = size_t(res);
+
+		    size -= c;
+		    count = 0;
+		}
+		continue;
 	    }
-	    continue;
 	}
 
 	LOGLINE(REMOTE, "write gave errno = " << errno);
@@ -513,6 +582,37 @@ RemoteConnection::send_file(char type, int fd, double end_time)
 #endif
 }
 
+bool
+RemoteConnection::input_waiting()
+{
+    LOGCALL(REMOTE, bool, "RemoteConnection::input_waiting", NO_ARGS);
+    if (!buffer.empty())
+	RETURN(true);
+    if (fdin == -1)
+	RETURN(false);
+
+#ifdef __WIN32__
+    // We'd need to start an overlapped read to find out, so just report that
+    // nothing is waiting.
+    RETURN(false);
+#elif defined HAVE_POLL
+    struct pollfd fds;
+    fds.fd = fdin;
+    fds.events = POLLIN;
+    RETURN(poll(&fds, 1, 0) > 0);
+#else
+    if (fdin >= FD_SETSIZE)
+	RETURN(false);
+    fd_set fdset;
+    FD_ZERO(&fdset);
+    FD_SET(fdin, &fdset);
+    struct timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = 0;
+    RETURN(select(fdin + 1, &fdset, 0, 0, &tv) > 0);
+#endif
+}
+
 int
 RemoteConnection::sniff_next_message_type(double end_time)
 {
@@ -523,7 +623,7 @@ RemoteConnection::sniff_next_message_type(double end_time)
     if (!read_at_least(1, end_time))
 	RETURN(-1);
     unsigned char type = buffer[0];
-    RETURN(type);
+    RETURN(type & ~MESSAGE_COMPRESSED);
 }
 
 int
@@ -544,6 +644,10 @@ RemoteConnection::get_message(string &result, double end_time)
 	result.assign(buffer.data() + 2, len);
 	unsigned char type = buffer[0];
 	buffer.erase(0, len + 2);
+	if (type & MESSAGE_COMPRESSED) {
+	    decompress_message(result);
+	    type ^= MESSAGE_COMPRESSED;
+	}
 	RETURN(type);
     }
 
@@ -563,9 +667,26 @@ RemoteConnection::get_message(string &result, double end_time)
     result.assign(buffer.data() + header_len, len);
     unsigned char type = buffer[0];
     buffer.erase(0, header_len + len);
+    if (type & MESSAGE_COMPRESSED) {
+	decompress_message(result);
+	type ^= MESSAGE_COMPRESSED;
+    }
     RETURN(type);
 }
 
+void
+RemoteConnection::decompress_message(string& result)
+{
+    CompressionStream& comp = get_comp_stream();
+    comp.decompress_start();
+    string compressed;
+    swap(compressed, result);
+    if (!comp.decompress_chunk(compressed.data(), compressed.size(), result)) {
+	throw Xapian::NetworkError("Compressed message was truncated",
+				   context);
+    }
+}
+
 int
 RemoteConnection::get_message_chunked(double end_time)
 {
@@ -579,9 +700,14 @@ RemoteConnection::get_message_chunked(double end_time)
     // This code assume things about the pack_uint() encoding in order to
     // handle partial reads.
     uint_least64_t len = static_cast<unsigned char>(buffer[1]);
+    unsigned char type = buffer[0];
+    chunked_compressed = (type & MESSAGE_COMPRESSED);
+    if (chunked_compressed) {
+	get_comp_stream().decompress_start();
+	type ^= MESSAGE_COMPRESSED;
+    }
     if (len < 128) {
 	chunked_data_left = off_t(len);
-	char type = buffer[0];
 	buffer.erase(0, 2);
 	RETURN(type);
     }
@@ -602,7 +728,6 @@ RemoteConnection::get_message_chunked(double end_time)
 	throw_network_error_insane_message_length();
     }
     size_t header_len = (p - buffer.data());
-    unsigned char type = buffer[0];
     buffer.erase(0, header_len);
     RETURN(type);
 }
@@ -616,6 +741,23 @@ RemoteConnection::get_message_chunk(string &result, size_t at_least,
 	throw_database_closed();
 
     if (at_least <= result.size()) RETURN(true);
+
+    if (chunked_compressed) {
+	// We don't know how much compressed data we need, so decompress
+	// a block at a time until we have enough.
+	while (result.size() < at_least) {
+	    if (chunked_data_left == 0)
+		RETURN(0);
+	    size_t n = size_t(min(chunked_data_left, off_t(CHUNKSIZE)));
+	    if (!read_at_least(n, end_time))
+		RETURN(-1);
+	    (void)comp_stream->decompress_chunk(buffer.data(), int(n), result);
+	    buffer.erase(0, n);
+	    chunked_data_left -= n;
+	}
+	RETURN(1);
+    }
+
     at_least -= result.size();
 
     bool read_enough = (off_t(at_least) <= chunked_data_left);
@@ -660,17 +802,153 @@ RemoteConnection::receive_file(const string &file, double end_time)
 	throw Xapian::NetworkError("Couldn't open file for writing: " + file, errno);
 
     int type = get_message_chunked(end_time);
-    do {
+#if defined HAVE_SPLICE && defined HAVE_POLL
+    if (!chunked_compressed) {
+	// Write out any data we've already read, then have the kernel move
+	// the rest from fdin to the file.
+	size_t n = size_t(min(off_t(buffer.size()), chunked_data_left));
+	write_all(fd, buffer.data(), n);
+	buffer.erase(0, n);
+	chunked_data_left -= n;
+	if (chunked_data_left == 0 || splice_to_file(fd, end_time))
+	    RETURN(type);
+    }
+#endif
+    string decompressed;
+    while (chunked_data_left) {
 	off_t min_read = min(chunked_data_left, off_t(CHUNKSIZE));
 	if (!read_at_least(min_read, end_time))
 	    RETURN(-1);
-	write_all(fd, buffer.data(), min_read);
+	if (chunked_compressed) {
+	    (void)comp_stream->decompress_chunk(buffer.data(), int(min_read),
+						decompressed);
+	    write_all(fd, decompressed.data(), decompressed.size());
+	    decompressed.resize(0);
+	} else {
+	    write_all(fd, buffer.data(), min_read);
+	}
 	chunked_data_left -= min_read;
 	buffer.erase(0, min_read);
-    } while (chunked_data_left);
+    }
     RETURN(type);
 }
 
+#if defined HAVE_SPLICE && defined HAVE_POLL
+bool
+RemoteConnection::splice_to_file(int fd, double end_time)
+{
+    LOGCALL(REMOTE, bool, "RemoteConnection::splice_to_file", fd | end_time);
+    // splice() needs one end to be a pipe, so we splice from fdin into a
+    // pipe and then from the pipe into the file.
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) < 0)
+	RETURN(false);
+    FD pipe_in(fds[0]), pipe_out(fds[1]);
+
+    // If there's no end_time, just use blocking I/O.
+    if (fcntl(fdin, F_SETFL, (end_time != 0.0) ? O_NONBLOCK : 0) < 0) {
+	throw Xapian::NetworkError("Failed to set fdin non-blocking-ness",
+				   context, errno);
+    }
+
+    bool started = false;
+    while (chunked_data_left) {
+	// A pipe holds 64KB by default, and we empty it each time.
+	size_t len = size_t(min(chunked_data_left, off_t(65536)));
+	ssize_t n = splice(fdin, NULL, pipe_out, NULL, len, SPLICE_F_MOVE);
+	if (n == 0)
+	    throw Xapian::NetworkError("Connection closed unexpectedly",
+				       context);
+	if (n < 0) {
+	    if (errno == EINTR) continue;
+	    if (!started && errno == EINVAL) {
+		// Not supported for fdin, so read it the usual way.
+		RETURN(false);
+	    }
+	    if (errno != EAGAIN)
+		throw Xapian::NetworkError("splice failed", context, errno);
+
+	    // Wait until there is data, an error, or the timeout is reached.
+	    double time_diff = end_time - RealTime::now();
+	    if (time_diff < 0)
+		throw_timeout("Timeout expired while trying to read", context);
+	    struct pollfd pfd;
+	    pfd.fd = fdin;
+	    pfd.events = POLLIN;
+	    int poll_result = poll(&pfd, 1, int(time_diff * 1000));
+	    if (poll_result == 0)
+		throw_timeout("Timeout expired while trying to read", context);
+	    if (poll_result < 0 && errno != EINTR && errno != EAGAIN)
+		throw Xapian::NetworkError("poll failed during read",
+					   context, errno);
+	    continue;
+	}
+	started = true;
+	chunked_data_left -= n;
+
+	while (n) {
+	    ssize_t m = splice(pipe_in, NULL, fd, NULL, size_t(n),
+			       SPLICE_F_MOVE);
+	    if (m < 0) {
+		if (errno == EINTR) continue;
+		throw Xapian::NetworkError("Error writing to file", errno);
+	    }
+	    n -= m;
+	}
+    }
+    RETURN(true);
+}
+#endif
+
+void
+RemoteConnection::send_file_compressed(char type, int fd, off_t size,
+				       double end_time)
+{
+    // The message header includes the length of the data, so we compress
+    // into a temporary file first.
+    FILE* tmp = tmpfile();
+    if (!tmp)
+	throw Xapian::NetworkError("Couldn't create temporary file", errno);
+    try {
+	int tmp_fd = fileno(tmp);
+	off_t start = lseek(fd, 0, SEEK_CUR);
+	off_t out_size = 0;
+	CompressionStream& comp = get_comp_stream();
+	comp.compress_start();
+	char buf[CHUNKSIZE];
+	string out;
+	while (true) {
+	    ssize_t res = read(fd, buf, sizeof(buf));
+	    if (res < 0) {
+		if (errno == EINTR) continue;
+		throw Xapian::NetworkError("read failed", errno);
+	    }
+	    comp.compress_chunk(buf, size_t(res), res == 0, out);
+	    write_all(tmp_fd, out.data(), out.size());
+	    out_size += out.size();
+	    out.resize(0);
+	    if (res == 0) break;
+	}
+
+	if (out_size < size) {
+	    if (lseek(tmp_fd, 0, SEEK_SET) < 0)
+		throw Xapian::NetworkError("Couldn't seek temporary file",
+					   errno);
+	    send_file_data(char(type | MESSAGE_COMPRESSED), tmp_fd, out_size,
+			   end_time);
+	} else {
+	    // It didn't get smaller, so send it uncompressed.
+	    if (start < 0 || lseek(fd, start, SEEK_SET) < 0)
+		throw Xapian::NetworkError("Couldn't seek file to send", errno);
+	    send_file_data(type, fd, size, end_time);
+	}
+    } catch (...) {
+	fclose(tmp);
+	throw;
+    }
+    fclose(tmp);
+}
+
 void
 RemoteConnection::shutdown()
 {
@@ -737,6 +1015,17 @@ RemoteConnection::do_close()
     }
 }
 
+int
+RemoteConnection::release_fd()
+{
+    LOGCALL(REMOTE, int, "RemoteConnection::release_fd", NO_ARGS);
+    Assert(fdin == fdout);
+    int fd = fdin;
+    fdin = fdout = -1;
+    buffer.resize(0);
+    RETURN(fd);
+}
+
 #ifdef __WIN32__
 DWORD
 RemoteConnection::calc_read_wait_msecs(double end_time)
@@ -158,6 +158,21 @@ inline int eai_to_xapian(int e) {
     return e;
 }
 
+class CompressionStream;
+
+/** Flag set in the type code of a message whose contents are compressed.
+ *
+ *  The type codes of messages are all less than this.
+ */
+const unsigned char MESSAGE_COMPRESSED = 0x80;
+
+/** Default size above which messages are compressed.
+ *
+ *  Used when compression is enabled - smaller messages are unlikely to
+ *  compress usefully.
+ */
+const size_t DEFAULT_COMPRESS_MIN = 1024;
+
 /** A RemoteConnection object provides a bidirectional connection to another
  *  RemoteConnection object on a remote machine.
  *
@@ -193,6 +208,34 @@ class RemoteConnection {
     /// Remaining bytes of message data still to come over fdin for a chunked read.
     off_t chunked_data_left;
 
+    /// Is the message being read in chunks compressed?
+    bool chunked_compressed = false;
+
+    /** Compress messages with at least this many bytes of data.
+     *
+     *  If 0, messages aren't compressed when sent.
+     */
+    size_t compress_min = 0;
+
+    /** Used to compress and decompress messages.
+     *
+     *  Allocated when first needed.
+     */
+    CompressionStream* comp_stream = nullptr;
+
+    /// Get the CompressionStream, allocating it if necessary.
+    CompressionStream& get_comp_stream();
+
+    /// Decompress the data of message read in one go.
+    void decompress_message(std::string& result);
+
+    /// Send size bytes from fd as a message, without compressing them.
+    void send_file_data(char type, int fd, off_t size, double end_time);
+
+    /// Send size bytes from fd as a compressed message if they compress.
+    void send_file_compressed(char type, int fd, off_t size,
+			      double end_time);
+
     /** Read until there are at least min_len bytes in buffer.
      *
      *  If for some reason this isn't possible, returns false upon EOF and
@@ -207,6 +250,23 @@ class RemoteConnection {
      */
     bool read_at_least(size_t min_len, double end_time);
 
+#if defined HAVE_SPLICE && defined HAVE_POLL
+    /** Move the rest of a chunked message's data from fdin to a file.
+     *
+     *  The data is moved with splice() so it isn't copied through buffer,
+     *  which must be empty.
+     *
+     *  @param fd	The file to write to.
+     *  @param end_time	If this time is reached, then a timeout
+     *			exception will be thrown.  If (end_time == 0.0),
+     *			then keep trying indefinitely.
+     *
+     *  @return false if splice() isn't supported for fdin (in which case
+     *		nothing has been read), otherwise true.
+     */
+    bool splice_to_file(int fd, double end_time);
+#endif
+
 #ifdef __WIN32__
     /** On Windows we use overlapped IO.  We share an overlapped structure
      *  for both reading and writing, as we know that we always wait for
@@ -234,14 +294,38 @@ class RemoteConnection {
     RemoteConnection(int fdin_, int fdout_,
 		     const std::string & context_ = std::string());
 
-#ifdef __WIN32__
-    /// Destructor
+    /// Destructor.
     ~RemoteConnection();
-#endif
 
     /** Return the underlying fd this remote connection reads from. */
     int get_read_fd() const { return fdin; }
 
+    /** Compress messages we send.
+     *
+     *  Messages we receive are decompressed if they were compressed by the
+     *  sender whether this has been called or not, but the other end must
+     *  know to expect compressed messages before we call this.
+     *
+     *  @param min_size	Only compress messages with at least this many
+     *			bytes of data (default: DEFAULT_COMPRESS_MIN).
+     *			Messages are sent uncompressed if they don't get
+     *			smaller.
+     */
+    void enable_compression(size_t min_size = DEFAULT_COMPRESS_MIN) {
+	compress_min = min_size ? min_size : 1;
+    }
+
+    /** Check if there's input waiting to be read.
+     *
+     *  This doesn't block, so it can be used to check if the other end has
+     *  sent a message while we're busy sending it a long reply.  On
+     *  platforms where this can't be checked cheaply, false is returned
+     *  unless some input has already been buffered.
+     *
+     *  @return		true if there's input waiting.
+     */
+    bool input_waiting();
+
     /** Check what the next message type is.
      *
      *  This must not be called after a call to get_message_chunked() until
@@ -358,6 +442,15 @@ class RemoteConnection {
 
     /** Close the connection. */
     void do_close();
+
+    /** Detach the connection's fd without closing it.
+     *
+     *  Only valid when the same fd is used in both directions.  Any buffered
+     *  input is discarded, so the caller should check input_waiting() first.
+     *
+     *  @return The fd, or -1 if the connection has been closed.
+     */
+    int release_fd();
 };
 
 /** RemoteConnection which owns its own fd(s).
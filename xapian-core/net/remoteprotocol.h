@@ -57,8 +57,14 @@
 // 44: pre-1.5.0 pack_uint() now used; many other changes
 // 44.1: pre-1.5.0 MSG_RECONSTRUCTTEXT added
 // 45: 1.5.0 Remote support for sorters
-#define XAPIAN_REMOTE_PROTOCOL_MAJOR_VERSION 45
-#define XAPIAN_REMOTE_PROTOCOL_MINOR_VERSION 0
+// 45.1: 1.5.0 MSG_DOCUMENTS added
+// 45.2: 1.5.0 MSG_COMPRESSION added, and messages may be compressed
+// 46: 1.5.0 REPLY_TERMLIST and REPLY_POSTLIST streamed in chunks, MSG_ENDLIST
+// 46.1: 1.5.0 MSG_PIPELINED, MSG_SYNCPIPELINE and REPLY_PIPELINEERROR added
+// 46.2: 1.5.0 MSG_DOCLENGTHS, MSG_UNIQUETERMCOUNTS and MSG_VALUES added
+// 46.3: 1.5.0 MSG_SETDOCUMENTVALUE added
+#define XAPIAN_REMOTE_PROTOCOL_MAJOR_VERSION 46
+#define XAPIAN_REMOTE_PROTOCOL_MINOR_VERSION 3
 
 /** Message types (client -> server).
  *
@@ -105,6 +111,15 @@ enum message_type {
     MSG_ADDSYNONYM,		// Add a synonym
     MSG_REMOVESYNONYM,		// Remove a synonym
     MSG_CLEARSYNONYMS,		// Clear synonyms for a term
+    MSG_DOCUMENTS,		// Get several Documents
+    MSG_COMPRESSION,		// Client can handle compressed messages
+    MSG_ENDLIST,		// Stop sending the list being streamed
+    MSG_PIPELINED,		// Update without waiting for a reply
+    MSG_SYNCPIPELINE,		// Report errors from pipelined updates
+    MSG_DOCLENGTHS,		// Get several Doc Lengths
+    MSG_UNIQUETERMCOUNTS,	// Get number of unique terms in several docs
+    MSG_VALUES,			// Get a value for several docs
+    MSG_SETDOCUMENTVALUE,	// Set one value of a document
     MSG_MAX
 };
 
@@ -140,6 +155,11 @@ enum reply_type {
     REPLY_RECONSTRUCTTEXT,	// Reconstruct document text
     REPLY_SYNONYMTERMLIST,	// Get synonyms for a term
     REPLY_SYNONYMKEYLIST,	// Get terms with an entry in synonym table
+    REPLY_DOCUMENT,		// Document from MSG_DOCUMENTS
+    REPLY_PIPELINEERROR,	// Error from a pipelined update
+    REPLY_DOCLENGTHS,		// Get several Doc Lengths
+    REPLY_UNIQUETERMCOUNTS,	// Get number of unique terms in several docs
+    REPLY_VALUES,		// Get a value for several docs
     REPLY_MAX
 };
 
@@ -35,6 +35,7 @@
 #include <cerrno>
 #include <cstdlib>
 #include <memory>
+#include <vector>
 
 #include "api/msetinternal.h"
 #include "api/termlist.h"
@@ -42,6 +43,7 @@
 #include "omassert.h"
 #include "pack.h"
 #include "realtime.h"
+#include "remoteserverstats.h"
 #include "serialise.h"
 #include "serialise-double.h"
 #include "serialise-error.h"
@@ -51,6 +53,13 @@
 
 using namespace std;
 
+/** Send termlists and postlists in chunks of about this many bytes.
+ *
+ *  This lets the client start on a long list before it has all arrived, and
+ *  stop us sending the rest if it doesn't need it.
+ */
+static const size_t LIST_CHUNK_SIZE = 8192;
+
 [[noreturn]]
 static void
 throw_read_only()
@@ -98,6 +107,23 @@ RemoteServer::RemoteServer(const vector<string>& dbpaths,
 	throw;
     }
 
+    start();
+}
+
+RemoteServer::RemoteServer(const Xapian::Database& db_,
+			   const string& context_,
+			   int fdin_, int fdout_,
+			   double active_timeout_, double idle_timeout_)
+    : RemoteConnection(fdin_, fdout_, context_),
+      db(new Xapian::Database(db_)), wdb(NULL), writable(false),
+      active_timeout(active_timeout_), idle_timeout(idle_timeout_)
+{
+    start();
+}
+
+void
+RemoteServer::start()
+{
 #ifndef __WIN32__
     // It's simplest to just ignore SIGPIPE.  We'll still know if the
     // connection dies because we'll get EPIPE back from write().
@@ -121,6 +147,8 @@ RemoteServer::get_message(double timeout, string & result,
 {
     double end_time = RealTime::end_time(timeout);
     int type = RemoteConnection::get_message(result, end_time);
+    if (stats && type >= 0)
+	stats->add_bytes_in(result.size());
 
     // Handle "shutdown connection" message here.  Treat EOF here for a read-only
     // database the same way since a read-only client just closes the
@@ -147,20 +175,64 @@ RemoteServer::get_message(double timeout, string & result,
 void
 RemoteServer::send_message(reply_type type, const string &message)
 {
-    double end_time = RealTime::end_time(active_timeout);
+    // The client doesn't wait for replies to pipelined updates.
+    if (in_pipelined_update) return;
+
+    send_message(type, message, RealTime::end_time(active_timeout));
+}
+
+void
+RemoteServer::send_message(reply_type type, const string &message,
+			   double end_time)
+{
+    if (stats)
+	stats->add_bytes_out(message.size());
     unsigned char type_as_char = static_cast<unsigned char>(type);
     RemoteConnection::send_message(type_as_char, message, end_time);
 }
 
 typedef void (RemoteServer::* dispatch_func)(const string &);
 
+/// Time handling a message, and add it to the statistics (if any).
+class MessageTimer {
+    RemoteServerStats* stats;
+
+    message_type type;
+
+    double start;
+
+  public:
+    MessageTimer(RemoteServerStats* stats_, message_type type_)
+	: stats(stats_), type(type_), start(stats ? RealTime::now() : 0) { }
+
+    ~MessageTimer() {
+	if (stats) stats->add_message(type, RealTime::now() - start);
+    }
+};
+
+/// Note a connection in the statistics (if any) while it is handled.
+class ConnectionCounter {
+    RemoteServerStats* stats;
+
+  public:
+    explicit ConnectionCounter(RemoteServerStats* stats_) : stats(stats_) {
+	if (stats) stats->connection_opened();
+    }
+
+    ~ConnectionCounter() {
+	if (stats) stats->connection_closed();
+    }
+};
+
 void
 RemoteServer::run()
 {
+    ConnectionCounter connection_counter(stats);
     while (true) {
 	try {
 	    string message;
 	    size_t type = get_message(idle_timeout, message);
+	    MessageTimer timer(stats, static_cast<message_type>(type));
 	    switch (type) {
 		case MSG_ALLTERMS:
 		    msg_allterms(message);
@@ -273,6 +345,34 @@ RemoteServer::run()
 		case MSG_CLEARSYNONYMS:
 		    msg_clearsynonyms(message);
 		    continue;
+		case MSG_DOCUMENTS:
+		    msg_documents(message);
+		    continue;
+		case MSG_COMPRESSION:
+		    msg_compression(message);
+		    continue;
+		case MSG_ENDLIST:
+		    // We'd already sent the whole list when this arrived, so
+		    // there's nothing to stop.
+		    continue;
+		case MSG_PIPELINED:
+		    msg_pipelined(message);
+		    continue;
+		case MSG_SYNCPIPELINE:
+		    msg_syncpipeline(message);
+		    continue;
+		case MSG_DOCLENGTHS:
+		    msg_doclengths(message);
+		    continue;
+		case MSG_UNIQUETERMCOUNTS:
+		    msg_uniquetermcounts(message);
+		    continue;
+		case MSG_VALUES:
+		    msg_values(message);
+		    continue;
+		case MSG_SETDOCUMENTVALUE:
+		    msg_setdocumentvalue(message);
+		    continue;
 		default: {
 		    // MSG_GETMSET - used during a conversation.
 		    // MSG_SHUTDOWN - handled by get_message().
@@ -337,6 +437,21 @@ RemoteServer::msg_allterms(const string& message)
     send_message(REPLY_ALLTERMS, reply);
 }
 
+bool
+RemoteServer::send_list_chunk(reply_type type, string& chunk)
+{
+    if (input_waiting()) {
+	// The client only sends a message while we're streaming a list to
+	// tell us it doesn't want the rest.
+	string message;
+	(void)get_message(active_timeout, message, MSG_ENDLIST);
+	return false;
+    }
+    send_message(type, chunk);
+    chunk.resize(0);
+    return true;
+}
+
 void
 RemoteServer::msg_termlist(const string &message)
 {
@@ -358,6 +473,11 @@ RemoteServer::msg_termlist(const string &message)
     reply.resize(0);
     string prev;
     while (t != db->termlist_end(did)) {
+	if (reply.size() >= LIST_CHUNK_SIZE &&
+	    !send_list_chunk(REPLY_TERMLIST, reply)) {
+	    send_message(REPLY_DONE, string());
+	    return;
+	}
 	if (rare(prev.size() > 255))
 	    prev.resize(255);
 	const string& term = *t;
@@ -370,7 +490,9 @@ RemoteServer::msg_termlist(const string &message)
 	prev = term;
 	++t;
     }
-    send_message(REPLY_TERMLIST, reply);
+    if (!reply.empty())
+	send_message(REPLY_TERMLIST, reply);
+    send_message(REPLY_DONE, string());
 }
 
 void
@@ -436,6 +558,11 @@ RemoteServer::msg_postlist(const string &message)
     for (Xapian::PostingIterator i = db->postlist_begin(term);
 	 i != db->postlist_end(term);
 	 ++i) {
+	if (reply.size() >= LIST_CHUNK_SIZE &&
+	    !send_list_chunk(REPLY_POSTLIST, reply)) {
+	    send_message(REPLY_DONE, string());
+	    return;
+	}
 	Xapian::docid newdocid = *i;
 	pack_uint(reply, newdocid - lastdocid - 1);
 	pack_uint(reply, i.get_wdf());
@@ -443,7 +570,9 @@ RemoteServer::msg_postlist(const string &message)
 	lastdocid = newdocid;
     }
 
-    send_message(REPLY_POSTLIST, reply);
+    if (!reply.empty())
+	send_message(REPLY_POSTLIST, reply);
+    send_message(REPLY_DONE, string());
 }
 
 void
@@ -622,7 +751,7 @@ RemoteServer::msg_query(const string &message_in)
 		    collapse_key, collapse_max,
 		    percent_threshold, weight_threshold,
 		    order, sort_key, sort_by, sort_value_forward, time_limit,
-		    matchspies);
+		    0.0, matchspies);
 
     send_message(REPLY_STATS, serialise_stats(local_stats));
 
@@ -703,6 +832,121 @@ RemoteServer::msg_document(const string &message)
     send_message(REPLY_DONE, string());
 }
 
+void
+RemoteServer::msg_documents(const string& message)
+{
+    const char *p = message.data();
+    const char *p_end = p + message.size();
+    string reply;
+    while (p != p_end) {
+	Xapian::docid did;
+	if (!unpack_uint(&p, p_end, &did)) {
+	    throw Xapian::NetworkError("Bad MSG_DOCUMENTS");
+	}
+
+	Xapian::Document doc;
+	try {
+	    doc = db->get_document(did);
+	} catch (const Xapian::DocNotFoundError&) {
+	    // The client only uses this to prefetch documents, so just skip
+	    // any which don't exist.
+	    continue;
+	}
+
+	reply.resize(0);
+	pack_uint(reply, did);
+	pack_string(reply, doc.get_data());
+	Xapian::ValueIterator i;
+	for (i = doc.values_begin(); i != doc.values_end(); ++i) {
+	    pack_uint(reply, i.get_valueno());
+	    pack_string(reply, *i);
+	}
+	send_message(REPLY_DOCUMENT, reply);
+    }
+    send_message(REPLY_DONE, string());
+}
+
+void
+RemoteServer::msg_compression(const string&)
+{
+    // This message doesn't get a reply - the client sends it straight after
+    // the greeting without waiting.
+    if (compression_allowed)
+	enable_compression();
+}
+
+void
+RemoteServer::msg_pipelined(const string& message)
+{
+    ++pipelined_count;
+    if (!pipeline_error.empty()) {
+	// An earlier pipelined update failed, so ignore the rest until the
+	// client finds out.
+	return;
+    }
+
+    if (message.empty())
+	throw Xapian::NetworkError("Bad MSG_PIPELINED");
+    dispatch_func handler;
+    switch (static_cast<unsigned char>(message[0])) {
+	case MSG_DELETEDOCUMENT:
+	    handler = &RemoteServer::msg_deletedocument;
+	    break;
+	case MSG_DELETEDOCUMENTTERM:
+	    handler = &RemoteServer::msg_deletedocumentterm;
+	    break;
+	case MSG_REPLACEDOCUMENT:
+	    handler = &RemoteServer::msg_replacedocument;
+	    break;
+	case MSG_SETMETADATA:
+	    handler = &RemoteServer::msg_setmetadata;
+	    break;
+	case MSG_SETDOCUMENTVALUE:
+	    handler = &RemoteServer::msg_setdocumentvalue;
+	    break;
+	case MSG_ADDSPELLING:
+	    handler = &RemoteServer::msg_addspelling;
+	    break;
+	case MSG_ADDSYNONYM:
+	    handler = &RemoteServer::msg_addsynonym;
+	    break;
+	case MSG_REMOVESYNONYM:
+	    handler = &RemoteServer::msg_removesynonym;
+	    break;
+	case MSG_CLEARSYNONYMS:
+	    handler = &RemoteServer::msg_clearsynonyms;
+	    break;
+	default:
+	    throw Xapian::NetworkError("Bad MSG_PIPELINED");
+    }
+
+    in_pipelined_update = true;
+    try {
+	(this->*handler)(message.substr(1));
+    } catch (const Xapian::Error& e) {
+	// Report the error when the client next sends MSG_SYNCPIPELINE.
+	pack_uint(pipeline_error, pipelined_count);
+	pipeline_error += serialise_error(e);
+    } catch (...) {
+	in_pipelined_update = false;
+	throw;
+    }
+    in_pipelined_update = false;
+}
+
+void
+RemoteServer::msg_syncpipeline(const string&)
+{
+    pipelined_count = 0;
+    if (pipeline_error.empty()) {
+	send_message(REPLY_DONE, string());
+	return;
+    }
+    string reply;
+    swap(reply, pipeline_error);
+    send_message(REPLY_PIPELINEERROR, reply);
+}
+
 void
 RemoteServer::msg_keepalive(const string &)
 {
@@ -773,6 +1017,51 @@ RemoteServer::msg_doclength(const string &message)
     send_message(REPLY_DOCLENGTH, reply);
 }
 
+/// Unpack the list of docids in @a message starting at @a p.
+static vector<Xapian::docid>
+unpack_docids(const char* p, const char* p_end, const char* msg_name)
+{
+    vector<Xapian::docid> dids;
+    while (p != p_end) {
+	Xapian::docid did;
+	if (!unpack_uint(&p, p_end, &did)) {
+	    throw Xapian::NetworkError(string("Bad ") + msg_name);
+	}
+	dids.push_back(did);
+    }
+    return dids;
+}
+
+void
+RemoteServer::msg_doclengths(const string& message)
+{
+    const char* p = message.data();
+    const char* p_end = p + message.size();
+    auto dids = unpack_docids(p, p_end, "MSG_DOCLENGTHS");
+    string reply;
+    for (Xapian::termcount doclen : db->get_doclength(dids)) {
+	pack_uint(reply, doclen);
+    }
+    send_message(REPLY_DOCLENGTHS, reply);
+}
+
+void
+RemoteServer::msg_values(const string& message)
+{
+    const char* p = message.data();
+    const char* p_end = p + message.size();
+    Xapian::valueno slot;
+    if (!unpack_uint(&p, p_end, &slot)) {
+	throw Xapian::NetworkError("Bad MSG_VALUES");
+    }
+    auto dids = unpack_docids(p, p_end, "MSG_VALUES");
+    string reply;
+    for (const string& value : db->get_values(dids, slot)) {
+	pack_string(reply, value);
+    }
+    send_message(REPLY_VALUES, reply);
+}
+
 void
 RemoteServer::msg_uniqueterms(const string &message)
 {
@@ -787,6 +1076,19 @@ RemoteServer::msg_uniqueterms(const string &message)
     send_message(REPLY_UNIQUETERMS, reply);
 }
 
+void
+RemoteServer::msg_uniquetermcounts(const string& message)
+{
+    const char* p = message.data();
+    const char* p_end = p + message.size();
+    auto dids = unpack_docids(p, p_end, "MSG_UNIQUETERMCOUNTS");
+    string reply;
+    for (Xapian::termcount count : db->get_unique_terms(dids)) {
+	pack_uint(reply, count);
+    }
+    send_message(REPLY_UNIQUETERMCOUNTS, reply);
+}
+
 void
 RemoteServer::msg_wdfdocmax(const string& message)
 {
@@ -968,6 +1270,25 @@ RemoteServer::msg_setmetadata(const string & message)
     send_message(REPLY_DONE, string());
 }
 
+void
+RemoteServer::msg_setdocumentvalue(const string& message)
+{
+    if (!wdb)
+	throw_read_only();
+    const char* p = message.data();
+    const char* p_end = p + message.size();
+    Xapian::docid did;
+    Xapian::valueno slot;
+    if (!unpack_uint(&p, p_end, &did) ||
+	!unpack_uint(&p, p_end, &slot)) {
+	throw Xapian::NetworkError("Bad MSG_SETDOCUMENTVALUE");
+    }
+    string value(p, p_end - p);
+    wdb->set_document_value(did, slot, value);
+
+    send_message(REPLY_DONE, string());
+}
+
 void
 RemoteServer::msg_addspelling(const string & message)
 {
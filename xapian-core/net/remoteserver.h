@@ -32,6 +32,8 @@
 
 #include <string>
 
+class RemoteServerStats;
+
 /** Remote backend server base class. */
 class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
     /// Don't allow assignment.
@@ -69,6 +71,24 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
     /// The registry, which allows unserialisation of user subclasses.
     Xapian::Registry reg;
 
+    /// Should we compress replies if the client can handle them?
+    bool compression_allowed = false;
+
+    /// Are we handling a pipelined update (so shouldn't reply to it)?
+    bool in_pipelined_update = false;
+
+    /// Number of pipelined updates received since the last MSG_SYNCPIPELINE.
+    unsigned long pipelined_count = 0;
+
+    /** The reply to MSG_SYNCPIPELINE if a pipelined update failed.
+     *
+     *  Empty if none has failed since the last MSG_SYNCPIPELINE.
+     */
+    std::string pipeline_error;
+
+    /// Statistics to update, or NULL.
+    RemoteServerStats* stats = nullptr;
+
     /// Accept a message from the client.
     XAPIAN_VISIBILITY_INTERNAL
     message_type get_message(double timeout, std::string & result,
@@ -81,10 +101,7 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
     /// Send a message to the client, with specific end_time.
     XAPIAN_VISIBILITY_INTERNAL
     void send_message(reply_type type, const std::string &message,
-		      double end_time) {
-	unsigned char type_as_char = static_cast<unsigned char>(type);
-	RemoteConnection::send_message(type_as_char, message, end_time);
-    }
+		      double end_time);
 
     // all terms
     XAPIAN_VISIBILITY_INTERNAL
@@ -94,6 +111,10 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
     XAPIAN_VISIBILITY_INTERNAL
     void msg_document(const std::string & message);
 
+    // get several documents
+    XAPIAN_VISIBILITY_INTERNAL
+    void msg_documents(const std::string& message);
+
     // term exists?
     XAPIAN_VISIBILITY_INTERNAL
     void msg_termexists(const std::string & message);
@@ -122,10 +143,29 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
     XAPIAN_VISIBILITY_INTERNAL
     void msg_doclength(const std::string & message);
 
+    // get several doclengths
+    XAPIAN_VISIBILITY_INTERNAL
+    void msg_doclengths(const std::string& message);
+
+    // get a value for several documents
+    XAPIAN_VISIBILITY_INTERNAL
+    void msg_values(const std::string& message);
+
     // set the query; return the mset
     XAPIAN_VISIBILITY_INTERNAL
     void msg_query(const std::string & message);
 
+    /** Send the next chunk of a list which is being streamed.
+     *
+     *  @param type	The reply type for the chunks of the list.
+     *  @param chunk	The data to send.  Cleared if it gets sent.
+     *
+     *  @return false if the client has asked us to stop sending the list
+     *		(in which case @a chunk isn't sent), otherwise true.
+     */
+    XAPIAN_VISIBILITY_INTERNAL
+    bool send_list_chunk(reply_type type, std::string& chunk);
+
     // get termlist
     XAPIAN_VISIBILITY_INTERNAL
     void msg_termlist(const std::string & message);
@@ -194,6 +234,9 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
     XAPIAN_VISIBILITY_INTERNAL
     void msg_setmetadata(const std::string & message);
 
+    // set a single value of a document
+    void msg_setdocumentvalue(const std::string& message);
+
     // add a spelling
     XAPIAN_VISIBILITY_INTERNAL
     void msg_addspelling(const std::string & message);
@@ -206,6 +249,10 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
     XAPIAN_VISIBILITY_INTERNAL
     void msg_uniqueterms(const std::string & message);
 
+    // get number of unique terms in several documents
+    XAPIAN_VISIBILITY_INTERNAL
+    void msg_uniquetermcounts(const std::string& message);
+
     // get max_wdf
     XAPIAN_VISIBILITY_INTERNAL
     void msg_wdfdocmax(const std::string& message);
@@ -234,6 +281,22 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
     XAPIAN_VISIBILITY_INTERNAL
     void msg_clearsynonyms(const std::string& message);
 
+    // client can handle compressed replies
+    XAPIAN_VISIBILITY_INTERNAL
+    void msg_compression(const std::string& message);
+
+    // update without replying
+    XAPIAN_VISIBILITY_INTERNAL
+    void msg_pipelined(const std::string& message);
+
+    // report errors from pipelined updates
+    XAPIAN_VISIBILITY_INTERNAL
+    void msg_syncpipeline(const std::string& message);
+
+    /// Prepare the connection and send the greeting message.
+    XAPIAN_VISIBILITY_INTERNAL
+    void start();
+
   public:
     /** Construct a RemoteServer.
      *
@@ -253,6 +316,27 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
 		 double idle_timeout_,
 		 bool writable = false);
 
+    /** Construct a read-only RemoteServer for an already open database.
+     *
+     *  This allows a database to be reused for several connections (one
+     *  after another) instead of opening it for each.
+     *
+     *  @param db_	The database to use.
+     *  @param context_	The context to return with any error messages.
+     *  @param fdin	The file descriptor to read from.
+     *  @param fdout	The file descriptor to write to (fdin and fdout may be
+     *			the same).
+     *  @param active_timeout_	Timeout for actions during a conversation
+     *			(specified in seconds).
+     *  @param idle_timeout_	Timeout while waiting for a new action from
+     *			the client (specified in seconds).
+     */
+    RemoteServer(const Xapian::Database& db_,
+		 const std::string& context_,
+		 int fdin, int fdout,
+		 double active_timeout_,
+		 double idle_timeout_);
+
     /// Destructor.
     ~RemoteServer();
 
@@ -265,6 +349,19 @@ class XAPIAN_VISIBILITY_DEFAULT RemoteServer : private RemoteConnection {
 
     /// Set the registry used for (un)serialisation.
     void set_registry(const Xapian::Registry & reg_) { reg = reg_; }
+
+    /** Allow replies to be compressed.
+     *
+     *  Replies are only compressed if the client says it can handle
+     *  compressed messages, and only larger replies are compressed.
+     */
+    void allow_compression() { compression_allowed = true; }
+
+    /** Record statistics about the messages handled.
+     *
+     *  @param stats_	The statistics to update (must outlive run()).
+     */
+    void set_stats(RemoteServerStats* stats_) { stats = stats_; }
 };
 
 #endif // XAPIAN_INCLUDED_REMOTESERVER_H
@@ -0,0 +1,274 @@
+/** @file remoteserverstats.cc
+ * @brief Statistics about the messages handled by RemoteServer
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <config.h>
+
+#include "remoteserverstats.h"
+
+#ifdef HAVE_FORK
+# include <sys/mman.h>
+#endif
+
+#include <new>
+
+#include "str.h"
+
+using namespace std;
+
+/// Names for message types in the report, indexed by message_type.
+static const char* const message_names[] = {
+    "allterms",
+    "collfreq",
+    "document",
+    "termexists",
+    "termfreq",
+    "valuestats",
+    "keepalive",
+    "doclength",
+    "query",
+    "termlist",
+    "positionlist",
+    "postlist",
+    "reopen",
+    "update",
+    "adddocument",
+    "cancel",
+    "deletedocumentterm",
+    "commit",
+    "replacedocument",
+    "replacedocumentterm",
+    "deletedocument",
+    "writeaccess",
+    "getmetadata",
+    "setmetadata",
+    "addspelling",
+    "removespelling",
+    "getmset",
+    "shutdown",
+    "metadatakeylist",
+    "freqs",
+    "uniqueterms",
+    "wdfdocmax",
+    "positionlistcount",
+    "reconstructtext",
+    "synonymtermlist",
+    "synonymkeylist",
+    "addsynonym",
+    "removesynonym",
+    "clearsynonyms",
+    "documents",
+    "compression",
+    "endlist",
+    "pipelined",
+    "syncpipeline",
+    "doclengths",
+    "uniquetermcounts",
+    "values",
+    "setdocumentvalue",
+};
+
+static_assert(sizeof(message_names) / sizeof(message_names[0]) == MSG_MAX,
+	      "message_names needs updating");
+
+/// The quantiles included in the report.
+static const struct { double q; const char* label; } quantiles[] = {
+    { 0.5, "0.5" },
+    { 0.9, "0.9" },
+    { 0.99, "0.99" },
+    { 0.999, "0.999" },
+};
+
+RemoteServerStats::RemoteServerStats()
+{
+    // std::atomic's default constructor doesn't initialise the value.
+    for (auto& m : messages) {
+	m.total_usecs = 0;
+	m.max_usecs = 0;
+	for (auto& b : m.buckets) b = 0;
+    }
+    bytes_in = 0;
+    bytes_out = 0;
+    active_connections = 0;
+    connections = 0;
+}
+
+RemoteServerStats*
+RemoteServerStats::create()
+{
+#if defined HAVE_FORK && defined MAP_ANONYMOUS && ATOMIC_LLONG_LOCK_FREE == 2
+    // Lock-free atomics work between processes sharing the memory they're
+    // in, so connections handled by forked children can update the counts.
+    void* p = mmap(NULL, sizeof(RemoteServerStats), PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p != MAP_FAILED)
+	return new (p) RemoteServerStats();
+#endif
+    return new RemoteServerStats();
+}
+
+unsigned
+RemoteServerStats::bucket(uint64_t usecs)
+{
+    if (usecs < SUB_BUCKETS) return unsigned(usecs);
+    // Find the most significant bit, then use the next two bits below it
+    // to pick the sub-bucket.
+    unsigned msb = 0;
+    while (usecs >> (msb + 1)) ++msb;
+    unsigned b = (msb - 1) * SUB_BUCKETS;
+    b += unsigned(usecs >> (msb - 2)) % SUB_BUCKETS;
+    return b < BUCKETS ? b : BUCKETS - 1;
+}
+
+uint64_t
+RemoteServerStats::bucket_max(unsigned b)
+{
+    if (b < SUB_BUCKETS) return b;
+    unsigned msb = b / SUB_BUCKETS + 1;
+    uint64_t lo = uint64_t(SUB_BUCKETS + b % SUB_BUCKETS) << (msb - 2);
+    return lo + (uint64_t(1) << (msb - 2)) - 1;
+}
+
+void
+RemoteServerStats::add_message(message_type type, double secs)
+{
+    uint64_t usecs = secs > 0 ? uint64_t(secs * 1e6 + 0.5) : 0;
+    message_stats& m = messages[type];
+    m.total_usecs += usecs;
+    ++m.buckets[bucket(usecs)];
+    uint64_t old_max = m.max_usecs;
+    while (usecs > old_max &&
+	   !m.max_usecs.compare_exchange_weak(old_max, usecs)) { }
+}
+
+/// Format a time in microseconds as seconds.
+static string
+format_secs(uint64_t usecs)
+{
+    string result = str(usecs / 1000000);
+    string frac = str(usecs % 1000000);
+    result += '.';
+    result.append(6 - frac.size(), '0');
+    result += frac;
+    return result;
+}
+
+/// Append a line for metric @a name with labels @a labels to @a out.
+static void
+add_metric(string& out, const char* name, const string& labels,
+	   const string& value)
+{
+    out += name;
+    if (!labels.empty()) {
+	out += '{';
+	out += labels;
+	out += '}';
+    }
+    out += ' ';
+    out += value;
+    out += '\n';
+}
+
+/// Append HELP and TYPE lines for metric @a name to @a out.
+static void
+add_header(string& out, const char* name, const char* type, const char* help)
+{
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+string
+RemoteServerStats::report() const
+{
+    string out;
+    add_header(out, "xapian_remote_connections", "counter",
+	       "Connections handled.");
+    add_metric(out, "xapian_remote_connections", string(),
+	       str(connections.load()));
+    add_header(out, "xapian_remote_active_connections", "gauge",
+	       "Connections currently being handled.");
+    add_metric(out, "xapian_remote_active_connections", string(),
+	       str(active_connections.load()));
+    add_header(out, "xapian_remote_received_bytes", "counter",
+	       "Bytes received in messages.");
+    add_metric(out, "xapian_remote_received_bytes", string(),
+	       str(bytes_in.load()));
+    add_header(out, "xapian_remote_sent_bytes", "counter",
+	       "Bytes sent in messages (before any compression).");
+    add_metric(out, "xapian_remote_sent_bytes", string(),
+	       str(bytes_out.load()));
+
+    add_header(out, "xapian_remote_message_seconds", "summary",
+	       "Time taken to handle each type of message.");
+    string max_lines;
+    for (unsigned type = 0; type != MSG_MAX; ++type) {
+	const message_stats& m = messages[type];
+	// Take a copy of the histogram so the quantiles are consistent.
+	uint64_t buckets[BUCKETS];
+	uint64_t count = 0;
+	for (unsigned b = 0; b != BUCKETS; ++b) {
+	    buckets[b] = m.buckets[b].load();
+	    count += buckets[b];
+	}
+	if (count == 0) continue;
+	uint64_t max_usecs = m.max_usecs.load();
+
+	string labels = "type=\"";
+	labels += message_names[type];
+	labels += '"';
+	for (auto&& quantile : quantiles) {
+	    // The rank of the message at this quantile (counting from 1).
+	    double q = quantile.q;
+	    uint64_t rank = uint64_t(q * count);
+	    if (rank < q * count || rank == 0) ++rank;
+	    uint64_t seen = 0;
+	    unsigned b = 0;
+	    while (true) {
+		seen += buckets[b];
+		if (seen >= rank || b == BUCKETS - 1) break;
+		++b;
+	    }
+	    // Report the top of the bucket, but not more than the maximum.
+	    uint64_t usecs = bucket_max(b);
+	    if (usecs > max_usecs) usecs = max_usecs;
+	    add_metric(out, "xapian_remote_message_seconds",
+		       labels + ",quantile=\"" + quantile.label + '"',
+		       format_secs(usecs));
+	}
+	add_metric(out, "xapian_remote_message_seconds_sum", labels,
+		   format_secs(m.total_usecs.load()));
+	add_metric(out, "xapian_remote_message_seconds_count", labels,
+		   str(count));
+	add_metric(max_lines, "xapian_remote_message_seconds_max", labels,
+		   format_secs(max_usecs));
+    }
+    if (!max_lines.empty()) {
+	add_header(out, "xapian_remote_message_seconds_max", "gauge",
+		   "Longest time taken to handle each type of message.");
+	out += max_lines;
+    }
+    return out;
+}
@@ -0,0 +1,132 @@
+/** @file remoteserverstats.h
+ * @brief Statistics about the messages handled by RemoteServer
+ */
+/* Copyright (C) 2026 Xapian contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef XAPIAN_INCLUDED_REMOTESERVERSTATS_H
+#define XAPIAN_INCLUDED_REMOTESERVERSTATS_H
+
+#include "xapian/visibility.h"
+
+#include "remoteprotocol.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/** Statistics about the messages handled by RemoteServer.
+ *
+ *  For each message type we count the messages and keep a histogram of how
+ *  long they took to handle.  The histogram has four buckets for each power
+ *  of two microseconds, so a reported latency is within 25% of the true
+ *  value, however widely latencies vary.
+ *
+ *  All the counters are atomic so the statistics can be updated by several
+ *  connections at once.  Use create() to allocate them in memory which is
+ *  shared with child processes, so that connections handled by forked
+ *  processes are counted too.
+ */
+class XAPIAN_VISIBILITY_DEFAULT RemoteServerStats {
+    /// Don't allow assignment.
+    void operator=(const RemoteServerStats&) = delete;
+
+    /// Don't allow copying.
+    RemoteServerStats(const RemoteServerStats&) = delete;
+
+    typedef std::atomic<std::uint64_t> counter;
+
+    /// Number of histogram buckets per power of two.
+    static constexpr unsigned SUB_BUCKETS = 4;
+
+    /// Number of histogram buckets (enough for about 12 days).
+    static constexpr unsigned BUCKETS = SUB_BUCKETS * 40;
+
+    struct message_stats {
+	/// Total time taken to handle them (in microseconds).
+	counter total_usecs;
+
+	/// The longest time taken to handle one (in microseconds).
+	counter max_usecs;
+
+	/// Histogram of the time taken to handle them.
+	counter buckets[BUCKETS];
+    };
+
+    /// Statistics for each message type.
+    message_stats messages[MSG_MAX];
+
+    /// Bytes received in messages.
+    counter bytes_in;
+
+    /// Bytes sent in messages.
+    counter bytes_out;
+
+    /// Number of connections currently being handled.
+    counter active_connections;
+
+    /// Number of connections handled in total.
+    counter connections;
+
+    /// Find the histogram bucket for @a usecs.
+    static unsigned bucket(std::uint64_t usecs);
+
+    /// Return the largest value which is counted in bucket @a b.
+    static std::uint64_t bucket_max(unsigned b);
+
+    RemoteServerStats();
+
+  public:
+    /** Allocate a new RemoteServerStats.
+     *
+     *  Where possible the statistics are held in memory which will be
+     *  shared with any child processes forked after this call.  The
+     *  returned object is never freed.
+     */
+    static RemoteServerStats* create();
+
+    /** Note that a message has been handled.
+     *
+     *  @param type	The type of the message.
+     *  @param secs	How long it took to handle (in seconds).
+     */
+    void add_message(message_type type, double secs);
+
+    /// Note that @a bytes have been received in messages.
+    void add_bytes_in(std::uint64_t bytes) { bytes_in += bytes; }
+
+    /// Note that @a bytes have been sent in messages.
+    void add_bytes_out(std::uint64_t bytes) { bytes_out += bytes; }
+
+    /// Note that a connection has started to be handled.
+    void connection_opened() {
+	++connections;
+	++active_connections;
+    }
+
+    /// Note that a connection has finished being handled.
+    void connection_closed() { --active_connections; }
+
+    /** Return a report of the statistics.
+     *
+     *  The report uses the Prometheus text format, with latencies in
+     *  seconds.  Message types which haven't been seen are omitted.
+     */
+    std::string report() const;
+};
+
+#endif // XAPIAN_INCLUDED_REMOTESERVERSTATS_H
@@ -24,11 +24,81 @@
 
 #include <xapian/error.h>
 
+#include "parseint.h"
+#include "socket_utils.h"
 #include "str.h"
 #include "tcpclient.h"
 
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <vector>
+
 using namespace std;
 
+/// Idle connections to servers, which can be reused.
+class ConnectionPool {
+    mutex pool_mutex;
+
+    /// Idle connection fds for each pool key, most recently used last.
+    map<string, vector<int>> idle;
+
+  public:
+    /// Take an idle connection for @a key, or return -1 if there isn't one.
+    int take(const string& key) {
+	lock_guard<mutex> lock(pool_mutex);
+	auto i = idle.find(key);
+	if (i == idle.end()) return -1;
+	int fd = i->second.back();
+	i->second.pop_back();
+	if (i->second.empty()) idle.erase(i);
+	return fd;
+    }
+
+    /** Add idle connection @a fd for @a key.
+     *
+     *  If there are already @a max_idle idle connections for @a key, @a fd is
+     *  closed instead.
+     */
+    void put(const string& key, int fd, unsigned max_idle) {
+	try {
+	    lock_guard<mutex> lock(pool_mutex);
+	    vector<int>& fds = idle[key];
+	    if (fds.size() < max_idle) {
+		fds.push_back(fd);
+		return;
+	    }
+	} catch (...) {
+	}
+	close_fd_or_socket(fd);
+    }
+};
+
+/** Get the process-wide pool.
+ *
+ *  The pool is never destroyed, so databases can still be closed safely while
+ *  static objects are being destroyed at exit.
+ */
+static ConnectionPool&
+get_pool()
+{
+    static ConnectionPool* pool = new ConnectionPool;
+    return *pool;
+}
+
+/// Maximum number of idle connections to keep for each server.
+static unsigned
+get_pool_size()
+{
+    const char* p = getenv("XAPIAN_REMOTE_POOL_SIZE");
+    unsigned pool_size = 0;
+    if (p && *p && !parse_unsigned(p, pool_size)) {
+	throw Xapian::InvalidArgumentError("XAPIAN_REMOTE_POOL_SIZE must be "
+					   "a non-negative integer");
+    }
+    return pool_size;
+}
+
 int
 RemoteTcpClient::open_socket(const string & hostname, int port,
 			     double timeout_connect)
@@ -56,8 +126,54 @@ RemoteTcpClient::get_tcpcontext(const string & hostname, int port)
     return result;
 }
 
+string
+RemoteTcpClient::get_pool_key(const string& hostname, int port)
+{
+    // Each xapian-tcpsrv serves a fixed set of databases, so the host and
+    // port identify what the connection is to.
+    string result = hostname;
+    result += ':';
+    result += str(port);
+    return result;
+}
+
+RemoteTcpClient*
+RemoteTcpClient::open(const string& hostname, int port,
+		      double timeout_, double timeout_connect)
+{
+    if (get_pool_size() > 0) {
+	string key = get_pool_key(hostname, port);
+	int fd;
+	while ((fd = get_pool().take(key)) >= 0) {
+	    try {
+		return new RemoteTcpClient(fd, hostname, port, timeout_);
+	    } catch (const Xapian::NetworkError&) {
+		// The connection has most likely been closed by the server
+		// after being idle for too long.  The fd has been closed, so
+		// try the next idle connection.
+	    }
+	}
+    }
+    return new RemoteTcpClient(hostname, port, timeout_, timeout_connect,
+			       false, 0);
+}
+
 RemoteTcpClient::~RemoteTcpClient()
 {
+    try {
+	if (!pool_key.empty()) {
+	    unsigned max_idle = get_pool_size();
+	    if (max_idle > 0) {
+		int fd = release_idle_connection();
+		if (fd >= 0) {
+		    get_pool().put(pool_key, fd, max_idle);
+		    return;
+		}
+	    }
+	}
+    } catch (...) {
+    }
+
     try {
 	do_close();
     } catch (...) {
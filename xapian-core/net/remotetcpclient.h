@@ -61,6 +61,23 @@ class RemoteTcpClient : SOCKET_INITIALIZER_MIXIN public RemoteDatabase {
      */
     static std::string get_tcpcontext(const std::string & hostname, int port);
 
+    /** Key for the pool of idle connections.
+     *
+     *  Empty for a writable database, since those connections can't be
+     *  reused.
+     */
+    std::string pool_key;
+
+    /// Constructor for reusing an idle connection from the pool.
+    RemoteTcpClient(int fd, const std::string& hostname, int port,
+		    double timeout_)
+	: RemoteDatabase(fd, timeout_, get_tcpcontext(hostname, port),
+			 false, 0, true),
+	  pool_key(get_pool_key(hostname, port)) { }
+
+    /// Get the pool key for a connection to port @a port of @a hostname.
+    static std::string get_pool_key(const std::string& hostname, int port);
+
   public:
     /** Constructor.
      *
@@ -78,7 +95,22 @@ class RemoteTcpClient : SOCKET_INITIALIZER_MIXIN public RemoteDatabase {
 		    int flags)
 	: RemoteDatabase(open_socket(hostname, port, timeout_connect),
 			 timeout_, get_tcpcontext(hostname, port),
-			 writable, flags) { }
+			 writable, flags) {
+	if (!writable) pool_key = get_pool_key(hostname, port);
+    }
+
+    /** Open a read-only connection, reusing an idle one if possible.
+     *
+     *  When the environment variable XAPIAN_REMOTE_POOL_SIZE is set to a
+     *  non-zero value, up to that many idle connections to each server are
+     *  kept when read-only databases are closed, and reused by later calls
+     *  to this method for the same server.  An idle connection is checked
+     *  before being reused, and a new one is opened if it fails.
+     *
+     *  Parameters are as for the constructor.
+     */
+    static RemoteTcpClient* open(const std::string& hostname, int port,
+				 double timeout_, double timeout_connect);
 
     /** Destructor. */
     ~RemoteTcpClient();
@@ -50,9 +50,12 @@ ReplicateTcpClient::update_from_master(const std::string & path,
 				       const std::string & masterdb,
 				       Xapian::ReplicationInfo & info,
 				       double reader_close_time,
-				       bool force_copy)
+				       bool force_copy,
+				       bool compress)
 {
     Xapian::DatabaseReplica replica(path);
+    if (compress)
+	remconn.send_message('C', string(), 0.0);
     remconn.send_message('R',
 			 force_copy ? string() : replica.get_revision_info(),
 			 0.0);
@@ -72,11 +72,18 @@ class XAPIAN_VISIBILITY_DEFAULT ReplicateTcpClient SOCKET_INITIALIZER_MIXIN {
     ReplicateTcpClient(const std::string & hostname, int port,
 		       double timeout_connect, double socket_timeout);
 
+    /** Update a replica from the server.
+     *
+     *  @param compress	Ask the server to compress larger messages.  Servers
+     *			from before this was supported will reject the
+     *			request.
+     */
     void update_from_master(const std::string & path,
 			    const std::string & remotedb,
 			    Xapian::ReplicationInfo & info,
 			    double reader_close_time,
-			    bool force_copy);
+			    bool force_copy,
+			    bool compress = false);
 
     /** Destructor. */
     ~ReplicateTcpClient();
@@ -42,9 +42,16 @@ ReplicateTcpServer::handle_one_connection(int socket)
 {
     RemoteConnection client(socket, -1);
     try {
-	// Read start_revision from the client.
+	// Read start_revision from the client, which may be preceded by a
+	// request for compression.
 	string start_revision;
-	if (client.get_message(start_revision, 0.0) != 'R') {
+	int type = client.get_message(start_revision, 0.0);
+	bool compress = false;
+	if (type == 'C') {
+	    compress = true;
+	    type = client.get_message(start_revision, 0.0);
+	}
+	if (type != 'R') {
 	    throw Xapian::NetworkError("Bad replication client message");
 	}
 
@@ -61,7 +68,7 @@ ReplicateTcpServer::handle_one_connection(int socket)
 	dbpath += '/';
 	dbpath += dbname;
 	Xapian::DatabaseMaster master(dbpath);
-	master.write_changesets_to_fd(socket, start_revision, NULL);
+	master.write_changesets_to_fd(socket, start_revision, NULL, compress);
     } catch (...) {
 	// Ignore exceptions.
     }
@@ -33,6 +33,7 @@
 
 #include "remoteconnection.h"
 #include "resolver.h"
+#include "safesysselect.h"
 #include "socket_utils.h"
 #include "str.h"
 
@@ -46,6 +47,12 @@
 # include <arpa/inet.h>
 # include <signal.h>
 # include <sys/wait.h>
+
+# include <condition_variable>
+# include <deque>
+# include <mutex>
+# include <thread>
+# include <vector>
 #endif
 
 #include <iostream>
@@ -53,6 +60,7 @@
 #include <cerrno>
 #include <cstring>
 #include <cstdlib>
+#include <functional>
 #include <sys/types.h>
 
 using namespace std;
@@ -249,6 +257,8 @@ TcpServer::accept_connection()
 TcpServer::~TcpServer()
 {
     CLOSESOCKET(listen_socket);
+    if (metrics_socket >= 0)
+	CLOSESOCKET(metrics_socket);
 #if defined __CYGWIN__ || defined __WIN32__
     if (mutex) CloseHandle(mutex);
 #endif
@@ -304,6 +314,8 @@ TcpServer::run()
 	    if (pid == 0) {
 		// Child process.
 		close(listen_socket);
+		if (metrics_socket >= 0)
+		    close(metrics_socket);
 
 		handle_one_connection(connected_socket);
 		close(connected_socket);
@@ -334,6 +346,86 @@ TcpServer::run()
     }
 }
 
+void
+TcpServer::run_threaded(unsigned num_threads)
+{
+    if (num_threads == 0)
+	throw Xapian::InvalidArgumentError("num_threads must be > 0");
+
+    // Handle connections until shutdown.
+
+    // There are no child processes to clean up, so the default action for
+    // SIGTERM (terminating this process) is what we want.
+    signal(SIGTERM, SIG_DFL);
+
+    // Accepted connections waiting for a free worker thread.  Once there are
+    // as many of these as workers we stop accepting, so further connections
+    // wait in the listen backlog rather than each using a file descriptor
+    // here.
+    const size_t max_pending = num_threads;
+    deque<int> pending;
+    mutex pending_mutex;
+    // Signalled when a connection is added to pending.
+    condition_variable pending_cond;
+    // Signalled when a connection is removed from pending.
+    condition_variable space_cond;
+
+    auto worker = [&]() {
+	while (true) {
+	    int connected_socket;
+	    {
+		unique_lock<mutex> lock(pending_mutex);
+		pending_cond.wait(lock, [&]() { return !pending.empty(); });
+		connected_socket = pending.front();
+		pending.pop_front();
+	    }
+	    space_cond.notify_one();
+
+	    try {
+		handle_one_connection(connected_socket);
+	    } catch (const Xapian::Error &e) {
+		// FIXME: better error handling.
+		cerr << "Caught " << e.get_description() << endl;
+	    } catch (...) {
+		// FIXME: better error handling.
+		cerr << "Caught exception." << endl;
+	    }
+	    close(connected_socket);
+
+	    if (verbose) cout << "Connection closed." << endl;
+	}
+    };
+
+    vector<thread> workers;
+    workers.reserve(num_threads);
+    for (unsigned i = 0; i != num_threads; ++i) {
+	workers.emplace_back(worker);
+    }
+
+    while (true) {
+	try {
+	    {
+		unique_lock<mutex> lock(pending_mutex);
+		space_cond.wait(lock, [&]() {
+		    return pending.size() < max_pending;
+		});
+	    }
+	    int connected_socket = accept_connection();
+	    {
+		lock_guard<mutex> lock(pending_mutex);
+		pending.push_back(connected_socket);
+	    }
+	    pending_cond.notify_one();
+	} catch (const Xapian::Error &e) {
+	    // FIXME: better error handling.
+	    cerr << "Caught " << e.get_description() << endl;
+	} catch (...) {
+	    // FIXME: better error handling.
+	    cerr << "Caught exception." << endl;
+	}
+    }
+}
+
 #elif defined __WIN32__
 
 // A threaded, Windows specific, implementation.
@@ -454,10 +546,128 @@ TcpServer::run()
     }
 }
 
+void
+TcpServer::run_threaded(unsigned num_threads)
+{
+    if (num_threads == 0)
+	throw Xapian::InvalidArgumentError("num_threads must be > 0");
+    // We already handle each connection in a thread in this process, so
+    // resources can be reused between connections without a pool.
+    run();
+}
+
 #else
 # error Neither HAVE_FORK nor __WIN32__ are defined.
 #endif
 
+/// Reply to a connection to the metrics port with a report.
+static void
+send_metrics(int fd, const function<string()>& report)
+{
+    // Give the client a moment to send a request, so we can tell if it
+    // wants an HTTP response.
+    char buf[1024];
+    int n = 0;
+    fd_set fdset;
+    FD_ZERO(&fdset);
+    FD_SET(fd, &fdset);
+    struct timeval tv;
+    tv.tv_sec = 1;
+    tv.tv_usec = 0;
+    if (select(fd + 1, &fdset, NULL, NULL, &tv) > 0)
+	n = int(recv(fd, buf, sizeof(buf), 0));
+
+    string reply = report();
+    if (n >= 4 && memcmp(buf, "GET ", 4) == 0) {
+	string header = "HTTP/1.0 200 OK\r\n"
+			"Content-Type: text/plain; version=0.0.4\r\n"
+			"Content-Length: ";
+	header += str(reply.size());
+	header += "\r\nConnection: close\r\n\r\n";
+	reply.insert(0, header);
+    }
+
+    const char* p = reply.data();
+    size_t left = reply.size();
+    while (left) {
+	int r = int(send(fd, p, left, 0));
+	if (r < 0 && socket_errno() == EINTR) continue;
+	if (r <= 0) break;
+	p += r;
+	left -= r;
+    }
+    CLOSESOCKET(fd);
+}
+
+/// Accept connections to the metrics port until it's closed.
+static void
+run_metrics(int metrics_socket, const function<string()>& report)
+{
+    while (true) {
+	int fd = accept(metrics_socket, NULL, NULL);
+	if (fd < 0) {
+	    int accept_errno = socket_errno();
+	    if (accept_errno == EINTR) continue;
+	    Xapian::NetworkError e("accept failed", accept_errno);
+	    cerr << "Metrics: caught " << e.get_description() << endl;
+	    return;
+	}
+	send_metrics(fd, report);
+    }
+}
+
+#ifdef __WIN32__
+/// Structure which is used to pass parameters to the metrics thread.
+struct metrics_thread_param {
+    int metrics_socket;
+    function<string()> report;
+};
+
+/// The metrics thread entry-point.
+static unsigned __stdcall
+run_metrics_thread(void * param_)
+{
+    metrics_thread_param * param =
+	reinterpret_cast<metrics_thread_param *>(param_);
+    run_metrics(param->metrics_socket, param->report);
+    delete param;
+    _endthreadex(0);
+    return 0;
+}
+#endif
+
+void
+TcpServer::serve_metrics(const std::string& host, int port,
+			 function<string()> report)
+{
+    if (metrics_socket >= 0)
+	throw Xapian::InvalidOperationError("Already serving metrics");
+#if defined __CYGWIN__ || defined __WIN32__
+    // The mutex is held until the process exits, like the socket.
+    HANDLE metrics_mutex = NULL;
+    metrics_socket = get_listening_socket(host, port, false, metrics_mutex);
+#else
+    metrics_socket = get_listening_socket(host, port, false);
+#endif
+
+#ifdef __WIN32__
+    auto param = new metrics_thread_param{metrics_socket, std::move(report)};
+    HANDLE hthread = (HANDLE)_beginthreadex(NULL, 0, ::run_metrics_thread,
+					    param, 0, NULL);
+    if (hthread == 0) {
+	int saved_errno = errno;
+	delete param;
+	throw Xapian::NetworkError("_beginthreadex failed", saved_errno);
+    }
+    CloseHandle(hthread);
+#else
+    // We'll still know if the client closes the connection early because
+    // we'll get EPIPE back from send().
+    signal(SIGPIPE, SIG_IGN);
+    thread(run_metrics, metrics_socket, std::move(report)).detach();
+#endif
+}
+
 void
 TcpServer::run_once()
 {
@@ -34,6 +34,7 @@
 
 #include <xapian/visibility.h>
 
+#include <functional>
 #include <string>
 
 /** TCP/IP socket based server for RemoteDatabase.
@@ -55,6 +56,9 @@ class XAPIAN_VISIBILITY_DEFAULT TcpServer SOCKET_INITIALIZER_MIXIN {
     /** The socket we're listening on. */
     int listen_socket;
 
+    /** The socket we're listening on for metrics requests, or -1. */
+    int metrics_socket = -1;
+
     /** Create a listening socket ready to accept connections.
      *
      *  @param host	hostname or address to listen on or an empty string to
@@ -102,9 +106,44 @@ class XAPIAN_VISIBILITY_DEFAULT TcpServer SOCKET_INITIALIZER_MIXIN {
      */
     void run();
 
+    /** Accept connections and service them with a fixed pool of threads.
+     *
+     *  Unlike run(), every connection is handled in this process by one of
+     *  @a num_threads worker threads, which avoids the cost of a fork() per
+     *  connection and allows resources to be reused between connections.
+     *  A worker handles one connection at a time until the client closes
+     *  it, so at most @a num_threads connections are served at once.  If all
+     *  the workers are busy, up to @a num_threads more connections are
+     *  accepted to wait for a free worker, and any beyond that wait in the
+     *  listen backlog (which the OS may refuse connections from once full).
+     *
+     *  handle_one_connection() must be safe to call from several threads at
+     *  once to use this method.
+     *
+     *  @param num_threads	The number of worker threads (must be > 0).
+     */
+    void run_threaded(unsigned num_threads);
+
     /** Accept a single connection, service requests on it, then stop.  */
     void run_once();
 
+    /** Serve a metrics report on another port.
+     *
+     *  A thread is started which accepts connections on @a port and replies
+     *  to each with the text returned by @a report.  If the client sends an
+     *  HTTP GET request the reply is an HTTP response, so the report can be
+     *  fetched by monitoring systems which scrape HTTP endpoints; otherwise
+     *  just the text is sent.
+     *
+     *  @param host	The hostname or address for the interface to listen on
+     *			(or "" to listen on all interfaces).
+     *  @param port	The TCP port number to listen on.
+     *  @param report	Function returning the report.  It's called from the
+     *			metrics thread, so must be thread-safe.
+     */
+    void serve_metrics(const std::string& host, int port,
+		       std::function<std::string()> report);
+
     /// Handle a single connection on an already connected socket.
     virtual void handle_one_connection(int socket) = 0;
 };
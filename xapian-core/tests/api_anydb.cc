@@ -28,7 +28,12 @@
 #include "api_anydb.h"
 
 #include <algorithm>
+#include <exception>
+#include <functional>
+#include <future>
 #include <string>
+#include <thread>
+#include <vector>
 
 #define XAPIAN_DEPRECATED(X) X
 #include <xapian.h>
@@ -204,6 +209,110 @@ DEFINE_TESTCASE(simplequery3, backend) {
     TEST_MSET_SIZE(mymset, 6);
 }
 
+/// Test Enquire::get_mset_async() gives the same results as get_mset().
+DEFINE_TESTCASE(getmsetasync1, backend) {
+    Xapian::Enquire enquire(get_database("apitest_simpledata"));
+    enquire.set_query(query(Xapian::Query::OP_OR, "this", "word"));
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+
+    // Run the task straight away, which makes this test deterministic.
+    auto run_now = [](const function<void()>& task) { task(); };
+
+    Xapian::MSet async_mset;
+    bool called = false;
+    enquire.get_mset_async(run_now,
+			   [&](Xapian::MSet m, exception_ptr error) {
+			       TEST(!error);
+			       async_mset = m;
+			       called = true;
+			   },
+			   0, 10);
+    TEST(called);
+    TEST_EQUAL(async_mset, mset);
+    TEST_EQUAL(async_mset.begin().get_document().get_data(),
+	       mset.begin().get_document().get_data());
+
+    // Check the RSet is copied.
+    Xapian::RSet rset;
+    rset.add_document(2);
+    mset = enquire.get_mset(0, 10, &rset);
+    called = false;
+    {
+	Xapian::RSet rset_copy(rset);
+	vector<function<void()>> queued;
+	enquire.get_mset_async([&](const function<void()>& task) {
+				   queued.push_back(task);
+			       },
+			       [&](Xapian::MSet m, exception_ptr error) {
+				   TEST(!error);
+				   async_mset = m;
+				   called = true;
+			       },
+			       0, 10, 0, &rset_copy);
+	rset_copy = Xapian::RSet();
+	TEST(!called);
+	TEST_EQUAL(queued.size(), 1);
+	queued[0]();
+    }
+    TEST(called);
+    TEST_EQUAL(async_mset, mset);
+
+    // Check the version which runs the match in a thread.
+    auto future = enquire.get_mset_async(0, 10);
+    // We mustn't use enquire again until the future is ready.
+    async_mset = future.get();
+    TEST_EQUAL(async_mset, enquire.get_mset(0, 10));
+}
+
+/// Test more std::future get_mset_async() calls than the pool has threads.
+DEFINE_TESTCASE(getmsetasync3, path) {
+    const string path = get_database_path("apitest_simpledata");
+    Xapian::Query q = query(Xapian::Query::OP_OR, "this", "word");
+    Xapian::Enquire ref_enquire{Xapian::Database(path)};
+    ref_enquire.set_query(q);
+    Xapian::MSet ref = ref_enquire.get_mset(0, 10);
+
+    // Each match in flight needs its own Enquire and Database.
+    unsigned n = 4 * thread::hardware_concurrency() + 3;
+    vector<Xapian::Enquire> enquires;
+    for (unsigned i = 0; i != n; ++i) {
+	enquires.emplace_back(Xapian::Database(path));
+	enquires.back().set_query(q);
+    }
+    vector<future<Xapian::MSet>> futures;
+    for (auto&& enquire : enquires) {
+	futures.push_back(enquire.get_mset_async(0, 10));
+    }
+    for (auto&& f : futures) {
+	Xapian::MSet mset = f.get();
+	TEST(mset_range_is_same(mset, 0, ref, 0, ref.size()));
+    }
+}
+
+/// Test exceptions from Enquire::get_mset_async() are reported.
+DEFINE_TESTCASE(getmsetasync2, backend) {
+    Xapian::Enquire enquire(get_database("apitest_simpledata"));
+    enquire.set_query(query("this"));
+    // Sorting by value with a percentage cutoff isn't supported.
+    enquire.set_sort_by_value(1, false);
+    enquire.set_cutoff(50);
+
+    bool called = false;
+    enquire.get_mset_async([](const function<void()>& task) { task(); },
+			   [&](Xapian::MSet m, exception_ptr error) {
+			       TEST(error);
+			       TEST(m.empty());
+			       TEST_EXCEPTION(Xapian::UnimplementedError,
+					      rethrow_exception(error));
+			       called = true;
+			   },
+			   0, 10);
+    TEST(called);
+
+    auto future = enquire.get_mset_async(0, 10);
+    TEST_EXCEPTION(Xapian::UnimplementedError, future.get());
+}
+
 // multidb2 no longer exists.
 
 // test that a multidb with 2 dbs query returns correct docids
@@ -1083,6 +1192,112 @@ DEFINE_TESTCASE(fetchdocs1, backend) {
     TEST_EQUAL(it1, mymset2.end());
 }
 
+/// Check prefetching a range of documents from several shards.
+DEFINE_TESTCASE(fetchdocs2, backend) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    db.add_database(get_database("apitest_simpledata2"));
+    Xapian::Enquire enquire(db);
+    enquire.set_query(query(Xapian::Query::OP_OR, "this", "word"));
+
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_REL(mset.size(), >=, 4);
+    mset.fetch(mset[2], mset[mset.size() - 1]);
+
+    for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	Xapian::Document doc = i.get_document();
+	Xapian::Document expected = db.get_document(*i);
+	TEST_EQUAL(doc.get_data(), expected.get_data());
+	TEST_NOT_EQUAL(doc.get_data(), "");
+	TEST_EQUAL(doc.values_count(), expected.values_count());
+	Xapian::ValueIterator v1 = doc.values_begin();
+	Xapian::ValueIterator v2 = expected.values_begin();
+	while (v1 != doc.values_end() && v2 != expected.values_end()) {
+	    TEST_EQUAL(v1.get_valueno(), v2.get_valueno());
+	    TEST_EQUAL(*v1, *v2);
+	    ++v1;
+	    ++v2;
+	}
+	TEST(v1 == doc.values_end());
+	TEST(v2 == expected.values_end());
+    }
+}
+
+/// Check fetched documents are kept in the MSet.
+DEFINE_TESTCASE(fetchdocs4, backend && !inmemory) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Enquire enquire(db);
+    enquire.set_query(query(Xapian::Query::OP_OR, "this", "word"));
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_REL(mset.size(), >=, 5);
+
+    vector<string> data;
+    for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	data.push_back(db.get_document(*i).get_data());
+    }
+
+    mset.fetch(mset[1], mset[4]);
+    mset.fetch(mset[4]);
+    // Once the database is closed, only the fetched documents are available.
+    db.close();
+    TEST_EXCEPTION(Xapian::DatabaseClosedError,
+		   mset[0].get_document().get_data());
+    for (Xapian::doccount i = 1; i != 5; ++i) {
+	Xapian::Document doc = mset[i].get_document();
+	TEST_EQUAL(doc.get_data(), data[i]);
+	(void)doc.values_count();
+    }
+    // The MSet keeps a fetched document after returning it, so a second
+    // read doesn't need the database.
+    for (Xapian::doccount i = 1; i != 5; ++i) {
+	Xapian::Document doc = mset[i].get_document();
+	TEST_EQUAL(doc.get_data(), data[i]);
+    }
+}
+
+/// Check the batch document statistics methods match the single ones.
+DEFINE_TESTCASE(batchdocstats1, backend) {
+    Xapian::Database db = get_database("etext");
+    vector<Xapian::docid> dids;
+    for (Xapian::docid did = 1; did <= db.get_lastdocid(); did += 3) {
+	dids.push_back(did);
+    }
+    TEST_REL(dids.size(), >, 100);
+
+    vector<Xapian::termcount> doclens = db.get_doclength(dids);
+    vector<Xapian::termcount> uniqs = db.get_unique_terms(dids);
+    TEST_EQUAL(doclens.size(), dids.size());
+    TEST_EQUAL(uniqs.size(), dids.size());
+    for (size_t i = 0; i != dids.size(); ++i) {
+	TEST_EQUAL(doclens[i], db.get_doclength(dids[i]));
+	TEST_EQUAL(uniqs[i], db.get_unique_terms(dids[i]));
+    }
+
+    for (Xapian::valueno slot = 0; slot < 15; ++slot) {
+	vector<string> values = db.get_values(dids, slot);
+	TEST_EQUAL(values.size(), dids.size());
+	for (size_t i = 0; i != dids.size(); ++i) {
+	    TEST_EQUAL(values[i], db.get_document(dids[i]).get_value(slot));
+	}
+    }
+
+    // Repeated docids are allowed, and documents which don't exist have no
+    // values.
+    dids = { 2, 2, db.get_lastdocid() + 1 };
+    vector<string> values = db.get_values(dids, 0);
+    TEST_EQUAL(values.size(), 3);
+    TEST_EQUAL(values[0], db.get_document(2).get_value(0));
+    TEST_EQUAL(values[1], values[0]);
+    TEST_EQUAL(values[2], string());
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_doclength(dids));
+
+    TEST(db.get_doclength(vector<Xapian::docid>()).empty());
+
+    dids = { 3, 2 };
+    TEST_EXCEPTION(Xapian::InvalidArgumentError, db.get_doclength(dids));
+    dids = { 0, 2 };
+    TEST_EXCEPTION(Xapian::InvalidArgumentError, db.get_values(dids, 0));
+}
+
 // test that searching for a term not in the database fails nicely
 DEFINE_TESTCASE(absentterm1, backend) {
     Xapian::Enquire enquire(get_database("apitest_simpledata"));
@@ -49,6 +49,8 @@
 #include <cerrno>
 #include <fstream>
 #include <iterator>
+#include <thread>
+#include <vector>
 
 using namespace std;
 
@@ -1865,6 +1867,111 @@ DEFINE_TESTCASE(positfrompostit1, positional) {
     }
 }
 
+/// Feature tests for Database::clone().
+DEFINE_TESTCASE(clone1, glass) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Database db2 = db.clone();
+    TEST_EQUAL(db2.get_doccount(), db.get_doccount());
+    TEST_EQUAL(db2.get_lastdocid(), db.get_lastdocid());
+    TEST_EQUAL(db2.get_uuid(), db.get_uuid());
+
+    // Check the two objects have independent cursors by reading the same
+    // postlist from each in step.
+    auto p1 = db.postlist_begin("this");
+    auto p2 = db2.postlist_begin("this");
+    TEST_NOT_EQUAL(p1, db.postlist_end("this"));
+    while (p1 != db.postlist_end("this")) {
+	TEST_NOT_EQUAL(p2, db2.postlist_end("this"));
+	TEST_EQUAL(*p1, *p2);
+	TEST_EQUAL(db.get_document(*p1).get_data(),
+		   db2.get_document(*p2).get_data());
+	++p1;
+	++p2;
+    }
+    TEST_EQUAL(p2, db2.postlist_end("this"));
+
+    Xapian::Enquire enq1(db), enq2(db2);
+    enq1.set_query(Xapian::Query("this"));
+    enq2.set_query(Xapian::Query("this"));
+    TEST_EQUAL(enq1.get_mset(0, 10), enq2.get_mset(0, 10));
+
+    // Closing the original shouldn't affect the clone.
+    db.close();
+    TEST_EXCEPTION(Xapian::DatabaseClosedError, db.postlist_begin("this"));
+    TEST_EQUAL(db2.get_document(1).get_data(),
+	       get_database("apitest_simpledata").get_document(1).get_data());
+    TEST_EQUAL(db2.get_termfreq("this"), 6);
+
+    // A sharded database can be cloned too.
+    Xapian::Database multi;
+    multi.add_database(db2);
+    multi.add_database(db2);
+    Xapian::Database multi2 = multi.clone();
+    TEST_EQUAL(multi2.get_doccount(), 2 * db2.get_doccount());
+    TEST_EQUAL(multi2.get_termfreq("this"), 12);
+
+    TEST_EQUAL(Xapian::Database().clone().get_doccount(), 0);
+}
+
+/// Test Database::clone() with a database which is being modified.
+DEFINE_TESTCASE(clone2, glass) {
+    Xapian::WritableDatabase wdb = get_writable_database();
+    TEST_EXCEPTION(Xapian::InvalidOperationError, wdb.clone());
+    wdb.add_document(Xapian::Document());
+    wdb.commit();
+
+    Xapian::Database db = get_writable_database_as_database();
+    Xapian::Database db2 = db.clone();
+    TEST_EQUAL(db2.get_doccount(), 1);
+
+    wdb.add_document(Xapian::Document());
+    wdb.commit();
+    // Each object can be reopened independently.
+    TEST(db2.reopen());
+    TEST_EQUAL(db2.get_doccount(), 2);
+    TEST_EQUAL(db.get_doccount(), 1);
+    TEST(db.reopen());
+    TEST_EQUAL(db.get_doccount(), 2);
+
+    // A clone of a clone reads the same revision as the clone.
+    Xapian::Database db3 = db2.clone();
+    db2.close();
+    TEST_EQUAL(db3.get_doccount(), 2);
+}
+
+/// Test searching cloned handles from two threads at once.
+DEFINE_TESTCASE(clone3, glass) {
+    Xapian::Database db = get_database("etext");
+    const char* terms[] = { "the", "of", "water", "point", "king" };
+    auto search = [&terms](const Xapian::Database& d) {
+	vector<string> result;
+	Xapian::Enquire enquire(d);
+	for (int i = 0; i != 20; ++i) {
+	    for (auto term : terms) {
+		enquire.set_query(Xapian::Query(term));
+		Xapian::MSet mset = enquire.get_mset(0, 20);
+		for (auto m = mset.begin(); m != mset.end(); ++m) {
+		    result.push_back(m.get_document().get_data());
+		}
+	    }
+	}
+	return result;
+    };
+    vector<string> expected = search(db);
+    TEST(!expected.empty());
+
+    // Each thread clones the handle itself, since several threads may call
+    // clone() on the same object at once.
+    vector<string> results[2];
+    auto run = [&](int i) { results[i] = search(db.clone()); };
+    thread t1(run, 0);
+    thread t2(run, 1);
+    t1.join();
+    t2.join();
+    TEST(results[0] == expected);
+    TEST(results[1] == expected);
+}
+
 /* Test searching for non-existent terms returns zero results.
  *
  * Regression test for GlassTable::readahead_key() throwing "Key too long"
@@ -533,6 +533,76 @@ DEFINE_TESTCASE(compactmergesynonym1, compact && generated) {
     }
 }
 
+static void
+make_synonyms_d1(Xapian::WritableDatabase &db, const string &)
+{
+    db.add_spelling("dog");
+    db.add_synonym("Dfoo", "Dbar");
+    db.add_synonym("Dtest", "Dtrial");
+    db.add_synonym("dog", "hound");
+    db.commit();
+}
+
+static void
+make_synonyms_d2(Xapian::WritableDatabase &db, const string &)
+{
+    db.add_synonym("D", "Dbare");
+    db.add_synonym("Dtest", "Dexam");
+    db.commit();
+}
+
+/// Regression test - synonym keys starting with 'D' were dropped.
+DEFINE_TESTCASE(compactmergesynonym2, compact && generated) {
+    string a = get_database_path("compactmergesynonym2a",
+				 make_synonyms_d1);
+    string b = get_database_path("compactmergesynonym2b",
+				 make_synonyms_d2);
+
+    string out = get_compaction_output_path("compactmergesynonym2out");
+    rm_rf(out);
+
+    {
+	Xapian::Database db;
+	db.add_database(Xapian::Database(a));
+	db.add_database(Xapian::Database(b));
+	db.compact(out);
+    }
+
+    {
+	Xapian::Database db(out);
+
+	Xapian::TermIterator i = db.synonym_keys_begin();
+	TEST_NOT_EQUAL(i, db.synonym_keys_end());
+	TEST_EQUAL(*i, "D");
+	++i;
+	TEST_NOT_EQUAL(i, db.synonym_keys_end());
+	TEST_EQUAL(*i, "Dfoo");
+	++i;
+	TEST_NOT_EQUAL(i, db.synonym_keys_end());
+	TEST_EQUAL(*i, "Dtest");
+	++i;
+	TEST_NOT_EQUAL(i, db.synonym_keys_end());
+	TEST_EQUAL(*i, "dog");
+	++i;
+	TEST_EQUAL(i, db.synonym_keys_end());
+
+	i = db.synonyms_begin("D");
+	TEST_NOT_EQUAL(i, db.synonyms_end("D"));
+	TEST_EQUAL(*i, "Dbare");
+	++i;
+	TEST_EQUAL(i, db.synonyms_end("D"));
+
+	i = db.synonyms_begin("Dtest");
+	TEST_NOT_EQUAL(i, db.synonyms_end("Dtest"));
+	TEST_EQUAL(*i, "Dexam");
+	++i;
+	TEST_NOT_EQUAL(i, db.synonyms_end("Dtest"));
+	TEST_EQUAL(*i, "Dtrial");
+	++i;
+	TEST_EQUAL(i, db.synonyms_end("Dtest"));
+    }
+}
+
 DEFINE_TESTCASE(compactempty1, compact) {
     string empty_dbpath = get_database_path(string());
     string outdbpath = get_compaction_output_path("compactempty1out");
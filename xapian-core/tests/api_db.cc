@@ -30,14 +30,21 @@
 #include <fstream>
 #include <map>
 #include <string>
+#include <thread>
 #include <vector>
 #include "safenetdb.h" // For gai_strerror().
 #include "safesysstat.h" // For mkdir().
 #include "safeunistd.h" // For sleep().
+#include "setenv.h"
+#if defined HAVE_FORK && defined HAVE_POLL
+# include <signal.h>
+#endif
 
 #include <xapian.h>
 
 #include "backendmanager.h"
+#include "str.h"
+#include "stringutils.h"
 #include "testsuite.h"
 #include "testutils.h"
 #include "unixcmds.h"
@@ -863,6 +870,353 @@ DEFINE_TESTCASE(keepalive1, remote) {
 			      enquire.get_mset(0, 10));
 }
 
+// Test reusing idle remote connections.
+DEFINE_TESTCASE(remotepool1, remote && !multi) {
+    Xapian::Database db(get_remote_database("apitest_simpledata", 10000));
+    // Only connections made with the tcp method are reused.
+    const string desc = db.get_description();
+    size_t start = desc.find("remote:tcp(");
+    if (start == string::npos)
+	SKIP_TEST("Not using the tcp method");
+    start += CONST_STRLEN("remote:tcp(");
+    size_t colon = desc.find(':', start);
+    string host(desc, start, colon - start);
+    unsigned port = atoi(desc.c_str() + colon + 1);
+    Xapian::doccount doccount = db.get_doccount();
+
+    // Ensure that we don't leave connection pooling on for the next test,
+    // even if this one fails.
+    struct unset_pool_size {
+	~unset_pool_size() { setenv("XAPIAN_REMOTE_POOL_SIZE", "0", 1); }
+    } unset_pool_size_afterwards;
+    setenv("XAPIAN_REMOTE_POOL_SIZE", "1", 1);
+
+    // The test harness runs xapian-tcpsrv with --one-shot so it only accepts
+    // a single connection - reopening can only work if that connection is
+    // reused.
+    db = Xapian::Database();
+    for (int i = 0; i != 3; ++i) {
+	Xapian::Database db2(Xapian::Remote::open(host, port));
+	TEST_EQUAL(db2.get_doccount(), doccount);
+	Xapian::Enquire enquire(db2);
+	enquire.set_query(Xapian::Query("word"));
+	TEST(!enquire.get_mset(0, 10).empty());
+    }
+
+    // Take the connection from the pool again so it gets closed.
+    db = Xapian::Remote::open(host, port);
+    TEST_EQUAL(db.get_doccount(), doccount);
+}
+
+// Test xapian-tcpsrv serving connections with a pool of threads.
+DEFINE_TESTCASE(remotethreads1, remote && !multi) {
+    skip_test_unless_backend("remotetcp");
+    Xapian::Database db(get_remote_database_threaded("apitest_simpledata", 2));
+    const string desc = db.get_description();
+    size_t start = desc.find("remote:tcp(");
+    TEST(start != string::npos);
+    start += CONST_STRLEN("remote:tcp(");
+    size_t colon = desc.find(':', start);
+    string host(desc, start, colon - start);
+    unsigned port = atoi(desc.c_str() + colon + 1);
+    Xapian::doccount doccount = db.get_doccount();
+
+    // Search over two connections at once, so both worker threads are busy.
+    Xapian::Database db2(Xapian::Remote::open(host, port));
+    auto search = [](Xapian::Database d, Xapian::doccount* result) {
+	Xapian::Enquire enquire(d);
+	enquire.set_query(Xapian::Query("word"));
+	*result = enquire.get_mset(0, 10).size();
+    };
+    Xapian::doccount size1 = 0, size2 = 0;
+    thread t1(search, db, &size1);
+    thread t2(search, db2, &size2);
+    t1.join();
+    t2.join();
+    TEST_NOT_EQUAL(size1, 0);
+    TEST_EQUAL(size1, size2);
+
+    // The worker threads should handle new connections once the existing
+    // ones are closed.
+    db = Xapian::Database();
+    db2 = Xapian::Database();
+    for (int i = 0; i != 3; ++i) {
+	Xapian::Database db3(Xapian::Remote::open(host, port));
+	TEST_EQUAL(db3.get_doccount(), doccount);
+    }
+}
+
+// Test searching replicas of a remote database with hedged requests.
+DEFINE_TESTCASE(hedgedsearch1, remote && !multi) {
+    Xapian::Database db1(get_remote_database("apitest_simpledata", 10000));
+    Xapian::Database db2(get_remote_database("apitest_simpledata", 10000));
+    Xapian::Database db3(get_remote_database("apitest_simpledata", 10000));
+
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   Xapian::Remote::replicated({}));
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   Xapian::Remote::replicated({db1, db1}));
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   Xapian::Remote::replicated({db1, db2}, 101.0));
+
+    // With a percentile of 0, a search is hedged whenever a reply takes
+    // longer than the fastest recent one, so plenty of searches should be.
+    Xapian::Database db = Xapian::Remote::replicated({db1, db2, db3}, 0.0);
+
+    // db1 now has replicas, so can't be a replica itself.
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   Xapian::Remote::replicated({db2, db1}));
+
+    Xapian::Query query(Xapian::Query::OP_OR,
+			Xapian::Query("this"), Xapian::Query("word"));
+    Xapian::Enquire ref_enquire(get_remote_database("apitest_simpledata",
+						    10000));
+    ref_enquire.set_query(query);
+    Xapian::MSet ref = ref_enquire.get_mset(0, 10);
+    TEST(!ref.empty());
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(query);
+    for (int i = 0; i != 50; ++i) {
+	Xapian::MSet mset = enquire.get_mset(0, 10);
+	TEST(mset_range_is_same(mset, 0, ref, 0, ref.size()));
+	TEST_EQUAL(mset.size(), ref.size());
+	// Check that abandoned searches don't leave the connection out of
+	// step.
+	TEST_EQUAL(db.get_document(*mset[0]).get_data(),
+		   ref[0].get_document().get_data());
+    }
+
+    // Also search the replicated shard alongside another shard.
+    Xapian::Database multi;
+    multi.add_database(db);
+    multi.add_database(get_remote_database("apitest_simpledata", 10000));
+    Xapian::Database ref_multi;
+    ref_multi.add_database(get_remote_database("apitest_simpledata", 10000));
+    ref_multi.add_database(get_remote_database("apitest_simpledata", 10000));
+    Xapian::Enquire ref_multi_enquire(ref_multi);
+    ref_multi_enquire.set_query(query);
+    ref = ref_multi_enquire.get_mset(0, 10);
+
+    Xapian::Enquire multi_enquire(multi);
+    multi_enquire.set_query(query);
+    for (int i = 0; i != 20; ++i) {
+	Xapian::MSet mset = multi_enquire.get_mset(0, 10);
+	TEST(mset_range_is_same(mset, 0, ref, 0, ref.size()));
+	TEST_EQUAL(mset.size(), ref.size());
+    }
+}
+
+#if defined HAVE_FORK && defined HAVE_POLL
+/// Stop a process, and let it continue again on destruction.
+struct StoppedProcess {
+    pid_t pid;
+
+    explicit StoppedProcess(pid_t pid_) : pid(pid_) {
+	kill(pid, SIGSTOP);
+    }
+
+    ~StoppedProcess() {
+	kill(pid, SIGCONT);
+    }
+};
+#endif
+
+// Check a search is hedged when the database it's sent to doesn't reply.
+DEFINE_TESTCASE(hedgedsearch2, path) {
+#if defined XAPIAN_HAS_REMOTE_BACKEND && defined HAVE_FORK && defined HAVE_POLL
+    // Run the servers via a script which records their pids, so we can stop
+    // one of them.
+    mkdir(".stub", 0755);
+    const char* script = ".stub/hedgedsearch2.sh";
+    {
+	ofstream out(script);
+	TEST(out.is_open());
+	out << "echo $$ > \"$1\"\n"
+	       "shift\n"
+	       "exec " << BackendManager::get_xapian_progsrv_command()
+	    << " \"$@\"\n";
+    }
+    string args = " -t10000 " + get_database_path("apitest_simpledata");
+    Xapian::Database db = Xapian::Remote::open("/bin/sh",
+					       string(script) +
+					       " .stub/hedgedsearch2.pid" +
+					       args);
+    Xapian::Database replica = Xapian::Remote::open("/bin/sh",
+						    string(script) +
+						    " /dev/null" + args);
+    pid_t pid;
+    {
+	ifstream in(".stub/hedgedsearch2.pid");
+	TEST(in >> pid);
+    }
+    db = Xapian::Remote::replicated({db, replica}, 0.0);
+
+    Xapian::Query query(Xapian::Query::OP_OR,
+			Xapian::Query("this"), Xapian::Query("word"));
+    Xapian::Enquire ref_enquire(get_database("apitest_simpledata"));
+    ref_enquire.set_query(query);
+    Xapian::MSet ref = ref_enquire.get_mset(0, 10);
+    TEST(!ref.empty());
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(query);
+    // Record enough reply times for searches to be hedged.
+    for (int i = 0; i != 10; ++i) {
+	Xapian::MSet mset = enquire.get_mset(0, 10);
+	TEST(mset_range_is_same(mset, 0, ref, 0, ref.size()));
+    }
+    // Bring the connection to db back into step if the last search on it
+    // was abandoned, so the next search is sent to it first.
+    Xapian::Database local = get_database("apitest_simpledata");
+    TEST_EQUAL(db.get_termfreq("word"), local.get_termfreq("word"));
+
+    {
+	StoppedProcess stopped(pid);
+	// Without hedging this would wait until the time limit and then leave
+	// the shard out.
+	enquire.set_shard_time_limit(10.0);
+	Xapian::MSet mset = enquire.get_mset(0, 10);
+	TEST(!mset.shard_timed_out(0));
+	TEST(mset_range_is_same(mset, 0, ref, 0, ref.size()));
+	TEST_EQUAL(mset.size(), ref.size());
+    }
+
+    // The abandoned search doesn't leave the connection out of step.
+    TEST_EQUAL(db.get_termfreq("word"), local.get_termfreq("word"));
+    enquire.set_shard_time_limit(0.0);
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST(mset_range_is_same(mset, 0, ref, 0, ref.size()));
+    TEST_EQUAL(db.get_document(*mset[0]).get_data(),
+	       ref[0].get_document().get_data());
+#else
+    SKIP_TEST("Needs the remote backend, fork() and poll()");
+#endif
+}
+
+// Test Enquire::set_shard_time_limit().
+DEFINE_TESTCASE(shardtimelimit1, remote && !multi) {
+    Xapian::Database db;
+    db.add_database(get_remote_database("apitest_simpledata", 10000));
+    db.add_database(get_remote_database("apitest_simpledata", 10000));
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("word"));
+    Xapian::MSet ref = enquire.get_mset(0, 10);
+    TEST(!ref.empty());
+    TEST(!ref.shard_timed_out(0));
+    TEST(!ref.shard_timed_out(1));
+
+    // A generous limit shouldn't change the results.
+    enquire.set_shard_time_limit(60.0);
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset, ref);
+    TEST(!mset.shard_timed_out(0));
+    TEST(!mset.shard_timed_out(1));
+
+    // The limit will have passed before we check for replies.
+    enquire.set_shard_time_limit(1e-9);
+    mset = enquire.get_mset(0, 10);
+    TEST(mset.empty());
+    TEST(mset.shard_timed_out(0));
+    TEST(mset.shard_timed_out(1));
+    TEST(!mset.shard_timed_out(2));
+
+    // Check that the shards which timed out still work.
+    enquire.set_shard_time_limit(0.0);
+    mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset, ref);
+    TEST(!mset.shard_timed_out(0));
+    TEST_EQUAL(db.get_document(*mset[0]).get_data(),
+	       ref[0].get_document().get_data());
+
+    // Check a single remote database too.
+    Xapian::Enquire enquire1(get_remote_database("apitest_simpledata", 10000));
+    enquire1.set_query(Xapian::Query("word"));
+    enquire1.set_shard_time_limit(1e-9);
+    mset = enquire1.get_mset(0, 10);
+    TEST(mset.empty());
+    TEST(mset.shard_timed_out(0));
+    enquire1.set_shard_time_limit(0.0);
+    mset = enquire1.get_mset(0, 10);
+    TEST(!mset.empty());
+}
+
+static void
+make_streamedlists1_db(Xapian::WritableDatabase& db, const string&)
+{
+    Xapian::Document doc;
+    for (Xapian::termpos i = 1; i <= 3000; ++i) {
+	doc.add_posting("t" + str(i), i);
+    }
+    doc.add_term("all");
+    doc.add_term("odd");
+    db.add_document(doc);
+    for (Xapian::docid did = 2; did <= 5000; ++did) {
+	doc.clear_terms();
+	doc.add_term("all");
+	if (did & 1) doc.add_term("odd");
+	db.add_document(doc);
+    }
+}
+
+// Check lists which are streamed from a remote server in chunks.
+DEFINE_TESTCASE(streamedlists1, generated) {
+    Xapian::Database db = get_database("streamedlists1",
+				       make_streamedlists1_db);
+
+    // Stop part way through a long postlist, then check we're still in step
+    // with the server.
+    {
+	Xapian::PostingIterator p = db.postlist_begin("all");
+	p.skip_to(100);
+	TEST_EQUAL(*p, 100);
+    }
+    TEST_EQUAL(db.get_termfreq("all"), 5000);
+    TEST_EQUAL(db.get_termfreq("odd"), 2500);
+
+    // Iterate two long postlists together.
+    Xapian::PostingIterator p1 = db.postlist_begin("all");
+    Xapian::PostingIterator p2 = db.postlist_begin("odd");
+    Xapian::docid did = 1;
+    while (p1 != db.postlist_end("all")) {
+	TEST_EQUAL(*p1, did);
+	if (did & 1) {
+	    TEST(p2 != db.postlist_end("odd"));
+	    TEST_EQUAL(*p2, did);
+	    ++p2;
+	}
+	++p1;
+	++did;
+    }
+    TEST_EQUAL(did, 5001);
+    TEST(p2 == db.postlist_end("odd"));
+
+    // Look up positions while iterating a long termlist.
+    Xapian::termcount count = 0;
+    for (Xapian::TermIterator t = db.termlist_begin(1);
+	 t != db.termlist_end(1);
+	 ++t) {
+	if ((*t)[0] != 't') continue;
+	++count;
+	if (count % 500 == 0) {
+	    TEST_EQUAL(t.positionlist_count(), 1);
+	    Xapian::termpos pos = *t.positionlist_begin();
+	    TEST_EQUAL(*t, "t" + str(pos));
+	}
+    }
+    TEST_EQUAL(count, 3000);
+
+    // Stop part way through a long termlist.
+    {
+	Xapian::TermIterator t = db.termlist_begin(1);
+	t.skip_to("t2");
+	TEST_EQUAL(*t, "t2");
+    }
+    TEST_EQUAL(db.get_doclength(1), 3002);
+    TEST_EQUAL(db.get_document(2).termlist_count(), 1);
+}
+
 // test that iterating through all terms in a database works.
 DEFINE_TESTCASE(allterms1, backend) {
     Xapian::Database db(get_database("apitest_allterms"));
@@ -706,6 +706,59 @@ DEFINE_TESTCASE(multicharwildcard1, writable) {
     }
 }
 
+/// Check WILDCARD_USE_NGRAM_INDEX gives the same expansions as a scan.
+DEFINE_TESTCASE(ngramwildcard1, backend) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Enquire enq(db);
+    const Xapian::Query::op o = Xapian::Query::OP_WILDCARD;
+    const int f = Xapian::Query::WILDCARD_PATTERN_GLOB;
+    const int use_index = Xapian::Query::WILDCARD_USE_NGRAM_INDEX;
+
+    static const char* const patterns[] = {
+	"*ing", "*ere*", "th*s", "?his", "w*", "*e", "*xyzzy*", "t?o", "paragraph"
+    };
+    for (auto pattern : patterns) {
+	tout << pattern << endl;
+	for (int limit : { Xapian::Query::WILDCARD_LIMIT_FIRST,
+			   Xapian::Query::WILDCARD_LIMIT_MOST_FREQUENT }) {
+	    enq.set_query(Xapian::Query(o, pattern, 2, f | limit));
+	    Xapian::MSet mset1 = enq.get_mset(0, 100);
+	    enq.set_query(Xapian::Query(o, pattern, 2, f | limit | use_index));
+	    Xapian::MSet mset2 = enq.get_mset(0, 100);
+	    TEST_EQUAL(mset1.size(), mset2.size());
+	    TEST(mset_range_is_same(mset1, 0, mset2, 0, mset1.size()));
+	}
+    }
+}
+
+/// Check WILDCARD_USE_NGRAM_INDEX sees terms added by a new revision.
+DEFINE_TESTCASE(ngramwildcard2, glass) {
+    Xapian::WritableDatabase wdb = get_writable_database();
+    Xapian::Document doc;
+    doc.add_term("bookcase");
+    wdb.add_document(doc);
+    wdb.commit();
+
+    Xapian::Database db(get_writable_database_as_database());
+    Xapian::Enquire enq(db);
+    enq.set_query(Xapian::Query(Xapian::Query::OP_WILDCARD, "*kca*", 0,
+				Xapian::Query::WILDCARD_PATTERN_GLOB |
+				Xapian::Query::WILDCARD_USE_NGRAM_INDEX));
+    // Enough searches for the index to be built and used.
+    for (int i = 0; i != 10; ++i) {
+	TEST_EQUAL(enq.get_mset(0, 10).size(), 1);
+    }
+
+    doc.clear_terms();
+    doc.add_term("backcatalogue");
+    wdb.add_document(doc);
+    wdb.commit();
+    TEST(db.reopen());
+    for (int i = 0; i != 10; ++i) {
+	TEST_EQUAL(enq.get_mset(0, 10).size(), 2);
+    }
+}
+
 struct editdist_testcase {
     const char* target;
     unsigned edit_distance;
@@ -774,6 +827,53 @@ DEFINE_TESTCASE(editdist1, backend) {
     }
 }
 
+/// Test OP_EDIT_DISTANCE with non-ASCII characters and skipping.
+DEFINE_TESTCASE(editdist2, generated) {
+    Xapian::Database db = get_database("editdist2",
+				       [](Xapian::WritableDatabase& wdb,
+					  const string&)
+				       {
+					   static const char* const terms[] = {
+					       "cafe", "caf\xc3\xa9",
+					       "caf\xc3\xa9s", "calf",
+					       "\xe2\x82\xac",
+					       "\xe2\x82\xacuro", "euro",
+					       "na\xc3\xafve", "naive",
+					       "knave", "zzz"
+					   };
+					   for (auto term : terms) {
+					       Xapian::Document doc;
+					       doc.add_term(term);
+					       wdb.add_document(doc);
+					   }
+				       });
+
+    Xapian::Enquire enq(db);
+    enq.set_weighting_scheme(Xapian::BoolWeight());
+    const Xapian::Query::op o = Xapian::Query::OP_EDIT_DISTANCE;
+    const Xapian::Query::op s = Xapian::Query::OP_SYNONYM;
+
+    enq.set_query(Xapian::Query(o, "caf\xc3\xa9", 0, 0, s, 0));
+    mset_expect_order(enq.get_mset(0, 20), 2);
+    enq.set_query(Xapian::Query(o, "caf\xc3\xa9", 0, 0, s, 1));
+    mset_expect_order(enq.get_mset(0, 20), 1, 2, 3);
+    // Regression test - a single multi-byte character was rejected as too
+    // long to match by a check which assumed at most 4/3 bytes per
+    // character.
+    enq.set_query(Xapian::Query(o, "\xe2\x82\xac", 0, 0, s, 0));
+    mset_expect_order(enq.get_mset(0, 20), 5);
+    enq.set_query(Xapian::Query(o, "euro", 0, 0, s, 1));
+    mset_expect_order(enq.get_mset(0, 20), 6, 7);
+    enq.set_query(Xapian::Query(o, "naive", 0, 0, s, 1));
+    mset_expect_order(enq.get_mset(0, 20), 8, 9);
+    enq.set_query(Xapian::Query(o, "naive", 0, 0, s, 2));
+    mset_expect_order(enq.get_mset(0, 20), 8, 9, 10);
+    enq.set_query(Xapian::Query(o, "zzzz", 0, 0, s, 0));
+    mset_expect_order(enq.get_mset(0, 20));
+    enq.set_query(Xapian::Query(o, "zzzz", 0, 0, s, 1));
+    mset_expect_order(enq.get_mset(0, 20), 11);
+}
+
 DEFINE_TESTCASE(dualprefixeditdist1, generated) {
     Xapian::Database db = get_database("dualprefixeditdist1",
 				       [](Xapian::WritableDatabase& wdb,
@@ -39,6 +39,7 @@
 #include "safesysstat.h"
 #include "safeunistd.h"
 #include "setenv.h"
+#include "str.h"
 #include "testsuite.h"
 #include "testutils.h"
 #include "unixcmds.h"
@@ -143,7 +144,8 @@ get_changeset(const string & changesetpath,
 	      int expected_changesets,
 	      int expected_fullcopies,
 	      bool expected_changed,
-	      bool full_copy = false)
+	      bool full_copy = false,
+	      bool compress = false)
 {
     FD fd(open(changesetpath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666));
     if (fd == -1) {
@@ -153,7 +155,7 @@ get_changeset(const string & changesetpath,
     Xapian::ReplicationInfo info1;
     master.write_changesets_to_fd(fd,
 				  full_copy ? "" : replica.get_revision_info(),
-				  &info1);
+				  &info1, compress);
 
     TEST_EQUAL(info1.changeset_count, expected_changesets);
     TEST_EQUAL(info1.fullcopy_count, expected_fullcopies);
@@ -205,14 +207,16 @@ replicate(Xapian::DatabaseMaster & master,
 	  int expected_changesets,
 	  int expected_fullcopies,
 	  bool expected_changed,
-	  bool full_copy = false)
+	  bool full_copy = false,
+	  bool compress = false)
 {
     string changesetpath = tempdir + "/changeset";
     get_changeset(changesetpath, master, replica,
 		  expected_changesets,
 		  expected_fullcopies,
 		  expected_changed,
-		  full_copy);
+		  full_copy,
+		  compress);
     return apply_changeset(changesetpath, replica,
 			   expected_changesets,
 			   expected_fullcopies,
@@ -607,13 +611,19 @@ DEFINE_TESTCASE(replicate4, replicas) {
 	orig.commit();
 
 	// Replicate, and check that we have the positional information.
-	count = replicate(master, replica, tempdir, 0, 1, true);
-	TEST_EQUAL(count, 1);
+	// There's no changeset, but the replica has an older revision of the
+	// same database so for glass only the changed blocks are sent.
+	if (get_dbtype() == "glass") {
+	    count = replicate(master, replica, tempdir, 1, 0, true);
+	    TEST_EQUAL(count, 2);
+	} else {
+	    count = replicate(master, replica, tempdir, 0, 1, true);
+	    TEST_EQUAL(count, 1);
+	}
 	{
 	    Xapian::Database dbcopy(replicapath);
 	    TEST_EQUAL(orig.get_uuid(), dbcopy.get_uuid());
 	}
-	// Should have pulled a full copy
 	check_equal_dbs(masterpath, replicapath);
 	TEST(!file_exists(masterpath + "/changes3"));
 
@@ -903,3 +913,127 @@ DEFINE_TESTCASE(replicate7, replicas) {
     rmtmpdir(tempdir);
 #endif
 }
+
+// Test replication with compressed messages.
+DEFINE_TESTCASE(replicate8, replicas) {
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+    UNSET_MAX_CHANGESETS_AFTERWARDS;
+    string tempdir = ".replicatmp";
+    mktmpdir(tempdir);
+    string masterpath = get_named_writable_database_path("master");
+
+    set_max_changesets(10);
+
+    Xapian::WritableDatabase orig(get_named_writable_database("master"));
+    Xapian::DatabaseMaster master(masterpath);
+    string replicapath = tempdir + "/replica";
+    {
+	Xapian::DatabaseReplica replica(replicapath);
+
+	// Use documents with plenty of repetition so the changesets and
+	// database files compress well.
+	Xapian::Document doc1;
+	doc1.set_data(string(10000, 'x'));
+	for (int i = 0; i != 100; ++i) {
+	    doc1.add_term("term" + str(i));
+	}
+	orig.add_document(doc1);
+	orig.commit();
+
+	// A full copy, which sends the database files.
+	int count = replicate(master, replica, tempdir, 0, 1, true, false,
+			      true);
+	TEST_EQUAL(count, 1);
+	check_equal_dbs(masterpath, replicapath);
+
+	for (int i = 0; i != 3; ++i) {
+	    orig.add_document(doc1);
+	    orig.commit();
+	}
+
+	// Changesets.
+	count = replicate(master, replica, tempdir, 3, 0, true, false, true);
+	TEST_EQUAL(count, 4);
+	// Uncompressed, the three changesets hold 30000 bytes of document
+	// data.
+	TEST_REL(get_file_size(tempdir + "/changeset"), <, 10000);
+	check_equal_dbs(masterpath, replicapath);
+	{
+	    Xapian::Database dbcopy(replicapath);
+	    TEST_EQUAL(dbcopy.get_document(4).get_data(), string(10000, 'x'));
+	}
+
+	// We need this inner scope to we close the replica before we remove
+	// the temporary directory on Windows.
+    }
+
+    rmtmpdir(tempdir);
+#endif
+}
+
+/// Test catching up a replica when the master has no changesets to send.
+DEFINE_TESTCASE(replicate9, replicas) {
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+    UNSET_MAX_CHANGESETS_AFTERWARDS;
+    string tempdir = ".replicatmp";
+    mktmpdir(tempdir);
+    string masterpath = get_named_writable_database_path("master");
+
+    // Don't keep any changesets on the master.
+    set_max_changesets(0);
+
+    Xapian::WritableDatabase orig(get_named_writable_database("master"));
+    Xapian::DatabaseMaster master(masterpath);
+    string replicapath = tempdir + "/replica";
+    {
+	Xapian::DatabaseReplica replica(replicapath);
+
+	Xapian::Document doc1;
+	doc1.set_data(string(1000, 'x'));
+	for (int i = 0; i != 1000; ++i) {
+	    doc1.add_term("term" + str(i));
+	    doc1.add_posting("pos", i + 1);
+	}
+	for (int i = 0; i != 20; ++i) {
+	    orig.add_document(doc1);
+	}
+	orig.commit();
+
+	int count = replicate(master, replica, tempdir, 0, 1, true);
+	TEST_EQUAL(count, 1);
+	check_equal_dbs(masterpath, replicapath);
+
+	Xapian::Document doc2;
+	doc2.add_term("newterm");
+	for (int i = 0; i != 3; ++i) {
+	    orig.add_document(doc2);
+	    orig.commit();
+	}
+
+	// There's no changeset for the replica's revision, but it has the
+	// same database so only the changed blocks should be sent.
+	count = replicate(master, replica, tempdir, 1, 0, true);
+	TEST_EQUAL(count, 2);
+	TEST_REL(get_file_size(tempdir + "/changeset"), <,
+		 get_file_size(masterpath + "/postlist.glass"));
+	check_equal_dbs(masterpath, replicapath);
+	{
+	    Xapian::Database dbcopy(replicapath);
+	    TEST_EQUAL(dbcopy.get_doccount(), 23);
+	    TEST_EQUAL(dbcopy.get_termfreq("newterm"), 3);
+	}
+
+	// A second catch up from the new revision.
+	orig.delete_document(1);
+	orig.commit();
+	count = replicate(master, replica, tempdir, 1, 0, true);
+	TEST_EQUAL(count, 2);
+	check_equal_dbs(masterpath, replicapath);
+
+	// We need this inner scope to we close the replica before we remove
+	// the temporary directory on Windows.
+    }
+
+    rmtmpdir(tempdir);
+#endif
+}
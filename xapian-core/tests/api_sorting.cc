@@ -28,6 +28,11 @@
 #include "apitest.h"
 #include "testutils.h"
 
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
 using namespace std;
 
 DEFINE_TESTCASE(sortfunctor1, backend) {
@@ -396,3 +401,82 @@ DEFINE_TESTCASE(sort_existing_mset_by_relevance, backend) {
     TEST_EQUAL_DOUBLE(mymset.get_max_attained(), weights[1]);
     TEST_EQUAL_DOUBLE(mymset.get_max_possible(), weights[1]);
 }
+
+/// Reranker which ranks higher docids first and checks the candidate stats.
+class DocidReranker : public Xapian::Reranker {
+  public:
+    mutable Xapian::doccount calls = 0;
+
+    void operator()(const Xapian::RerankCandidates& candidates,
+		    std::vector<double>& weights) const override {
+	++calls;
+	const Xapian::Database& db = candidates.get_database();
+	const vector<string>& terms = candidates.get_terms();
+	TEST_EQUAL(weights.size(), candidates.size());
+	TEST_EQUAL(candidates.get_doccount(), db.get_doccount());
+	TEST_EQUAL(candidates.get_total_length(), db.get_total_length());
+	for (Xapian::termcount t = 0; t != terms.size(); ++t) {
+	    TEST_EQUAL(candidates.get_termfreq(t), db.get_termfreq(terms[t]));
+	    TEST_EQUAL(candidates.get_collection_freq(t),
+		       db.get_collection_freq(terms[t]));
+	}
+	for (Xapian::doccount i = 0; i != candidates.size(); ++i) {
+	    Xapian::docid did = candidates.get_docid(i);
+	    TEST_EQUAL_DOUBLE(candidates.get_weight(i), weights[i]);
+	    TEST_EQUAL(candidates.get_doclength(i), db.get_doclength(did));
+	    for (Xapian::termcount t = 0; t != terms.size(); ++t) {
+		Xapian::termcount wdf = 0;
+		Xapian::TermIterator term = db.termlist_begin(did);
+		term.skip_to(terms[t]);
+		if (term != db.termlist_end(did) && *term == terms[t])
+		    wdf = term.get_wdf();
+		TEST_EQUAL(candidates.get_wdf(i, t), wdf);
+	    }
+	    weights[i] = did;
+	}
+    }
+};
+
+DEFINE_TESTCASE(rerank1, backend) {
+    Xapian::Database db = get_database("apitest_simpledata");
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query(Xapian::Query::OP_OR,
+				    Xapian::Query("this"),
+				    Xapian::Query("paragraph")));
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_REL(mset.size(), >, 4);
+
+    // The top 3 should be reordered by descending docid, and the rest left
+    // in their original order following them.
+    vector<Xapian::docid> expected(mset.begin(), mset.end());
+    sort(expected.begin(), expected.begin() + 3, greater<Xapian::docid>());
+
+    DocidReranker reranker;
+    enquire.set_reranker(&reranker, 3);
+    Xapian::MSet reranked = enquire.get_mset(0, 10);
+    TEST_EQUAL(reranker.calls, 1);
+    TEST_EQUAL(reranked.size(), mset.size());
+    TEST_EQUAL(reranked.get_matches_estimated(), mset.get_matches_estimated());
+    for (Xapian::doccount i = 0; i != expected.size(); ++i) {
+	TEST_EQUAL(*reranked[i], expected[i]);
+    }
+    TEST_EQUAL_DOUBLE(reranked[0].get_weight(), expected[0]);
+    TEST_EQUAL_DOUBLE(reranked[3].get_weight(), mset[3].get_weight());
+    TEST_EQUAL(reranked[0].get_percent(), mset[0].get_percent());
+
+    // Asking for a later page should give the same order.
+    Xapian::MSet page = enquire.get_mset(1, 3);
+    TEST_EQUAL(page.size(), 3);
+    TEST_EQUAL(page.get_firstitem(), 1);
+    for (Xapian::doccount i = 0; i != page.size(); ++i) {
+	TEST_EQUAL(*page[i], expected[i + 1]);
+    }
+
+    enquire.set_sort_by_value(1, false);
+    TEST_EXCEPTION(Xapian::UnimplementedError, enquire.get_mset(0, 10));
+
+    enquire.set_sort_by_relevance();
+    enquire.set_reranker(NULL, 0);
+    page = enquire.get_mset(0, 10);
+    TEST(mset_range_is_same(page, 0, mset, 0, mset.size()));
+}
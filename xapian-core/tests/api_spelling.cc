@@ -28,6 +28,7 @@
 #include "apitest.h"
 #include "testsuite.h"
 #include "testutils.h"
+#include "unixcmds.h"
 
 #include <string>
 
@@ -295,3 +296,65 @@ DEFINE_TESTCASE(spell8, spelling) {
     db.commit();
     TEST_EQUAL(db.get_spelling_suggestion("scimkin", 3), "skinking");
 }
+
+// Test suggestions using the symmetric delete index.
+DEFINE_TESTCASE(spelldeletes1, glass) {
+    Xapian::WritableDatabase db = get_named_writable_database("spelldeletes1");
+    db.add_spelling("abcd");
+    db.add_spelling("hello");
+    db.add_spelling("cell", 2);
+    db.add_spelling("caf\xc3\xa9");
+    db.commit();
+    // The trigram lists for "abcd" and "xbcx" have nothing in common.
+    TEST_EQUAL(db.get_spelling_suggestion("xbcx"), "");
+    TEST_EQUAL(db.get_spelling_suggestion("hell"), "cell");
+    db.close();
+
+    // Opening with DB_SPELLING_DELETES should build the index.
+    string path = get_named_writable_database_path("spelldeletes1");
+    db = Xapian::WritableDatabase(path, Xapian::DB_SPELLING_DELETES);
+    TEST_EQUAL(db.get_spelling_suggestion("xbcx"), "abcd");
+    TEST_EQUAL(db.get_spelling_suggestion("xbcx", 1), "");
+    TEST_EQUAL(db.get_spelling_suggestion("hell"), "cell");
+    TEST_EQUAL(db.get_spelling_suggestion("hellp"), "hello");
+    TEST_EQUAL(db.get_spelling_suggestion("hello", 1), "");
+    // Deletions are of characters, not bytes.
+    TEST_EQUAL(db.get_spelling_suggestion("cfe"), "caf\xc3\xa9");
+    // A larger edit distance than the index covers uses trigrams.
+    TEST_EQUAL(db.get_spelling_suggestion("xbcx", 3), "");
+
+    // Check the index is updated before and after commit.
+    db.add_spelling("wxyz");
+    TEST_EQUAL(db.get_spelling_suggestion("axyb"), "wxyz");
+    db.remove_spelling("abcd");
+    TEST_EQUAL(db.get_spelling_suggestion("xbcx"), "");
+    db.commit();
+    TEST_EQUAL(db.get_spelling_suggestion("axyb"), "wxyz");
+    db.close();
+
+    // The index should be maintained without the flag once it exists.
+    db = Xapian::WritableDatabase(path);
+    db.add_spelling("abcd");
+    db.commit();
+    Xapian::Database dbr(path);
+    TEST_EQUAL(dbr.get_spelling_suggestion("xbcx"), "abcd");
+    TEST_EQUAL(dbr.get_spelling_suggestion("axyb"), "wxyz");
+
+    // Compacting should keep the index.
+    string out = get_compaction_output_path("spelldeletes1out");
+    rm_rf(out);
+    dbr.compact(out);
+    TEST_EQUAL(Xapian::Database(out).get_spelling_suggestion("xbcx"), "abcd");
+
+    // But not if one of the inputs lacks it.
+    Xapian::WritableDatabase other = get_named_writable_database("spelldeletes1b");
+    other.add_spelling("other");
+    other.commit();
+    Xapian::Database both(path);
+    both.add_database(other);
+    rm_rf(out);
+    both.compact(out);
+    Xapian::Database compacted(out);
+    TEST_EQUAL(compacted.get_spelling_suggestion("xbcx"), "");
+    TEST_EQUAL(compacted.get_spelling_suggestion("hell"), "cell");
+}
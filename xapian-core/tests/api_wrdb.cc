@@ -30,6 +30,7 @@
 
 #include <xapian.h>
 
+#include "backendmanager.h"
 #include "filetests.h"
 #include "omassert.h"
 #include "str.h"
@@ -41,10 +42,14 @@
 #include "apitest.h"
 
 #include "safeunistd.h"
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <cstdlib>
+#include <fstream>
 #include <map>
 #include <string>
+#include <thread>
 
 using namespace std;
 
@@ -2009,3 +2014,798 @@ DEFINE_TESTCASE(protocolbug1, remote && writable) {
 		   db.replace_document(1, doc));
     db.commit();
 }
+
+/// Test Xapian::DB_PIPELINE_UPDATES.
+DEFINE_TESTCASE(pipelineupdates1, remote && writable && !multi) {
+    // Create an empty database, then open it with the flag.
+    string path = get_database_path("pipelineupdates1",
+				    [](Xapian::WritableDatabase&,
+				       const string&) {});
+    Xapian::WritableDatabase(path, Xapian::DB_CREATE_OR_OVERWRITE).close();
+    Xapian::WritableDatabase db =
+	Xapian::Remote::open_writable(XAPIAN_PROGSRV,
+				      "-t300000 --writable " + path,
+				      0, Xapian::DB_PIPELINE_UPDATES);
+
+    for (Xapian::docid did = 1; did <= 100; ++did) {
+	Xapian::Document doc;
+	doc.add_term("foo");
+	doc.add_term("Q" + str(did));
+	doc.set_data(str(did));
+	TEST_EQUAL(db.add_document(doc), did);
+    }
+    Xapian::Document doc;
+    doc.add_term("bar");
+    db.replace_document(200, doc);
+    TEST_EQUAL(db.add_document(doc), 201);
+    db.delete_document(5);
+    db.delete_document("Q6");
+    db.set_metadata("key", "value");
+    db.add_spelling("pipeline");
+    db.add_synonym("foo", "bar");
+    db.commit();
+
+    TEST_EQUAL(db.get_doccount(), 100);
+    TEST_EQUAL(db.get_lastdocid(), 201);
+    TEST_EQUAL(db.get_termfreq("foo"), 98);
+    TEST_EQUAL(db.get_termfreq("bar"), 2);
+    TEST_EQUAL(db.get_document(100).get_data(), "100");
+    TEST_EQUAL(db.get_metadata("key"), "value");
+    TEST_EQUAL(db.synonyms_begin("foo") != db.synonyms_end("foo"),
+	       true);
+
+    // An error is reported by the next method which waits for the server,
+    // and the later updates are ignored.
+    db.set_metadata("key", "changed");
+    db.delete_document(1000);
+    db.delete_document(1);
+    try {
+	db.commit();
+	FAIL_TEST("Expected DocNotFoundError");
+    } catch (const Xapian::DocNotFoundError& e) {
+	TEST(e.get_msg().find("Pipelined update 2 of 3 failed") !=
+	     string::npos);
+    }
+    TEST_EQUAL(db.get_metadata("key"), "changed");
+    TEST(db.term_exists("Q1"));
+    // Docids for pipelined additions still follow on correctly.
+    TEST_EQUAL(db.add_document(doc), 202);
+    db.commit();
+    TEST_EQUAL(db.get_doccount(), 101);
+
+    // An error doesn't stop a transaction being cancelled.
+    db.begin_transaction();
+    db.delete_document(1);
+    db.delete_document(1000);
+    db.cancel_transaction();
+    TEST(db.term_exists("Q1"));
+    TEST_EQUAL(db.get_lastdocid(), 202);
+}
+
+/// Check a prefetched document isn't used after it's been replaced.
+DEFINE_TESTCASE(fetchdocs3, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    for (int i = 0; i != 5; ++i) {
+	Xapian::Document doc;
+	doc.add_term("foo");
+	doc.set_data("old" + str(i));
+	doc.add_value(1, "v" + str(i));
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(Xapian::Query("foo"));
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_EQUAL(mset.size(), 5);
+    mset.fetch();
+
+    Xapian::Document doc;
+    doc.add_term("foo");
+    doc.set_data("new");
+    db.replace_document(*mset[1], doc);
+
+    TEST_EQUAL(mset[0].get_document().get_data(),
+	       "old" + str(*mset[0] - 1));
+    TEST_EQUAL(mset[0].get_document().get_value(1),
+	       "v" + str(*mset[0] - 1));
+    TEST_EQUAL(mset[1].get_document().get_data(), "new");
+    TEST_EQUAL(mset[1].get_document().get_value(1), "");
+}
+
+/// Check IndexingPipeline gives the same result as indexing sequentially.
+DEFINE_TESTCASE(indexingpipeline1, writable) {
+    auto text = [](int i) {
+	return "Document " + str(i) + " talks about indexing " +
+	       str(i % 7) + " things in parallel";
+    };
+    auto setup = [](Xapian::TermGenerator& termgen) {
+	termgen.set_stemmer(Xapian::Stem("english"));
+    };
+
+    Xapian::WritableDatabase db = get_writable_database();
+    {
+	Xapian::IndexingPipeline pipeline(db, setup, 4, 8);
+	for (int i = 0; i != 100; ++i) {
+	    pipeline.add_document([i, &text](Xapian::TermGenerator& termgen,
+					     Xapian::Document& doc) {
+		termgen.index_text(text(i));
+		doc.add_boolean_term("Q" + str(i));
+		doc.set_data(str(i));
+	    });
+	}
+	// Replace a document by term and another by docid.
+	pipeline.replace_document("Q10", [](Xapian::TermGenerator& termgen,
+					    Xapian::Document& doc) {
+	    termgen.index_text("replaced");
+	    doc.add_boolean_term("Q10");
+	    doc.set_data("r10");
+	});
+	pipeline.replace_document(21, [](Xapian::TermGenerator& termgen,
+					  Xapian::Document& doc) {
+	    termgen.index_text("also replaced");
+	    doc.set_data("r20");
+	});
+	pipeline.finish();
+	TEST_EQUAL(pipeline.get_submitted_count(), 102);
+	TEST_EQUAL(pipeline.get_built_count(), 102);
+	TEST_EQUAL(pipeline.get_written_count(), 102);
+	TEST(pipeline.get_build_time() >= 0.0);
+	TEST(pipeline.get_write_time() >= 0.0);
+    }
+    db.commit();
+
+    Xapian::TermGenerator termgen;
+    termgen.set_stemmer(Xapian::Stem("english"));
+    TEST_EQUAL(db.get_doccount(), 100);
+    TEST_EQUAL(db.get_lastdocid(), 100);
+    for (Xapian::docid did = 1; did <= 100; ++did) {
+	Xapian::Document expected;
+	termgen.set_document(expected);
+	int i = int(did - 1);
+	if (i == 10) {
+	    termgen.index_text("replaced");
+	    expected.add_boolean_term("Q10");
+	    expected.set_data("r10");
+	} else if (i == 20) {
+	    termgen.index_text("also replaced");
+	    expected.set_data("r20");
+	} else {
+	    termgen.index_text(text(i));
+	    expected.add_boolean_term("Q" + str(i));
+	    expected.set_data(str(i));
+	}
+	Xapian::Document doc = db.get_document(did);
+	TEST_EQUAL(doc.get_data(), expected.get_data());
+	TEST_EQUAL(doc.termlist_count(), expected.termlist_count());
+	Xapian::TermIterator t = doc.termlist_begin();
+	for (auto e = expected.termlist_begin(); e != expected.termlist_end();
+	     ++e) {
+	    TEST(t != doc.termlist_end());
+	    TEST_EQUAL(*t, *e);
+	    TEST_EQUAL(t.get_wdf(), e.get_wdf());
+	    TEST_EQUAL(t.positionlist_count(), e.positionlist_count());
+	    ++t;
+	}
+    }
+}
+
+/// Check errors from IndexingPipeline builders are reported.
+DEFINE_TESTCASE(indexingpipeline2, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    Xapian::IndexingPipeline pipeline(db, {}, 2);
+    // Hold back the failure until all the documents have been submitted, as
+    // otherwise add_document() could report it.
+    atomic<bool> all_submitted(false);
+    for (int i = 0; i != 20; ++i) {
+	auto builder = [i, &all_submitted](Xapian::TermGenerator& termgen,
+					   Xapian::Document&) {
+	    if (i == 5) {
+		while (!all_submitted) this_thread::yield();
+		throw Xapian::InvalidArgumentError("bad document");
+	    }
+	    termgen.index_text("doc");
+	};
+	pipeline.add_document(builder);
+    }
+    all_submitted = true;
+    TEST_EXCEPTION(Xapian::InvalidArgumentError, pipeline.finish());
+    // Documents are written in the order submitted, so exactly those before
+    // the failed one are written, and those after it are discarded.
+    Xapian::doccount written = pipeline.get_written_count();
+    TEST_EQUAL(written, 5);
+    TEST_EQUAL(db.get_doccount(), written);
+
+    // The error is only reported once and the pipeline can be reused.
+    pipeline.finish();
+    pipeline.add_document([](Xapian::TermGenerator& termgen,
+			     Xapian::Document&) {
+	termgen.index_text("more");
+    });
+    pipeline.finish();
+    TEST_EQUAL(db.get_doccount(), written + 1);
+    TEST_EQUAL(db.get_termfreq("more"), 1);
+}
+
+/// Test a WritableDatabase with shards opened with DB_PIPELINE_UPDATES.
+DEFINE_TESTCASE(pipelineshards1, glass) {
+    const int flags = Xapian::DB_CREATE_OR_OVERWRITE | Xapian::DB_BACKEND_GLASS;
+    vector<string> paths;
+    Xapian::WritableDatabase db;
+    for (int i = 0; i != 3; ++i) {
+	paths.push_back(get_named_writable_database_path("pipelineshards1_" +
+							 str(i)));
+	// Leave the last shard without the flag to check mixing works.
+	int shard_flags = flags;
+	if (i != 2) shard_flags |= Xapian::DB_PIPELINE_UPDATES;
+	db.add_database(Xapian::WritableDatabase(paths.back(), shard_flags));
+    }
+
+    for (Xapian::docid did = 1; did <= 100; ++did) {
+	Xapian::Document doc;
+	doc.add_term("foo");
+	doc.add_posting("bar", did);
+	doc.add_boolean_term("Q" + str(did));
+	doc.set_data(str(did));
+	doc.add_value(1, str(did));
+	TEST_EQUAL(db.add_document(doc), did);
+    }
+    Xapian::Document doc;
+    doc.add_term("baz");
+    db.replace_document(150, doc);
+    TEST_EQUAL(db.add_document(doc), 151);
+    TEST_EQUAL(db.get_lastdocid(), 151);
+    db.delete_document(5);
+    db.replace_document("Q6", doc);
+
+    // Reads see the queued updates.
+    TEST_EQUAL(db.get_doccount(), 101);
+    TEST_EQUAL(db.get_termfreq("foo"), 98);
+    TEST_EQUAL(db.get_termfreq("baz"), 3);
+    Xapian::Document doc7 = db.get_document(7);
+    TEST_EQUAL(doc7.get_data(), "7");
+    TEST_EQUAL(doc7.get_value(1), "7");
+    TEST_EQUAL(db.get_document(8).termlist_count(), 3);
+    TEST_EQUAL(*db.positionlist_begin(9, "bar"), 9);
+
+    // Replacing a document with one read from the database works.
+    doc7.add_term("modified");
+    db.replace_document(10, doc7);
+    TEST_EQUAL(db.get_document(10).get_data(), "7");
+    TEST_EQUAL(db.get_termfreq("modified"), 1);
+
+    // A document read via the combined database doesn't see updates queued
+    // after it was read, which the writer thread may be applying.
+    Xapian::Document doc11 = db.get_document(11);
+    Xapian::Document new11;
+    new11.add_term("foo");
+    new11.add_boolean_term("Q11");
+    new11.set_data("changed");
+    db.replace_document(11, new11);
+    db.commit();
+    TEST_EQUAL(doc11.get_data(), "11");
+    TEST_EQUAL(doc11.get_value(1), "11");
+    TEST_EQUAL(doc11.termlist_count(), 3);
+    TEST_EQUAL(db.get_document(11).get_data(), "changed");
+
+    // The queued update has its own copy of the document, so changing the
+    // caller's document straight away doesn't affect it.  The removed term
+    // mustn't be indexed either.
+    Xapian::Document reused;
+    reused.add_posting("reused", 1);
+    reused.add_posting("reused", 2);
+    reused.add_term("removed");
+    reused.remove_term("removed");
+    db.replace_document(12, reused);
+    reused.clear_terms();
+    reused.add_term("later");
+    db.replace_document(13, reused);
+    TEST_EQUAL(db.get_document(12).termlist_count(), 1);
+    TEST_EQUAL(db.get_termfreq("removed"), 0);
+    TEST_EQUAL(db.get_termfreq("later"), 1);
+    TEST_EQUAL(db.get_document(12).termlist_begin().positionlist_count(), 2);
+
+    db.commit();
+    Xapian::doccount total = 0;
+    for (auto&& path : paths) {
+	Xapian::Database shard(path);
+	total += shard.get_doccount();
+    }
+    TEST_EQUAL(total, 101);
+
+    // An error from a queued update is reported later, and the updates
+    // queued after it for that shard are discarded.  Docid 152 is in the
+    // second shard.
+    Xapian::Document bad;
+    bad.add_term(string(300, 'x'));
+    TEST_EQUAL(db.add_document(bad), 152);
+    TEST_EXCEPTION(Xapian::InvalidArgumentError, db.commit());
+    TEST_EQUAL(db.get_doccount(), 101);
+    db.replace_document(152, doc);
+    db.commit();
+    TEST_EQUAL(db.get_doccount(), 102);
+    TEST_EQUAL(db.get_termfreq("baz"), 4);
+}
+
+/// Test DB_SEGMENTED_COMMITS.
+DEFINE_TESTCASE(segmentedcommits1, glass) {
+    const int flags = Xapian::DB_CREATE_OR_OVERWRITE | Xapian::DB_BACKEND_GLASS;
+    string path = get_named_writable_database_path("segmentedcommits1");
+    Xapian::WritableDatabase db(path, flags | Xapian::DB_SEGMENTED_COMMITS);
+
+    // Commit often, so the background thread has to merge segments.
+    for (Xapian::docid did = 1; did <= 1000; ++did) {
+	Xapian::Document doc;
+	doc.add_term("foo");
+	doc.add_posting("bar", did);
+	doc.add_boolean_term("Q" + str(did));
+	doc.set_data(str(did));
+	doc.add_value(1, str(did));
+	TEST_EQUAL(db.add_document(doc), did);
+	if (did % 10 == 0) db.commit();
+    }
+    for (Xapian::docid did = 1; did <= 1000; did += 3) {
+	Xapian::Document doc;
+	doc.add_term("updated");
+	doc.add_boolean_term("Q" + str(did));
+	doc.set_data("updated " + str(did));
+	db.replace_document(did, doc);
+	if (did % 100 == 1) db.commit();
+    }
+
+    Xapian::Document doc;
+    doc.add_term("baz");
+    db.replace_document(1500, doc);
+    TEST_EQUAL(db.add_document(doc), 1501);
+    TEST_EQUAL(db.get_lastdocid(), 1501);
+    db.delete_document(5);
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db.delete_document(5));
+    TEST_EQUAL(db.replace_document("Q6", doc), 6);
+    db.delete_document("Q8");
+    db.set_metadata("key", "value");
+    db.add_spelling("word");
+
+    // Reads see the changes which haven't been committed.
+    TEST_EQUAL(db.get_doccount(), 1000);
+    TEST_EQUAL(db.get_termfreq("updated"), 334);
+    TEST_EQUAL(db.get_termfreq("baz"), 3);
+    TEST_EQUAL(db.get_document(7).get_data(), "updated 7");
+    TEST_EQUAL(db.get_document(9).get_value(1), "9");
+    TEST_EQUAL(*db.positionlist_begin(9, "bar"), 9);
+    TEST_EQUAL(db.get_metadata("key"), "value");
+    TEST_EQUAL(db.get_spelling_suggestion("wrod"), "word");
+
+    // A term the tables can't store is rejected straight away.
+    Xapian::Document bad;
+    bad.add_term(string(300, 'x'));
+    TEST_EXCEPTION(Xapian::InvalidArgumentError, db.add_document(bad));
+
+    db.commit();
+
+    // Cancelling discards changes since the commit but not those before.
+    db.begin_transaction(false);
+    db.add_document(doc);
+    db.delete_document(11);
+    TEST_EQUAL(db.get_doccount(), 1000);
+    db.cancel_transaction();
+    TEST_EQUAL(db.get_lastdocid(), 1501);
+    TEST_EQUAL(db.get_doccount(), 1000);
+    TEST_EQUAL(db.get_termfreq("baz"), 3);
+    TEST_EQUAL(db.get_document(11).get_data(), "11");
+
+    // Transactions work.
+    db.begin_transaction();
+    TEST_EQUAL(db.add_document(doc), 1502);
+    db.commit_transaction();
+    db.begin_transaction(false);
+    db.add_document(doc);
+    db.cancel_transaction();
+    TEST_EQUAL(db.get_lastdocid(), 1502);
+
+    db.close();
+
+    Xapian::Database rdb(path);
+    TEST_EQUAL(rdb.get_doccount(), 1001);
+    TEST_EQUAL(rdb.get_lastdocid(), 1502);
+    TEST_EQUAL(rdb.get_termfreq("updated"), 334);
+    TEST_EQUAL(rdb.get_termfreq("baz"), 4);
+    TEST_EQUAL(rdb.get_document(1000).get_data(), "updated 1000");
+    TEST_EQUAL(rdb.get_document(998).get_data(), "998");
+    TEST_EQUAL(rdb.get_metadata("key"), "value");
+    TEST_EQUAL(rdb.get_spelling_suggestion("wrod"), "word");
+    TEST(!file_exists(path + "/segment1"));
+}
+
+/// Test segments left when the database was last open are applied.
+DEFINE_TESTCASE(segmentedcommits2, glass) {
+    const int flags = Xapian::DB_CREATE_OR_OVERWRITE | Xapian::DB_BACKEND_GLASS;
+    string path = get_named_writable_database_path("segmentedcommits2");
+    {
+	Xapian::WritableDatabase db(path, flags);
+	Xapian::Document doc;
+	doc.add_term("foo");
+	db.add_document(doc);
+	db.add_document(doc);
+	db.commit();
+    }
+
+    // Write segments by hand as if the database had crashed before they
+    // were applied: set metadata, delete document 1, and delete document 3
+    // (which doesn't exist, as if the segment was being applied again).
+    {
+	ofstream out(path + "/segment7", ios::binary);
+	out << "xapian-glass-segment\n" << "M\x03key\x05value" << "D\x01";
+    }
+    {
+	ofstream out(path + "/segment8", ios::binary);
+	out << "xapian-glass-segment\n" << "D\x03" << "M\x03key\x06value2";
+    }
+    // A segment which wasn't completely written is ignored.
+    {
+	ofstream out(path + "/segment9.tmp", ios::binary);
+	out << "xapian-glass-seg";
+    }
+
+    {
+	// The segments are applied whether or not DB_SEGMENTED_COMMITS is
+	// specified.
+	Xapian::WritableDatabase db(path, Xapian::DB_BACKEND_GLASS);
+	TEST_EQUAL(db.get_doccount(), 1);
+	TEST_EQUAL(db.get_metadata("key"), "value2");
+    }
+    TEST(!file_exists(path + "/segment7"));
+    TEST(!file_exists(path + "/segment8"));
+    TEST(!file_exists(path + "/segment9.tmp"));
+
+    Xapian::Database rdb(path);
+    TEST_EQUAL(rdb.get_doccount(), 1);
+    TEST_EQUAL(rdb.get_metadata("key"), "value2");
+
+    // Segments are removed rather than applied if the database is
+    // overwritten.
+    {
+	ofstream out(path + "/segment3", ios::binary);
+	out << "xapian-glass-segment\n" << "M\x03key\x05value";
+    }
+    Xapian::WritableDatabase db(path, flags | Xapian::DB_SEGMENTED_COMMITS);
+    TEST(!file_exists(path + "/segment3"));
+    TEST_EQUAL(db.get_doccount(), 0);
+    TEST_EQUAL(db.get_metadata("key"), "");
+}
+
+/// Test the tables aren't updated in the background while they're read.
+DEFINE_TESTCASE(segmentedcommits3, glass) {
+    const int flags = Xapian::DB_CREATE_OR_OVERWRITE | Xapian::DB_BACKEND_GLASS;
+    string path = get_named_writable_database_path("segmentedcommits3");
+    Xapian::WritableDatabase db(path, flags | Xapian::DB_SEGMENTED_COMMITS);
+
+    auto add_docs = [&db](Xapian::docid first, Xapian::docid last) {
+	for (Xapian::docid did = first; did <= last; ++did) {
+	    Xapian::Document doc;
+	    doc.add_term("foo");
+	    doc.set_data(str(did));
+	    db.add_document(doc);
+	}
+    };
+    add_docs(1, 100);
+    db.commit();
+    // Reading waits for the segment to be applied.
+    TEST_EQUAL(db.get_termfreq("foo"), 100);
+    TEST(!file_exists(path + "/segment1"));
+
+    {
+	Xapian::PostingIterator p = db.postlist_begin("foo");
+	Xapian::Document doc = db.get_document(50);
+	Xapian::TermIterator t = db.allterms_begin();
+	add_docs(101, 200);
+	db.commit();
+	// The segment isn't applied while the iterators and document exist.
+	this_thread::sleep_for(chrono::milliseconds(100));
+	TEST(file_exists(path + "/segment2"));
+	TEST_EQUAL(doc.get_data(), "50");
+	TEST_EQUAL(*t, "foo");
+	Xapian::docid did = 0;
+	while (p != db.postlist_end("foo")) {
+	    TEST_REL(*p, >, did);
+	    did = *p;
+	    ++p;
+	}
+	TEST_REL(did, >=, 100);
+
+	// Reading via the database applies the segment in this thread.
+	TEST_EQUAL(db.get_termfreq("foo"), 200);
+	TEST(!file_exists(path + "/segment2"));
+	TEST_EQUAL(doc.get_data(), "50");
+    }
+
+    // Once they've gone, segments are applied in the background again.
+    add_docs(201, 300);
+    db.commit();
+    for (int i = 0; i < 1000; ++i) {
+	if (!file_exists(path + "/segment3")) break;
+	this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    TEST(!file_exists(path + "/segment3"));
+    Xapian::Database rdb(path);
+    TEST_EQUAL(rdb.get_termfreq("foo"), 300);
+}
+
+/// Check replace_document(unique_term) keeps up with other changes.
+DEFINE_TESTCASE(replacedocterm1, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    auto make_doc = [](const string& term, const string& data) {
+	Xapian::Document doc;
+	if (!term.empty()) doc.add_term(term);
+	doc.add_term("all");
+	doc.set_data(data);
+	return doc;
+    };
+
+    // A new term, then the same term again.
+    TEST_EQUAL(db.replace_document("Qa", make_doc("Qa", "a1")), 1);
+    TEST_EQUAL(db.replace_document("Qa", make_doc("Qa", "a2")), 1);
+    TEST_EQUAL(db.get_doccount(), 1);
+    TEST_EQUAL(db.get_document(1).get_data(), "a2");
+
+    // A term which isn't found, then added by another method.
+    TEST_EQUAL(db.replace_document("Qb", make_doc("", "nob")), 2);
+    TEST_EQUAL(db.add_document(make_doc("Qb", "b1")), 3);
+    TEST_EQUAL(db.replace_document("Qb", make_doc("Qb", "b2")), 3);
+    TEST_EQUAL(db.get_document(3).get_data(), "b2");
+
+    // A term which is removed by replacing by docid.
+    db.replace_document(1, make_doc("", "nota"));
+    TEST_EQUAL(db.replace_document("Qa", make_doc("Qa", "a3")), 4);
+
+    // A term which is removed by deleting the document.
+    db.delete_document(4);
+    TEST_EQUAL(db.replace_document("Qa", make_doc("Qa", "a4")), 5);
+
+    // A term which is added to a second document, so both must be replaced.
+    db.replace_document(2, make_doc("Qa", "alsoa"));
+    TEST_EQUAL(db.replace_document("Qa", make_doc("Qa", "a5")), 2);
+    TEST_EQUAL(db.get_termfreq("Qa"), 1);
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_document(5));
+    TEST_EQUAL(db.replace_document("Qa", make_doc("Qa", "a6")), 2);
+    TEST_EQUAL(db.get_document(2).get_data(), "a6");
+}
+
+/// Check replace_document(unique_term) after a transaction is cancelled.
+DEFINE_TESTCASE(replacedocterm2, transactions) {
+    Xapian::WritableDatabase db = get_writable_database();
+    Xapian::Document doc;
+    doc.add_term("Qa");
+    TEST_EQUAL(db.replace_document("Qa", doc), 1);
+    db.commit();
+
+    db.begin_transaction();
+    Xapian::Document doc2;
+    doc2.add_term("Qb");
+    TEST_EQUAL(db.replace_document("Qb", doc2), 2);
+    db.delete_document(1);
+    db.cancel_transaction();
+
+    // Neither change should be remembered.
+    TEST_EQUAL(db.replace_document("Qb", doc2), 2);
+    TEST_EQUAL(db.replace_document("Qa", doc), 1);
+    TEST_EQUAL(db.get_doccount(), 2);
+}
+
+/// Check replace_documents().
+DEFINE_TESTCASE(replacedocuments1, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    auto make_doc = [](const string& term, const string& data) {
+	Xapian::Document doc;
+	doc.add_term(term);
+	doc.set_data(data);
+	return doc;
+    };
+    db.add_document(make_doc("Qm", "m1"));
+
+    vector<string> terms{"Qz", "Qm", "Qa", "Qz"};
+    vector<Xapian::Document> docs{
+	make_doc("Qz", "z1"),
+	make_doc("Qm", "m2"),
+	make_doc("Qa", "a1"),
+	make_doc("Qz", "z2"),
+    };
+    vector<Xapian::docid> dids = db.replace_documents(terms, docs);
+    // New documents get docids in order of unique term.
+    vector<Xapian::docid> expected{3, 1, 2, 3};
+    TEST(dids == expected);
+    TEST_EQUAL(db.get_doccount(), 3);
+    TEST_EQUAL(db.get_document(1).get_data(), "m2");
+    TEST_EQUAL(db.get_document(2).get_data(), "a1");
+    TEST_EQUAL(db.get_document(3).get_data(), "z2");
+
+    TEST(db.replace_documents({}, {}).empty());
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   db.replace_documents({"Qa"}, {}));
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   db.replace_documents({"Qa", ""}, {Xapian::Document(),
+						     Xapian::Document()}));
+    // Nothing is changed if the arguments are invalid.
+    TEST_EQUAL(db.get_doccount(), 3);
+}
+
+/// Check a document is intact after being read, modified and replaced.
+DEFINE_TESTCASE(replacedoc9, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    for (int i = 1; i <= 3; ++i) {
+	Xapian::Document doc;
+	doc.add_term("foo", i);
+	doc.add_posting("bar", i);
+	doc.set_data("data" + str(i));
+	doc.add_value(1, "v" + str(i));
+	db.add_document(doc);
+    }
+    db.commit();
+
+    // Replacing the document records removing position lists for terms
+    // without any, which glass used to count as emptying the position table.
+    // For a remote shard of a multi-database, the document was then
+    // serialised without its position counts and couldn't be unserialised.
+    for (int n = 0; n != 2; ++n) {
+	Xapian::Document doc = db.get_document(2);
+	doc.add_value(2, "x" + str(n));
+	db.replace_document(2, doc);
+	doc = db.get_document(2);
+	TEST_EQUAL(doc.get_data(), "data2");
+	TEST_EQUAL(doc.termlist_count(), 2);
+	TEST_EQUAL(doc.get_value(1), "v2");
+	TEST_EQUAL(doc.get_value(2), "x" + str(n));
+    }
+    TEST(db.has_positions());
+    TEST_EQUAL(*db.positionlist_begin(2, "bar"), 2);
+}
+
+/// Check set_document_value().
+DEFINE_TESTCASE(setdocumentvalue1, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    for (int i = 1; i <= 3; ++i) {
+	Xapian::Document doc;
+	doc.add_term("foo", i);
+	doc.add_posting("bar", i);
+	doc.set_data("data" + str(i));
+	doc.add_value(1, "v" + str(i));
+	doc.add_value(3, "w" + str(i));
+	db.add_document(doc);
+    }
+    db.commit();
+
+    // Change an existing value.
+    db.set_document_value(2, 1, "v9");
+    Xapian::Document doc = db.get_document(2);
+    TEST_EQUAL(doc.get_value(1), "v9");
+    TEST_EQUAL(doc.get_value(3), "w2");
+    TEST_EQUAL(doc.get_data(), "data2");
+    TEST_EQUAL(doc.termlist_count(), 2);
+    TEST_EQUAL(db.get_doclength(2), 3);
+    TEST_EQUAL(db.get_value_freq(1), 3);
+    TEST_EQUAL(db.get_value_upper_bound(1), "v9");
+    TEST_EQUAL(db.get_value_lower_bound(1), "v1");
+
+    // Add a value in a slot the document didn't use.
+    db.set_document_value(2, 2, "x2");
+    doc = db.get_document(2);
+    TEST_EQUAL(doc.values_count(), 3);
+    Xapian::ValueIterator v = doc.values_begin();
+    TEST_EQUAL(v.get_valueno(), 1);
+    ++v;
+    TEST_EQUAL(v.get_valueno(), 2);
+    TEST_EQUAL(*v, "x2");
+    ++v;
+    TEST_EQUAL(v.get_valueno(), 3);
+    TEST_EQUAL(db.get_value_freq(2), 1);
+
+    // Remove a value.
+    db.set_document_value(3, 1, string());
+    doc = db.get_document(3);
+    TEST_EQUAL(doc.get_value(1), "");
+    TEST_EQUAL(doc.values_count(), 1);
+    TEST_EQUAL(db.get_value_freq(1), 2);
+
+    // Setting a value to what it already is changes nothing.
+    db.set_document_value(1, 1, "v1");
+    TEST_EQUAL(db.get_value_freq(1), 2);
+
+    TEST_EXCEPTION(Xapian::DocNotFoundError,
+		   db.set_document_value(4, 1, "v4"));
+    TEST_EXCEPTION(Xapian::InvalidArgumentError,
+		   db.set_document_value(0, 1, "v0"));
+    db.commit();
+
+    Xapian::ValueIterator s = db.valuestream_begin(1);
+    TEST(s != db.valuestream_end(1));
+    TEST_EQUAL(s.get_docid(), 1);
+    TEST_EQUAL(*s, "v1");
+    ++s;
+    TEST(s != db.valuestream_end(1));
+    TEST_EQUAL(s.get_docid(), 2);
+    TEST_EQUAL(*s, "v9");
+    ++s;
+    TEST(s == db.valuestream_end(1));
+
+    TEST_EQUAL(db.get_value_freq(1), 2);
+    TEST_EQUAL(db.get_value_freq(2), 1);
+    TEST_EQUAL(db.get_document(2).get_value(2), "x2");
+    TEST_EQUAL(db.get_document(3).values_count(), 1);
+    TEST_EQUAL(db.get_termfreq("foo"), 3);
+}
+
+/// Check set_document_value() with DB_SEGMENTED_COMMITS.
+DEFINE_TESTCASE(setdocumentvalue2, glass) {
+    string path = get_named_writable_database_path("setdocumentvalue2");
+    {
+	Xapian::WritableDatabase db(path, Xapian::DB_CREATE_OR_OVERWRITE |
+					  Xapian::DB_BACKEND_GLASS |
+					  Xapian::DB_SEGMENTED_COMMITS);
+	Xapian::Document doc;
+	doc.add_term("foo");
+	doc.add_value(1, "a");
+	db.add_document(doc);
+	db.add_document(doc);
+	db.commit();
+
+	db.set_document_value(2, 1, "b");
+	TEST_EQUAL(db.get_document(2).get_value(1), "b");
+	TEST_EXCEPTION(Xapian::DocNotFoundError,
+		       db.set_document_value(3, 1, "c"));
+	db.commit();
+    }
+    Xapian::Database rdb(path);
+    TEST_EQUAL(rdb.get_document(1).get_value(1), "a");
+    TEST_EQUAL(rdb.get_document(2).get_value(1), "b");
+}
+
+/// Check the batch document statistics methods see uncommitted changes.
+static void
+check_batch_uncommitted(Xapian::WritableDatabase& db)
+{
+    for (Xapian::termcount i = 1; i <= 10; ++i) {
+	Xapian::Document doc;
+	for (Xapian::termcount j = 0; j != i; ++j) {
+	    doc.add_term("t" + str(j), i);
+	}
+	db.add_document(doc);
+    }
+    db.commit();
+
+    Xapian::Document doc;
+    doc.add_term("new", 7);
+    db.delete_document(6);
+    db.replace_document(4, doc);
+    db.add_document(doc);
+
+    vector<Xapian::docid> dids = { 1, 3, 4, 5, 8, 11 };
+    vector<Xapian::termcount> doclens = db.get_doclength(dids);
+    vector<Xapian::termcount> uniqs = db.get_unique_terms(dids);
+    TEST_EQUAL(doclens.size(), dids.size());
+    TEST_EQUAL(uniqs.size(), dids.size());
+    for (size_t i = 0; i != dids.size(); ++i) {
+	TEST_EQUAL(doclens[i], db.get_doclength(dids[i]));
+	TEST_EQUAL(uniqs[i], db.get_unique_terms(dids[i]));
+    }
+    TEST_EQUAL(doclens[2], 7);
+    TEST_EQUAL(uniqs[2], 1);
+    TEST_EQUAL(doclens[5], 7);
+
+    dids = { 5, 6 };
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_doclength(dids));
+    TEST_EXCEPTION(Xapian::DocNotFoundError, db.get_unique_terms(dids));
+}
+
+DEFINE_TESTCASE(batchdocstats2, writable) {
+    Xapian::WritableDatabase db = get_writable_database();
+    check_batch_uncommitted(db);
+
+    if (get_dbtype() == "glass") {
+	// With DB_SEGMENTED_COMMITS, the batch methods must wait for the
+	// background thread and see documents which haven't been committed.
+	string path = get_named_writable_database_path("batchdocstats2");
+	Xapian::WritableDatabase sdb(path, Xapian::DB_CREATE_OR_OVERWRITE |
+					   Xapian::DB_BACKEND_GLASS |
+					   Xapian::DB_SEGMENTED_COMMITS);
+	check_batch_uncommitted(sdb);
+    }
+}
@@ -115,6 +115,14 @@ get_remote_database(const string &dbname, unsigned int timeout)
     return backendmanager->get_remote_database(dbnames, timeout);
 }
 
+Xapian::Database
+get_remote_database_threaded(const string& dbname, unsigned num_threads)
+{
+    vector<string> dbnames;
+    dbnames.push_back(dbname);
+    return backendmanager->get_remote_database_threaded(dbnames, num_threads);
+}
+
 Xapian::Database
 get_writable_database_as_database()
 {
@@ -53,6 +53,9 @@ std::string get_compaction_output_path(const std::string& name);
 
 Xapian::Database get_remote_database(const std::string &db, unsigned timeout);
 
+Xapian::Database get_remote_database_threaded(const std::string& db,
+					      unsigned num_threads);
+
 Xapian::Database get_writable_database_as_database();
 
 Xapian::WritableDatabase get_writable_database_again();
@@ -262,6 +262,16 @@ BackendManager::get_remote_database(const vector<string> &, unsigned int)
     throw Xapian::InvalidOperationError(msg);
 }
 
+Xapian::Database
+BackendManager::get_remote_database_threaded(const vector<string>&, unsigned)
+{
+    string msg = "BackendManager::get_remote_database_threaded() called for "
+		 "non-remotetcp database (type is ";
+    msg += get_dbtype();
+    msg += ')';
+    throw Xapian::InvalidOperationError(msg);
+}
+
 string
 BackendManager::get_writable_database_args(const std::string&,
 					   unsigned int)
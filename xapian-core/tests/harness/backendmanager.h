@@ -143,6 +143,11 @@ class BackendManager {
     /// Get a remote database instance with the specified timeout.
     virtual Xapian::Database get_remote_database(const std::vector<std::string> & files, unsigned int timeout);
 
+    /** Get a remote database instance from a server which handles connections
+     *  with a pool of @a num_threads threads.
+     */
+    virtual Xapian::Database get_remote_database_threaded(const std::vector<std::string>& files, unsigned num_threads);
+
     /** Get the args for opening a writable remote database with the
      *  specified timeout.
      */
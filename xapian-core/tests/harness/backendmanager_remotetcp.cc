@@ -76,6 +76,8 @@ using namespace std;
 struct pid_fd {
     pid_t pid;
     int fd;
+    /// True for a threaded server, which clean_up() needs to stop.
+    bool persistent;
 };
 
 static pid_fd pid_to_fd[16];
@@ -104,7 +106,7 @@ on_SIGCHLD(int /*sig*/)
 }
 
 static int
-launch_xapian_tcpsrv(const string & args)
+launch_xapian_tcpsrv(const string & args, unsigned num_threads = 0)
 {
     int port = DEFAULT_PORT;
 
@@ -112,7 +114,19 @@ launch_xapian_tcpsrv(const string & args)
     // if xapian-tcpsrv doesn't start listening successfully.
     signal(SIGCHLD, SIG_DFL);
 try_next_port:
-    string cmd = XAPIAN_TCPSRV " --one-shot --interface " LOCALHOST " --port ";
+    // Normally the server handles a single connection and then exits, but if
+    // num_threads is non-zero it serves connections with a pool of threads
+    // until clean_up() stops it.
+    string cmd = XAPIAN_TCPSRV;
+    if (num_threads) {
+	cmd += " --threads ";
+	cmd += str(num_threads);
+    } else {
+	cmd += " --one-shot";
+    }
+    // Use --compress so the remotetcp backends exercise compressed replies
+    // (the remoteprog backends don't, so both paths get tested).
+    cmd += " --compress --interface " LOCALHOST " --port ";
     cmd += str(port);
     cmd += " ";
     cmd += args;
@@ -144,6 +158,9 @@ try_next_port:
 	dup2(fds[1], 1);
 	dup2(fds[1], 2);
 	close(fds[1]);
+	// Make sure that clean_up() signals xapian-tcpsrv rather than the
+	// shell.
+	if (num_threads) cmd.insert(0, "exec ");
 	execl("/bin/sh", "/bin/sh", "-c", cmd.c_str(), static_cast<void*>(0));
 	_exit(-1);
     }
@@ -215,6 +232,7 @@ try_next_port:
 	if (pid_to_fd[i].pid == 0) {
 	    pid_to_fd[i].fd = tracked_fd;
 	    pid_to_fd[i].pid = child;
+	    pid_to_fd[i].persistent = (num_threads != 0);
 	    break;
 	}
     }
@@ -229,6 +247,7 @@ try_next_port:
 #elif defined __WIN32__
 
 static HANDLE tcpsrv_handles[16];
+static bool tcpsrv_persistent[16];
 static unsigned tcpsrv_handles_index = 0;
 
 static constexpr auto TCPSRV_HANDLES_INDEX_MAX =
@@ -258,12 +277,24 @@ static void win32_throw_error_string(const char * str)
 // This implementation uses the WIN32 API to start xapian-tcpsrv as a child
 // process and read its output using a pipe.
 static int
-launch_xapian_tcpsrv(const string & args)
+launch_xapian_tcpsrv(const string & args, unsigned num_threads = 0)
 {
     int port = DEFAULT_PORT;
 
 try_next_port:
-    string cmd = XAPIAN_TCPSRV " --one-shot --interface " LOCALHOST " --port ";
+    // Normally the server handles a single connection and then exits, but if
+    // num_threads is non-zero it serves connections with a pool of threads
+    // until clean_up() stops it.
+    string cmd = XAPIAN_TCPSRV;
+    if (num_threads) {
+	cmd += " --threads ";
+	cmd += str(num_threads);
+    } else {
+	cmd += " --one-shot";
+    }
+    // Use --compress so the remotetcp backends exercise compressed replies
+    // (the remoteprog backends don't, so both paths get tested).
+    cmd += " --compress --interface " LOCALHOST " --port ";
     cmd += str(port);
     cmd += " ";
     cmd += args;
@@ -331,6 +362,7 @@ try_next_port:
     fclose(fh);
 
     if (tcpsrv_handles_index < TCPSRV_HANDLES_INDEX_MAX) {
+	tcpsrv_persistent[tcpsrv_handles_index] = (num_threads != 0);
 	tcpsrv_handles[tcpsrv_handles_index++] = procinfo.hProcess;
     }
 
@@ -377,6 +409,15 @@ BackendManagerRemoteTcp::get_remote_database(const vector<string> & files,
     return Xapian::Remote::open(LOCALHOST, port);
 }
 
+Xapian::Database
+BackendManagerRemoteTcp::get_remote_database_threaded(const vector<string>& files,
+						      unsigned num_threads)
+{
+    string args = get_remote_database_args(files, 300000);
+    int port = launch_xapian_tcpsrv(args, num_threads);
+    return Xapian::Remote::open(LOCALHOST, port);
+}
+
 Xapian::Database
 BackendManagerRemoteTcp::get_database_by_path(const string& path)
 {
@@ -409,6 +450,8 @@ BackendManagerRemoteTcp::clean_up()
     for (unsigned i = 0; i < sizeof(pid_to_fd) / sizeof(pid_fd); ++i) {
 	pid_t child = pid_to_fd[i].pid;
 	if (child) {
+	    // A threaded server won't exit by itself.
+	    if (pid_to_fd[i].persistent) kill(child, SIGTERM);
 	    int status;
 	    while (waitpid(child, &status, 0) == -1 && errno == EINTR) { }
 	    // Other possible error from waitpid is ECHILD, which it seems can
@@ -423,6 +466,8 @@ BackendManagerRemoteTcp::clean_up()
     }
 #elif defined __WIN32__
     for (unsigned i = 0; i != tcpsrv_handles_index; ++i) {
+	// A threaded server won't exit by itself.
+	if (tcpsrv_persistent[i]) TerminateProcess(tcpsrv_handles[i], 0);
 	WaitForSingleObject(tcpsrv_handles[i], INFINITE);
 	CloseHandle(tcpsrv_handles[i]);
     }
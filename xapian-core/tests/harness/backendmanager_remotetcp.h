@@ -58,6 +58,10 @@ class BackendManagerRemoteTcp : public BackendManagerRemote {
     Xapian::Database get_remote_database(const std::vector<std::string> & files,
 					 unsigned int timeout);
 
+    /// Create a RemoteTcp Xapian::Database using a threaded server.
+    Xapian::Database get_remote_database_threaded(const std::vector<std::string>& files,
+						  unsigned num_threads);
+
     /// Get a RemoteTcp Xapian::Database instance of the database at path
     Xapian::Database get_database_by_path(const std::string& path);
 
@@ -78,13 +78,19 @@ using namespace std;
 #include "../common/closefrom.cc"
 #include "../common/errno_to_string.cc"
 #include "../common/fileutils.cc"
+#include "../common/io_batch.cc"
+#include "../common/io_utils.cc"
 #include "../common/overflow.h"
 #include "../common/pack.cc"
+#include "../common/posixy_wrapper.cc"
 #include "../common/parseint.h"
 #include "../common/serialise-double.cc"
 #include "../common/str.cc"
 #include "../backends/uuids.cc"
 #include "../net/serialise-error.cc"
+#ifdef XAPIAN_HAS_REMOTE_BACKEND
+# include "../net/remoteserverstats.cc"
+#endif
 #include "../api/error.cc"
 #include "../api/sortable-serialise.cc"
 #include "../include/xapian/intrusive_ptr.h"
@@ -374,6 +380,50 @@ static void test_serialiseerror1()
     Xapian::DatabaseOpeningError ecopy(e);
     TEST_STRINGS_EQUAL(ecopy.get_error_string(), enoent_msg);
 }
+
+// Check the remote server statistics report.
+static void test_remoteserverstats1()
+{
+    RemoteServerStats* stats = RemoteServerStats::create();
+    stats->connection_opened();
+    stats->add_bytes_in(10);
+    stats->add_bytes_out(20);
+    for (int i = 0; i != 99; ++i) {
+	stats->add_message(MSG_QUERY, 0.0001);
+    }
+    stats->add_message(MSG_QUERY, 0.5);
+    string report = stats->report();
+    tout << report;
+    TEST(report.find("\nxapian_remote_connections 1\n") != string::npos);
+    TEST(report.find("\nxapian_remote_active_connections 1\n") !=
+	 string::npos);
+    TEST(report.find("\nxapian_remote_received_bytes 10\n") != string::npos);
+    TEST(report.find("\nxapian_remote_sent_bytes 20\n") != string::npos);
+    // 100us is reported as the top of its bucket.
+    TEST(report.find("\nxapian_remote_message_seconds"
+		     "{type=\"query\",quantile=\"0.5\"} 0.000111\n") !=
+	 string::npos);
+    TEST(report.find("\nxapian_remote_message_seconds"
+		     "{type=\"query\",quantile=\"0.99\"} 0.000111\n") !=
+	 string::npos);
+    // But the top of the bucket for 0.5s is clamped to the maximum.
+    TEST(report.find("\nxapian_remote_message_seconds"
+		     "{type=\"query\",quantile=\"0.999\"} 0.500000\n") !=
+	 string::npos);
+    TEST(report.find("\nxapian_remote_message_seconds_sum"
+		     "{type=\"query\"} 0.509900\n") != string::npos);
+    TEST(report.find("\nxapian_remote_message_seconds_count"
+		     "{type=\"query\"} 100\n") != string::npos);
+    TEST(report.find("\nxapian_remote_message_seconds_max"
+		     "{type=\"query\"} 0.500000\n") != string::npos);
+    // Message types which haven't been seen aren't reported.
+    TEST(report.find("type=\"document\"") == string::npos);
+
+    stats->connection_closed();
+    report = stats->report();
+    TEST(report.find("\nxapian_remote_active_connections 0\n") !=
+	 string::npos);
+}
 #endif
 
 // Test log2() (which might be our replacement version).
@@ -566,6 +616,55 @@ static void test_closefrom1()
 #endif
 }
 
+// Check IOBatch reads and writes blocks correctly.
+static void test_iobatch1()
+{
+    const char* file = ".unittest_iobatch";
+    int fd = io_open_block_wr(file, true);
+    TEST(fd >= 0);
+    // Use more blocks than fit in one io_uring submission.
+    const size_t block_size = 512;
+    const int n_blocks = 200;
+    const off_t offset = 100;
+    string data;
+    for (int i = 0; i != n_blocks; ++i) {
+	string block = str(i);
+	block.resize(block_size, char('a' + i % 26));
+	data += block;
+    }
+
+    IOBatch batch;
+    for (int i = 0; i != n_blocks; ++i) {
+	batch.add_write_block(fd, data.data() + i * block_size, block_size, i,
+			      offset);
+    }
+    TEST_EQUAL(batch.size(), size_t(n_blocks));
+    batch.run();
+    TEST(batch.empty());
+
+    // Read back in reverse order, with some readahead requests mixed in.
+    string buf(data.size(), '\0');
+    for (int i = n_blocks - 1; i >= 0; --i) {
+	batch.add_read_block(fd, &buf[i * block_size], block_size, i, offset);
+	if (i % 10 == 0) batch.add_readahead_block(fd, block_size, i, offset);
+    }
+    batch.run();
+    TEST(batch.empty());
+    TEST(buf == data);
+
+    // Reading past the end of the file should report an error, but the
+    // other reads should still happen.
+    buf.assign(2 * block_size, '\0');
+    batch.add_read_block(fd, &buf[0], block_size, n_blocks, offset);
+    batch.add_read_block(fd, &buf[block_size], block_size, 0, offset);
+    TEST_EXCEPTION(Xapian::DatabaseError, batch.run());
+    TEST(batch.empty());
+    TEST(buf.compare(block_size, block_size, data, 0, block_size) == 0);
+
+    close(fd);
+    io_unlink(file);
+}
+
 static void test_shard1()
 {
     for (Xapian::docid did = 1; did != 10; ++did) {
@@ -870,12 +969,14 @@ static const test_desc tests[] = {
     TESTCASE(packstring2),
 #ifdef XAPIAN_HAS_REMOTE_BACKEND
     TESTCASE(serialiseerror1),
+    TESTCASE(remoteserverstats1),
 #endif
     TESTCASE(log2),
     TESTCASE(sortableserialise1),
     TESTCASE(tostring1),
     TESTCASE(strbool1),
     TESTCASE(closefrom1),
+    TESTCASE(iobatch1),
     TESTCASE(shard1),
     TESTCASE(uuid1),
     TESTCASE(movesupport1),
@@ -26,6 +26,7 @@
 #include "xapian-letor/featurelist.h"
 
 #include <map>
+#include <utility>
 
 namespace Xapian {
 
@@ -100,14 +101,19 @@ class Feature::Internal : public Xapian::Internal::intrusive_base {
     /// Get collection_termfreq
     Xapian::termcount get_collection_termfreq(const std::string& term) const;
 
+    /// Set the document to use for Feature building.
+    void set_document(const Xapian::Document& doc) {
+	feature_doc = doc;
+    }
+
     /// Set the term frequency to use for Feature building.
     void set_termfreq(std::map<std::string, Xapian::termcount>&& tf) {
-	termfreq = tf;
+	termfreq = std::move(tf);
     }
 
     /// Set the inverse_doc_freq to use for Feature building.
     void set_inverse_doc_freq(std::map<std::string, double>&& idf) {
-	inverse_doc_freq = idf;
+	inverse_doc_freq = std::move(idf);
     }
 
     /** Set the doc_length to use for Feature building.
@@ -115,19 +121,26 @@ class Feature::Internal : public Xapian::Internal::intrusive_base {
      *  This is used by Feature::Internal while populating Statistics.
      */
     void set_doc_length(std::map<std::string, Xapian::termcount>&& doc_len) {
-	doc_length = doc_len;
+	doc_length = std::move(doc_len);
     }
 
     /// Set the collection_length to use for Feature building.
     void set_collection_length(std::map<std::string,
 					Xapian::termcount>&& collection_len) {
-	collection_length = collection_len;
+	collection_length = std::move(collection_len);
     }
 
     /// Set the collection_termfreq to use for Feature building.
     void set_collection_termfreq(std::map<std::string,
 					  Xapian::termcount>&& collection_tf) {
-	collection_termfreq = collection_tf;
+	collection_termfreq = std::move(collection_tf);
+    }
+
+    /// Copy the statistics which only depend on the query from @a o.
+    void copy_query_stats(const Internal& o) {
+	inverse_doc_freq = o.inverse_doc_freq;
+	collection_length = o.collection_length;
+	collection_termfreq = o.collection_termfreq;
     }
 };
 
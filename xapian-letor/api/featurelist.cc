@@ -31,10 +31,37 @@
 #include "debuglog.h"
 #include "omassert.h"
 
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
 using namespace std;
 
 namespace Xapian {
 
+/** Calculate the values of all the Features for the current document.
+ *
+ *  @param features	The Features to calculate.
+ *  @param wt		The weight Xapian gave the document, which is added
+ *			as the final feature value.
+ */
+static vector<double>
+compute_values(const vector<Feature*>& features, double wt)
+{
+    vector<double> fvals;
+    for (Feature* it : features) {
+	const vector<double>& values = it->get_values();
+	// Append feature values
+	fvals.insert(fvals.end(), values.begin(), values.end());
+    }
+    // Weight is added as a feature by default.
+    fvals.push_back(wt);
+    return fvals;
+}
+
 FeatureList::FeatureList() : internal(new FeatureList::Internal())
 {
     LOGCALL_CTOR(API, "FeatureList", NO_ARGS);
@@ -64,12 +91,22 @@ FeatureList::FeatureList(const std::vector<Feature*> & f)
     }
 }
 
+FeatureList::FeatureList(const FeatureList & o) : internal(o.internal)
+{
+    LOGCALL_CTOR(API, "FeatureList", o);
+}
+
+FeatureList &
+FeatureList::operator=(const FeatureList & o)
+{
+    LOGCALL(API, FeatureList &, "FeatureList::operator=", o);
+    internal = o.internal;
+    RETURN(*this);
+}
+
 FeatureList::~FeatureList()
 {
     LOGCALL_DTOR(API, "FeatureList");
-    for (Feature* it : internal->feature)
-	delete it;
-    internal->feature.clear();
 }
 
 void
@@ -99,35 +136,156 @@ FeatureList::normalise(std::vector<FeatureVector>& fvec) const
 std::vector<FeatureVector>
 FeatureList::create_feature_vectors(const Xapian::MSet & mset,
 				    const Xapian::Query & letor_query,
-				    const Xapian::Database & letor_db) const
+				    const Xapian::Database & letor_db,
+				    unsigned threads) const
 {
-    LOGCALL(API, std::vector<FeatureVector>, "FeatureList::create_feature_vectors", mset | letor_query | letor_db);
+    LOGCALL(API, std::vector<FeatureVector>, "FeatureList::create_feature_vectors", mset | letor_query | letor_db | threads);
     if (mset.empty())
 	return vector<FeatureVector>();
     std::vector<FeatureVector> fvec;
     Assert(!internal->feature.empty());
 
-    for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
-	Xapian::Document doc = i.get_document();
-	std::vector<double> fvals;
-	internal->set_data(letor_query, letor_db, doc);
-	auto internal_feature = new Feature::Internal(letor_db,
-						      letor_query, doc);
-	// Computes and populates the Feature::Internal with required stats.
-	internal->populate_feature_internal(internal_feature);
-	for (Feature* it : internal->feature) {
-	    it->internal = internal_feature;
-	    const vector<double>& values = it->get_values();
-	    // Append feature values
-	    fvals.insert(fvals.end(), values.begin(), values.end());
+    internal->set_data(letor_query, letor_db, Xapian::Document());
+    // All the Features share one Feature::Internal.  The statistics which
+    // only depend on the query are computed once, and the per-document ones
+    // are updated for each document in turn.
+    Xapian::Internal::intrusive_ptr<Feature::Internal> internal_feature(
+	new Feature::Internal(letor_db, letor_query, Xapian::Document()));
+    internal->populate_query_stats(internal_feature.get());
+    for (Feature* it : internal->feature) {
+	it->internal = internal_feature;
+    }
+
+    // None of Database, Query or Feature can be used by several threads at
+    // once, so each thread gets its own copy of all of them.
+    typedef Xapian::Internal::intrusive_ptr<Internal> list_ptr;
+    typedef Xapian::Internal::intrusive_ptr<Feature::Internal> stats_ptr;
+    vector<list_ptr> lists;
+    vector<stats_ptr> stats;
+    threads = min(threads, unsigned(mset.size()));
+    if (threads > 1) {
+	try {
+	    string serialised_query = letor_query.serialise();
+	    for (unsigned t = 0; t != threads; ++t) {
+		Xapian::Database db = letor_db.clone();
+		Xapian::Query query =
+		    Xapian::Query::unserialise(serialised_query);
+		list_ptr list(new Internal());
+		list->stats_needed = internal->stats_needed;
+		for (Feature* it : internal->feature) {
+		    Feature* copy = it->clone();
+		    if (!copy) break;
+		    list->feature.push_back(copy);
+		}
+		if (list->feature.size() != internal->feature.size()) {
+		    lists.clear();
+		    break;
+		}
+		list->set_data(query, db, Xapian::Document());
+		stats_ptr list_stats(
+		    new Feature::Internal(db, query, Xapian::Document()));
+		list_stats->copy_query_stats(*internal_feature);
+		for (Feature* it : list->feature) {
+		    it->internal = list_stats;
+		}
+		lists.push_back(list);
+		stats.push_back(list_stats);
+	    }
+	} catch (const Xapian::UnimplementedError&) {
+	    // The database doesn't support clone(), or the query can't be
+	    // serialised.
+	    lists.clear();
+	} catch (const Xapian::InvalidOperationError&) {
+	    // clone() isn't allowed for a WritableDatabase.
+	    lists.clear();
+	}
+    }
+
+    if (lists.empty()) {
+	fvec.reserve(mset.size());
+	for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	    Xapian::Document doc = i.get_document();
+	    internal->set_doc(doc);
+	    internal_feature->set_document(doc);
+	    internal->populate_document_stats(internal_feature.get());
+	    fvec.emplace_back(*i,
+			      compute_values(internal->feature,
+					     i.get_weight()));
 	}
-	double wt = i.get_weight();
-	// Weight is added as a feature by default.
-	fvals.push_back(wt);
-	Xapian::docid did = doc.get_docid();
-	// construct a FeatureVector object using did and fvals.
-	Xapian::FeatureVector fv(did, fvals);
-	fvec.push_back(fv);
+	normalise(fvec);
+	return fvec;
+    }
+
+    vector<pair<Xapian::docid, double>> docs;
+    docs.reserve(mset.size());
+    for (Xapian::MSetIterator i = mset.begin(); i != mset.end(); ++i) {
+	docs.emplace_back(*i, i.get_weight());
+    }
+    fvec.resize(docs.size());
+    // Each thread builds the FeatureVectors for a contiguous part of the
+    // MSet, so they end up in the same order as the MSet.
+    vector<exception_ptr> errors(lists.size());
+    vector<thread> pool;
+    pool.reserve(lists.size());
+    for (size_t t = 0; t != lists.size(); ++t) {
+	size_t begin = docs.size() * t / lists.size();
+	size_t end = docs.size() * (t + 1) / lists.size();
+	pool.emplace_back([&, t, begin, end]() {
+	    try {
+		Internal* list = lists[t].get();
+		Feature::Internal* list_stats = stats[t].get();
+		for (size_t i = begin; i != end; ++i) {
+		    Xapian::docid did = docs[i].first;
+		    Xapian::Document doc =
+			list->featurelist_db.get_document(did);
+		    list->set_doc(doc);
+		    list_stats->set_document(doc);
+		    list->populate_document_stats(list_stats);
+		    fvec[i] = FeatureVector(did,
+					    compute_values(list->feature,
+							   docs[i].second));
+		}
+	    } catch (...) {
+		errors[t] = current_exception();
+	    }
+	});
+    }
+    for (auto&& th : pool) th.join();
+    for (auto&& e : errors) {
+	if (e) rethrow_exception(e);
+    }
+    normalise(fvec);
+    return fvec;
+}
+
+std::vector<FeatureVector>
+FeatureList::create_feature_vectors(const RerankCandidates & candidates) const
+{
+    LOGCALL(API, std::vector<FeatureVector>, "FeatureList::create_feature_vectors", candidates.size());
+    if (candidates.size() == 0)
+	return vector<FeatureVector>();
+    std::vector<FeatureVector> fvec;
+    fvec.reserve(candidates.size());
+    Assert(!internal->feature.empty());
+
+    const Xapian::Database& letor_db = candidates.get_database();
+    const Xapian::Query& letor_query = candidates.get_query();
+    internal->set_data(letor_query, letor_db, Xapian::Document());
+    Xapian::Internal::intrusive_ptr<Feature::Internal> internal_feature(
+	new Feature::Internal(letor_db, letor_query, Xapian::Document()));
+    internal->populate_query_stats(internal_feature.get(), candidates);
+    for (Feature* it : internal->feature) {
+	it->internal = internal_feature;
+    }
+
+    for (Xapian::doccount i = 0; i != candidates.size(); ++i) {
+	Xapian::docid did = candidates.get_docid(i);
+	// The document is only read if a Feature asks for its contents.
+	internal_feature->set_document(
+	    letor_db.get_document(did, Xapian::DOC_ASSUME_VALID));
+	internal->populate_document_stats(internal_feature.get(), candidates, i);
+	fvec.emplace_back(did, compute_values(internal->feature,
+					      candidates.get_weight(i)));
     }
     normalise(fvec);
     return fvec;
@@ -31,6 +31,9 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
 #include "debuglog.h"
 
 using namespace std;
@@ -46,21 +49,6 @@ FeatureList::Internal::set_data(const Xapian::Query & letor_query,
     set_database(letor_db);
 }
 
-std::map<std::string, Xapian::termcount>
-FeatureList::Internal::compute_termfreq() const
-{
-    std::map<std::string, Xapian::termcount> tf;
-
-    Xapian::TermIterator docterms = featurelist_doc.termlist_begin();
-    for (Xapian::TermIterator qt = featurelist_query.get_unique_terms_begin();
-	 qt != featurelist_query.get_terms_end(); ++qt) {
-	docterms.skip_to(*qt);
-	if (docterms != featurelist_doc.termlist_end() && *qt == *docterms)
-	    tf[*qt] = docterms.get_wdf();
-    }
-    return tf;
-}
-
 std::map<std::string, double>
 FeatureList::Internal::compute_inverse_doc_freq() const
 {
@@ -76,28 +64,63 @@ FeatureList::Internal::compute_inverse_doc_freq() const
     return idf;
 }
 
-std::map<std::string, Xapian::termcount>
-FeatureList::Internal::compute_doc_length() const
+void
+FeatureList::Internal::compute_doc_stats(
+	std::map<std::string, Xapian::termcount>* tf,
+	std::map<std::string, Xapian::termcount>* len) const
 {
-    std::map<std::string, Xapian::termcount> len;
+    vector<string> qterms;
+    if (tf) {
+	for (Xapian::TermIterator qt = featurelist_query.get_unique_terms_begin();
+	     qt != featurelist_query.get_terms_end(); ++qt) {
+	    qterms.push_back(*qt);
+	}
+    }
 
-    Xapian::termcount title_len = 0;
+    // The query terms are in ascending order, so we can find them and the
+    // title terms (those with prefix "S") in one pass over the termlist.
     Xapian::TermIterator dt = featurelist_doc.termlist_begin();
-    // reach the iterator to the start of the title terms i.e. prefix "S"
-    dt.skip_to("S");
-    for ( ; dt != featurelist_doc.termlist_end(); ++dt) {
-	if ((*dt)[0] != 'S') {
-	    // We've reached the end of the S-prefixed terms.
-	    break;
+    Xapian::TermIterator dt_end = featurelist_doc.termlist_end();
+    auto q = qterms.begin();
+    auto find_query_terms_before = [&](const string& limit) {
+	for ( ; q != qterms.end() && (limit.empty() || *q < limit); ++q) {
+	    dt.skip_to(*q);
+	    if (dt == dt_end)
+		break;
+	    if (*dt == *q)
+		(*tf)[*q] = dt.get_wdf();
+	}
+    };
+
+    Xapian::termcount title_len = 0;
+    if (len) {
+	find_query_terms_before("S");
+	dt.skip_to("S");
+	for ( ; dt != dt_end; ++dt) {
+	    const string& term = *dt;
+	    if (term[0] != 'S') {
+		// We've reached the end of the S-prefixed terms.
+		break;
+	    }
+	    title_len += dt.get_wdf();
+	    while (q != qterms.end() && *q < term)
+		++q;
+	    if (q != qterms.end() && *q == term) {
+		(*tf)[*q] = dt.get_wdf();
+		++q;
+	    }
 	}
-	title_len += dt.get_wdf();
     }
-    len["title"] = title_len;
-    Xapian::termcount whole_len =
-	    featurelist_db.get_doclength(featurelist_doc.get_docid());
-    len["whole"] = whole_len;
-    len["body"] = whole_len - title_len;
-    return len;
+    if (dt != dt_end)
+	find_query_terms_before(string());
+
+    if (len) {
+	(*len)["title"] = title_len;
+	Xapian::termcount whole_len =
+		featurelist_db.get_doclength(featurelist_doc.get_docid());
+	(*len)["whole"] = whole_len;
+	(*len)["body"] = whole_len - title_len;
+    }
 }
 
 std::map<std::string, Xapian::termcount>
@@ -145,19 +168,85 @@ FeatureList::Internal::compute_collection_termfreq() const
     return tf;
 }
 
-void
-FeatureList::Internal::populate_feature_internal(Feature::Internal*
-						 internal_feature)
+std::map<std::string, Xapian::termcount>
+FeatureList::Internal::compute_termfreq(const RerankCandidates& candidates,
+					Xapian::doccount i) const
 {
-    if (stats_needed & TERM_FREQUENCY) {
-	internal_feature->set_termfreq(compute_termfreq());
+    std::map<std::string, Xapian::termcount> tf;
+
+    const vector<string>& terms = candidates.get_terms();
+    for (Xapian::termcount t = 0; t != terms.size(); ++t) {
+	Xapian::termcount wdf = candidates.get_wdf(i, t);
+	if (wdf != 0)
+	    tf[terms[t]] = wdf;
+    }
+    return tf;
+}
+
+std::map<std::string, double>
+FeatureList::Internal::compute_inverse_doc_freq(
+	const RerankCandidates& candidates) const
+{
+    std::map<std::string, double> idf;
+    Xapian::doccount totaldocs = candidates.get_doccount();
+
+    const vector<string>& terms = candidates.get_terms();
+    for (Xapian::termcount t = 0; t != terms.size(); ++t) {
+	Xapian::doccount df = candidates.get_termfreq(t);
+	if (df != 0)
+	    idf[terms[t]] = log10((double)totaldocs / (double)(1 + df));
+    }
+    return idf;
+}
+
+std::map<std::string, Xapian::termcount>
+FeatureList::Internal::compute_doc_length(const RerankCandidates& candidates,
+					  Xapian::doccount i) const
+{
+    std::map<std::string, Xapian::termcount> len;
+
+    // The title length isn't something the match knows about, so we still
+    // need to look at the title terms in the document's termlist.
+    Xapian::docid did = candidates.get_docid(i);
+    Xapian::termcount title_len = 0;
+    Xapian::TermIterator dt = featurelist_db.termlist_begin(did);
+    dt.skip_to("S");
+    for ( ; dt != featurelist_db.termlist_end(did); ++dt) {
+	if ((*dt)[0] != 'S') {
+	    // We've reached the end of the S-prefixed terms.
+	    break;
+	}
+	title_len += dt.get_wdf();
+    }
+    len["title"] = title_len;
+    Xapian::termcount whole_len = candidates.get_doclength(i);
+    len["whole"] = whole_len;
+    len["body"] = whole_len - title_len;
+    return len;
+}
+
+std::map<std::string, Xapian::termcount>
+FeatureList::Internal::compute_collection_termfreq(
+	const RerankCandidates& candidates) const
+{
+    std::map<std::string, Xapian::termcount> tf;
+
+    const vector<string>& terms = candidates.get_terms();
+    for (Xapian::termcount t = 0; t != terms.size(); ++t) {
+	Xapian::termcount coll_tf = candidates.get_collection_freq(t);
+	if (coll_tf != 0)
+	    tf[terms[t]] = coll_tf;
     }
+    return tf;
+}
+
+void
+FeatureList::Internal::populate_query_stats(Feature::Internal*
+					    internal_feature) const
+{
     if (stats_needed & INVERSE_DOCUMENT_FREQUENCY) {
 	internal_feature->set_inverse_doc_freq(compute_inverse_doc_freq());
     }
-    if (stats_needed & DOCUMENT_LENGTH) {
-	internal_feature->set_doc_length(compute_doc_length());
-    }
     if (stats_needed & COLLECTION_LENGTH) {
 	internal_feature->set_collection_length(compute_collection_length());
     }
@@ -166,3 +255,53 @@ FeatureList::Internal::populate_feature_internal(Feature::Internal*
 			  compute_collection_termfreq());
     }
 }
+
+void
+FeatureList::Internal::populate_document_stats(Feature::Internal*
+					       internal_feature) const
+{
+    bool need_tf = (stats_needed & TERM_FREQUENCY);
+    bool need_len = (stats_needed & DOCUMENT_LENGTH);
+    if (!need_tf && !need_len)
+	return;
+    std::map<std::string, Xapian::termcount> tf, len;
+    compute_doc_stats(need_tf ? &tf : NULL, need_len ? &len : NULL);
+    if (need_tf) {
+	internal_feature->set_termfreq(std::move(tf));
+    }
+    if (need_len) {
+	internal_feature->set_doc_length(std::move(len));
+    }
+}
+
+void
+FeatureList::Internal::populate_query_stats(
+	Feature::Internal* internal_feature,
+	const RerankCandidates& candidates) const
+{
+    if (stats_needed & INVERSE_DOCUMENT_FREQUENCY) {
+	internal_feature->set_inverse_doc_freq(
+			  compute_inverse_doc_freq(candidates));
+    }
+    if (stats_needed & COLLECTION_LENGTH) {
+	internal_feature->set_collection_length(compute_collection_length());
+    }
+    if (stats_needed & COLLECTION_TERM_FREQ) {
+	internal_feature->set_collection_termfreq(
+			  compute_collection_termfreq(candidates));
+    }
+}
+
+void
+FeatureList::Internal::populate_document_stats(
+	Feature::Internal* internal_feature,
+	const RerankCandidates& candidates,
+	Xapian::doccount i) const
+{
+    if (stats_needed & TERM_FREQUENCY) {
+	internal_feature->set_termfreq(compute_termfreq(candidates, i));
+    }
+    if (stats_needed & DOCUMENT_LENGTH) {
+	internal_feature->set_doc_length(compute_doc_length(candidates, i));
+    }
+}
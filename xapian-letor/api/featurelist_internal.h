@@ -61,16 +61,6 @@ class FeatureList::Internal : public Xapian::Internal::intrusive_base {
     /// Xapian::Document using which features will be calculated.
     Document featurelist_doc;
 
-    /** This method finds the frequency of the query terms in the
-     *  specified documents.
-     *
-     *  This method is a helper method and statistics gathered through
-     *  this method are used in feature value calculation.
-     *
-     *  @return A map from query terms to their term frequencies.
-     */
-    std::map<std::string, Xapian::termcount> compute_termfreq() const;
-
     /** This method calculates the inverse document frequency(idf) of query
      *  terms in the database.
      *
@@ -87,14 +77,20 @@ class FeatureList::Internal : public Xapian::Internal::intrusive_base {
      */
     std::map<std::string, double> compute_inverse_doc_freq() const;
 
-    /** This method calculates the length of the documents as number of 'terms'.
-     *  It calculates the length for three different parts:
-     *  title, body and whole document.
+    /** This method finds the frequency of the query terms in the
+     *  specified document, and calculates the length of the document as
+     *  number of 'terms' for three different parts: title, body and whole
+     *  document.
+     *
+     *  Both are found in a single pass over the document's termlist.
      *
      *  This method is a helper method and statistics gathered through
      *  this method are used in feature value calculation.
      *
-     *  @return A map from query terms to their document lengths.
+     *  @param tf	If not NULL, set to a map from query terms to their
+     *			term frequencies.
+     *  @param len	If not NULL, set to a map from the document parts to
+     *			their lengths.
      *  @code
      *  map<string, long int> len;
      *  len["title"];
@@ -102,7 +98,8 @@ class FeatureList::Internal : public Xapian::Internal::intrusive_base {
      *  len["whole"];
      *  @endcode
      */
-    std::map<std::string, Xapian::termcount> compute_doc_length() const;
+    void compute_doc_stats(std::map<std::string, Xapian::termcount>* tf,
+			   std::map<std::string, Xapian::termcount>* len) const;
 
     /** This method calculates the length of the collection in number of terms
      *  for different parts like 'title', 'body' and 'whole'.
@@ -136,6 +133,29 @@ class FeatureList::Internal : public Xapian::Internal::intrusive_base {
     std::map<std::string, Xapian::termcount> compute_collection_termfreq()
 								const;
 
+    /** Versions of the above which use the statistics gathered by the match
+     *  for a Xapian::Reranker.
+     *
+     *  These are used in place of the versions above when creating
+     *  FeatureVectors for RerankCandidates.
+     *  @{
+     */
+    std::map<std::string, Xapian::termcount>
+    compute_termfreq(const Xapian::RerankCandidates& candidates,
+		     Xapian::doccount i) const;
+
+    std::map<std::string, double>
+    compute_inverse_doc_freq(const Xapian::RerankCandidates& candidates) const;
+
+    std::map<std::string, Xapian::termcount>
+    compute_doc_length(const Xapian::RerankCandidates& candidates,
+		       Xapian::doccount i) const;
+
+    std::map<std::string, Xapian::termcount>
+    compute_collection_termfreq(const Xapian::RerankCandidates& candidates)
+								const;
+    // @}
+
     /** Specify the database to use for feature building.
      *
      *  This will be used by the Internal class.
@@ -160,10 +180,37 @@ class FeatureList::Internal : public Xapian::Internal::intrusive_base {
 	featurelist_doc = doc;
     }
 
-    /// Computes and populates the stats needed by a Feature.
-    void populate_feature_internal(Feature::Internal* internal_feature);
+    /** Computes and populates the stats needed by a Feature which only
+     *  depend on the query.
+     *
+     *  These are the same for every document, so only need to be computed
+     *  once per query.
+     */
+    void populate_query_stats(Feature::Internal* internal_feature) const;
+
+    /** Computes and populates the stats needed by a Feature which depend on
+     *  the document.
+     */
+    void populate_document_stats(Feature::Internal* internal_feature) const;
+
+    /** Versions of the above which use the statistics gathered by the match
+     *  for a Xapian::Reranker.
+     *  @{
+     */
+    void populate_query_stats(Feature::Internal* internal_feature,
+			      const Xapian::RerankCandidates& candidates) const;
+
+    void populate_document_stats(Feature::Internal* internal_feature,
+				 const Xapian::RerankCandidates& candidates,
+				 Xapian::doccount i) const;
+    // @}
 
   public:
+    /// Destructor.
+    ~Internal() {
+	for (Feature* it : feature)
+	    delete it;
+    }
 
     /** Vector containing Feature pointer objects.
      *  Each will be used to return feature value.
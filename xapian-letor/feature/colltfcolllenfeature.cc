@@ -38,6 +38,12 @@ CollTfCollLenFeature::name() const
     return "CollTfCollLenFeature";
 }
 
+Feature*
+CollTfCollLenFeature::clone() const
+{
+    return new CollTfCollLenFeature();
+}
+
 /** A helper function for feature->get_value()
  *
  *  Checks if the term belongs to the title or is stemmed from the title.
@@ -37,6 +37,12 @@ Feature::~Feature() {
     LOGCALL_DTOR(API, "Feature");
 }
 
+Feature*
+Feature::clone() const
+{
+    return NULL;
+}
+
 Xapian::termcount
 Feature::get_termfreq(const std::string& term) const
 {
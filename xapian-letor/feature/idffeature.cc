@@ -38,6 +38,12 @@ IdfFeature::name() const
     return "IdfFeature";
 }
 
+Feature*
+IdfFeature::clone() const
+{
+    return new IdfFeature();
+}
+
 /** A helper function for feature->get_value()
  *
  *  Checks if the term belongs to the title or is stemmed from the title.
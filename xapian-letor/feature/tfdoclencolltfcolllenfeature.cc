@@ -38,6 +38,12 @@ TfDoclenCollTfCollLenFeature::name() const
     return "TfDoclenCollTfCollLenFeature";
 }
 
+Feature*
+TfDoclenCollTfCollLenFeature::clone() const
+{
+    return new TfDoclenCollTfCollLenFeature();
+}
+
 /** A helper function for feature->get_value()
  *
  *  Checks if the term belongs to the title or is stemmed from the title.
@@ -38,6 +38,12 @@ TfDoclenFeature::name() const
     return "TfDoclenFeature";
 }
 
+Feature*
+TfDoclenFeature::clone() const
+{
+    return new TfDoclenFeature();
+}
+
 /** A helper function for feature->get_value()
  *
  *  Checks if the term belongs to the title or is stemmed from the title.
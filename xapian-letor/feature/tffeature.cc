@@ -38,6 +38,12 @@ TfFeature::name() const
     return "TfFeature";
 }
 
+Feature*
+TfFeature::clone() const
+{
+    return new TfFeature();
+}
+
 /** A helper function for feature->get_value()
  *
  *  Checks if the term belongs to the title or is stemmed from the title.
@@ -38,6 +38,12 @@ TfIdfDoclenFeature::name() const
     return "TfIdfDoclenFeature";
 }
 
+Feature*
+TfIdfDoclenFeature::clone() const
+{
+    return new TfIdfDoclenFeature();
+}
+
 /** A helper function for feature->get_value()
  *
  *  Checks if the term belongs to the title or is stemmed from the title.
@@ -110,6 +110,17 @@ class XAPIAN_VISIBILITY_DEFAULT Feature {
     /// Return name of the feature
     virtual std::string name() const = 0;
 
+    /** Return a new copy of this Feature.
+     *
+     *  FeatureList::create_feature_vectors() uses this to give each thread
+     *  its own Features when asked to use more than one thread.  The default
+     *  implementation returns NULL, in which case the FeatureVectors are
+     *  built in the calling thread.
+     *
+     *  @return	A new object allocated with new, which the caller deletes.
+     */
+    virtual Feature* clone() const;
+
   private:
     /// Don't allow assignment.
     void operator=(const Feature &);
@@ -135,6 +146,7 @@ class XAPIAN_VISIBILITY_DEFAULT TfFeature : public Feature {
     }
     std::vector<double> get_values() const;
     std::string name() const;
+    Feature* clone() const;
 };
 
 /** Feature subclass returning feature value calculated as:
@@ -154,6 +166,7 @@ class XAPIAN_VISIBILITY_DEFAULT TfDoclenFeature : public Feature {
     }
     std::vector<double> get_values() const;
     std::string name() const;
+    Feature* clone() const;
 };
 
 /** Feature subclass returning feature value calculated as:
@@ -169,6 +182,7 @@ class XAPIAN_VISIBILITY_DEFAULT IdfFeature : public Feature {
     }
     std::vector<double> get_values() const;
     std::string name() const;
+    Feature* clone() const;
 };
 
 /** Feature subclass returning feature value calculated as:
@@ -188,6 +202,7 @@ class XAPIAN_VISIBILITY_DEFAULT CollTfCollLenFeature : public Feature {
     }
     std::vector<double> get_values() const;
     std::string name() const;
+    Feature* clone() const;
 };
 
 /** Feature subclass returning feature value calculated as:
@@ -209,6 +224,7 @@ class XAPIAN_VISIBILITY_DEFAULT TfIdfDoclenFeature : public Feature {
     }
     std::vector<double> get_values() const;
     std::string name() const;
+    Feature* clone() const;
 };
 
 /** Feature subclass returning feature value calculated as:
@@ -230,6 +246,7 @@ class XAPIAN_VISIBILITY_DEFAULT TfDoclenCollTfCollLenFeature : public Feature {
     }
     std::vector<double> get_values() const;
     std::string name() const;
+    Feature* clone() const;
 };
 
 }
@@ -79,16 +79,44 @@ class XAPIAN_VISIBILITY_DEFAULT FeatureList {
     /** Returns a vector of FeatureVectors for each document in the MSet for
      *  a given query.
      *
+     *  The query-level statistics are calculated once per call and shared by
+     *  all the documents.  A FeatureList shouldn't be used by several
+     *  threads at once since its Features hold the statistics for the
+     *  current document.
+     *
+     *  With @a threads > 1 the MSet is split between that many threads, each
+     *  of which reads from its own Database::clone() of @a letor_db and uses
+     *  its own Feature::clone() of each Feature.  If @a letor_db doesn't
+     *  support clone(), a Feature returns NULL from clone(), or @a
+     *  letor_query can't be serialised, the FeatureVectors are built in the
+     *  calling thread instead.
+     *
      *  @param  mset		MSet for which the vector<FeatureVector>
      *				is to be returned
      *  @param  letor_query	Query for which the vector<FeatureVector>
      *				is to be returned
      *  @param  letor_db	Corresponding Database
+     *  @param  threads		The number of threads to use (default: 1)
      */
     std::vector<Xapian::FeatureVector>
     create_feature_vectors(const Xapian::MSet & mset,
 			   const Xapian::Query & letor_query,
-			   const Xapian::Database & letor_db) const;
+			   const Xapian::Database & letor_db,
+			   unsigned threads = 1) const;
+
+    /** Returns a vector of FeatureVectors for candidates passed to a
+     *  Xapian::Reranker.
+     *
+     *  This produces the same feature values as the MSet version, but uses
+     *  the statistics gathered for all the candidates together by the match
+     *  instead of reading each document's termlist, and only calculates the
+     *  query-level statistics once.
+     *
+     *  @param  candidates	The candidates to create FeatureVectors for.
+     *				The FeatureVectors are in the same order.
+     */
+    std::vector<Xapian::FeatureVector>
+    create_feature_vectors(const Xapian::RerankCandidates & candidates) const;
 
   private:
     /// Perform query-level normalisation of FeatureVectors.
@@ -236,6 +236,8 @@ class XAPIAN_VISIBILITY_DEFAULT Ranker : public Xapian::Internal::intrusive_base
 			      const FeatureVector & secondfv);
 
   private:
+    friend class LetorReranker;
+
     /// Don't allow assignment.
     void operator=(const Ranker &);
 
@@ -409,6 +411,43 @@ class XAPIAN_VISIBILITY_DEFAULT ListMLERanker : public Ranker {
     ~ListMLERanker();
 };
 
+/** Apply a Ranker's model during the match.
+ *
+ *  Pass this to Xapian::Enquire::set_reranker() to rerank the top documents
+ *  using the model before the MSet is returned.  Unlike calling
+ *  Ranker::rank() on the MSet afterwards, the features are calculated from
+ *  statistics the match gathers for all the candidates together, and the
+ *  requested page of results is taken from the reranked order.
+ */
+class XAPIAN_VISIBILITY_DEFAULT LetorReranker : public Xapian::Reranker {
+    /// The Ranker whose model is used.
+    const Ranker& ranker;
+
+    /// The features to use.
+    Xapian::FeatureList flist;
+
+  public:
+    /** Constructor.
+     *
+     *  @param ranker_	The Ranker to use.  The model is loaded from the
+     *			database set with Ranker::set_database_path() by this
+     *			constructor, and @a ranker_ must remain valid while
+     *			this object is in use.
+     *  @param model_key	DB metadata key from which the ranking model is
+     *			to be loaded.  If empty, the Ranker subclass uses its
+     *			default model_key.
+     *  @param flist_	The features to use.  This should be the same as
+     *			what was used to prepare the training file.
+     */
+    explicit LetorReranker(Ranker& ranker_,
+			   const std::string& model_key = std::string(),
+			   const Xapian::FeatureList& flist_ =
+				Xapian::FeatureList());
+
+    void operator()(const Xapian::RerankCandidates& candidates,
+		    std::vector<double>& weights) const;
+};
+
 }
 
 #endif /* XAPIAN_INCLUDED_RANKER_H */
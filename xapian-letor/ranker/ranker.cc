@@ -390,6 +390,27 @@ Ranker::rank(Xapian::MSet & mset, const string & model_key, const Xapian::Featur
     mset.sort_by_relevance();
 }
 
+LetorReranker::LetorReranker(Ranker& ranker_, const string& model_key,
+			     const Xapian::FeatureList& flist_)
+    : ranker(ranker_), flist(flist_)
+{
+    LOGCALL_CTOR(API, "LetorReranker", ranker_ | model_key | flist_);
+    ranker_.load_model_from_metadata(model_key);
+}
+
+void
+LetorReranker::operator()(const Xapian::RerankCandidates& candidates,
+			  vector<double>& weights) const
+{
+    LOGCALL_VOID(API, "LetorReranker::operator()", candidates.size() | weights.size());
+    vector<FeatureVector> fvv = flist.create_feature_vectors(candidates);
+    vector<FeatureVector> rankedfvv = ranker.rank_fvv(fvv);
+    AssertEq(rankedfvv.size(), weights.size());
+    for (size_t i = 0; i != rankedfvv.size(); ++i) {
+	weights[i] = rankedfvv[i].get_score();
+    }
+}
+
 void
 Ranker::train_model(const std::string & input_filename, const std::string & model_key)
 {
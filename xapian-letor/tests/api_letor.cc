@@ -655,6 +655,42 @@ DEFINE_TESTCASE(listnet_ranker_three_correct, generated && path && writable)
     unlink("err_output_listnet_3.txt");
 }
 
+/// Check LetorReranker gives the same order as Ranker::rank().
+DEFINE_TESTCASE(listnet_reranker, generated && path && writable)
+{
+    // Ranker::rank() gives different feature values with a multidatabase.
+    XFAIL_FOR_BACKEND("multi", "Testcase fails with multidatabase");
+    Xapian::ListNETRanker ranker;
+    string db_path = get_database_path("db_index_three_documents",
+				       db_index_three_documents);
+    Xapian::Enquire enquire((Xapian::Database(db_path)));
+    enquire.set_query(Xapian::Query("score"));
+    string data_directory = test_driver::get_srcdir() + "/testdata/";
+    string training_data = data_directory + "training_data_three_correct.txt";
+    ranker.set_database_path(db_path);
+    ranker.set_query(Xapian::Query("score"));
+    ranker.train_model(training_data, "ListNet_Ranker");
+    Xapian::MSet mymset = enquire.get_mset(0, 10);
+    ranker.rank(mymset, "ListNet_Ranker");
+
+    Xapian::LetorReranker reranker(ranker, "ListNet_Ranker");
+    enquire.set_reranker(&reranker, 10);
+    Xapian::MSet reranked = enquire.get_mset(0, 10);
+    TEST_EQUAL(reranked.size(), mymset.size());
+    for (Xapian::doccount i = 0; i != mymset.size(); ++i) {
+	TEST_EQUAL(*reranked[i], *mymset[i]);
+	TEST_EQUAL_DOUBLE(reranked[i].get_weight(), mymset[i].get_weight());
+    }
+
+    // The requested page should come from the reranked order.
+    Xapian::MSet page = enquire.get_mset(1, 1);
+    TEST_EQUAL(page.size(), 1);
+    TEST_EQUAL(*page[0], *mymset[1]);
+
+    TEST_EXCEPTION(Xapian::LetorInternalError,
+		   Xapian::LetorReranker(ranker, "no_such_model"));
+}
+
 DEFINE_TESTCASE(scorer, generated && path && writable)
 {
     XFAIL_FOR_BACKEND("multi", "Testcase fails with multidatabase");
@@ -1574,3 +1610,160 @@ DEFINE_TESTCASE(populatefeature, generated) {
 
     custom_feature->test_stats();
 }
+
+/// Feature which records the raw statistics it sees for each document.
+class RecordingFeature : public Xapian::Feature {
+    vector<string> terms;
+
+  public:
+    mutable vector<vector<double>> recorded;
+
+    explicit RecordingFeature(const vector<string>& terms_) : terms(terms_) {
+	need_stat(Xapian::Feature::TERM_FREQUENCY);
+	need_stat(Xapian::Feature::DOCUMENT_LENGTH);
+	need_stat(Xapian::Feature::COLLECTION_TERM_FREQ);
+	need_stat(Xapian::Feature::COLLECTION_LENGTH);
+	need_stat(Xapian::Feature::INVERSE_DOCUMENT_FREQUENCY);
+    }
+    std::vector<double> get_values() const {
+	vector<double> stats;
+	for (const string& term : terms) {
+	    stats.push_back(get_termfreq(term));
+	    stats.push_back(get_inverse_doc_freq(term));
+	    stats.push_back(get_collection_termfreq(term));
+	}
+	for (const char* field : {"title", "body", "whole"}) {
+	    stats.push_back(get_doc_length(field));
+	    stats.push_back(get_collection_length(field));
+	}
+	recorded.push_back(stats);
+	return vector<double>();
+    }
+    std::string name() const {
+	return "RecordingFeature";
+    }
+};
+
+/// Check that per-document statistics don't leak between documents.
+DEFINE_TESTCASE(createfeaturevectorshared, generated) {
+    Xapian::Database db = get_database("db_index_three_documents",
+				       db_index_three_documents);
+    Xapian::QueryParser queryparser;
+    queryparser.set_stemmer(Xapian::Stem("en"));
+    queryparser.set_stemming_strategy(queryparser.STEM_ALL_Z);
+    queryparser.add_prefix("title", "S");
+    queryparser.add_prefix("description", "XD");
+    Xapian::Query query =
+	queryparser.parse_query("title:score description:score score tigers");
+
+    vector<string> terms(query.get_unique_terms_begin(),
+			 query.get_unique_terms_end());
+    vector<Xapian::Feature*> f;
+    RecordingFeature* recording_feature = new RecordingFeature(terms);
+    f.push_back(recording_feature);
+    Xapian::FeatureList fl(f);
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(query);
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_REL(mset.size(), >=, 2);
+
+    // The query-level statistics are shared by all the documents in one
+    // call, so the statistics should be the same as those seen when building
+    // the vectors one document at a time.
+    auto fv = fl.create_feature_vectors(mset, query, db);
+    TEST_EQUAL(fv.size(), mset.size());
+    auto batch = recording_feature->recorded;
+    TEST_EQUAL(batch.size(), mset.size());
+    for (Xapian::doccount i = 0; i != mset.size(); ++i) {
+	recording_feature->recorded.clear();
+	auto fv1 = fl.create_feature_vectors(enquire.get_mset(i, 1),
+					     query, db);
+	TEST_EQUAL(fv1.size(), 1);
+	TEST_EQUAL(fv1[0].get_did(), fv[i].get_did());
+	TEST_EQUAL(recording_feature->recorded.size(), 1);
+	const auto& single = recording_feature->recorded[0];
+	TEST_EQUAL(single.size(), batch[i].size());
+	for (size_t j = 0; j != single.size(); ++j) {
+	    TEST_EQUAL_DOUBLE(batch[i][j], single[j]);
+	}
+    }
+    // Check the documents actually differ, so the test is meaningful.
+    TEST(batch[0] != batch[1]);
+}
+
+/// TfFeature which counts how many times it has been cloned.
+class CountingTfFeature : public Xapian::TfFeature {
+  public:
+    static int clones;
+
+    Xapian::Feature* clone() const {
+	++clones;
+	return new CountingTfFeature();
+    }
+};
+
+int CountingTfFeature::clones = 0;
+
+/// Check building FeatureVectors with several threads.
+DEFINE_TESTCASE(createfeaturevectorthreads, generated) {
+    Xapian::Database db = get_database("db_index_three_documents",
+				       db_index_three_documents);
+    Xapian::QueryParser queryparser;
+    queryparser.set_stemmer(Xapian::Stem("en"));
+    queryparser.set_stemming_strategy(queryparser.STEM_ALL_Z);
+    queryparser.add_prefix("title", "S");
+    queryparser.add_prefix("description", "XD");
+    Xapian::Query query =
+	queryparser.parse_query("title:score description:score score tigers");
+
+    Xapian::Enquire enquire(db);
+    enquire.set_query(query);
+    Xapian::MSet mset = enquire.get_mset(0, 10);
+    TEST_REL(mset.size(), >=, 2);
+
+    // The FeatureVectors are the same, and in the same order, however many
+    // threads are used.
+    Xapian::FeatureList fl;
+    auto fv = fl.create_feature_vectors(mset, query, db);
+    for (unsigned threads : {2, 8}) {
+	auto fvt = fl.create_feature_vectors(mset, query, db, threads);
+	TEST_EQUAL(fvt.size(), fv.size());
+	for (size_t i = 0; i != fv.size(); ++i) {
+	    TEST_EQUAL(fvt[i].get_did(), fv[i].get_did());
+	    vector<double> vals = fv[i].get_fvals();
+	    vector<double> thread_vals = fvt[i].get_fvals();
+	    TEST_EQUAL(thread_vals.size(), vals.size());
+	    for (size_t j = 0; j != vals.size(); ++j) {
+		TEST_EQUAL_DOUBLE(thread_vals[j], vals[j]);
+	    }
+	}
+    }
+
+    // Each thread uses its own copy of each Feature, if the database can be
+    // cloned.
+    bool can_clone = true;
+    try {
+	(void)db.clone();
+    } catch (const Xapian::UnimplementedError&) {
+	can_clone = false;
+    }
+    vector<Xapian::Feature*> f;
+    f.push_back(new CountingTfFeature());
+    Xapian::FeatureList counting_fl(f);
+    CountingTfFeature::clones = 0;
+    auto fvc = counting_fl.create_feature_vectors(mset, query, db, 2);
+    TEST_EQUAL(fvc.size(), mset.size());
+    TEST_EQUAL(CountingTfFeature::clones, can_clone ? 2 : 0);
+
+    // If a Feature can't be cloned, the calling thread is used instead.
+    vector<string> terms(query.get_unique_terms_begin(),
+			 query.get_unique_terms_end());
+    RecordingFeature* recording_feature = new RecordingFeature(terms);
+    f.clear();
+    f.push_back(recording_feature);
+    Xapian::FeatureList recording_fl(f);
+    auto fvr = recording_fl.create_feature_vectors(mset, query, db, 2);
+    TEST_EQUAL(fvr.size(), mset.size());
+    TEST_EQUAL(recording_feature->recorded.size(), mset.size());
+}